@@ -0,0 +1,143 @@
+#ifndef SF2ML_BENCH_HARNESS_HPP_
+#define SF2ML_BENCH_HARNESS_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SF2ML::bench {
+	/// global operator new calls(and bytes) made so far, from every thread (see main.cpp)
+	extern std::atomic<std::uint64_t> heap_allocations;
+	extern std::atomic<std::uint64_t> heap_bytes;
+
+	/// What one iteration of a benchmark processes, for the throughput figures.
+	struct Work {
+		std::uint64_t bytes = 0;
+		std::uint64_t items = 0;
+	};
+
+	struct Result {
+		std::string name;
+		std::string bank;
+		std::uint64_t iterations = 0;
+		double ns_median = 0;
+		double ns_min = 0;
+		Work work;
+		double allocs_per_iter = 0;
+		double alloc_bytes_per_iter = 0;
+
+		double BytesPerSecond() const { return ns_median > 0 ? work.bytes * 1e9 / ns_median : 0; }
+		double ItemsPerSecond() const { return ns_median > 0 ? work.items * 1e9 / ns_median : 0; }
+	};
+
+	struct Options {
+		double min_time = 0.5;         // seconds spent on each benchmark (at least min_iterations are run)
+		std::uint64_t min_iterations = 2;
+		std::string filter;            // only benchmarks whose name contains it
+	};
+
+	/// Times `f` until both options.min_time and options.min_iterations are reached.
+	/// `setup` runs before every iteration, outside of the timed section and of the allocation counts.
+	template <typename Setup, typename F>
+	auto Run(const Options& options, std::string name, std::string bank, Work work, Setup&& setup, F&& f) -> Result {
+		using Clock = std::chrono::steady_clock;
+		Result result { std::move(name), std::move(bank) };
+		result.work = work;
+
+		std::vector<double> samples;
+		std::uint64_t allocs = 0;
+		std::uint64_t alloc_bytes = 0;
+		double total = 0;
+		while (total < options.min_time || samples.size() < options.min_iterations) {
+			setup();
+			const std::uint64_t allocs0 = heap_allocations.load(std::memory_order_relaxed);
+			const std::uint64_t bytes0 = heap_bytes.load(std::memory_order_relaxed);
+			const auto t0 = Clock::now();
+			f();
+			const auto t1 = Clock::now();
+			allocs += heap_allocations.load(std::memory_order_relaxed) - allocs0;
+			alloc_bytes += heap_bytes.load(std::memory_order_relaxed) - bytes0;
+
+			const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+			samples.push_back(ns);
+			total += ns * 1e-9;
+		}
+
+		result.iterations = samples.size();
+		std::sort(samples.begin(), samples.end());
+		result.ns_median = samples[samples.size() / 2];
+		result.ns_min = samples.front();
+		result.allocs_per_iter = static_cast<double>(allocs) / samples.size();
+		result.alloc_bytes_per_iter = static_cast<double>(alloc_bytes) / samples.size();
+		return result;
+	}
+
+	template <typename F>
+	auto Run(const Options& options, std::string name, std::string bank, Work work, F&& f) -> Result {
+		return Run(options, std::move(name), std::move(bank), work, [] {}, std::forward<F>(f));
+	}
+
+	/// one line per result, for humans
+	inline void PrintResult(std::FILE* out, const Result& r) {
+		std::fprintf(out, "%-34s %-36s %12.0f ns", r.name.c_str(), r.bank.c_str(), r.ns_median);
+		if (r.work.bytes) {
+			std::fprintf(out, " %10.1f MB/s", r.BytesPerSecond() / (1 << 20));
+		} else {
+			std::fprintf(out, " %15s", "");
+		}
+		if (r.work.items) {
+			std::fprintf(out, " %12.3g items/s", r.ItemsPerSecond());
+		} else {
+			std::fprintf(out, " %20s", "");
+		}
+		std::fprintf(out, " %10.1f allocs\n", r.allocs_per_iter);
+	}
+
+	inline void WriteJsonString(std::ostream& os, std::string_view s) {
+		os << '"';
+		for (char c : s) {
+			if (c == '"' || c == '\\') {
+				os << '\\' << c;
+			} else if (static_cast<unsigned char>(c) < 0x20) {
+				char buf[8];
+				std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+				os << buf;
+			} else {
+				os << c;
+			}
+		}
+		os << '"';
+	}
+
+	/// Writes the results as JSON, one benchmark per line and in a fixed key order,
+	/// so that the reports of two runs can be diffed.
+	inline void WriteJson(std::ostream& os, const std::vector<Result>& results) {
+		os << "{\n  \"benchmarks\": [\n";
+		for (std::size_t i = 0; i < results.size(); i++) {
+			const Result& r = results[i];
+			os << "    {\"name\": ";
+			WriteJsonString(os, r.name);
+			os << ", \"bank\": ";
+			WriteJsonString(os, r.bank);
+			os << ", \"iterations\": " << r.iterations
+			   << ", \"ns_median\": " << static_cast<std::uint64_t>(r.ns_median)
+			   << ", \"ns_min\": " << static_cast<std::uint64_t>(r.ns_min)
+			   << ", \"bytes\": " << r.work.bytes
+			   << ", \"items\": " << r.work.items
+			   << ", \"bytes_per_second\": " << static_cast<std::uint64_t>(r.BytesPerSecond())
+			   << ", \"items_per_second\": " << static_cast<std::uint64_t>(r.ItemsPerSecond())
+			   << ", \"allocs_per_iter\": " << r.allocs_per_iter
+			   << ", \"alloc_bytes_per_iter\": " << static_cast<std::uint64_t>(r.alloc_bytes_per_iter)
+			   << '}' << (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		os << "  ]\n}\n";
+	}
+}
+
+#endif
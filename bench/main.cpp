@@ -0,0 +1,448 @@
+// sf2ml_bench: timings, throughput and heap allocation counts of the main SF2ML operations
+// on synthetic banks (see sfsynth.hpp), reported as JSON that can be diffed between runs.
+//
+// usage: sf2ml_bench [--zones 100,10000,100000] [--bits 16,24] [--pcm-mb 10]
+//                    [--min-time 0.5] [--filter name] [--json report.json|-] [--work-dir dir]
+
+#include "harness.hpp"
+
+#include <SF2ML/sffrozen.hpp>
+#include <SF2ML/sfresidency.hpp>
+#include <SF2ML/sfsynth.hpp>
+#include <SF2ML/sfview.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+std::atomic<std::uint64_t> SF2ML::bench::heap_allocations { 0 };
+std::atomic<std::uint64_t> SF2ML::bench::heap_bytes { 0 };
+
+void* operator new(std::size_t size) {
+	SF2ML::bench::heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	SF2ML::bench::heap_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+// (std::pmr::new_delete_resource, the default resource of SoundFont, goes through the aligned versions)
+void* operator new(std::size_t size, std::align_val_t align) {
+	SF2ML::bench::heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	SF2ML::bench::heap_bytes.fetch_add(size, std::memory_order_relaxed);
+	const std::size_t alignment = std::max(static_cast<std::size_t>(align), sizeof(void*));
+	if (void* p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+using namespace SF2ML;
+using namespace SF2ML::bench;
+
+namespace {
+	struct Config {
+		std::vector<std::uint64_t> zones { 100, 10000, 100000 };
+		std::vector<std::uint64_t> bits { 16, 24 };
+		std::vector<std::uint64_t> pcm_mb { 10 };
+		Options options;
+		std::string json;
+		std::filesystem::path work_dir = ".";
+	};
+
+	std::vector<std::uint64_t> ParseList(const char* arg) {
+		std::vector<std::uint64_t> list;
+		for (const char* p = arg; *p; ) {
+			char* end = nullptr;
+			list.push_back(std::strtoull(p, &end, 10));
+			p = *end == ',' ? end + 1 : end + std::strlen(end);
+		}
+		return list;
+	}
+
+	bool ParseArgs(int argc, char** argv, Config& config) {
+		for (int i = 1; i < argc; i++) {
+			const std::string_view arg = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+			if (arg == "--help" || !value) {
+				return false;
+			}
+			if (arg == "--zones") {
+				config.zones = ParseList(value);
+			} else if (arg == "--bits") {
+				config.bits = ParseList(value);
+			} else if (arg == "--pcm-mb") {
+				config.pcm_mb = ParseList(value);
+			} else if (arg == "--min-time") {
+				config.options.min_time = std::strtod(value, nullptr);
+			} else if (arg == "--filter") {
+				config.options.filter = value;
+			} else if (arg == "--json") {
+				config.json = value;
+			} else if (arg == "--work-dir") {
+				config.work_dir = value;
+			} else {
+				return false;
+			}
+			i++;
+		}
+		return true;
+	}
+
+	class Suite {
+	public:
+		explicit Suite(const Config& config) : config{config} {}
+
+		bool Wants(std::string_view name) const {
+			return config.options.filter.empty() || name.find(config.options.filter) != std::string_view::npos;
+		}
+
+		template <typename... Args>
+		void Add(std::string_view name, Args&&... args) {
+			if (!Wants(name)) {
+				return;
+			}
+			results.push_back(Run(config.options, std::string(name), std::forward<Args>(args)...));
+			PrintResult(stderr, results.back());
+		}
+
+		auto Results() const -> const std::vector<Result>& { return results; }
+
+	private:
+		const Config& config;
+		std::vector<Result> results;
+	};
+
+	volatile std::int64_t sink;
+
+	auto SaveFile(SoundFont& sf2, const std::filesystem::path& path) -> SF2MLError {
+		std::ofstream ofs(path, std::ios::binary);
+		return sf2.Save(ofs);
+	}
+
+	auto LoadFile(SoundFont& sf2, const std::filesystem::path& path) -> SF2MLError {
+		std::ifstream ifs(path, std::ios::binary);
+		return sf2.Load(ifs);
+	}
+
+	auto PointSize(const SfSynthSpec& spec) -> std::uint32_t {
+		return spec.bit_depth == SampleBitDepth::Signed16 ? 2 : 3;
+	}
+
+	// label of the bank in the reports (ex: "10k zones, 24-bit, 10 MB")
+	auto Describe(const SfSynthSpec& spec) -> std::string {
+		const std::uint64_t zones = spec.InstrumentZones();
+		std::string label = zones >= 1000 && zones % 1000 == 0
+			? std::to_string(zones / 1000) + "k zones"
+			: std::to_string(zones) + " zones";
+		label += spec.bit_depth == SampleBitDepth::Signed16 ? ", 16-bit, " : ", 24-bit, ";
+		label += std::to_string((std::uint64_t(spec.samples) * spec.sample_points * PointSize(spec)) >> 20) + " MB";
+		if (spec.modulator_chain) {
+			label += ", " + std::to_string(spec.modulator_chain) + " mods/zone";
+		}
+		return label;
+	}
+
+	// banks of 100 zone instruments, with pcm_bytes of sample data held in memory
+	auto MakeSpec(std::uint64_t zones, SampleBitDepth bit_depth, std::uint64_t pcm_bytes) -> SfSynthSpec {
+		SfSynthSpec spec;
+		spec.zones_per_instrument = static_cast<std::uint32_t>(std::min<std::uint64_t>(zones, 100));
+		spec.instruments = static_cast<std::uint32_t>((zones + 99) / 100);
+		spec.bit_depth = bit_depth;
+		spec.sample_points = static_cast<std::uint32_t>(pcm_bytes / spec.samples / PointSize(spec));
+		spec.stream_samples = false;
+		return spec;
+	}
+
+	void BenchBank(Suite& suite, const Config& config, const SfSynthSpec& spec) {
+		SoundFont sf2;
+		if (auto err = BuildSynthBank(sf2, spec)) {
+			std::cerr << "failed to build the bank: " << ToStringView(err) << std::endl;
+			return;
+		}
+		const std::string bank = Describe(spec);
+		const std::filesystem::path path = config.work_dir / "sf2ml_bench.sf2";
+		const std::uint64_t zones = spec.InstrumentZones();
+		const std::uint64_t file_size = sf2.GetSavedSize();
+		const std::uint32_t inst_count = static_cast<std::uint32_t>(sf2.Instruments().size());
+		const std::uint32_t smpl_count = static_cast<std::uint32_t>(sf2.Samples().size());
+		std::uint64_t frames = 0;
+		for (const SfSample& smpl : sf2.Samples()) {
+			frames += smpl.GetSampleCount();
+		}
+
+		// a bank past the 16-bit indexes of the format cannot be saved(SF2ML_INDEX_OVERFLOW): only the
+		// in-memory benchmarks run on it
+		const bool fits_file = SynthFitsFileIndexes(spec);
+		if (!fits_file) {
+			std::cerr << "note: " << bank << " exceeds the 16-bit indexes of the format; Save and Load are skipped" << std::endl;
+		}
+
+		if (fits_file) {
+			suite.Add("Save", bank, Work{ file_size, zones }, [&] {
+				sink = SaveFile(sf2, path);
+			});
+		}
+
+		// the same bank, its sample points produced block by block while saving
+		if (fits_file && suite.Wants("Save (streamed samples)")) {
+			SfSynthSpec streamed_spec = spec;
+			streamed_spec.stream_samples = true;
+			SoundFont streamed;
+			if (auto err = BuildSynthBank(streamed, streamed_spec)) {
+				std::cerr << "failed to build the bank: " << ToStringView(err) << std::endl;
+				return;
+			}
+			suite.Add("Save (streamed samples)", bank, Work{ file_size, zones }, [&] {
+				sink = SaveFile(streamed, path);
+			});
+		}
+
+		if (fits_file && (suite.Wants("Load") || suite.Wants("Open view") || suite.Wants("Load (cached)")
+			|| suite.Wants("Sample reads (residency)"))) {
+			if (auto err = SaveFile(sf2, path)) {
+				std::cerr << "failed to save the bank: " << ToStringView(err) << std::endl;
+				return;
+			}
+			if (suite.Wants("Load")) {
+				SoundFont loaded;
+				suite.Add("Load", bank, Work{ file_size, zones }, [&] {
+					sink = LoadFile(loaded, path);
+				});
+				if (loaded.Samples().size() != smpl_count || loaded.Instruments().size() != inst_count) {
+					std::cerr << "warning: the loaded bank does not match the saved one" << std::endl;
+				}
+			}
+			// mapping the file and locating its chunks: independent of the bank size
+			SoundFontView view;
+			suite.Add("Open view", bank, Work{ file_size, zones }, [&] {
+				sink = view.Open(path);
+			});
+			if (view.IsOpen() && (view.SampleCount() != smpl_count || view.InstrumentCount() != inst_count)) {
+				std::cerr << "warning: the view does not match the saved bank" << std::endl;
+			}
+			// a warm start: the key of the file, then the cache mapped back
+			const std::filesystem::path cache_path = config.work_dir / "sf2ml_bench.sf2ml-cache";
+			if (auto [frozen, err] = FrozenSoundFont::LoadCached(path, cache_path); err) {
+				std::cerr << "failed to build the cache: " << ToStringView(err) << std::endl;
+				return;
+			}
+			suite.Add("Load (cached)", bank, Work{ file_size, zones }, [&] {
+				sink = FrozenSoundFont::LoadCached(path, cache_path).value.SampleCount();
+			});
+
+			// every sample read in turn with room for a quarter of them: each one is read back from the file
+			if (suite.Wants("Sample reads (residency)")) {
+				SoundFont managed;
+				if (auto err = LoadFile(managed, path)) {
+					std::cerr << "failed to load the bank: " << ToStringView(err) << std::endl;
+					return;
+				}
+				const std::uint64_t pcm_bytes = frames * PointSize(spec);
+				SfResidencyManager residency(pcm_bytes / 4, config.work_dir);
+				if (auto err = residency.Manage(managed, path)) {
+					std::cerr << "failed to manage the bank: " << ToStringView(err) << std::endl;
+					return;
+				}
+				suite.Add("Sample reads (residency)", bank, Work{ pcm_bytes, smpl_count }, [&] {
+					std::int64_t sum = 0;
+					for (const SfSample& smpl : managed.Samples()) {
+						sum += smpl.GetWav().size();
+					}
+					sink = sum;
+				});
+			}
+		}
+
+		// CalculateRiffSize through the size cache: one edit, then every instrument edited
+		auto& edited = sf2.GetInstrument(sf2.Instruments().front().GetHandle()).GetGlobalZone();
+		std::int16_t pan = 0;
+		suite.Add("GetSavedSize after an edit", bank, Work{ 0, 1 }, [&] {
+			edited.SetPan(pan++ % 500);
+			sink = sf2.GetSavedSize();
+		});
+		const auto inst_handles = sf2.AllInstruments();
+		suite.Add("GetSavedSize after a full edit", bank, Work{ 0, inst_count },
+			[&] {
+				for (InstHandle handle : inst_handles) {
+					sf2.GetInstrument(handle).GetGlobalZone().SetPan(pan++ % 500);
+				}
+			},
+			[&] {
+				sink = sf2.GetSavedSize();
+			});
+
+		// lookups in a shuffled order
+		std::mt19937 rng(static_cast<std::mt19937::result_type>(spec.seed));
+		auto shuffled_insts = inst_handles;
+		std::shuffle(shuffled_insts.begin(), shuffled_insts.end(), rng);
+		auto shuffled_smpls = sf2.AllSamples();
+		std::shuffle(shuffled_smpls.begin(), shuffled_smpls.end(), rng);
+		suite.Add("Handle lookup", bank, Work{ 0, shuffled_insts.size() + shuffled_smpls.size() }, [&] {
+			std::int64_t sum = 0;
+			for (InstHandle handle : shuffled_insts) {
+				sum += sf2.GetInstrument(handle).CountZones();
+			}
+			for (SmplHandle handle : shuffled_smpls) {
+				sum += sf2.GetSample(handle).GetRootKey();
+			}
+			sink = sum;
+		});
+
+		std::vector<std::string> names;
+		for (InstHandle handle : shuffled_insts) {
+			names.push_back(sf2.GetInstrument(handle).GetName());
+		}
+		suite.Add("FindInstrumentByName", bank, Work{ 0, names.size() }, [&] {
+			std::int64_t sum = 0;
+			for (const std::string& name : names) {
+				sum += sf2.FindInstrumentByName(name).has_value();
+			}
+			sink = sum;
+		});
+
+		suite.Add("FindSamples", bank, Work{ 0, smpl_count }, [&] {
+			sink = static_cast<std::int64_t>(sf2.FindSamples([](const SfSample& smpl) {
+				return smpl.GetRootKey() == 60;
+			}).size());
+		});
+
+		const std::uint64_t queries = sf2.Presets().size() * 128;
+		suite.Add("FindNoteZones", bank, Work{ 0, queries }, [&] {
+			SfNoteZone found[64];
+			std::int64_t sum = 0;
+			for (const SfPreset& preset : sf2.Presets()) {
+				for (std::uint8_t key = 0; key < 128; key++) {
+					sum += sf2.FindNoteZones(preset.GetBankNumber(), preset.GetPresetNumber(), key, 100, found);
+				}
+			}
+			sink = sum;
+		});
+
+		suite.Add("Zone iteration", bank, Work{ 0, zones }, [&] {
+			std::int64_t sum = 0;
+			for (const SfInstrument& inst : sf2.Instruments()) {
+				inst.ForEachZone([&](const SfInstrumentZone& zone) {
+					sum += zone.GetInitialAttenuation();
+				});
+			}
+			sink = sum;
+		});
+
+		// the same queries on an immutable snapshot
+		suite.Add("Freeze", bank, Work{ 0, zones }, [&] {
+			sink = static_cast<std::int64_t>(sf2.Freeze().PresetCount());
+		});
+		const FrozenSoundFont frozen = sf2.Freeze();
+		suite.Add("FindNoteZones (frozen)", bank, Work{ 0, queries }, [&] {
+			SfFrozenNoteZone found[64];
+			std::int64_t sum = 0;
+			for (std::size_t p = 0; p < frozen.PresetCount(); p++) {
+				for (std::uint8_t key = 0; key < 128; key++) {
+					sum += frozen.FindNoteZones(frozen.PresetBanks()[p], frozen.PresetPrograms()[p], key, 100, found);
+				}
+			}
+			sink = sum;
+		});
+		suite.Add("Zone iteration (frozen)", bank, Work{ 0, zones }, [&] {
+			const SfFrozenZones inst_zones = frozen.InstrumentZones();
+			std::int64_t sum = 0;
+			for (std::size_t z = 0; z < inst_zones.Size(); z++) {
+				for (const SfGenEntry& gen : inst_zones.Generators(z)) {
+					if (gen.type == SfGenInitialAttenuation) {
+						sum += static_cast<std::int16_t>(gen.raw);
+					}
+				}
+			}
+			sink = sum;
+		});
+
+		suite.Add("Sample decode", bank, Work{ frames * PointSize(spec), frames }, [&] {
+			std::int64_t sum = 0;
+			for (const SfSample& smpl : sf2.Samples()) {
+				const auto count = static_cast<std::uint32_t>(smpl.GetSampleCount());
+				for (std::uint32_t i = 0; i < count; i++) {
+					sum += smpl.GetSampleAt(i);
+				}
+			}
+			sink = sum;
+		});
+
+		// the same zones with chains of linked modulators (and little sample data), loaded back
+		SfSynthSpec mod_spec = spec;
+		mod_spec.sample_points = static_cast<std::uint32_t>((1u << 20) / spec.samples / PointSize(spec));
+		mod_spec.modulator_chain = static_cast<std::uint32_t>(std::min<std::uint64_t>(8, 0xFFFE / zones));
+		if (mod_spec.modulator_chain >= 2 && SynthFitsFileIndexes(mod_spec) && suite.Wants("Load (modulator validation)")) {
+			SoundFont mod_bank;
+			if (auto err = BuildSynthBank(mod_bank, mod_spec)) {
+				std::cerr << "failed to build the bank: " << ToStringView(err) << std::endl;
+				return;
+			}
+			const std::filesystem::path mod_path = config.work_dir / "sf2ml_bench_mod.sf2";
+			if (auto err = SaveFile(mod_bank, mod_path)) {
+				std::cerr << "failed to save the bank: " << ToStringView(err) << std::endl;
+				return;
+			}
+			SoundFont loaded;
+			suite.Add("Load (modulator validation)", Describe(mod_spec),
+					  Work{ mod_bank.GetSavedSize(), zones * mod_spec.modulator_chain },
+					  [&] {
+						  sink = LoadFile(loaded, mod_path);
+					  });
+			std::filesystem::remove(mod_path);
+		}
+		std::filesystem::remove(path);
+	}
+}
+
+int main(int argc, char** argv) {
+	Config config;
+	if (!ParseArgs(argc, argv, config)) {
+		std::cerr << "usage: " << argv[0]
+				  << " [--zones 100,10000,100000] [--bits 16,24] [--pcm-mb 10]"
+					 " [--min-time 0.5] [--filter name] [--json report.json|-] [--work-dir dir]" << std::endl;
+		return 1;
+	}
+
+	Suite suite(config);
+	for (std::uint64_t zones : config.zones) {
+		for (std::uint64_t bits : config.bits) {
+			for (std::uint64_t mb : config.pcm_mb) {
+				const auto bit_depth = bits == 24 ? SampleBitDepth::Signed24 : SampleBitDepth::Signed16;
+				BenchBank(suite, config, MakeSpec(zones, bit_depth, mb << 20));
+			}
+		}
+	}
+
+	if (config.json == "-") {
+		WriteJson(std::cout, suite.Results());
+	} else if (!config.json.empty()) {
+		std::ofstream ofs(config.json);
+		WriteJson(ofs, suite.Results());
+	}
+	return 0;
+}
@@ -3,12 +3,30 @@
 // #include <catch2/matchers/catch_matchers_predicate.hpp>
 // #include <catch2/matchers/catch_matchers_contains.hpp>
 #include <catch2/matchers/catch_matchers_all.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <SF2ML/sf2ml.hpp>
+#include <SF2ML/sffrozen.hpp>
+#include <SF2ML/sfresidency.hpp>
+#include <SF2ML/sfsynth.hpp>
+#include <SF2ML/sftrace.hpp>
+#include <SF2ML/sfview.hpp>
 
 #include <vector>
 #include <string>
 #include <optional>
 #include <type_traits>
+#include <memory_resource>
+#include <array>
+#include <ranges>
+#include <functional>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <atomic>
 
 std::string src_dir = "../sf2src/";
 
@@ -327,4 +345,1495 @@ TEST_CASE("Load from file #2", "[loader][inst][preset]") {
     }
 
     
-}
\ No newline at end of file
+}
+
+namespace {
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        std::size_t allocations = 0;
+        std::size_t outstanding = 0;
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            ++allocations;
+            outstanding += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+            outstanding -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    // allocation trap for real-time sections: counts every global operator new call on this thread,
+    // and every allocation from the default memory resource and the SoundFont's own resource
+    thread_local bool rt_section = false;
+    thread_local std::size_t rt_heap_allocations = 0;
+
+    class RtSection {
+    public:
+        explicit RtSection(const CountingResource& sf2_resource)
+            : sf2_resource{sf2_resource}, sf2_allocations{sf2_resource.allocations} {
+            prev_default = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+            rt_heap_allocations = 0;
+            rt_section = true;
+        }
+        // @return number of allocations made in the section
+        std::size_t End() {
+            rt_section = false;
+            std::pmr::set_default_resource(prev_default);
+            return rt_heap_allocations + (sf2_resource.allocations - sf2_allocations);
+        }
+    private:
+        const CountingResource& sf2_resource;
+        std::size_t sf2_allocations;
+        std::pmr::memory_resource* prev_default;
+    };
+}
+
+void* operator new(std::size_t size) {
+    if (rt_section) {
+        ++rt_heap_allocations;
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+TEST_CASE("Load & Save with a custom memory resource", "[loader][memory]") {
+    CountingResource counting;
+    {
+        SF2ML::SoundFont sf2(&counting);
+        CHECK(sf2.GetMemoryResource() == &counting);
+
+        // nothing may silently fall back to the default resource
+        std::pmr::memory_resource* prev_default = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+        std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+        SF2ML::SF2MLError load_err = sf2.Load(sf2_ifs);
+        std::ofstream sf2_ofs("SF2ML_TEST1_pmr.sf2", std::ios::binary);
+        SF2ML::SF2MLError save_err = sf2.Save(sf2_ofs);
+        std::pmr::set_default_resource(prev_default);
+
+        REQUIRE(load_err == SF2ML::SF2ML_SUCCESS);
+        REQUIRE(save_err == SF2ML::SF2ML_SUCCESS);
+        CHECK(counting.allocations > 0);
+        CHECK(sf2.AllSamples().size() == 9);
+    }
+    CHECK(counting.outstanding == 0);
+}
+
+TEST_CASE("Modulators round trip", "[modulator][serializer]") {
+    SF2ML::SoundFont sf2;
+    sf2.Info().SetBankName("Mod Test Bank").SetSoundEngine("EMU8000");
+    auto ih = sf2.NewInstrument("Mod Inst").GetHandle();
+    auto& zone = sf2.GetInstrument(ih).GetGlobalZone();
+    auto m1h = zone.NewModulator()
+        .SetSource(SF2ML::GeneralController::Link, 0, 0, SF2ML::SfModSourceType::Linear)
+        .SetAmtSource(SF2ML::MidiController(4), 1, 0, SF2ML::SfModSourceType::Convex)
+        .SetDestination(SF2ML::SfGenInitialFilterFc)
+        .SetModAmount(-120)
+        .GetHandle();
+    zone.NewModulator()
+        .SetSource(SF2ML::GeneralController::NoteOnVelocity, 0, 1, SF2ML::SfModSourceType::Concave)
+        .SetAmtSource(SF2ML::MidiController(2), 0, 0, SF2ML::SfModSourceType::Linear)
+        .SetDestination(m1h)
+        .SetTransform(SF2ML::SfModAbsoluteValueTransform)
+        .SetModAmount(7);
+
+    auto mods = zone.Modulators();
+    REQUIRE(mods.size() == 2);
+    CHECK(std::holds_alternative<SF2ML::ModHandle>(mods[1].GetDestination()));
+
+    {
+        std::ofstream ofs("SF2ML_mod_roundtrip.sf2", std::ios::binary);
+        REQUIRE(sf2.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+    }
+    SF2ML::SoundFont loaded;
+    std::ifstream ifs("SF2ML_mod_roundtrip.sf2", std::ios::binary);
+    REQUIRE(loaded.Load(ifs) == SF2ML::SF2ML_SUCCESS);
+
+    auto insts = loaded.AllInstruments();
+    REQUIRE(insts.size() == 1);
+    auto loaded_mods = loaded.GetInstrument(insts[0]).GetGlobalZone().Modulators();
+    REQUIRE(loaded_mods.size() == 2);
+    for (std::size_t i = 0; i < 2; i++) {
+        CHECK(loaded_mods[i].GetSourceBits()    == mods[i].GetSourceBits());
+        CHECK(loaded_mods[i].GetAmtSourceBits() == mods[i].GetAmtSourceBits());
+        CHECK(loaded_mods[i].GetModAmount()     == mods[i].GetModAmount());
+        CHECK(loaded_mods[i].GetTransform()     == mods[i].GetTransform());
+    }
+    CHECK(loaded_mods[1].GetDestination() == std::variant<SF2ML::SFGenerator, SF2ML::ModHandle>(loaded_mods[0].GetHandle()));
+}
+
+TEST_CASE("24-bit samples round trip", "[loader][serializer][sample]") {
+    // mono 24-bit PCM .wav: 4 frames after the 44 byte header
+    const std::uint8_t frames[] = { 0x01, 0x02, 0x03, 0xFF, 0xFE, 0xFD, 0x10, 0x20, 0x30, 0xAA, 0xBB, 0xCC };
+    std::vector<std::uint8_t> wav = {
+        'R', 'I', 'F', 'F', 36 + sizeof(frames), 0, 0, 0, 'W', 'A', 'V', 'E',
+        'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0, 0x44, 0xAC, 0, 0, 0xCC, 0x04, 0x02, 0, 3, 0, 24, 0,
+        'd', 'a', 't', 'a', sizeof(frames), 0, 0, 0,
+    };
+    wav.insert(wav.end(), std::begin(frames), std::end(frames));
+
+    SF2ML::SoundFont sf2;
+    for (int i = 0; i < 2; i++) { // the second one starts past the first one in smpl/sm24
+        auto [handle, err] = sf2.AddMonoSample(wav.data(), wav.size(), "Smpl24 " + std::to_string(i));
+        REQUIRE(err == SF2ML::SF2ML_SUCCESS);
+    }
+    {
+        std::ofstream ofs("SF2ML_24bit.sf2", std::ios::binary);
+        REQUIRE(sf2.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+    }
+    SF2ML::SoundFont loaded;
+    std::ifstream ifs("SF2ML_24bit.sf2", std::ios::binary);
+    REQUIRE(loaded.Load(ifs) == SF2ML::SF2ML_SUCCESS);
+    REQUIRE(loaded.Samples().size() == 2);
+    for (const auto& smpl : loaded.Samples()) {
+        CHECK(smpl.GetBitDepth() == SF2ML::SampleBitDepth::Signed24);
+        auto data = smpl.GetWav();
+        CHECK(std::vector<std::uint8_t>(data.begin(), data.end()) == std::vector<std::uint8_t>(std::begin(frames), std::end(frames)));
+    }
+}
+
+TEST_CASE("Synthetic banks with streamed samples", "[serializer][sample]") {
+    SF2ML::SfSynthSpec spec;
+    spec.instruments = 3;
+    spec.zones_per_instrument = 4;
+    spec.modulator_chain = 3;
+    spec.presets = 5;
+    spec.samples = 2;
+    spec.sample_points = 1000;
+    spec.bit_depth = SF2ML::SampleBitDepth::Signed24;
+    spec.stereo = true;
+
+    auto save = [](const SF2ML::SfSynthSpec& spec, const char* path) {
+        SF2ML::SoundFont sf2;
+        REQUIRE(SF2ML::BuildSynthBank(sf2, spec) == SF2ML::SF2ML_SUCCESS);
+        {
+            std::ofstream ofs(path, std::ios::binary);
+            REQUIRE(sf2.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+        }
+        std::ifstream ifs(path, std::ios::binary);
+        std::vector<char> bytes { std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>() };
+        CHECK(bytes.size() == sf2.GetSavedSize());
+        return bytes;
+    };
+
+    // points produced while saving give the same file as points held in memory, on every build
+    const auto streamed = save(spec, "SF2ML_synth_a.sf2");
+    CHECK(save(spec, "SF2ML_synth_b.sf2") == streamed);
+    spec.stream_samples = false;
+    CHECK(save(spec, "SF2ML_synth_b.sf2") == streamed);
+
+    SF2ML::SoundFont built;
+    REQUIRE(SF2ML::BuildSynthBank(built, spec) == SF2ML::SF2ML_SUCCESS);
+    SF2ML::SoundFont loaded;
+    std::ifstream ifs("SF2ML_synth_a.sf2", std::ios::binary);
+    REQUIRE(loaded.Load(ifs) == SF2ML::SF2ML_SUCCESS);
+    CHECK(loaded.Presets().size() == 5);
+    CHECK(loaded.Instruments().size() == 3);
+    REQUIRE(loaded.Samples().size() == 4);
+    CHECK(loaded.Samples()[0].GetLink() == loaded.Samples()[1].GetHandle());
+    for (std::size_t i = 0; i < loaded.Samples().size(); i++) {
+        const auto data = loaded.Samples()[i].GetWav();
+        const auto expected = built.Samples()[i].GetWav();
+        CHECK(std::vector<std::uint8_t>(data.begin(), data.end()) == std::vector<std::uint8_t>(expected.begin(), expected.end()));
+    }
+    for (const auto& inst : loaded.Instruments()) {
+        std::size_t mods = 0;
+        for (const auto& zone : inst.Zones()) {
+            mods += zone.ModulatorCount();
+        }
+        CHECK(mods == 4 * 3);
+    }
+
+    auto max_spec = SF2ML::MaximizeSynthIndexes(spec);
+    CHECK(SF2ML::SynthFitsFileIndexes(max_spec));
+    CHECK(SF2ML::CountSynthRecords(max_spec).inst_gens > 0xFF00);
+    max_spec.instruments++;
+    CHECK_FALSE(SF2ML::SynthFitsFileIndexes(max_spec));
+
+    // a bank past the 16-bit indexes is refused instead of being written with wrapped indexes
+    max_spec.samples = 2;
+    max_spec.sample_points = 64;
+    SF2ML::SoundFont overflowed;
+    REQUIRE(SF2ML::BuildSynthBank(overflowed, max_spec) == SF2ML::SF2ML_SUCCESS);
+    {
+        std::ofstream ofs("SF2ML_overflow.sf2", std::ios::binary);
+        CHECK(overflowed.Save(ofs) == SF2ML::SF2ML_INDEX_OVERFLOW);
+    }
+    std::ifstream overflowed_ifs("SF2ML_overflow.sf2", std::ios::binary | std::ios::ate);
+    CHECK(overflowed_ifs.tellg() == 0);
+}
+
+TEST_CASE("Sparse generator storage", "[generator]") {
+    SF2ML::SoundFont sf2;
+    auto& zone = sf2.NewInstrument("Gen Inst").NewZone();
+    zone.SetPan(-250)
+        .SetKeyRange(SF2ML::Ranges<std::uint8_t>{ 36, 72 })
+        .SetSampleModes(SF2ML::LoopMode::LoopWithRemainder)
+        .SetCoarseTune(-12);
+
+    CHECK(zone.GeneratorCount() == 4);
+    CHECK(zone.HasGenerator(SF2ML::SfGenPan));
+    CHECK_FALSE(zone.HasGenerator(SF2ML::SfGenFineTune));
+    CHECK(zone.GetPan() == -250);
+    CHECK(zone.GetCoarseTune() == -12);
+    CHECK(zone.GetKeyRange().start == 36);
+    CHECK(zone.GetKeyRange().end == 72);
+    CHECK(zone.GetSampleModes() == SF2ML::LoopMode::LoopWithRemainder);
+    CHECK(std::get<SF2ML::SHORT>(zone.GetGenerator(SF2ML::SfGenPan)) == -250);
+
+    auto gens = zone.Generators();
+    REQUIRE(gens.size() == 4);
+    for (std::size_t i = 1; i < gens.size(); i++) {
+        CHECK(gens[i - 1].type < gens[i].type);
+    }
+
+    zone.SetPan(std::nullopt).SetCoarseTune(24);
+    CHECK(zone.GeneratorCount() == 3);
+    CHECK_FALSE(zone.HasGenerator(SF2ML::SfGenPan));
+    CHECK(zone.GetPan() == 0);
+    CHECK(zone.GetCoarseTune() == 24);
+}
+
+TEST_CASE("Generator traits", "[generator]") {
+    using SF2ML::GetGenTraits;
+    static_assert(GetGenTraits(SF2ML::SfGenInitialFilterFc).default_value == 13500);
+    static_assert(SF2ML::GetGenValueType(SF2ML::SfGenKeyRange) == SF2ML::SfGenValueType::Range);
+    static_assert(SF2ML::ClampGenAmount(SF2ML::SfGenPan, 900) == 500);
+    CHECK(GetGenTraits(SF2ML::SfGenSampleID).instrument_only);
+    CHECK_FALSE(GetGenTraits(SF2ML::SfGenKeyRange).additive);
+    CHECK(GetGenTraits(SF2ML::SfGenCoarseTune).additive);
+
+    SF2ML::SoundFont sf2;
+    auto& zone = sf2.NewInstrument("Traits Inst").NewZone();
+    // setters clamp into the legal range, raw amounts are kept as is
+    zone.SetPan(-900).SetDelayVolEnv(100.0);
+    CHECK(zone.GetPan() == -500);
+    CHECK(std::get<SF2ML::SHORT>(zone.GetGenerator(SF2ML::SfGenDelayVolEnv)) == 5000);
+    zone.SetGenerator(SF2ML::SfGenInitialAttenuation, std::int16_t(2000))
+        .SetGenerator(SF2ML::SfGenFineTune, std::int16_t(-50));
+    CHECK(zone.GetInitialAttenuation() == 1440);
+    CHECK(std::get<SF2ML::SHORT>(zone.GetGenerator(SF2ML::SfGenInitialAttenuation)) == 2000);
+    CHECK(SF2ML::CountGenAmountsOutOfRange(zone.Generators()) == 1);
+    CHECK(zone.GetScaleTuning() == 100);
+
+    // preset amounts are offsets and are not clamped to the instrument range
+    auto& pzone = sf2.NewPreset(0, 0, "Traits Preset").NewZone();
+    pzone.SetInitialAttenuation(-200);
+    CHECK(pzone.GetInitialAttenuation() == -200);
+}
+
+TEST_CASE("Name and program indexes", "[lookup]") {
+    SF2ML::SoundFont sf2;
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+
+    // loaded objects are indexed
+    for (auto sh : sf2.AllSamples()) {
+        CHECK(sf2.FindSampleByName(sf2.GetSample(sh).GetName()) == sf2.FindSample(
+            [&](const SF2ML::SfSample& x) { return x.GetName() == sf2.GetSample(sh).GetName(); }));
+    }
+    for (auto ph : sf2.AllPresets()) {
+        auto& preset = sf2.GetPreset(ph);
+        CHECK(sf2.FindPresetByName(preset.GetName()) == ph);
+        CHECK(sf2.FindPreset(preset.GetBankNumber(), preset.GetPresetNumber()) == ph);
+    }
+    CHECK_FALSE(sf2.FindSampleByName("no such sample"));
+
+    // renaming
+    auto sh = sf2.AllSamples().front();
+    std::string old_name = sf2.GetSample(sh).GetName();
+    sf2.GetSample(sh).SetName("Renamed");
+    CHECK(sf2.FindSampleByName("Renamed") == sh);
+    CHECK(sf2.GetSample(sh).GetName() == "Renamed");
+    CHECK(sf2.FindSampleByName(old_name) != sh);
+    sf2.RemoveSample(sh);
+    CHECK_FALSE(sf2.FindSampleByName("Renamed"));
+
+    // names are truncated to 20 characters
+    auto ih = sf2.NewInstrument("A Very Long Instrument Name").GetHandle();
+    CHECK(sf2.FindInstrumentByName("A Very Long Instrument Name") == ih);
+    CHECK(sf2.FindInstrumentByName("A Very Long Instrume") == ih);
+    sf2.GetInstrument(ih).SetName("Short");
+    CHECK_FALSE(sf2.FindInstrumentByName("A Very Long Instrume"));
+    CHECK(sf2.FindInstrumentByName("Short") == ih);
+    sf2.RemoveInstrument(ih);
+    CHECK_FALSE(sf2.FindInstrumentByName("Short"));
+
+    // (bank, program); duplicates resolve to the first created preset
+    auto p1 = sf2.NewPreset(42, 7, "Dup 1").GetHandle();
+    auto p2 = sf2.NewPreset(42, 7, "Dup 2").GetHandle();
+    CHECK(sf2.FindPreset(7, 42) == p1);
+    sf2.GetPreset(p1).SetBankNumber(8);
+    CHECK(sf2.FindPreset(7, 42) == p2);
+    CHECK(sf2.FindPreset(8, 42) == p1);
+    sf2.RemovePreset(p2);
+    CHECK_FALSE(sf2.FindPreset(7, 42));
+    CHECK(sf2.FindPresetByName("Dup 1") == p1);
+    CHECK_FALSE(sf2.FindPresetByName("Dup 2"));
+
+    // out of range programs do not alias onto valid ones, as in a frozen snapshot
+    auto p3 = sf2.NewPreset(72, 0, "Program 72").GetHandle();
+    CHECK(sf2.FindPreset(0, 72) == p3);
+    CHECK_FALSE(sf2.FindPreset(0, 200));
+    CHECK_FALSE(sf2.Freeze().FindPreset(0, 200));
+}
+
+TEST_CASE("Template and range queries", "[lookup]") {
+    SF2ML::SoundFont sf2;
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+
+    // lambdas pick the template overloads, std::function objects the type-erased ones
+    auto has_loop = [](const SF2ML::SfSample& x) { return x.GetLoop().second > x.GetLoop().first; };
+    std::function<bool(const SF2ML::SfSample&)> has_loop_fn = has_loop;
+    CHECK(sf2.FindSample(has_loop) == sf2.FindSample(has_loop_fn));
+
+    // lazy queries over the views
+    auto looped = sf2.Samples() | std::views::filter(has_loop)
+                                | std::views::transform([](const SF2ML::SfSample& x) { return x.GetHandle(); });
+    std::vector<SF2ML::SmplHandle> lazy(looped.begin(), looped.end());
+    CHECK(lazy == sf2.FindSamples(has_loop_fn));
+    CHECK(sf2.Samples().size() == sf2.AllSamples().size());
+    CHECK(sf2.Instruments().size() == sf2.AllInstruments().size());
+    CHECK(sf2.Presets().size() == sf2.AllPresets().size());
+
+    for (auto ih : sf2.AllInstruments()) {
+        auto& inst = sf2.GetInstrument(ih);
+        std::vector<SF2ML::IZoneHandle> visited;
+        inst.ForEachZone([&](const SF2ML::SfInstrumentZone& zone) { visited.push_back(zone.GetHandle()); });
+        CHECK(visited == inst.AllZoneHandles());
+
+        auto with_sample = [](const SF2ML::SfInstrumentZone& zone) { return zone.HasGenerator(SF2ML::SfGenSampleID); };
+        CHECK(inst.FindZone(with_sample) == inst.FindZone(std::function<bool(const SF2ML::SfInstrumentZone&)>(with_sample)));
+
+        for (const auto& zone : inst.Zones()) {
+            std::size_t mods = 0;
+            zone.ForEachModulators([&](const SF2ML::SfModulator&) { mods++; });
+            CHECK(mods == zone.ModulatorCount());
+            CHECK(zone.FindModulator([](const SF2ML::SfModulator&) { return true; }).has_value() == (mods > 0));
+        }
+    }
+}
+
+TEST_CASE("Batch removal", "[remove]") {
+    SF2ML::SoundFont sf2;
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+
+    auto all_samples = sf2.AllSamples();
+    std::vector<SF2ML::SmplHandle> doomed, kept;
+    for (std::size_t i = 0; i < all_samples.size(); i++) {
+        (i % 2 ? doomed : kept).push_back(all_samples[i]);
+    }
+    std::vector<std::string> kept_names;
+    for (auto sh : kept) {
+        kept_names.push_back(sf2.GetSample(sh).GetName());
+    }
+    doomed.push_back(doomed.front());          // duplicates
+    doomed.push_back(SF2ML::SmplHandle(9999)); // and unknown handles are ignored
+
+    sf2.RemoveSamples(doomed);
+    REQUIRE(sf2.AllSamples() == kept);
+    for (std::size_t i = 0; i < kept.size(); i++) {
+        CHECK(sf2.GetSample(kept[i]).GetName() == kept_names[i]);
+        CHECK(sf2.FindSampleByName(kept_names[i]) == kept[i]);
+        if (auto link = sf2.GetSample(kept[i]).GetLink()) {
+            CHECK(std::find(kept.begin(), kept.end(), *link) != kept.end());
+        }
+    }
+
+    // zones
+    const auto& busiest = *std::max_element(sf2.Instruments().begin(), sf2.Instruments().end(),
+        [](const SF2ML::SfInstrument& x, const SF2ML::SfInstrument& y) { return x.Zones().size() < y.Zones().size(); });
+    auto& inst = sf2.GetInstrument(busiest.GetHandle());
+    auto zones = inst.AllZoneHandles();
+    REQUIRE(zones.size() > 2);
+    std::vector<SF2ML::IZoneHandle> doomed_zones(zones.begin() + 1, zones.end() - 1);
+    inst.RemoveZones(doomed_zones);
+    CHECK(inst.AllZoneHandles() == std::vector<SF2ML::IZoneHandle>{ zones.front(), zones.back() });
+
+    // presets, instruments
+    auto presets = sf2.AllPresets();
+    auto bank = sf2.GetPreset(presets.front()).GetBankNumber();
+    auto program = sf2.GetPreset(presets.front()).GetPresetNumber();
+    sf2.RemovePresets(presets);
+    CHECK(sf2.AllPresets().empty());
+    CHECK_FALSE(sf2.FindPreset(bank, program));
+    auto insts = sf2.AllInstruments();
+    std::vector<SF2ML::InstHandle> first_inst { insts.front() };
+    sf2.RemoveInstruments(first_inst);
+    CHECK(sf2.AllInstruments() == std::vector<SF2ML::InstHandle>(insts.begin() + 1, insts.end()));
+}
+
+TEST_CASE("Reverse references", "[remove][reference]") {
+    SF2ML::SoundFont sf2;
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+
+    // counts match a scan of all zones
+    for (auto sh : sf2.AllSamples()) {
+        std::uint32_t scanned = 0;
+        for (const auto& inst : sf2.Instruments()) {
+            for (const auto& zone : inst.Zones()) {
+                scanned += zone.GetSample() == sh;
+            }
+        }
+        CHECK(sf2.CountSampleUsers(sh) == scanned);
+        CHECK(sf2.FindSampleUsers(sh).size() == scanned);
+    }
+    for (auto ih : sf2.AllInstruments()) {
+        std::uint32_t scanned = 0;
+        for (const auto& preset : sf2.Presets()) {
+            for (const auto& zone : preset.Zones()) {
+                scanned += zone.GetInstrument() == ih;
+            }
+        }
+        CHECK(sf2.CountInstrumentUsers(ih) == scanned);
+    }
+
+    // edits move the reference
+    auto samples = sf2.AllSamples();
+    auto used = std::find_if(samples.begin(), samples.end(), [&](auto sh) { return sf2.CountSampleUsers(sh) > 0; });
+    REQUIRE(used != samples.end());
+    auto [ih, zh] = sf2.FindSampleUsers(*used).front();
+    auto used_count = sf2.CountSampleUsers(*used);
+    auto spare = sf2.NewInstrument("Spare").GetHandle();
+    auto spare_zone = sf2.GetInstrument(spare).NewZone().SetSample(*used).GetHandle();
+    CHECK(sf2.CountSampleUsers(*used) == used_count + 1);
+    sf2.GetInstrument(spare).RemoveZone(spare_zone);
+    CHECK(sf2.CountSampleUsers(*used) == used_count);
+
+    // rejecting or cascading the removal of a used sample
+    CHECK(sf2.RemoveSample(*used, SF2ML::RemovalMode::Normal, SF2ML::ReferenceMode::Reject) == SF2ML::SF2ML_STILL_REFERENCED);
+    CHECK(sf2.GetSample(*used).GetHandle() == *used);
+    CHECK(sf2.RemoveSample(*used, SF2ML::RemovalMode::Normal, SF2ML::ReferenceMode::Cascade) == SF2ML::SF2ML_SUCCESS);
+    CHECK(sf2.CountSampleUsers(*used) == 0);
+    auto zones = sf2.GetInstrument(ih).AllZoneHandles();
+    CHECK(std::find(zones.begin(), zones.end(), zh) == zones.end());
+
+    // instruments
+    auto insts = sf2.AllInstruments();
+    auto used_inst = std::find_if(insts.begin(), insts.end(), [&](auto ih) { return sf2.CountInstrumentUsers(ih) > 0; });
+    REQUIRE(used_inst != insts.end());
+    CHECK(sf2.RemoveInstrument(*used_inst, SF2ML::ReferenceMode::Reject) == SF2ML::SF2ML_STILL_REFERENCED);
+    auto users = sf2.FindInstrumentUsers(*used_inst);
+    CHECK(sf2.RemoveInstrument(*used_inst, SF2ML::ReferenceMode::Cascade) == SF2ML::SF2ML_SUCCESS);
+    CHECK(sf2.CountInstrumentUsers(*used_inst) == 0);
+    for (auto [ph, pzh] : users) {
+        auto pzones = sf2.GetPreset(ph).AllZoneHandles();
+        CHECK(std::find(pzones.begin(), pzones.end(), pzh) == pzones.end());
+    }
+
+    // removing a preset drops its references
+    auto presets = sf2.AllPresets();
+    sf2.RemovePresets(presets);
+    for (auto ih : sf2.AllInstruments()) {
+        CHECK(sf2.CountInstrumentUsers(ih) == 0);
+    }
+}
+
+TEST_CASE("Garbage collection", "[remove][reference]") {
+    SF2ML::SoundFont sf2;
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+    auto saved_size = [&sf2](const char* path) {
+        {
+            std::ofstream ofs(path, std::ios::binary);
+            REQUIRE(sf2.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+        }
+        std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+        return static_cast<std::uint64_t>(ifs.tellg());
+    };
+
+    // everything of the test bank is in use
+    auto samples = sf2.AllSamples();
+    auto insts = sf2.AllInstruments();
+    auto report = sf2.CollectGarbage();
+    CHECK(report.instruments == 0);
+    CHECK(report.bytes == 0);
+    CHECK(sf2.AllInstruments() == insts);
+    std::size_t kept_samples = sf2.AllSamples().size();
+    CHECK(kept_samples + report.samples == samples.size());
+
+    // an orphan instrument, and the samples only it uses
+    auto orphan = sf2.NewInstrument("Orphan").GetHandle();
+    sf2.GetInstrument(orphan).NewZone().SetSample(sf2.AllSamples().front());
+    auto size_before = saved_size("SF2ML_gc_before.sf2");
+    report = sf2.CollectGarbage();
+    CHECK(report.instruments == 1);
+    CHECK(report.samples == 0);
+    CHECK(report.bytes == size_before - saved_size("SF2ML_gc_after.sf2"));
+    CHECK(sf2.AllInstruments() == insts);
+
+    // without presets nothing is reachable
+    sf2.RemovePresets(sf2.AllPresets());
+    size_before = saved_size("SF2ML_gc_before.sf2");
+    report = sf2.CollectGarbage();
+    CHECK(report.instruments == insts.size());
+    CHECK(report.samples == kept_samples);
+    CHECK(sf2.AllInstruments().empty());
+    CHECK(sf2.AllSamples().empty());
+    CHECK(report.bytes == size_before - saved_size("SF2ML_gc_after.sf2"));
+}
+
+TEST_CASE("Saving with dangling references", "[serializer][reference]") {
+    SF2ML::SoundFont sf2;
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+    auto save = [&sf2]() {
+        SF2ML::SF2MLError err;
+        {
+            std::ofstream ofs("SF2ML_dangling.sf2", std::ios::binary);
+            err = sf2.Save(ofs);
+        }
+        std::ifstream ifs("SF2ML_dangling.sf2", std::ios::binary | std::ios::ate);
+        CHECK((err == SF2ML::SF2ML_SUCCESS) == (ifs.tellg() > 0)); // nothing is written on failure
+        return err;
+    };
+
+    auto samples = sf2.AllSamples();
+    auto used = std::find_if(samples.begin(), samples.end(), [&](auto sh) { return sf2.CountSampleUsers(sh) > 0; });
+    REQUIRE(used != samples.end());
+    sf2.RemoveSample(*used);
+    CHECK(save() == SF2ML::SF2ML_NO_SUCH_SAMPLE);
+
+    // presets are checked first
+    auto insts = sf2.AllInstruments();
+    auto used_inst = std::find_if(insts.begin(), insts.end(), [&](auto ih) { return sf2.CountInstrumentUsers(ih) > 0; });
+    REQUIRE(used_inst != insts.end());
+    sf2.RemoveInstrument(*used_inst);
+    CHECK(save() == SF2ML::SF2ML_NO_SUCH_INSTRUMENT);
+
+    sf2.RemovePresets(sf2.AllPresets());
+    sf2.CollectGarbage();
+    CHECK(save() == SF2ML::SF2ML_SUCCESS);
+}
+
+TEST_CASE("Saved size tracking", "[serializer]") {
+    SF2ML::SoundFont sf2;
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+    auto saved_size = [&sf2]() {
+        {
+            std::ofstream ofs("SF2ML_size.sf2", std::ios::binary);
+            REQUIRE(sf2.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+        }
+        std::ifstream ifs("SF2ML_size.sf2", std::ios::binary | std::ios::ate);
+        return static_cast<SF2ML::DWORD>(ifs.tellg());
+    };
+    CHECK(sf2.GetSavedSize() == saved_size());
+
+    // edits are picked up
+    auto ih = sf2.NewInstrument("Sized").GetHandle();
+    auto& zone = sf2.GetInstrument(ih).NewZone().SetSample(sf2.AllSamples().front());
+    CHECK(sf2.GetSavedSize() == saved_size());
+    zone.SetGenerator(SF2ML::SfGenPan, std::int16_t(100)).SetGenerator(SF2ML::SfGenCoarseTune, std::int16_t(-12));
+    CHECK(sf2.GetSavedSize() == saved_size());
+    sf2.GetPreset(sf2.AllPresets().front()).NewZone().SetInstrument(ih);
+    CHECK(sf2.GetSavedSize() == saved_size());
+    sf2.GetInstrument(ih).RemoveZone(zone.GetHandle());
+    CHECK(sf2.GetSavedSize() == saved_size());
+    sf2.RemovePresets(std::vector<SF2ML::PresetHandle>{ sf2.AllPresets().front() });
+    CHECK(sf2.RemoveSample(sf2.AllSamples().back(), SF2ML::RemovalMode::Recursive, SF2ML::ReferenceMode::Cascade) == SF2ML::SF2ML_SUCCESS);
+    CHECK(sf2.GetSavedSize() == saved_size());
+
+    // INFO strings of even length are padded to keep the chunks aligned
+    sf2.Info().SetBankName("Even");
+    CHECK(sf2.GetSavedSize() == saved_size());
+    SF2ML::SoundFont reloaded;
+    std::ifstream ifs("SF2ML_size.sf2", std::ios::binary);
+    REQUIRE(reloaded.Load(ifs) == SF2ML::SF2ML_SUCCESS);
+    CHECK(reloaded.Info().GetBankName() == "Even");
+
+    // past the 32-bit size of the RIFF chunk, the bank is refused before anything is written
+    auto big = sf2.NewSample("Big", SF2ML::SampleBitDepth::Signed16);
+    REQUIRE(big.error == SF2ML::SF2ML_SUCCESS);
+    sf2.GetSample(big.value).SetWavSource(0x80000000u, [](std::uint32_t, std::span<SF2ML::BYTE> out) {
+        std::fill(out.begin(), out.end(), SF2ML::BYTE(0));
+    });
+    CHECK(sf2.GetSavedSize() > 0xFFFFFFFFull);
+    {
+        std::ofstream ofs("SF2ML_too_large.sf2", std::ios::binary);
+        CHECK(sf2.Save(ofs) == SF2ML::SF2ML_FILE_TOO_LARGE);
+    }
+    std::ifstream too_large_ifs("SF2ML_too_large.sf2", std::ios::binary | std::ios::ate);
+    CHECK(too_large_ifs.tellg() == 0);
+}
+
+TEST_CASE("Note-on lookup", "[lookup]") {
+    using SF2ML::Ranges;
+    SF2ML::SoundFont sf2;
+    auto ih = sf2.NewInstrument("Split Inst").GetHandle();
+    {
+        auto& inst = sf2.GetInstrument(ih);
+        inst.NewZone().SetKeyRange(Ranges<std::uint8_t>{ 0, 59 }).SetSample(SF2ML::SmplHandle(0));
+        inst.NewZone().SetKeyRange(Ranges<std::uint8_t>{ 60, 127 }).SetVelRange(Ranges<std::uint8_t>{ 0, 63 }).SetSample(SF2ML::SmplHandle(1));
+        inst.NewZone().SetKeyRange(Ranges<std::uint8_t>{ 60, 127 }).SetVelRange(Ranges<std::uint8_t>{ 64, 127 }).SetSample(SF2ML::SmplHandle(2));
+    }
+    auto ph = sf2.NewPreset(5, 0, "Split Preset").GetHandle();
+    sf2.GetPreset(ph).NewZone().SetInstrument(ih);
+
+    auto samples_of = [](const std::vector<SF2ML::SfNoteZone>& zones) {
+        std::vector<std::uint16_t> res;
+        for (const auto& z : zones) {
+            res.push_back(z.sample.value);
+        }
+        return res;
+    };
+
+    CHECK(samples_of(sf2.FindNoteZones(0, 5, 40, 100)) == std::vector<std::uint16_t>{ 0 });
+    CHECK(samples_of(sf2.FindNoteZones(0, 5, 70, 30))  == std::vector<std::uint16_t>{ 1 });
+    CHECK(samples_of(sf2.FindNoteZones(0, 5, 70, 100)) == std::vector<std::uint16_t>{ 2 });
+    CHECK(sf2.FindNoteZones(0, 6, 70, 100).empty());
+    CHECK(sf2.FindNoteZones(1, 5, 70, 100).empty());
+    CHECK(sf2.FindNoteZones(0, 5 + 128, 70, 100).empty());
+
+    auto zones = sf2.FindNoteZones(0, 5, 40, 100);
+    REQUIRE(zones.size() == 1);
+    CHECK(zones[0].preset == ph);
+    CHECK(zones[0].instrument == ih);
+
+    // instrument edit
+    auto first_zone = sf2.GetInstrument(ih).AllZoneHandles()[1];
+    sf2.GetInstrument(ih).GetZone(first_zone).SetKeyRange(Ranges<std::uint8_t>{ 0, 70 });
+    CHECK(samples_of(sf2.FindNoteZones(0, 5, 65, 30)) == std::vector<std::uint16_t>{ 0, 1 });
+
+    std::array<SF2ML::SfNoteZone, 1> buf;
+    CHECK(sf2.FindNoteZones(0, 5, 65, 30, buf) == 2);
+    CHECK(buf[0].sample.value == 0);
+
+    // renumbering
+    sf2.GetPreset(ph).SetPresetNumber(6);
+    CHECK(sf2.FindNoteZones(0, 5, 40, 100).empty());
+    CHECK(samples_of(sf2.FindNoteZones(0, 6, 40, 100)) == std::vector<std::uint16_t>{ 0 });
+
+    // preset zone ranges are intersected with instrument zone ranges
+    auto pz = sf2.GetPreset(ph).AllZoneHandles()[1];
+    sf2.GetPreset(ph).GetZone(pz).SetKeyRange(Ranges<std::uint8_t>{ 0, 50 });
+    CHECK(sf2.FindNoteZones(0, 6, 65, 30).empty());
+    CHECK(samples_of(sf2.FindNoteZones(0, 6, 50, 30)) == std::vector<std::uint16_t>{ 0 });
+
+    sf2.RemoveInstrument(ih);
+    CHECK(sf2.FindNoteZones(0, 6, 50, 30).empty());
+    sf2.RemovePreset(ph);
+    CHECK(sf2.FindNoteZones(0, 6, 50, 30).empty());
+}
+
+TEST_CASE("Voice parameter table", "[lookup][generator]") {
+    using SF2ML::Ranges;
+    SF2ML::SoundFont sf2;
+    auto ih = sf2.NewInstrument("Voice Inst").GetHandle();
+    {
+        auto& inst = sf2.GetInstrument(ih);
+        inst.GetGlobalZone()
+            .SetGenerator(SF2ML::SfGenInitialAttenuation, std::int16_t(100))
+            .SetGenerator(SF2ML::SfGenAttackVolEnv, std::int16_t(-1200));
+        inst.NewZone().SetKeyRange(Ranges<std::uint8_t>{ 0, 63 }).SetSample(SF2ML::SmplHandle(0))
+            .SetGenerator(SF2ML::SfGenInitialAttenuation, std::int16_t(200));
+        inst.NewZone().SetKeyRange(Ranges<std::uint8_t>{ 64, 127 }).SetSample(SF2ML::SmplHandle(1))
+            .SetGenerator(SF2ML::SfGenOverridingRootKey, std::int16_t(60));
+    }
+    auto ph = sf2.NewPreset(0, 0, "Voice Preset").GetHandle();
+    sf2.GetPreset(ph).GetGlobalZone().SetGenerator(SF2ML::SfGenCoarseTune, std::int16_t(-12));
+    auto pz = sf2.GetPreset(ph).NewZone()
+        .SetInstrument(ih)
+        .SetKeyRange(Ranges<std::uint8_t>{ 32, 95 })
+        .SetGenerator(SF2ML::SfGenInitialAttenuation, std::int16_t(50))
+        .SetGenerator(SF2ML::SfGenOverridingRootKey, std::int16_t(10)) // instrument-only: ignored
+        .GetHandle();
+
+    auto low = sf2.FindNoteZones(0, 0, 40, 100);
+    auto high = sf2.FindNoteZones(0, 0, 80, 100);
+    REQUIRE(low.size() == 1);
+    REQUIRE(high.size() == 1);
+
+    auto lo = sf2.GetVoiceParams(low[0]);
+    auto hi = sf2.GetVoiceParams(high[0]);
+    REQUIRE(lo);
+    REQUIRE(hi);
+    // local instrument zone overrides the global one, preset value is added
+    CHECK(lo->raw[SF2ML::SfGenInitialAttenuation] == 250);
+    CHECK(hi->raw[SF2ML::SfGenInitialAttenuation] == 150);
+    CHECK(lo->physical[SF2ML::SfGenInitialAttenuation] == Approx(25.0f));
+    CHECK(lo->raw[SF2ML::SfGenAttackVolEnv] == -1200);
+    CHECK(lo->physical[SF2ML::SfGenAttackVolEnv] == Approx(0.5f));
+    CHECK(lo->raw[SF2ML::SfGenCoarseTune] == -12);
+    // defaults
+    CHECK(lo->raw[SF2ML::SfGenInitialFilterFc] == 13500);
+    CHECK(lo->raw[SF2ML::SfGenDecayVolEnv] == -12000);
+    CHECK(lo->raw[SF2ML::SfGenScaleTuning] == 100);
+    CHECK(lo->raw[SF2ML::SfGenOverridingRootKey] == -1);
+    CHECK(hi->raw[SF2ML::SfGenOverridingRootKey] == 60);
+    // ranges are intersected, references hold the handle values
+    CHECK(lo->raw[SF2ML::SfGenKeyRange] == (32 | (63 << 8)));
+    CHECK(hi->raw[SF2ML::SfGenKeyRange] == (64 | (95 << 8)));
+    CHECK(lo->raw[SF2ML::SfGenSampleID] == 0);
+    CHECK(hi->raw[SF2ML::SfGenSampleID] == 1);
+    CHECK(lo->raw[SF2ML::SfGenInstrument] == ih.value);
+
+    // edits only invalidate what they touch
+    sf2.GetPreset(ph).GetZone(pz).SetGenerator(SF2ML::SfGenInitialAttenuation, std::int16_t(-150));
+    CHECK(sf2.GetVoiceParams(low[0])->raw[SF2ML::SfGenInitialAttenuation] == 50);
+    // the sum is clamped into the legal range of the generator
+    sf2.GetPreset(ph).GetZone(pz).SetGenerator(SF2ML::SfGenInitialAttenuation, std::int16_t(-300));
+    CHECK(sf2.GetVoiceParams(low[0])->raw[SF2ML::SfGenInitialAttenuation] == 0);
+    sf2.GetInstrument(ih).GetGlobalZone().SetGenerator(SF2ML::SfGenInitialAttenuation, std::int16_t(500));
+    CHECK(sf2.GetVoiceParams(high[0])->raw[SF2ML::SfGenInitialAttenuation] == 200);
+
+    sf2.GetInstrument(ih).RemoveZone(low[0].instrument_zone);
+    CHECK_FALSE(sf2.GetVoiceParams(low[0]));
+    CHECK(sf2.GetVoiceParams(high[0])); // position is stale, found by the zone pair
+}
+
+TEST_CASE("Real-time view does not allocate", "[lookup][realtime]") {
+    CountingResource counting;
+    SF2ML::SoundFont sf2(&counting);
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+
+    const SF2ML::SoundFontRtView view = sf2.GetRtView();
+    std::array<SF2ML::SfNoteZone, 32> zones;
+    SF2ML::SfVoiceParams params;
+    std::size_t found = 0, voices = 0, pcm_bytes = 0, items = 0;
+
+    RtSection rt(counting);
+    for (const SF2ML::SfPreset& preset : view.Presets()) {
+        for (std::uint8_t key = 0; key < 128; key++) {
+            std::size_t n = view.FindNoteZones(preset.GetBankNumber(), preset.GetPresetNumber(), key, 100, zones);
+            found += n;
+            for (std::size_t i = 0; i < n && i < zones.size(); i++) {
+                voices += view.GetVoiceParams(zones[i], params);
+                pcm_bytes += view.GetSampleData(zones[i].sample).size();
+                if (const SF2ML::SfInstrument* inst = view.GetInstrument(zones[i].instrument)) {
+                    for (const SF2ML::SfInstrumentZone& izone : inst->Zones()) {
+                        items += izone.Generators().size() + izone.Modulators().size();
+                    }
+                }
+            }
+        }
+        for (const SF2ML::SfPresetZone& pzone : preset.Zones()) {
+            items += pzone.Generators().size() + pzone.Modulators().size();
+        }
+    }
+    for (const SF2ML::SfSample& sample : view.Samples()) {
+        pcm_bytes += sample.GetWav().size() + sample.GetRootKey();
+    }
+    std::size_t allocations = rt.End();
+
+    CHECK(allocations == 0);
+    CHECK(found > 0);
+    CHECK(voices == found);
+    CHECK(pcm_bytes > 0);
+    CHECK(items > 0);
+    CHECK(view.GetPreset(SF2ML::PresetHandle(0xFFFF)) == nullptr);
+    CHECK(view.GetSampleData(SF2ML::SmplHandle(0xFFFF)).empty());
+
+    // the harness itself must notice allocations
+    RtSection check(counting);
+    std::vector<SF2ML::PresetHandle> handles = sf2.AllPresets();
+    CHECK(check.End() > 0);
+}
+
+TEST_CASE("Real-time view of a managed bank", "[lookup][realtime][residency]") {
+    SF2ML::SfSynthSpec spec;
+    spec.instruments = 2;
+    spec.zones_per_instrument = 4;
+    spec.samples = 8;
+    spec.sample_points = 1000;
+    spec.stream_samples = false;
+    SF2ML::SoundFont built;
+    REQUIRE(SF2ML::BuildSynthBank(built, spec) == SF2ML::SF2ML_SUCCESS);
+    {
+        std::ofstream ofs("SF2ML_rt_residency.sf2", std::ios::binary);
+        REQUIRE(built.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+    }
+    CountingResource counting;
+    SF2ML::SoundFont sf2(&counting);
+    std::ifstream ifs("SF2ML_rt_residency.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(ifs) == SF2ML::SF2ML_SUCCESS);
+
+    // nothing stays resident but the pinned samples, pinned from this(non real-time) thread
+    SF2ML::SfResidencyManager manager(0, ".", &counting);
+    REQUIRE(manager.Manage(sf2, "SF2ML_rt_residency.sf2") == SF2ML::SF2ML_SUCCESS);
+    const SF2ML::SfPreset& played = sf2.Presets().front();
+    const auto pinned = manager.PinPreset(sf2, played.GetHandle());
+    REQUIRE_FALSE(pinned.empty());
+    const SF2ML::SoundFontRtView view = sf2.GetRtView();
+    const auto before = manager.GetStats();
+
+    std::array<SF2ML::SfNoteZone, 32> zones;
+    std::size_t found = 0, pcm_bytes = 0, unpinned_bytes = 0;
+    RtSection rt(counting);
+    for (std::uint8_t key = 0; key < 128; key++) {
+        std::size_t n = view.FindNoteZones(played.GetBankNumber(), played.GetPresetNumber(), key, 100, zones);
+        found += n;
+        for (std::size_t i = 0; i < n && i < zones.size(); i++) {
+            pcm_bytes += view.GetSampleData(zones[i].sample).size();
+            pcm_bytes += view.GetSample(zones[i].sample)->GetWav().size();
+        }
+    }
+    for (const SF2ML::SfSample& sample : view.Samples()) {
+        if (std::ranges::find(pinned, sample.GetHandle()) == pinned.end()) {
+            unpinned_bytes += view.GetSampleData(sample.GetHandle()).size();
+        }
+    }
+    std::size_t allocations = rt.End();
+
+    CHECK(allocations == 0);
+    CHECK(found > 0);
+    CHECK(pcm_bytes > 0);
+    // the samples that are not pinned are not read back
+    CHECK(unpinned_bytes == 0);
+    const auto after = manager.GetStats();
+    CHECK(after.misses == before.misses);
+    CHECK(after.resident_bytes == after.pinned_bytes);
+
+    manager.Unpin(sf2, pinned);
+    CHECK(manager.GetStats().resident_bytes == 0);
+}
+
+TEST_CASE("Note-on lookup after loading", "[lookup][loader]") {
+    SF2ML::SoundFont sf2;
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+
+    for (auto ph : sf2.AllPresets()) {
+        auto& preset = sf2.GetPreset(ph);
+        for (int key = 0; key < 128; key += 7) {
+            auto zones = sf2.FindNoteZones(preset.GetBankNumber(), preset.GetPresetNumber(), key, 100);
+            for (const auto& z : zones) {
+                CHECK(z.preset == ph);
+                auto& izone = sf2.GetInstrument(z.instrument).GetZone(z.instrument_zone);
+                CHECK(izone.GetKeyRange().start <= key);
+                CHECK(izone.GetKeyRange().end >= key);
+                CHECK(izone.GetSample() == std::optional<SF2ML::SmplHandle>(z.sample));
+            }
+        }
+    }
+}
+
+TEST_CASE("Load and save statistics", "[loader][serializer][stats]") {
+    SF2ML::SfSynthSpec spec;
+    spec.instruments = 3;
+    spec.zones_per_instrument = 4;
+    spec.modulator_chain = 2;
+    spec.samples = 5;
+    spec.sample_points = 300;
+    const SF2ML::SfSynthRecords records = SF2ML::CountSynthRecords(spec);
+
+    SF2ML::SoundFont built;
+    REQUIRE(SF2ML::BuildSynthBank(built, spec) == SF2ML::SF2ML_SUCCESS);
+    SF2ML::SfSaveStats save_stats;
+    {
+        std::ofstream ofs("SF2ML_stats.sf2", std::ios::binary);
+        REQUIRE(built.Save(ofs, save_stats) == SF2ML::SF2ML_SUCCESS);
+    }
+    CHECK(save_stats.bytes_written == built.GetSavedSize());
+    CHECK(save_stats.sample_bytes > 5 * 300 * 2);
+    CHECK(save_stats.streamed_samples == 5);
+    CHECK(save_stats.allocations > 0);
+    CHECK(save_stats.total_ns >= save_stats.sdta_ns);
+
+    SF2ML::SoundFont sf2;
+    SF2ML::SfLoadStats load_stats;
+    std::ifstream ifs("SF2ML_stats.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(ifs, load_stats) == SF2ML::SF2ML_SUCCESS);
+    CHECK(load_stats.bytes_read == save_stats.bytes_written);
+    CHECK(load_stats.bytes_copied == 5 * 300 * 2);
+    CHECK(load_stats.presets == 3);
+    CHECK(load_stats.instruments == 3);
+    CHECK(load_stats.samples == 5);
+    CHECK(load_stats.zones == spec.PresetCount() + spec.instruments + spec.InstrumentZones());
+    CHECK(load_stats.generators == records.preset_gens + records.inst_gens - 2);
+    CHECK(load_stats.modulators == records.inst_mods - 1);
+    CHECK(load_stats.modulators_rejected == 0);
+    CHECK(load_stats.allocations > 0);
+    CHECK(load_stats.allocated_bytes >= load_stats.bytes_read);
+    CHECK(load_stats.total_ns >= load_stats.instruments_ns);
+
+    // buffers from the resource of the bank are still adopted by the samples loaded with statistics
+    std::pmr::vector<std::uint8_t> wav(600, 0, sf2.GetMemoryResource());
+    const auto* adopted = wav.data();
+    sf2.GetSample(sf2.AllSamples().front()).SetWav(std::move(wav));
+    CHECK(sf2.GetSample(sf2.AllSamples().front()).GetWav().data() == adopted);
+
+    // the same object, loaded again without statistics
+    std::ifstream again("SF2ML_stats.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(again) == SF2ML::SF2ML_SUCCESS);
+    CHECK(sf2.Samples().size() == 5);
+}
+
+TEST_CASE("Trace events", "[trace]") {
+    const auto count = [](const std::string& json, const std::string& what) {
+        std::size_t n = 0;
+        for (auto pos = json.find(what); pos != std::string::npos; pos = json.find(what, pos + 1)) {
+            n++;
+        }
+        return n;
+    };
+
+    SF2ML::SoundFont sf2;
+    SF2ML::EnableTrace();
+    REQUIRE(SF2ML::IsTraceEnabled());
+    {
+        std::ifstream ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+        REQUIRE(sf2.Load(ifs) == SF2ML::SF2ML_SUCCESS);
+        std::ofstream ofs("SF2ML_trace.sf2", std::ios::binary);
+        REQUIRE(sf2.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+    }
+    SF2ML::DisableTrace();
+
+    std::ostringstream trace;
+    REQUIRE(SF2ML::FlushTrace(trace) == SF2ML::SF2ML_SUCCESS);
+    const std::string json = trace.str();
+    CHECK(json.starts_with("{\"traceEvents\":["));
+    CHECK(json.ends_with("],\"displayTimeUnit\":\"ns\"}\n"));
+    for (const char* name : { "Load", "LoadSfbk", "LoadSamples", "LoadPresets", "LoadInstruments",
+                              "Save", "WriteRiff", "ValidateReferences", "WriteSDTA", "SerializeSHDR" }) {
+        CHECK(count(json, std::string("\"name\":\"") + name + "\"") == 1);
+    }
+    CHECK(count(json, "\"name\":\"LoadInstrument\"") == sf2.Instruments().size());
+    CHECK(json.find("\"args\":{\"index\":0}") != std::string::npos);
+
+    // flushed events are gone, and nothing is recorded while disabled
+    {
+        std::ofstream ofs("SF2ML_trace.sf2", std::ios::binary);
+        REQUIRE(sf2.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+    }
+    std::ostringstream empty;
+    REQUIRE(SF2ML::FlushTrace(empty) == SF2ML::SF2ML_SUCCESS);
+    CHECK(count(empty.str(), "\"ph\":\"X\"") == 0);
+
+    // a full ring keeps the newest events
+    SF2ML::EnableTrace(4);
+    {
+        std::ifstream ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+        REQUIRE(sf2.Load(ifs) == SF2ML::SF2ML_SUCCESS);
+    }
+    SF2ML::DisableTrace();
+    std::ostringstream newest;
+    REQUIRE(SF2ML::FlushTrace(newest) == SF2ML::SF2ML_SUCCESS);
+    CHECK(count(newest.str(), "\"ph\":\"X\"") == 4);
+    CHECK(count(newest.str(), "\"name\":\"Load\"") == 1);
+}
+
+TEST_CASE("Read-only view of a mapped file", "[view]") {
+    SF2ML::SoundFont sf2;
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+
+    SF2ML::SoundFontView view;
+    REQUIRE(view.Open(src_dir + "SF2ML_TEST1.sf2") == SF2ML::SF2ML_SUCCESS);
+    REQUIRE(view.IsOpen());
+    CHECK(view.GetBitDepth() == SF2ML::SampleBitDepth::Signed16);
+    REQUIRE(view.PresetCount() == sf2.Presets().size());
+    REQUIRE(view.InstrumentCount() == sf2.Instruments().size());
+    REQUIRE(view.SampleCount() == sf2.Samples().size());
+    CHECK(SF2ML::SoundFontView::Name(view.Phdr().back().ach_preset_name) == "EOP");
+
+    std::size_t preset_gens = 0;
+    for (std::size_t i = 0; i < view.PresetCount(); i++) {
+        const SF2ML::SfPreset& preset = sf2.Presets()[i];
+        CHECK(SF2ML::SoundFontView::Name(view.Phdr()[i].ach_preset_name) == preset.GetName());
+        CHECK(view.FindPreset(preset.GetBankNumber(), preset.GetPresetNumber()).has_value());
+        for (const auto& bag : view.PresetBags(i)) {
+            preset_gens += view.PresetGenerators(&bag - view.Pbag().data()).size();
+        }
+    }
+    CHECK(preset_gens == view.Pgen().size() - 1);
+    std::size_t zones = 0;
+    for (std::size_t i = 0; i < view.InstrumentCount(); i++) {
+        CHECK(SF2ML::SoundFontView::Name(view.Inst()[i].ach_inst_name) == sf2.Instruments()[i].GetName());
+        const auto bags = view.InstrumentBags(i);
+        for (std::size_t bag = 0; bag < bags.size(); bag++) {
+            const auto gens = view.InstrumentGenerators(&bags[bag] - view.Ibag().data());
+            // sample IDs come last
+            if (!gens.empty() && gens.back().sf_gen_oper == SF2ML::SfGenSampleID) {
+                CHECK(gens.back().gen_amount.w_amount < view.SampleCount());
+                zones++;
+            }
+        }
+    }
+    CHECK(zones > 0);
+    for (std::size_t i = 0; i < view.SampleCount(); i++) {
+        const SF2ML::SfSample& smpl = sf2.Samples()[i];
+        const auto data = view.SampleData(i);
+        CHECK(std::equal(data.begin(), data.end(), smpl.GetWav().begin(), smpl.GetWav().end()));
+        CHECK(view.SampleData24(i).empty());
+    }
+
+    // out of range indexes give empty spans
+    CHECK(view.PresetBags(view.PresetCount()).empty());
+    CHECK(view.InstrumentGenerators(view.Ibag().size()).empty());
+    CHECK(view.SampleData(view.SampleCount()).empty());
+    CHECK_FALSE(view.FindPreset(0xFFFF, 0xFFFF).has_value());
+
+    // a moved-from view is closed
+    SF2ML::SoundFontView moved = std::move(view);
+    CHECK_FALSE(view.IsOpen());
+    CHECK(moved.IsOpen());
+    moved.Close();
+    CHECK(moved.Phdr().empty());
+    CHECK(moved.Open(src_dir + "no such file.sf2") == SF2ML::SF2ML_FAILED);
+}
+
+TEST_CASE("Read-only view of a 24-bit bank in memory", "[view]") {
+    SF2ML::SfSynthSpec spec;
+    spec.instruments = 2;
+    spec.zones_per_instrument = 3;
+    spec.samples = 3;
+    spec.sample_points = 100;
+    spec.bit_depth = SF2ML::SampleBitDepth::Signed24;
+    spec.stream_samples = false;
+    SF2ML::SoundFont sf2;
+    REQUIRE(SF2ML::BuildSynthBank(sf2, spec) == SF2ML::SF2ML_SUCCESS);
+    {
+        std::ofstream ofs("SF2ML_view24.sf2", std::ios::binary);
+        REQUIRE(sf2.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+    }
+    std::ifstream ifs("SF2ML_view24.sf2", std::ios::binary);
+    const std::vector<SF2ML::BYTE> file((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    SF2ML::SoundFontView view;
+    REQUIRE(view.Open(file) == SF2ML::SF2ML_SUCCESS);
+    CHECK(view.GetBitDepth() == SF2ML::SampleBitDepth::Signed24);
+    REQUIRE(view.SampleCount() == 3);
+    for (std::size_t i = 0; i < view.SampleCount(); i++) {
+        const auto wav = sf2.Samples()[i].GetWav();
+        const auto hi = view.SampleData(i);
+        const auto lo = view.SampleData24(i);
+        REQUIRE(hi.size() == 200);
+        REQUIRE(lo.size() == 100);
+        for (std::size_t p = 0; p < 100; p++) {
+            CHECK(wav[3 * p] == lo[p]);
+            CHECK(wav[3 * p + 1] == hi[2 * p]);
+            CHECK(wav[3 * p + 2] == hi[2 * p + 1]);
+        }
+    }
+    CHECK(view.InstrumentBags(0).size() == 4);
+
+    // truncated files are rejected
+    CHECK(view.Open(std::span(file).first(file.size() / 2)) != SF2ML::SF2ML_SUCCESS);
+    CHECK_FALSE(view.IsOpen());
+}
+
+TEST_CASE("Frozen SoundFont", "[frozen][lookup]") {
+    SF2ML::SoundFont sf2;
+    std::ifstream sf2_ifs(src_dir + "SF2ML_TEST1.sf2", std::ios::binary);
+    REQUIRE(sf2.Load(sf2_ifs) == SF2ML::SF2ML_SUCCESS);
+
+    const SF2ML::FrozenSoundFont frozen = sf2.Freeze();
+    REQUIRE(frozen.PresetCount() == sf2.Presets().size());
+    REQUIRE(frozen.InstrumentCount() == sf2.Instruments().size());
+    REQUIRE(frozen.SampleCount() == sf2.Samples().size());
+    CHECK(frozen.GetBitDepth() == SF2ML::SampleBitDepth::Signed16);
+
+    auto index_of = [](auto objects, auto handle) {
+        auto it = std::find_if(objects.begin(), objects.end(), [&](const auto& x) { return x.GetHandle() == handle; });
+        return static_cast<std::uint32_t>(it - objects.begin());
+    };
+    for (std::size_t i = 0; i < frozen.SampleCount(); i++) {
+        const SF2ML::SfSample& smpl = sf2.Samples()[i];
+        CHECK(frozen.SampleName(i) == smpl.GetName());
+        CHECK(frozen.RootKeys()[i] == smpl.GetRootKey());
+        CHECK(frozen.LoopStarts()[i] == smpl.GetLoop().first);
+        CHECK(frozen.SampleModes()[i] == smpl.GetSampleMode());
+        if (smpl.GetLink()) {
+            CHECK(frozen.SampleLinks()[i] == index_of(sf2.Samples(), *smpl.GetLink()));
+        }
+        const auto data = frozen.SampleData(i);
+        CHECK(reinterpret_cast<std::uintptr_t>(data.data()) % 64 == 0);
+        CHECK(std::ranges::equal(data, smpl.GetWav()));
+    }
+    const SF2ML::SfFrozenZones izones = frozen.InstrumentZones();
+    for (std::size_t i = 0; i < frozen.InstrumentCount(); i++) {
+        const SF2ML::SfInstrument& inst = sf2.Instruments()[i];
+        CHECK(frozen.InstrumentName(i) == inst.GetName());
+        const std::uint32_t first = frozen.InstrumentZoneBegin()[i];
+        REQUIRE(frozen.InstrumentZoneBegin()[i + 1] - first == inst.Zones().size());
+        for (std::size_t z = 0; z < inst.Zones().size(); z++) {
+            CHECK(std::ranges::equal(izones.Generators(first + z), inst.Zones()[z].Generators(),
+                                     [](const auto& x, const auto& y) { return x.type == y.type && x.raw == y.raw; }));
+            CHECK(izones.Modulators(first + z).size() == inst.Zones()[z].Modulators().size());
+        }
+        CHECK(izones.target[first] == SF2ML::SfFrozenZones::no_target);
+    }
+
+    // the same zone pairs and voice parameters as the SoundFont
+    std::array<SF2ML::SfNoteZone, 32> zones;
+    std::array<SF2ML::SfFrozenNoteZone, 32> frozen_zones;
+    std::size_t found = 0;
+    for (std::size_t p = 0; p < frozen.PresetCount(); p++) {
+        const SF2ML::SfPreset& preset = sf2.Presets()[p];
+        CHECK(frozen.PresetName(p) == preset.GetName());
+        const auto bank = preset.GetBankNumber();
+        const auto program = preset.GetPresetNumber();
+        CHECK(frozen.FindPreset(bank, program) == index_of(sf2.Presets(), *sf2.FindPreset(bank, program)));
+        for (std::uint8_t key = 0; key < 128; key += 3) {
+            for (std::uint8_t vel : { 1, 64, 127 }) {
+                const std::size_t n = sf2.FindNoteZones(bank, program, key, vel, zones);
+                REQUIRE(frozen.FindNoteZones(bank, program, key, vel, frozen_zones) == n);
+                found += n;
+                for (std::size_t i = 0; i < n && i < zones.size(); i++) {
+                    const SF2ML::SfFrozenNoteZone& fz = frozen_zones[i];
+                    CHECK(fz.instrument == index_of(sf2.Instruments(), zones[i].instrument));
+                    CHECK(fz.sample == index_of(sf2.Samples(), zones[i].sample));
+                    CHECK(izones.target[fz.instrument_zone] == fz.sample);
+                    SF2ML::SfVoiceParams expected, actual;
+                    REQUIRE(sf2.GetVoiceParams(zones[i]).has_value());
+                    expected = *sf2.GetVoiceParams(zones[i]);
+                    REQUIRE(frozen.GetVoiceParams(fz, actual));
+                    expected.raw[SF2ML::SfGenInstrument] = static_cast<std::int16_t>(fz.instrument);
+                    expected.raw[SF2ML::SfGenSampleID] = static_cast<std::int16_t>(fz.sample);
+                    CHECK(std::ranges::equal(actual.raw, expected.raw));
+                    CHECK(actual.physical[SF2ML::SfGenInitialAttenuation] == expected.physical[SF2ML::SfGenInitialAttenuation]);
+                }
+            }
+        }
+    }
+    CHECK(found > 0);
+    SF2ML::SfVoiceParams params;
+    CHECK_FALSE(frozen.GetVoiceParams({ 0, 0, 0, 0, 0, 0xFFFFFF }, params));
+    CHECK_FALSE(frozen.FindPreset(0xFFFF, 0xFFFF).has_value());
+
+    // the snapshot is not affected by later edits, and is read by several threads at once
+    const auto bank = sf2.Presets()[0].GetBankNumber();
+    const auto program = sf2.Presets()[0].GetPresetNumber();
+    const std::size_t expected = frozen.FindNoteZones(bank, program, 60, 100, {});
+    sf2.RemovePresets(sf2.AllPresets());
+    std::vector<std::thread> readers;
+    std::array<std::size_t, 4> counts {};
+    for (std::size_t t = 0; t < counts.size(); t++) {
+        readers.emplace_back([&, t] {
+            for (int i = 0; i < 100; i++) {
+                counts[t] += frozen.FindNoteZones(bank, program, 60, 100, {});
+            }
+        });
+    }
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    for (std::size_t count : counts) {
+        CHECK(count == expected * 100);
+    }
+    CHECK(frozen.PresetCount() > 0);
+}
+
+TEST_CASE("Freezing streamed 24-bit samples", "[frozen][sample]") {
+    SF2ML::SfSynthSpec spec;
+    spec.instruments = 2;
+    spec.zones_per_instrument = 3;
+    spec.samples = 3;
+    spec.sample_points = 101;
+    spec.bit_depth = SF2ML::SampleBitDepth::Signed24;
+    SF2ML::SoundFont sf2;
+    REQUIRE(SF2ML::BuildSynthBank(sf2, spec) == SF2ML::SF2ML_SUCCESS);
+
+    const SF2ML::FrozenSoundFont frozen = sf2.Freeze();
+    CHECK(frozen.GetBitDepth() == SF2ML::SampleBitDepth::Signed24);
+    REQUIRE(frozen.SampleCount() == 3);
+    std::vector<SF2ML::BYTE> points(303);
+    for (std::size_t i = 0; i < frozen.SampleCount(); i++) {
+        sf2.Samples()[i].ReadWav(0, points);
+        CHECK(reinterpret_cast<std::uintptr_t>(frozen.SampleData(i).data()) % 64 == 0);
+        CHECK(std::ranges::equal(frozen.SampleData(i), points));
+    }
+    CHECK(frozen.SampleData(3).empty());
+    CHECK(frozen.InstrumentZoneBegin()[1] == 4);
+}
+
+TEST_CASE("Frozen SoundFont cache", "[frozen][cache]") {
+    const std::string sf2_path = src_dir + "SF2ML_TEST1.sf2";
+    const std::string cache_path = "SF2ML_TEST1.sf2ml-cache";
+    std::remove(cache_path.c_str());
+
+    const auto [key, key_err] = SF2ML::GetCacheKey(sf2_path);
+    REQUIRE(key_err == SF2ML::SF2ML_SUCCESS);
+    CHECK(key.size > 0);
+    CHECK(SF2ML::FrozenSoundFont::LoadCache(cache_path, key).error == SF2ML::SF2ML_FAILED);
+
+    // the first load builds the cache, the second one maps it
+    auto built = SF2ML::FrozenSoundFont::LoadCached(sf2_path, cache_path);
+    REQUIRE(built.error == SF2ML::SF2ML_SUCCESS);
+    auto cached = SF2ML::FrozenSoundFont::LoadCache(cache_path, key);
+    REQUIRE(cached.error == SF2ML::SF2ML_SUCCESS);
+
+    const SF2ML::FrozenSoundFont& x = built.value;
+    const SF2ML::FrozenSoundFont& y = cached.value;
+    REQUIRE(y.PresetCount() == x.PresetCount());
+    REQUIRE(y.InstrumentCount() == x.InstrumentCount());
+    REQUIRE(y.SampleCount() == x.SampleCount());
+    CHECK(y.GetBitDepth() == x.GetBitDepth());
+    for (std::size_t i = 0; i < x.PresetCount(); i++) {
+        CHECK(y.PresetName(i) == x.PresetName(i));
+    }
+    for (std::size_t i = 0; i < x.InstrumentCount(); i++) {
+        CHECK(y.InstrumentName(i) == x.InstrumentName(i));
+    }
+    CHECK(std::ranges::equal(y.InstrumentZones().generators, x.InstrumentZones().generators,
+                             [](const auto& a, const auto& b) { return a.type == b.type && a.raw == b.raw; }));
+    for (std::size_t i = 0; i < x.SampleCount(); i++) {
+        CHECK(y.SampleName(i) == x.SampleName(i));
+        CHECK(reinterpret_cast<std::uintptr_t>(y.SampleData(i).data()) % 64 == 0);
+        CHECK(std::ranges::equal(y.SampleData(i), x.SampleData(i)));
+    }
+    std::array<SF2ML::SfFrozenNoteZone, 32> xz, yz;
+    for (std::size_t p = 0; p < x.PresetCount(); p++) {
+        for (std::uint8_t key_no = 0; key_no < 128; key_no += 5) {
+            const std::size_t n = x.FindNoteZones(x.PresetBanks()[p], x.PresetPrograms()[p], key_no, 100, xz);
+            REQUIRE(y.FindNoteZones(x.PresetBanks()[p], x.PresetPrograms()[p], key_no, 100, yz) == n);
+            for (std::size_t i = 0; i < n && i < xz.size(); i++) {
+                SF2ML::SfVoiceParams xp, yp;
+                REQUIRE(x.GetVoiceParams(xz[i], xp));
+                REQUIRE(y.GetVoiceParams(yz[i], yp));
+                CHECK(std::ranges::equal(xp.raw, yp.raw));
+            }
+        }
+    }
+
+    // another key, or a damaged file, falls back to loading the bank
+    SF2ML::SfCacheKey other = key;
+    other.mtime++;
+    CHECK(SF2ML::FrozenSoundFont::LoadCache(cache_path, other).error == SF2ML::SF2ML_STALE_CACHE);
+    {
+        std::ifstream ifs(cache_path, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        bytes[300] ^= 1; // in the column table
+        std::ofstream ofs("SF2ML_damaged.sf2ml-cache", std::ios::binary);
+        ofs.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    CHECK(SF2ML::FrozenSoundFont::LoadCache("SF2ML_damaged.sf2ml-cache", key).error == SF2ML::SF2ML_BAD_CACHE);
+    auto reloaded = SF2ML::FrozenSoundFont::LoadCached(sf2_path, "SF2ML_damaged.sf2ml-cache");
+    REQUIRE(reloaded.error == SF2ML::SF2ML_SUCCESS);
+    CHECK(reloaded.value.PresetCount() == x.PresetCount());
+    CHECK(SF2ML::FrozenSoundFont::LoadCache("SF2ML_damaged.sf2ml-cache", key).error == SF2ML::SF2ML_SUCCESS);
+
+    // empty snapshots
+    const SF2ML::FrozenSoundFont empty;
+    CHECK(empty.PresetCount() == 0);
+    CHECK(empty.FindNoteZones(0, 0, 60, 100, xz) == 0);
+    REQUIRE(empty.SaveCache("SF2ML_empty.sf2ml-cache", key) == SF2ML::SF2ML_SUCCESS);
+    auto empty_cached = SF2ML::FrozenSoundFont::LoadCache("SF2ML_empty.sf2ml-cache", key);
+    REQUIRE(empty_cached.error == SF2ML::SF2ML_SUCCESS);
+    CHECK(empty_cached.value.SampleCount() == 0);
+}
+
+TEST_CASE("Frozen SoundFont from an image in memory", "[frozen][embed]") {
+    const std::string sf2_path = src_dir + "SF2ML_TEST1.sf2";
+    SF2ML::SoundFont sf2;
+    std::ifstream ifs(sf2_path, std::ios::binary);
+    REQUIRE(sf2.Load(ifs) == SF2ML::SF2ML_SUCCESS);
+    const SF2ML::FrozenSoundFont x = sf2.Freeze();
+
+    // the image as sf2ml-embed compiles it, in a 64-byte aligned block
+    std::ostringstream oss;
+    REQUIRE(x.SaveCache(oss, SF2ML::SfCacheKey{}) == SF2ML::SF2ML_SUCCESS);
+    const std::string bytes = oss.str();
+    struct alignas(64) Block { SF2ML::BYTE data[64]; };
+    std::vector<Block> storage(bytes.size() / sizeof(Block) + 1);
+    const auto image = std::span(storage.front().data, storage.size() * sizeof(Block)).first(bytes.size());
+    std::memcpy(image.data(), bytes.data(), bytes.size());
+
+    // nothing but the bookkeeping of the snapshot is allocated, and never from the heap
+    alignas(std::max_align_t) std::byte buffer[4096];
+    std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    auto embedded = SF2ML::FrozenSoundFont::FromImage(image, &resource);
+    REQUIRE(embedded.error == SF2ML::SF2ML_SUCCESS);
+    const SF2ML::FrozenSoundFont& y = embedded.value;
+    REQUIRE(y.PresetCount() == x.PresetCount());
+    REQUIRE(y.SampleCount() == x.SampleCount());
+    for (std::size_t i = 0; i < x.PresetCount(); i++) {
+        CHECK(y.PresetName(i) == x.PresetName(i));
+    }
+    for (std::size_t i = 0; i < x.SampleCount(); i++) {
+        CHECK(y.SampleData(i).data() >= image.data());
+        CHECK(std::ranges::equal(y.SampleData(i), x.SampleData(i)));
+    }
+    std::array<SF2ML::SfFrozenNoteZone, 32> xz, yz;
+    for (std::size_t p = 0; p < x.PresetCount(); p++) {
+        const std::size_t n = x.FindNoteZones(x.PresetBanks()[p], x.PresetPrograms()[p], 60, 100, xz);
+        CHECK(y.FindNoteZones(x.PresetBanks()[p], x.PresetPrograms()[p], 60, 100, yz) == n);
+    }
+
+    // a misaligned or truncated image is rejected
+    CHECK(SF2ML::FrozenSoundFont::FromImage(std::span(storage.front().data + 1, bytes.size())).error == SF2ML::SF2ML_BAD_CACHE);
+    CHECK(SF2ML::FrozenSoundFont::FromImage(image.first(image.size() / 2)).error == SF2ML::SF2ML_BAD_CACHE);
+}
+
+TEST_CASE("Sample residency manager", "[residency][sample]") {
+    auto bytes_of = [](std::span<const std::uint8_t> data) { return std::vector<std::uint8_t>(data.begin(), data.end()); };
+    for (auto bit_depth : { SF2ML::SampleBitDepth::Signed16, SF2ML::SampleBitDepth::Signed24 }) {
+        SF2ML::SfSynthSpec spec;
+        spec.instruments = 2;
+        spec.zones_per_instrument = 4;
+        spec.samples = 8;
+        spec.sample_points = 1000;
+        spec.bit_depth = bit_depth;
+        spec.stream_samples = false;
+        SF2ML::SoundFont built;
+        REQUIRE(SF2ML::BuildSynthBank(built, spec) == SF2ML::SF2ML_SUCCESS);
+        {
+            std::ofstream ofs("SF2ML_residency.sf2", std::ios::binary);
+            REQUIRE(built.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+        }
+        SF2ML::SoundFont loaded;
+        std::ifstream ifs("SF2ML_residency.sf2", std::ios::binary);
+        REQUIRE(loaded.Load(ifs) == SF2ML::SF2ML_SUCCESS);
+        REQUIRE(loaded.Samples().size() == 8);
+
+        // room for 3 of the 8 samples
+        const std::size_t sample_size = loaded.Samples()[0].GetWav().size();
+        SF2ML::SfResidencyManager manager(3 * sample_size, ".");
+        REQUIRE(manager.Manage(loaded, "SF2ML_residency.sf2") == SF2ML::SF2ML_SUCCESS);
+        auto stats = manager.GetStats();
+        CHECK(stats.managed_samples == 8);
+        CHECK(stats.evictions == 5);
+        CHECK(stats.resident_bytes == 3 * sample_size);
+        CHECK(stats.spills == 0);
+
+        // saved while another thread reads other samples, and evicts the ones being written(room for 1 sample)
+        {
+            manager.SetBudget(sample_size);
+            std::ifstream original("SF2ML_residency.sf2", std::ios::binary);
+            const std::vector<char> expected { std::istreambuf_iterator<char>(original), std::istreambuf_iterator<char>() };
+            std::atomic<bool> saving = true;
+            std::thread reader([&] {
+                std::vector<std::uint8_t> points(sample_size);
+                while (saving) {
+                    for (std::size_t i = 4; i < 8; i++) {
+                        loaded.Samples()[i].ReadWav(0, points);
+                    }
+                }
+            });
+            for (int round = 0; round < 100; round++) {
+                {
+                    std::ofstream ofs("SF2ML_residency_saved.sf2", std::ios::binary);
+                    REQUIRE(loaded.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+                }
+                std::ifstream saved("SF2ML_residency_saved.sf2", std::ios::binary);
+                CHECK(std::vector<char>(std::istreambuf_iterator<char>(saved), std::istreambuf_iterator<char>()) == expected);
+            }
+            saving = false;
+            reader.join();
+            manager.SetBudget(3 * sample_size);
+        }
+
+        // evicted samples are read back from the file, whatever the accessor
+        for (std::size_t i = 0; i < 8; i++) {
+            const SF2ML::SfSample& smpl = loaded.Samples()[i];
+            CHECK(smpl.GetSampleCount() == 1000);
+            CHECK(bytes_of(smpl.GetWav()) == bytes_of(built.Samples()[i].GetWav()));
+        }
+        std::vector<std::uint8_t> block(30);
+        for (std::size_t i = 0; i < 8; i++) {
+            loaded.Samples()[i].ReadWav(100, block);
+            CHECK(std::ranges::equal(block, built.Samples()[i].GetWav().subspan(100 * (sample_size / 1000), 30)));
+            CHECK(loaded.Samples()[i].GetSampleAt(999) == built.Samples()[i].GetSampleAt(999));
+        }
+        stats = manager.GetStats();
+        CHECK(stats.misses >= 16);
+        CHECK(stats.failed_reads == 0);
+        CHECK(stats.resident_bytes <= 3 * sample_size);
+        CHECK(stats.spills == 0);
+
+        // edited samples go to the spill file
+        const SF2ML::SmplHandle edited = loaded.Samples()[0].GetHandle();
+        std::vector<std::uint8_t> reversed = bytes_of(built.Samples()[0].GetWav());
+        std::ranges::reverse(reversed);
+        loaded.GetSample(edited).SetWav(std::span<const std::uint8_t>(reversed));
+        for (std::size_t i = 1; i < 8; i++) {
+            static_cast<void>(loaded.Samples()[i].GetWav());
+        }
+        CHECK(manager.GetStats().spills == 1);
+        CHECK(bytes_of(loaded.GetSample(edited).GetWav()) == reversed);
+
+        // pinned samples stay where they are
+        const auto pinned = manager.PinPreset(loaded, loaded.Presets()[0].GetHandle());
+        REQUIRE_FALSE(pinned.empty());
+        CHECK(manager.GetStats().pinned_bytes == pinned.size() * sample_size);
+        const std::uint8_t* data = loaded.GetSample(pinned[0]).GetWav().data();
+        for (std::size_t round = 0; round < 2; round++) {
+            for (const SF2ML::SfSample& smpl : loaded.Samples()) {
+                static_cast<void>(smpl.GetWav());
+            }
+        }
+        CHECK(loaded.GetSample(pinned[0]).GetWav().data() == data);
+        manager.Unpin(loaded, pinned);
+        CHECK(manager.GetStats().pinned_bytes == 0);
+
+        // released samples are resident again
+        manager.Release(loaded);
+        CHECK(manager.GetStats().managed_samples == 0);
+        CHECK(bytes_of(loaded.GetSample(edited).GetWav()) == reversed);
+        for (std::size_t i = 1; i < 8; i++) {
+            CHECK(bytes_of(loaded.Samples()[i].GetWav()) == bytes_of(built.Samples()[i].GetWav()));
+        }
+    }
+
+    // banks that do not come from a file, destroyed before the manager
+    SF2ML::SfResidencyManager manager(0, ".");
+    {
+        SF2ML::SfSynthSpec spec;
+        spec.instruments = 1;
+        spec.zones_per_instrument = 2;
+        spec.samples = 4;
+        spec.sample_points = 100;
+        spec.stream_samples = false;
+        SF2ML::SoundFont sf2, expected;
+        REQUIRE(SF2ML::BuildSynthBank(sf2, spec) == SF2ML::SF2ML_SUCCESS);
+        REQUIRE(SF2ML::BuildSynthBank(expected, spec) == SF2ML::SF2ML_SUCCESS);
+        manager.Manage(sf2);
+        CHECK(manager.GetStats().spills == 4);
+        for (std::size_t i = 0; i < 4; i++) {
+            CHECK(bytes_of(sf2.Samples()[i].GetWav()) == bytes_of(expected.Samples()[i].GetWav()));
+        }
+        auto save = [](SF2ML::SoundFont& bank, const char* path) {
+            {
+                std::ofstream ofs(path, std::ios::binary);
+                REQUIRE(bank.Save(ofs) == SF2ML::SF2ML_SUCCESS);
+            }
+            std::ifstream saved(path, std::ios::binary);
+            return std::vector<char>(std::istreambuf_iterator<char>(saved), std::istreambuf_iterator<char>());
+        };
+        CHECK(save(sf2, "SF2ML_residency_a.sf2") == save(expected, "SF2ML_residency_b.sf2"));
+    }
+    CHECK(manager.GetStats().managed_samples == 0);
+    CHECK(manager.GetStats().resident_bytes == 0);
+}
+
+// run with: [benchmark]
+TEST_CASE("Serializer on the largest loadable bank", "[.][benchmark][serializer]") {
+    // as many 100-zone instruments as the 16-bit bag/generator indexes of the format allow
+    SF2ML::SfSynthSpec spec;
+    spec.samples = 16;
+    spec.sample_points = 1024;
+    spec = SF2ML::MaximizeSynthIndexes(spec);
+    REQUIRE(SF2ML::SynthFitsFileIndexes(spec));
+    SF2ML::SoundFont sf2;
+    REQUIRE(SF2ML::BuildSynthBank(sf2, spec) == SF2ML::SF2ML_SUCCESS);
+    BENCHMARK("Save") {
+        std::ofstream ofs("SF2ML_bench.sf2", std::ios::binary);
+        return sf2.Save(ofs);
+    };
+    SF2ML::SoundFont loaded;
+    std::ifstream ifs("SF2ML_bench.sf2", std::ios::binary);
+    REQUIRE(loaded.Load(ifs) == SF2ML::SF2ML_SUCCESS);
+    CHECK(loaded.Instruments().size() == spec.instruments);
+    auto& zone = sf2.GetInstrument(sf2.AllInstruments().front()).GetGlobalZone();
+    BENCHMARK("GetSavedSize after an edit") {
+        zone.SetGenerator(SF2ML::SfGenPan, std::int16_t(1));
+        return sf2.GetSavedSize();
+    };
+}
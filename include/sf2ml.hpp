@@ -8,29 +8,167 @@
 #include "sfinstrument.hpp"
 #include "sfpreset.hpp"
 #include "sfinfo.hpp"
+#include "sfmemory.hpp"
 
+#include <array>
+#include <concepts>
 #include <cstddef>
 #include <memory>
+#include <memory_resource>
 #include <functional>
 #include <fstream>
 #include <vector>
 #include <string>
 #include <string_view>
 #include <optional>
+#include <span>
 
 namespace SF2ML {
+	class FrozenSoundFont;
+
 	enum class RemovalMode {
 		Recursive, Normal
 	};
 
+	/// What to do with the zones that still reference an object being removed.
+	enum class ReferenceMode {
+		Keep,    // leave them as they are (saving fails with SF2ML_NO_SUCH_SAMPLE/SF2ML_NO_SUCH_INSTRUMENT)
+		Cascade, // remove those zones as well
+		Reject,  // remove nothing and fail with SF2ML_STILL_REFERENCED
+	};
+
 	enum class SampleChannel {
 		Mono, Left, Right,
 	};
 
+	/// A zone pair to be played for a note: the preset zone, the instrument zone it reaches,
+	/// and the sample of the instrument zone.
+	struct SfNoteZone {
+		PresetHandle preset { 0 };
+		PZoneHandle preset_zone { 0 };
+		InstHandle instrument { 0 };
+		IZoneHandle instrument_zone { 0 };
+		SmplHandle sample { 0 };
+		/// position of the pair in the voice table of its preset (see SoundFont::GetVoiceParams);
+		/// only meaningful until the next edit of the SoundFont
+		std::uint32_t voice { 0 };
+	};
+
+	/// Fully resolved generator values of a zone pair, indexed by SFGenerator.
+	/// raw: instrument value(local zone, else global zone, else default) plus the preset offset
+	///      (local zone, else global zone) for additive generators, clamped into the legal range
+	///      of the generator (see SfGenTraits in sfgenerator.hpp).
+	///      KeyRange/VelRange hold the intersected ranges, Instrument/SampleID hold the handle values.
+	/// physical: raw converted by the unit of the generator (see SfGenUnit in sfgenerator.hpp).
+	struct SfVoiceParams {
+		std::array<std::int16_t, SfGenEndOper> raw;
+		std::array<float, SfGenEndOper> physical;
+	};
+
+	/// What SoundFont::CollectGarbage removed.
+	struct SfGarbageReport {
+		std::uint32_t instruments { 0 }; // instruments no preset used
+		std::uint32_t samples { 0 };     // samples no remaining instrument used (nor the pair of a used stereo sample)
+		std::uint64_t bytes { 0 };       // decrease of the size of the saved file
+	};
+
+	/// Where the time of SoundFont::Load went and what it built (see SoundFont::Load(std::ifstream&, SfLoadStats&)).
+	/// Times are wall times in nanoseconds. modulators_ns is part of presets_ns and instruments_ns.
+	struct SfLoadStats {
+		std::uint64_t read_ns { 0 };             // reading the file into memory
+		std::uint64_t map_ns { 0 };              // locating the chunks
+		std::uint64_t info_ns { 0 };
+		std::uint64_t samples_ns { 0 };          // sample headers, and copying the sample data out of the file
+		std::uint64_t presets_ns { 0 };          // preset zone construction
+		std::uint64_t instruments_ns { 0 };      // instrument zone construction
+		std::uint64_t modulators_ns { 0 };       // modulator link validation and construction
+		std::uint64_t index_ns { 0 };            // name indexes and edit tracking
+		std::uint64_t total_ns { 0 };
+		std::uint64_t bytes_read { 0 };
+		std::uint64_t bytes_copied { 0 };        // sample data copied out of the file
+		std::uint32_t presets { 0 };
+		std::uint32_t instruments { 0 };
+		std::uint32_t samples { 0 };
+		std::uint32_t zones { 0 };               // preset and instrument zones, global zones included
+		std::uint32_t generators { 0 };
+		std::uint32_t modulators { 0 };
+		std::uint32_t modulators_rejected { 0 }; // dangling or circular links, links to a modulator whose source is not Link
+		std::uint64_t allocations { 0 };         // working buffers of the load: the file contents, modulator link validation
+		std::uint64_t allocated_bytes { 0 };
+	};
+
+	/// Where the time of SoundFont::Save went (see SoundFont::Save(std::ofstream&, SfSaveStats&)).
+	/// Times are wall times in nanoseconds.
+	struct SfSaveStats {
+		std::uint64_t validate_ns { 0 };         // reference checks and file ID tables
+		std::uint64_t serialize_ns { 0 };        // building the INFO and pdta chunks
+		std::uint64_t sdta_ns { 0 };             // producing and writing the sample data
+		std::uint64_t write_ns { 0 };            // writing the INFO and pdta chunks
+		std::uint64_t total_ns { 0 };
+		std::uint64_t bytes_written { 0 };
+		std::uint64_t sample_bytes { 0 };        // size of the sdta chunk
+		std::uint32_t streamed_samples { 0 };    // samples whose points came from a source (see SfSample::SetWavSource)
+		std::uint64_t allocations { 0 };         // from the memory resource of the SoundFont
+		std::uint64_t allocated_bytes { 0 };
+	};
+
+	/// Read-only view of a SoundFont for real-time(audio callback) threads.
+	///
+	/// Real-time safety contract:
+	///  - Every member function is const and noexcept, and never allocates memory, takes a lock or blocks.
+	///  - The spans and pointers it hands out point into the SoundFont; reading them is real-time safe through
+	///    the following members only: GetHandle, IsEmpty, HasGenerator, Generators, Modulators, ModulatorCount,
+	///    GeneratorCount, Zones, GetPresetNumber, GetBankNumber, GetLoop, GetRootKey, GetPitchCorrection,
+	///    GetSampleRate, GetSampleMode, GetBitDepth, GetWav. (Name getters and handle lists return allocated objects.)
+	///  - The samples of a bank managed by an SfResidencyManager must be pinned(SfResidencyManager::PinPreset)
+	///    from a non real-time thread before they are played. GetSampleData returns an empty span for the ones
+	///    that are not pinned and never reads them back; GetWav on those would, so read their points through
+	///    GetSampleData.
+	///  - A view is created by SoundFont::GetRtView() on a non real-time thread(that call does the pending
+	///    index work and may allocate). It is valid until the SoundFont is edited, loaded or destroyed;
+	///    any number of threads may read through it concurrently as long as nothing edits the SoundFont.
+	///    Swapping in an edited bank is left to the caller(ex: publish a new SoundFont and view atomically).
+	class SoundFontRtView {
+	public:
+		/// @brief Same as SoundFont::FindNoteZones.
+		auto FindNoteZones(std::uint16_t bank,
+						   std::uint16_t program,
+						   std::uint8_t key,
+						   std::uint8_t velocity,
+						   std::span<SfNoteZone> out) const noexcept -> std::size_t;
+
+		/// @brief Same as SoundFont::GetVoiceParams.
+		/// @return false if the zone pair no longer exists(out is left untouched).
+		auto GetVoiceParams(const SfNoteZone& zone, SfVoiceParams& out) const noexcept -> bool;
+
+		auto Presets() const noexcept -> std::span<const SfPreset>;
+		auto Instruments() const noexcept -> std::span<const SfInstrument>;
+		auto Samples() const noexcept -> std::span<const SfSample>;
+
+		/// @return nullptr if the handle is not valid
+		auto GetPreset(PresetHandle handle) const noexcept -> const SfPreset*;
+		auto GetInstrument(InstHandle handle) const noexcept -> const SfInstrument*;
+		auto GetSample(SmplHandle handle) const noexcept -> const SfSample*;
+
+		/// @brief PCM data of the sample(little endian, see SfSample::GetBitDepth); empty if the handle is not valid,
+		///        if the sample points come from a source (see SfSample::SetWavSource), or if the sample is managed
+		///        by an SfResidencyManager and not pinned.
+		auto GetSampleData(SmplHandle handle) const noexcept -> std::span<const std::uint8_t>;
+
+	private:
+		friend class SoundFont;
+		explicit SoundFontRtView(const class SoundFontImpl* impl) noexcept : impl{impl} {}
+
+		const class SoundFontImpl* impl;
+	};
+
 	class SoundFont {
 	public:
 		/// @brief Creates a new SoundFont object.
-		SoundFont();
+		/// @param resource The memory resource from which every internal allocation
+		///                 (objects, zones, modulators, sample data, load/save buffers) is made.
+		///                 The resource must outlive the SoundFont object.
+		explicit SoundFont(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 
 		/// @brief Deletes the SoundFont object.
@@ -49,14 +187,43 @@ namespace SF2ML {
 		auto Load(std::ifstream& ifs) -> SF2MLError;
 
 
+		/// @brief Same as above, timing the phases of the load and counting what they do into stats.
+		///        The plain overload carries none of this instrumentation.
+		auto Load(std::ifstream& ifs, SfLoadStats& stats) -> SF2MLError;
+
+
 		/// @brief Saves the SoundFont object to disk
 		/// @param ofs The file stream for .sf2 file to save.
 		///            The behavior is undefined if (ofs.is_open() == false).
 		/// @retval SF2ML::SF2ML_SUCCESS when success
 		/// @retval SF2ML::SF2ML_FAILED when failed
+		/// @retval SF2ML::SF2ML_INDEX_OVERFLOW when the bags, modulators or generators of the presets or of the
+		///         instruments exceed the 16-bit indexes of the format(nothing is written then)
+		/// @retval SF2ML::SF2ML_FILE_TOO_LARGE when the file would exceed the 32-bit size of the RIFF chunk
+		///         (nothing is written then)
 		auto Save(std::ofstream& ofs) -> SF2MLError;
 
 
+		/// @brief Same as above, timing the phases of the save and counting what they do into stats.
+		///        The plain overload carries none of this instrumentation.
+		auto Save(std::ofstream& ofs, SfSaveStats& stats) -> SF2MLError;
+
+
+		/// @brief Gets the size in bytes of the file Save would write now.
+		///        Record counts are cached per object and only the objects edited since the previous call
+		///        are recounted, so it is cheap enough to be called after every edit.
+		///        Past 0xFFFFFFFF bytes(plus the RIFF chunk header), Save fails with SF2ML_FILE_TOO_LARGE.
+		auto GetSavedSize() -> std::uint64_t;
+
+
+		/// @brief Removes the objects that presets cannot reach: instruments no preset zone uses,
+		///        then samples no remaining instrument zone uses, keeping both samples of a stereo pair
+		///        when one of them is used. Each kind is removed in a single compaction pass.
+		///        Call it before Save to keep orphans left by editing out of the file.
+		/// @return counts of the removed objects and the number of bytes it takes off the saved file
+		auto CollectGarbage() -> SfGarbageReport;
+
+
 		/// @brief Exports the SfSample object existing in SoundFont object as .WAV file to disk.
 		/// @note currently unimplemented.
 		/// @param ofs The file stream for .WAV file.
@@ -65,6 +232,9 @@ namespace SF2ML {
 		/// @retval SF2ML::SF2ML_SUCCESS when success
 		auto ExportWav(std::ofstream& ofs, SmplHandle sample) -> SF2MLError;
 
+		/// @brief Gets the memory resource the SoundFont object allocates from.
+		auto GetMemoryResource() const -> std::pmr::memory_resource*;
+
 		/// @brief Gets the meta-data object of Soundfont object.
 		///        It corrisponds to INFO chunk described in [SoundFont Technical Specification]*
 		/// @return Reference to SfInfo object
@@ -157,6 +327,14 @@ namespace SF2ML {
 		/// @retval SF2ML::SF2ML_SUCCESS when succeeded
 		auto LinkSamples(SmplHandle left, SmplHandle right) -> SF2MLError;
 
+
+		/// @brief Adds a sample without sample points (44100Hz, root key 60),
+		///        to be filled with SfSample::SetWav or SfSample::SetWavSource.
+		/// @param name sample name
+		/// @param bit_depth bit depth of the sample points; it has to match the existing samples
+		/// @retval SF2ML::SF2ML_INCOMPATIBLE_BIT_DEPTH when the existing samples have another bit depth
+		auto NewSample(std::string_view name, SampleBitDepth bit_depth) -> SF2MLResult<SmplHandle>;
+
 		
 		/// @brief Gets the reference of corresponding SfSample object.
 		///        The behavior is undefined if the handle is invalid.
@@ -175,6 +353,28 @@ namespace SF2ML {
 		void RemoveSample(SmplHandle smpl, RemovalMode rm_mode = RemovalMode::Normal);
 
 
+		/// @brief Removes several SfSample objects at once, in a single pass over the samples.
+		///        Handles of non existing objects are ignored.
+		/// @param smpls the handles of the SfSample objects
+		/// @param rm_mode if RemovalMode::Recursive, it'll also remove the linked SfSample objects;
+		///                otherwise remaining samples linked to a removed one become mono.
+		void RemoveSamples(std::span<const SmplHandle> smpls, RemovalMode rm_mode = RemovalMode::Normal);
+
+
+		/// @brief Same as above, with a choice on the instrument zones still using the samples.
+		/// @return SF2ML_STILL_REFERENCED if ref_mode is ReferenceMode::Reject and any of the samples is in use.
+		auto RemoveSample(SmplHandle smpl, RemovalMode rm_mode, ReferenceMode ref_mode) -> SF2MLError;
+		auto RemoveSamples(std::span<const SmplHandle> smpls, RemovalMode rm_mode, ReferenceMode ref_mode) -> SF2MLError;
+
+
+		/// @brief Counts the instrument zones using the sample (kept up to date on every edit).
+		auto CountSampleUsers(SmplHandle smpl) -> std::uint32_t;
+
+
+		/// @brief Returns the instrument zones using the sample, in (instrument, zone) handle order.
+		auto FindSampleUsers(SmplHandle smpl) -> std::vector<std::pair<InstHandle, IZoneHandle>>;
+
+
 		/// @brief Find 1 SfSample object that satisfies pred(object) == true.
 		/// @param pred Functor that evaluates the object to bool
 		/// @return std::nullopt when none satisfies the condition.
@@ -182,6 +382,18 @@ namespace SF2ML {
 		-> std::optional<SmplHandle>;
 
 
+		/// @brief Same as above, but takes the predicate as is so it can be inlined (picked for lambdas).
+		template <std::predicate<const SfSample&> Pred>
+		auto FindSample(Pred&& pred) -> std::optional<SmplHandle> {
+			for (const SfSample& x : Samples()) {
+				if (pred(x)) {
+					return x.GetHandle();
+				}
+			}
+			return std::nullopt;
+		}
+
+
 		/// @brief Find all SfSample objects that satisfies pred(object) == true.
 		/// @param pred Functor that evaluates the object to bool
 		/// @return a vector of SmplHandles
@@ -189,11 +401,23 @@ namespace SF2ML {
 		-> std::vector<SmplHandle>;
 
 
+		/// @brief Finds the SfSample object by its name, through an index kept up to date on every edit.
+		/// @param name the name (truncated to 20 characters, the same way SetName does)
+		/// @return the first created one if several objects share the name / std::nullopt when none does.
+		auto FindSampleByName(std::string_view name) -> std::optional<SmplHandle>;
+
+
 		/// @brief Returns all SfSample objects that exists in the SoundFont object.
 		/// @return a vector of SmplHandles
 		auto AllSamples() -> std::vector<SmplHandle>;
 
 
+		/// @brief Returns a contiguous view of all SfSample objects, in file order.
+		///        Combine it with std::views::filter/transform for lazy queries that allocate nothing.
+		///        The view is invalidated when objects are added or removed.
+		auto Samples() const noexcept -> std::span<const SfSample>;
+
+
 		/// @brief Creates new SfInstrument object in the SoundFont object.
 		///        The returned reference is "short lived", which means
 		///        whenever addition/deletion of SfInstrument objects in SoundFont object,
@@ -219,6 +443,25 @@ namespace SF2ML {
 		void RemoveInstrument(InstHandle inst);
 
 
+		/// @brief Removes several SfInstrument objects at once, in a single pass over the instruments.
+		///        Handles of non existing objects are ignored.
+		void RemoveInstruments(std::span<const InstHandle> insts);
+
+
+		/// @brief Same as above, with a choice on the preset zones still using the instruments.
+		/// @return SF2ML_STILL_REFERENCED if ref_mode is ReferenceMode::Reject and any of the instruments is in use.
+		auto RemoveInstrument(InstHandle inst, ReferenceMode ref_mode) -> SF2MLError;
+		auto RemoveInstruments(std::span<const InstHandle> insts, ReferenceMode ref_mode) -> SF2MLError;
+
+
+		/// @brief Counts the preset zones using the instrument (kept up to date on every edit).
+		auto CountInstrumentUsers(InstHandle inst) -> std::uint32_t;
+
+
+		/// @brief Returns the preset zones using the instrument, in (preset, zone) handle order.
+		auto FindInstrumentUsers(InstHandle inst) -> std::vector<std::pair<PresetHandle, PZoneHandle>>;
+
+
 		/// @brief Find 1 SfInstrument object that satisfies pred(object) == true.
 		/// @param pred Functor that evaluates the object to bool
 		/// @return std::nullopt when none satisfies the condition.
@@ -226,6 +469,18 @@ namespace SF2ML {
 		-> std::optional<InstHandle>;
 
 
+		/// @brief Same as above, but takes the predicate as is so it can be inlined (picked for lambdas).
+		template <std::predicate<const SfInstrument&> Pred>
+		auto FindInstrument(Pred&& pred) -> std::optional<InstHandle> {
+			for (const SfInstrument& x : Instruments()) {
+				if (pred(x)) {
+					return x.GetHandle();
+				}
+			}
+			return std::nullopt;
+		}
+
+
 		/// @brief Find all SfInstrument objects that satisfies pred(object) == true.
 		/// @param pred Functor that evaluates the object to bool
 		/// @return a vector of InstHandles
@@ -233,11 +488,21 @@ namespace SF2ML {
 		-> std::vector<InstHandle>;
 
 
+		/// @brief Finds the SfInstrument object by its name (see FindSampleByName).
+		auto FindInstrumentByName(std::string_view name) -> std::optional<InstHandle>;
+
+
 		/// @brief Returns all SfInstrument objects that exists in the SoundFont object.
 		/// @return a vector of InstHandles
 		auto AllInstruments() -> std::vector<InstHandle>;
 
 
+		/// @brief Returns a contiguous view of all SfInstrument objects, in file order.
+		///        Combine it with std::views::filter/transform for lazy queries that allocate nothing.
+		///        The view is invalidated when objects are added or removed.
+		auto Instruments() const noexcept -> std::span<const SfInstrument>;
+
+
 		/// @brief Creates new SfPreset object in the SoundFont object.
 		///        The returned reference is "short lived", which means
 		///        whenever addition/deletion of SfPreset objects in SoundFont object,
@@ -269,6 +534,11 @@ namespace SF2ML {
 		void RemovePreset(PresetHandle preset);
 
 
+		/// @brief Removes several SfPreset objects at once, in a single pass over the presets.
+		///        Handles of non existing objects are ignored.
+		void RemovePresets(std::span<const PresetHandle> presets);
+
+
 		/// @brief Find 1 SfPreset object that satisfies pred(object) == true.
 		/// @param pred Functor that evaluates the object to bool
 		/// @return std::nullopt when none satisfies the condition.
@@ -276,6 +546,18 @@ namespace SF2ML {
 		-> std::optional<PresetHandle>;
 
 
+		/// @brief Same as above, but takes the predicate as is so it can be inlined (picked for lambdas).
+		template <std::predicate<const SfPreset&> Pred>
+		auto FindPreset(Pred&& pred) -> std::optional<PresetHandle> {
+			for (const SfPreset& x : Presets()) {
+				if (pred(x)) {
+					return x.GetHandle();
+				}
+			}
+			return std::nullopt;
+		}
+
+
 		/// @brief Find all SfPreset objects that satisfies pred(object) == true.
 		/// @param pred Functor that evaluates the object to bool
 		/// @return a vector of PresetHandles
@@ -283,12 +565,69 @@ namespace SF2ML {
 		-> std::vector<PresetHandle>;
 
 
+		/// @brief Finds the SfPreset object by its name (see FindSampleByName).
+		auto FindPresetByName(std::string_view name) -> std::optional<PresetHandle>;
+
+
+		/// @brief Finds the SfPreset object by its MIDI bank and program number,
+		///        through an index kept up to date on every edit.
+		/// @return the first created one if several presets share the numbers / std::nullopt when none does.
+		auto FindPreset(std::uint16_t bank, std::uint16_t program) -> std::optional<PresetHandle>;
+
+
 		/// @brief Returns all SfPreset objects that exists in the SoundFont object.
 		/// @return a vector of PresetHandles
 		auto AllPresets() -> std::vector<PresetHandle>;
 
+
+		/// @brief Returns a contiguous view of all SfPreset objects, in file order.
+		///        Combine it with std::views::filter/transform for lazy queries that allocate nothing.
+		///        The view is invalidated when objects are added or removed.
+		auto Presets() const noexcept -> std::span<const SfPreset>;
+
+
+		/// @brief Finds the zones to play for a MIDI note-on.
+		///        Every non-global preset zone of the preset (bank, program) is paired with
+		///        every non-global instrument zone of its instrument; a pair matches when both key and velocity
+		///        are within the ranges of both zones(unset ranges fall back to the global zones, then to 0-127).
+		///        The lookup goes through an index that is updated lazily: edits only mark the affected
+		///        presets, and they are recompiled by the first lookup afterwards.
+		/// @param bank MIDI bank number
+		/// @param program MIDI program number
+		/// @param key MIDI key number (0-127)
+		/// @param velocity MIDI velocity (0-127)
+		/// @param out buffer to receive the matching zones (in preset zone, then instrument zone order)
+		/// @return number of matching zones. Only the first out.size() of them are written to out.
+		auto FindNoteZones(std::uint16_t bank,
+						   std::uint16_t program,
+						   std::uint8_t key,
+						   std::uint8_t velocity,
+						   std::span<SfNoteZone> out) -> std::size_t;
+
+
+		/// @brief This function is provided for convenience, and it basically does the same thing as the function above.
+		auto FindNoteZones(std::uint16_t bank,
+						   std::uint16_t program,
+						   std::uint8_t key,
+						   std::uint8_t velocity) -> std::vector<SfNoteZone>;
+
+		/// @brief Returns the resolved generator values of a zone pair found by FindNoteZones.
+		///        The values are precomputed per zone pair in the same lazily updated index
+		///        (editing a zone only recomputes the presets that reach it).
+		/// @return std::nullopt if the zone pair no longer exists.
+		auto GetVoiceParams(const SfNoteZone& zone) -> std::optional<SfVoiceParams>;
+
+		/// @brief Brings the lookup index up to date and returns a real-time safe read-only view
+		///        (see SoundFontRtView for the contract). Any edit of the SoundFont invalidates the view.
+		auto GetRtView() -> SoundFontRtView;
+
+		/// @brief Takes an immutable snapshot of the SoundFont, laid out for playback(see FrozenSoundFont in sffrozen.hpp).
+		///        Later edits of the SoundFont do not affect the snapshot.
+		/// @param resource The memory resource of the snapshot, which must outlive it.
+		auto Freeze(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const -> FrozenSoundFont;
+
 	private:
-		std::unique_ptr<class SoundFontImpl> pimpl;
+		PmrUniquePtr<class SoundFontImpl> pimpl;
 	};
 
 }
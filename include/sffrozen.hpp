@@ -0,0 +1,182 @@
+#ifndef SF2ML_SFFROZEN_HPP_
+#define SF2ML_SFFROZEN_HPP_
+
+#include "sf2ml.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory_resource>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string_view>
+
+namespace SF2ML {
+	/// Zones of the presets(or of the instruments) of a FrozenSoundFont, column by column.
+	/// The zones of an object are contiguous, its global zone first(see FrozenSoundFont::PresetZoneBegin).
+	struct SfFrozenZones {
+		static constexpr std::uint32_t no_target = 0xFFFFFFFF;
+
+		/// key/velocity ranges of the zone, or of the global zone of its object when the zone has none
+		std::span<const BYTE> key_lo;
+		std::span<const BYTE> key_hi;
+		std::span<const BYTE> vel_lo;
+		std::span<const BYTE> vel_hi;
+		/// index of the instrument(preset zones) or of the sample(instrument zones);
+		/// no_target for global zones and for zones without a valid reference
+		std::span<const std::uint32_t> target;
+		/// generators/modulators of zone z: [gen_begin[z], gen_begin[z + 1]), [mod_begin[z], mod_begin[z + 1])
+		std::span<const std::uint32_t> gen_begin;
+		std::span<const std::uint32_t> mod_begin;
+		std::span<const SfGenEntry> generators;
+		/// modulators as they are saved: a modulator linked to another one has 0x8000 | (index of that
+		/// modulator within the zone) as its destination(0xFFFF when that modulator no longer exists)
+		std::span<const spec::SfModList> modulators;
+
+		auto Size() const noexcept -> std::size_t { return target.size(); }
+		auto Generators(std::size_t zone) const noexcept -> std::span<const SfGenEntry> {
+			return generators.subspan(gen_begin[zone], gen_begin[zone + 1] - gen_begin[zone]);
+		}
+		auto Modulators(std::size_t zone) const noexcept -> std::span<const spec::SfModList> {
+			return modulators.subspan(mod_begin[zone], mod_begin[zone + 1] - mod_begin[zone]);
+		}
+	};
+
+	/// A zone pair to be played for a note, found by FrozenSoundFont::FindNoteZones.
+	/// preset_zone and instrument_zone index FrozenSoundFont::PresetZones()/InstrumentZones().
+	struct SfFrozenNoteZone {
+		std::uint32_t preset { 0 };
+		std::uint32_t preset_zone { 0 };
+		std::uint32_t instrument { 0 };
+		std::uint32_t instrument_zone { 0 };
+		std::uint32_t sample { 0 };
+		/// row of the pair in the voice table (see FrozenSoundFont::GetVoiceParams)
+		std::uint32_t voice { 0 };
+	};
+
+	/// Identity of the .sf2 file a cache was built from(see FrozenSoundFont::SaveCache).
+	struct SfCacheKey {
+		std::uint64_t size { 0 };   // file size in bytes
+		std::int64_t mtime { 0 };   // last write time, in ticks of std::filesystem::file_time_type
+		std::uint64_t hash { 0 };   // FNV-1a of the pdta records(presets, instruments, samples, zones)
+
+		bool operator==(const SfCacheKey&) const = default;
+	};
+
+	/// @brief Reads the size and the last write time of the file, and hashes its pdta records
+	///        (the file is mapped; the sample data is not read).
+	/// @retval SF2ML::SF2ML_FAILED when the file cannot be mapped, or is not a RIFF sfbk file
+	auto GetCacheKey(const std::filesystem::path& sf2_path) -> SF2MLResult<SfCacheKey>;
+
+	/// Immutable snapshot of a SoundFont, laid out for playback(see SoundFont::Freeze).
+	///
+	///  - Objects are numbered by their position in SoundFont::Presets()/Instruments()/Samples();
+	///    every reference(zone targets, sample links) is such an index instead of a handle.
+	///  - Properties are stored column by column, zones, generators and modulators in flat arrays,
+	///    and names in one pool where equal names are stored once.
+	///  - The sample points of every sample(sourced samples included) are copied into one pool;
+	///    each sample starts on a 64-byte boundary.
+	///  - The note lookup table and the resolved voice table of every preset are built by Freeze.
+	///  - Nothing is ever written after Freeze(or LoadCache) returns: every member function is const
+	///    and noexcept, allocates nothing, and any number of threads may read the object concurrently without locking.
+	///  - A snapshot can be saved as a cache file and mapped back by LoadCache, which only checks the file
+	///    and points the columns into the mapping: no parsing, no validation of the bank, no copy of the samples.
+	class FrozenSoundFont {
+	public:
+		/// @brief an empty snapshot(no presets, instruments nor samples), as is a moved-from one
+		FrozenSoundFont() noexcept;
+		~FrozenSoundFont();
+		FrozenSoundFont(FrozenSoundFont&& other) noexcept;
+		FrozenSoundFont& operator=(FrozenSoundFont&& other) noexcept;
+		FrozenSoundFont(const FrozenSoundFont&) = delete;
+		FrozenSoundFont& operator=(const FrozenSoundFont&) = delete;
+
+		auto PresetCount() const noexcept -> std::size_t;
+		auto PresetName(std::size_t preset) const noexcept -> std::string_view;
+		auto PresetBanks() const noexcept -> std::span<const WORD>;
+		auto PresetPrograms() const noexcept -> std::span<const WORD>;
+		/// zones of preset p: PresetZones() [PresetZoneBegin()[p], PresetZoneBegin()[p + 1])
+		auto PresetZoneBegin() const noexcept -> std::span<const std::uint32_t>;
+		auto PresetZones() const noexcept -> SfFrozenZones;
+
+		auto InstrumentCount() const noexcept -> std::size_t;
+		auto InstrumentName(std::size_t inst) const noexcept -> std::string_view;
+		auto InstrumentZoneBegin() const noexcept -> std::span<const std::uint32_t>;
+		auto InstrumentZones() const noexcept -> SfFrozenZones;
+
+		auto SampleCount() const noexcept -> std::size_t;
+		auto SampleName(std::size_t sample) const noexcept -> std::string_view;
+		auto SampleRates() const noexcept -> std::span<const std::uint32_t>;
+		auto LoopStarts() const noexcept -> std::span<const std::uint32_t>;
+		auto LoopEnds() const noexcept -> std::span<const std::uint32_t>;
+		auto RootKeys() const noexcept -> std::span<const BYTE>;
+		auto PitchCorrections() const noexcept -> std::span<const CHAR>;
+		auto SampleModes() const noexcept -> std::span<const SFSampleLink>;
+		/// index of the linked sample, or SfFrozenZones::no_target
+		auto SampleLinks() const noexcept -> std::span<const std::uint32_t>;
+		auto GetBitDepth() const noexcept -> SampleBitDepth;
+		/// @brief points of the sample(little endian, 2 or 3 bytes per point, see GetBitDepth),
+		///        64-byte aligned; empty if the index is out of range
+		auto SampleData(std::size_t sample) const noexcept -> std::span<const BYTE>;
+
+		/// @brief index of the preset with this bank and program(the first one when several have them)
+		auto FindPreset(std::uint16_t bank, std::uint16_t program) const noexcept -> std::optional<std::size_t>;
+
+		/// @brief Same as SoundFont::FindNoteZones, on the snapshot.
+		/// @return number of matching zones. Only the first out.size() of them are written to out.
+		auto FindNoteZones(std::uint16_t bank,
+						   std::uint16_t program,
+						   std::uint8_t key,
+						   std::uint8_t velocity,
+						   std::span<SfFrozenNoteZone> out) const noexcept -> std::size_t;
+
+		/// @brief Same as SoundFont::GetVoiceParams, on the snapshot;
+		///        Instrument/SampleID hold the indices of the instrument and the sample.
+		/// @return false if zone does not come from this object(out is left untouched).
+		auto GetVoiceParams(const SfFrozenNoteZone& zone, SfVoiceParams& out) const noexcept -> bool;
+
+		/// @brief Writes the snapshot to cache_path, tagged with the key of its source file(see GetCacheKey).
+		///        The file holds a header, then the columns as they are in memory(64-byte aligned, native byte order),
+		///        with a checksum of everything but the sample points.
+		/// @retval SF2ML::SF2ML_FAILED when the file cannot be written
+		auto SaveCache(const std::filesystem::path& cache_path, const SfCacheKey& key) const -> SF2MLError;
+
+		/// @brief Same as above, writing the cache file into os.
+		auto SaveCache(std::ostream& os, const SfCacheKey& key) const -> SF2MLError;
+
+		/// @brief Maps a cache file written by SaveCache. The snapshot keeps the mapping until it is destroyed.
+		/// @param resource for the bookkeeping of the snapshot(the columns stay in the mapping)
+		/// @retval SF2ML::SF2ML_FAILED when the file cannot be mapped
+		/// @retval SF2ML::SF2ML_STALE_CACHE when the file was written for another key
+		/// @retval SF2ML::SF2ML_BAD_CACHE when the file is not a cache of this version of the library
+		///         (or of another byte order), or is damaged(checksum, sizes)
+		static auto LoadCache(const std::filesystem::path& cache_path,
+							  const SfCacheKey& key,
+							  std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> SF2MLResult<FrozenSoundFont>;
+
+		/// @brief Reads a snapshot in place from a cache file image held in memory(its key is not checked),
+		///        such as the arrays generated by sf2ml-embed. Nothing is parsed or copied: the only allocation is
+		///        the bookkeeping of the snapshot from resource(ex: a monotonic_buffer_resource over a static buffer).
+		/// @param image must be 64-byte aligned, and outlive the snapshot
+		/// @retval SF2ML::SF2ML_BAD_CACHE when the image is misaligned, or is not a valid cache(see LoadCache)
+		static auto FromImage(std::span<const BYTE> image,
+							  std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> SF2MLResult<FrozenSoundFont>;
+
+		/// @brief Loads the snapshot of the .sf2 file from cache_path when that cache is up to date;
+		///        otherwise loads the .sf2 file, freezes it and rewrites the cache(a cache that cannot be written
+		///        is not an error).
+		/// @retval SF2ML::SF2ML_FAILED when the cache is stale and the .sf2 file cannot be loaded
+		static auto LoadCached(const std::filesystem::path& sf2_path,
+							   const std::filesystem::path& cache_path,
+							   std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> SF2MLResult<FrozenSoundFont>;
+
+	private:
+		friend class SoundFont;
+		explicit FrozenSoundFont(PmrUniquePtr<class FrozenSoundFontImpl> pimpl) noexcept;
+
+		PmrUniquePtr<class FrozenSoundFontImpl> pimpl;
+	};
+}
+
+#endif
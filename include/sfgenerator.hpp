@@ -3,7 +3,13 @@
 
 #include "sfspec.hpp"
 #include "sfhandle.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
 #include <variant>
+#include <type_traits>
+#include <limits>
 #include <cmath>
 
 namespace SF2ML {
@@ -11,6 +17,195 @@ namespace SF2ML {
 	/// This variant represents the offical sfGenList/sfInstGenList::gen_amount union.
 	using SfGenAmount = std::variant<SHORT, WORD, InstHandle, SmplHandle, Ranges<BYTE>>;
 
+	/// How the 16-bit amount of a generator is interpreted.
+	enum class SfGenValueType : BYTE {
+		Signed,       // SHORT
+		Unsigned,     // WORD
+		Range,        // Ranges<BYTE> (lo in the low byte, hi in the high byte)
+		InstrumentId, // InstHandle
+		SampleId,     // SmplHandle
+	};
+
+	/// A generator as stored in a zone: its type and raw 16-bit amount(as stored in pgen/igen).
+	struct SfGenEntry {
+		SFGenerator type;
+		WORD raw;
+	};
+
+	/// Physical unit of a generator amount.
+	enum class SfGenUnit : BYTE {
+		None,          // indices, flags, key numbers, ranges and unused generators
+		Samples,       // sample data points
+		CoarseSamples, // 32768 sample data points
+		Cents,
+		AbsoluteCents, // physical value in Hz
+		TimeCents,     // physical value in seconds
+		Centibels,     // physical value in dB
+		TenthPercent,  // physical value as a fraction (1000 = 1.0)
+		Semitones,
+	};
+
+	/// Per-generator metadata (sfspec24 section 8.1.3).
+	struct SfGenTraits {
+		SHORT default_value;  // raw amount used when neither the local nor the global instrument zone sets it
+		SHORT min_value;      // legal range of the amount at instrument level
+		SHORT max_value;      // (the full 16-bit range when the spec gives none, or the amount is not a number)
+		SfGenUnit unit;
+		SfGenValueType value_type;
+		bool instrument_only; // ignored in preset zones
+		bool additive;        // a preset zone value is added on top of the instrument value
+	};
+
+	namespace detail {
+		constexpr SHORT s16_min = std::numeric_limits<SHORT>::min();
+		constexpr SHORT s16_max = std::numeric_limits<SHORT>::max();
+
+		constexpr SfGenTraits gen_traits[SfGenEndOper] = {
+			/*  0 StartAddrsOffset           */ {      0, s16_min, s16_max, SfGenUnit::Samples,       SfGenValueType::Signed,       true,  false },
+			/*  1 EndAddrsOffset             */ {      0, s16_min, s16_max, SfGenUnit::Samples,       SfGenValueType::Signed,       true,  false },
+			/*  2 StartloopAddrsOffset       */ {      0, s16_min, s16_max, SfGenUnit::Samples,       SfGenValueType::Signed,       true,  false },
+			/*  3 EndloopAddrsOffset         */ {      0, s16_min, s16_max, SfGenUnit::Samples,       SfGenValueType::Signed,       true,  false },
+			/*  4 StartAddrsCoarseOffset     */ {      0, s16_min, s16_max, SfGenUnit::CoarseSamples, SfGenValueType::Signed,       true,  false },
+			/*  5 ModLfoToPitch              */ {      0,  -12000,   12000, SfGenUnit::Cents,         SfGenValueType::Signed,       false, true  },
+			/*  6 VibLfoToPitch              */ {      0,  -12000,   12000, SfGenUnit::Cents,         SfGenValueType::Signed,       false, true  },
+			/*  7 ModEnvToPitch              */ {      0,  -12000,   12000, SfGenUnit::Cents,         SfGenValueType::Signed,       false, true  },
+			/*  8 InitialFilterFc            */ {  13500,    1500,   13500, SfGenUnit::AbsoluteCents, SfGenValueType::Signed,       false, true  },
+			/*  9 InitialFilterQ             */ {      0,       0,     960, SfGenUnit::Centibels,     SfGenValueType::Signed,       false, true  },
+			/* 10 ModLfoToFilterFc           */ {      0,  -12000,   12000, SfGenUnit::Cents,         SfGenValueType::Signed,       false, true  },
+			/* 11 ModEnvToFilterFc           */ {      0,  -12000,   12000, SfGenUnit::Cents,         SfGenValueType::Signed,       false, true  },
+			/* 12 EndAddrsCoarseOffset       */ {      0, s16_min, s16_max, SfGenUnit::CoarseSamples, SfGenValueType::Signed,       true,  false },
+			/* 13 ModLfoToVolume             */ {      0,    -960,     960, SfGenUnit::Centibels,     SfGenValueType::Signed,       false, true  },
+			/* 14 (unused)                   */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 15 ChorusEffectsSend          */ {      0,       0,    1000, SfGenUnit::TenthPercent,  SfGenValueType::Signed,       false, true  },
+			/* 16 ReverbEffectsSend          */ {      0,       0,    1000, SfGenUnit::TenthPercent,  SfGenValueType::Signed,       false, true  },
+			/* 17 Pan                        */ {      0,    -500,     500, SfGenUnit::TenthPercent,  SfGenValueType::Signed,       false, true  },
+			/* 18 (unused)                   */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 19 (unused)                   */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 20 (unused)                   */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 21 DelayModLFO                */ { -12000,  -12000,    5000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 22 FreqModLFO                 */ {      0,  -16000,    4500, SfGenUnit::AbsoluteCents, SfGenValueType::Signed,       false, true  },
+			/* 23 DelayVibLFO                */ { -12000,  -12000,    5000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 24 FreqVibLFO                 */ {      0,  -16000,    4500, SfGenUnit::AbsoluteCents, SfGenValueType::Signed,       false, true  },
+			/* 25 DelayModEnv                */ { -12000,  -12000,    5000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 26 AttackModEnv               */ { -12000,  -12000,    8000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 27 HoldModEnv                 */ { -12000,  -12000,    5000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 28 DecayModEnv                */ { -12000,  -12000,    8000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 29 SustainModEnv              */ {      0,       0,    1000, SfGenUnit::TenthPercent,  SfGenValueType::Signed,       false, true  },
+			/* 30 ReleaseModEnv              */ { -12000,  -12000,    8000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 31 KeynumToModEnvHold         */ {      0,   -1200,    1200, SfGenUnit::None,          SfGenValueType::Signed,       false, true  },
+			/* 32 KeynumToModEnvDecay        */ {      0,   -1200,    1200, SfGenUnit::None,          SfGenValueType::Signed,       false, true  },
+			/* 33 DelayVolEnv                */ { -12000,  -12000,    5000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 34 AttackVolEnv               */ { -12000,  -12000,    8000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 35 HoldVolEnv                 */ { -12000,  -12000,    5000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 36 DecayVolEnv                */ { -12000,  -12000,    8000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 37 SustainVolEnv              */ {      0,       0,    1440, SfGenUnit::Centibels,     SfGenValueType::Signed,       false, true  },
+			/* 38 ReleaseVolEnv              */ { -12000,  -12000,    8000, SfGenUnit::TimeCents,     SfGenValueType::Signed,       false, true  },
+			/* 39 KeynumToVolEnvHold         */ {      0,   -1200,    1200, SfGenUnit::None,          SfGenValueType::Signed,       false, true  },
+			/* 40 KeynumToVolEnvDecay        */ {      0,   -1200,    1200, SfGenUnit::None,          SfGenValueType::Signed,       false, true  },
+			/* 41 Instrument                 */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::InstrumentId, false, false },
+			/* 42 (reserved)                 */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 43 KeyRange                   */ { 0x7F00, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Range,        false, false },
+			/* 44 VelRange                   */ { 0x7F00, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Range,        false, false },
+			/* 45 StartloopAddrsCoarseOffset */ {      0, s16_min, s16_max, SfGenUnit::CoarseSamples, SfGenValueType::Signed,       true,  false },
+			/* 46 Keynum                     */ {     -1,      -1,     127, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 47 Velocity                   */ {     -1,      -1,     127, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 48 InitialAttenuation         */ {      0,       0,    1440, SfGenUnit::Centibels,     SfGenValueType::Signed,       false, true  },
+			/* 49 (reserved)                 */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 50 EndloopAddrsCoarseOffset   */ {      0, s16_min, s16_max, SfGenUnit::CoarseSamples, SfGenValueType::Signed,       true,  false },
+			/* 51 CoarseTune                 */ {      0,    -120,     120, SfGenUnit::Semitones,     SfGenValueType::Signed,       false, true  },
+			/* 52 FineTune                   */ {      0,     -99,      99, SfGenUnit::Cents,         SfGenValueType::Signed,       false, true  },
+			/* 53 SampleID                   */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::SampleId,     true,  false },
+			/* 54 SampleModes                */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Unsigned,     true,  false },
+			/* 55 (reserved)                 */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 56 ScaleTuning                */ {    100,       0,    1200, SfGenUnit::Cents,         SfGenValueType::Signed,       false, true  },
+			/* 57 ExclusiveClass             */ {      0,       0,     127, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 58 OverridingRootKey          */ {     -1,      -1,     127, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+			/* 59 (unused)                   */ {      0, s16_min, s16_max, SfGenUnit::None,          SfGenValueType::Signed,       true,  false },
+		};
+	}
+
+	/// returns the metadata of the generator (type must be less than SfGenEndOper)
+	constexpr const SfGenTraits& GetGenTraits(SFGenerator type) noexcept {
+		return detail::gen_traits[type];
+	}
+
+	/// returns the amount type of the generator (unknown generators are treated as signed)
+	constexpr SfGenValueType GetGenValueType(SFGenerator type) noexcept {
+		return type < SfGenEndOper ? detail::gen_traits[type].value_type : SfGenValueType::Signed;
+	}
+
+	/// clamps the amount into the legal range of the generator (amounts which are not numbers are left as is)
+	constexpr SHORT ClampGenAmount(SFGenerator type, SHORT value) noexcept {
+		const SfGenTraits& traits = GetGenTraits(type);
+		return std::min(std::max(value, traits.min_value), traits.max_value);
+	}
+
+	namespace detail {
+		// columns of gen_traits laid out as plain arrays, for the bulk checks below
+		template <SHORT SfGenTraits::*Field>
+		constexpr auto GenTraitsColumn() noexcept {
+			std::array<SHORT, SfGenEndOper> column {};
+			for (std::size_t g = 0; g < SfGenEndOper; g++) {
+				column[g] = gen_traits[g].*Field;
+			}
+			return column;
+		}
+		constexpr auto gen_min_values = GenTraitsColumn<&SfGenTraits::min_value>();
+		constexpr auto gen_max_values = GenTraitsColumn<&SfGenTraits::max_value>();
+
+		// bit set of the generators whose amount is of the value type
+		constexpr std::uint64_t GenTypeMask(SfGenValueType value_type) noexcept {
+			std::uint64_t mask = 0;
+			for (std::size_t g = 0; g < SfGenEndOper; g++) {
+				if (gen_traits[g].value_type == value_type) {
+					mask |= std::uint64_t(1) << g;
+				}
+			}
+			return mask;
+		}
+	}
+
+	/// counts the generators whose amount is outside of the legal range of their type
+	/// (the amounts are kept as loaded/set; synthesizers clamp them when playing)
+	inline std::size_t CountGenAmountsOutOfRange(std::span<const SfGenEntry> gens) noexcept {
+		std::size_t count = 0;
+		for (const SfGenEntry& gen : gens) {
+			const SHORT value = static_cast<SHORT>(gen.raw);
+			count += (value < detail::gen_min_values[gen.type]) | (value > detail::gen_max_values[gen.type]);
+		}
+		return count;
+	}
+
+	/// interprets the raw 16-bit generator amount(as stored in pgen/igen) according to the generator type
+	inline SfGenAmount DecodeGenAmount(SFGenerator type, WORD raw) noexcept {
+		switch (GetGenValueType(type)) {
+			case SfGenValueType::Range:
+				return Ranges<BYTE>{ static_cast<BYTE>(raw & 0xFF), static_cast<BYTE>(raw >> 8) };
+			case SfGenValueType::InstrumentId:
+				return InstHandle(raw);
+			case SfGenValueType::SampleId:
+				return SmplHandle(raw);
+			case SfGenValueType::Unsigned:
+				return raw;
+			default:
+				return static_cast<SHORT>(raw);
+		}
+	}
+
+	/// packs the generator amount back into its raw 16-bit form
+	inline WORD EncodeGenAmount(const SfGenAmount& amt) noexcept {
+		return std::visit([](auto&& arg) -> WORD {
+			using T = std::decay_t<decltype(arg)>;
+			if constexpr (std::is_same_v<T, Ranges<BYTE>>) {
+				return static_cast<WORD>(arg.start | (arg.end << 8));
+			} else if constexpr (std::is_same_v<T, InstHandle> || std::is_same_v<T, SmplHandle>) {
+				return arg.value;
+			} else {
+				return static_cast<WORD>(arg);
+			}
+		}, amt);
+	}
+
 	/// converts absolute cent(*defined in sfspec24) to hertz
 	inline double AbsoluteCentToHertz(SHORT cent) {
 		return cent == 13500 ? 20000.0 : std::pow(2, cent/1200.0) * 8.176;
@@ -52,6 +247,18 @@ namespace SF2ML {
 			return std::numeric_limits<SHORT>::min();
 		}
 	}
+
+	/// converts the raw amount of a generator to its physical unit (see SfGenUnit)
+	inline float GenAmountToPhysical(SFGenerator type, SHORT raw) {
+		switch (GetGenTraits(type).unit) {
+			case SfGenUnit::CoarseSamples: return raw * 32768.0f;
+			case SfGenUnit::AbsoluteCents: return static_cast<float>(AbsoluteCentToHertz(raw));
+			case SfGenUnit::TimeCents:     return static_cast<float>(TimeCentToSeconds(raw));
+			case SfGenUnit::Centibels:     return raw / 10.0f;
+			case SfGenUnit::TenthPercent:  return raw / 1000.0f;
+			default:                       return raw;
+		}
+	}
 }
 
 #endif
\ No newline at end of file
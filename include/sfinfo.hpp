@@ -2,17 +2,19 @@
 #define SF2ML_SFINFO_HPP_
 
 #include "sfspec.hpp"
+#include "sfmemory.hpp"
 #include <string>
 #include <string_view>
 #include <optional>
 #include <memory>
+#include <memory_resource>
 
 namespace SF2ML {
 	struct VersionTag { std::uint16_t major = 2, minor = 1; };
 
 	class SfInfo {
 	public:
-		SfInfo();
+		explicit SfInfo(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 		~SfInfo();
 		SfInfo(const SfInfo&) = delete;
 		SfInfo(SfInfo&&) noexcept;
@@ -44,7 +46,7 @@ namespace SF2ML {
 		auto GetToolUsed() const -> std::optional<std::string>;
 
 	private:
-		std::unique_ptr<class SfInfoImpl> pimpl;
+		PmrUniquePtr<class SfInfoImpl> pimpl;
 	};
 }
 
@@ -3,19 +3,27 @@
 
 #include "sfhandle.hpp"
 #include "sfinstrumentzone.hpp"
+#include "sfmemory.hpp"
 
 #include <cstdint>
+#include <concepts>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <optional>
+#include <span>
 #include <vector>
 #include <string>
 #include <string_view>
 
 namespace SF2ML {
+	class SfObserver;
+
 	class SfInstrument {
+		friend class SoundFont;
+		friend class SoundFontImpl;
 	public:
-		SfInstrument(InstHandle handle);
+		SfInstrument(InstHandle handle, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 		~SfInstrument();
 		SfInstrument(const SfInstrument&) = delete;
 		SfInstrument(SfInstrument&&) noexcept;
@@ -31,8 +39,34 @@ namespace SF2ML {
 
 		void ForEachZone(std::function<void(SfInstrumentZone&)> pred);
 		void ForEachZone(std::function<void(const SfInstrumentZone&)> pred) const;
+		/// @brief all zones in a contiguous view, the global zone first (invalidated by NewZone/RemoveZone)
+		auto Zones() const noexcept -> std::span<const SfInstrumentZone>;
+		// overloads of ForEachZone/FindZone taking the callable as is, so it can be inlined (picked for lambdas)
+		template <std::invocable<SfInstrumentZone&> F>
+		void ForEachZone(F&& f) {
+			for (SfInstrumentZone& zone : MutableZones()) {
+				f(zone);
+			}
+		}
+		template <std::invocable<const SfInstrumentZone&> F>
+		void ForEachZone(F&& f) const {
+			for (const SfInstrumentZone& zone : Zones()) {
+				f(zone);
+			}
+		}
+		template <std::predicate<const SfInstrumentZone&> Pred>
+		auto FindZone(Pred&& pred) -> std::optional<IZoneHandle> {
+			for (const SfInstrumentZone& zone : Zones()) {
+				if (pred(zone)) {
+					return zone.GetHandle();
+				}
+			}
+			return std::nullopt;
+		}
 
 		void RemoveZone(IZoneHandle zone_handle);
+		/// @brief removes several zones at once, in a single pass over the zones (non existing handles are ignored)
+		void RemoveZones(std::span<const IZoneHandle> zone_handles);
 
 		auto FindZone(std::function<bool(const SfInstrumentZone&)> pred)
 		-> std::optional<IZoneHandle>;
@@ -44,7 +78,13 @@ namespace SF2ML {
 		std::string GetName() const;
 
 	private:
-		std::unique_ptr<class SfInstrumentImpl> pimpl;
+		// attaches the object and its zones to the observer (edits made afterwards are reported to it)
+		void Attach(SfObserver* observer);
+		// reports that its zones no longer reference anything and stops reporting (the object is being removed)
+		void Detach();
+		auto MutableZones() noexcept -> std::span<SfInstrumentZone>;
+
+		PmrUniquePtr<class SfInstrumentImpl> pimpl;
 	};
 }
 
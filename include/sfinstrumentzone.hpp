@@ -5,20 +5,27 @@
 #include "sfhandle.hpp"
 #include "sfgenerator.hpp"
 #include "sfmodulator.hpp"
+#include "sfmemory.hpp"
 
 #include <cstdint>
 #include <optional>
 #include <memory>
+#include <memory_resource>
+#include <concepts>
 #include <functional>
+#include <span>
 
 namespace SF2ML {
 	enum class LoopMode {
 		NoLoop, Loop, LoopWithRemainder
 	};
 
+	class SfObserver;
+
 	class SfInstrumentZone {
+		friend class SfInstrument;
 	public:
-		SfInstrumentZone(IZoneHandle handle);
+		SfInstrumentZone(IZoneHandle handle, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 		~SfInstrumentZone();
 		SfInstrumentZone(const SfInstrumentZone&) = delete;
 		SfInstrumentZone(SfInstrumentZone&&) noexcept;
@@ -36,17 +43,48 @@ namespace SF2ML {
 		auto NewModulator() -> SfModulator&;
 		auto NewModulatorWithKey(ModHandle handle) -> SfModulator&;
 		void RemoveModulator(ModHandle handle);
+		/// @note edits made through the returned reference are not reported to the owning SoundFont
 		auto GetModulator(ModHandle handle) -> SfModulator&;
 		auto FindModulator(std::function<bool(const SfModulator&)> pred) const -> std::optional<ModHandle>;
 		auto FindModulators(std::function<bool(const SfModulator&)> pred) const -> std::vector<ModHandle>;
 		void ForEachModulators(std::function<void(SfModulator&)> pred);
 		void ForEachModulators(std::function<void(const SfModulator&)> pred) const;
+		// overloads of the above taking the callable as is, so it can be inlined (picked for lambdas)
+		template <std::predicate<const SfModulator&> Pred>
+		auto FindModulator(Pred&& pred) const -> std::optional<ModHandle> {
+			for (const SfModulator& mod : Modulators()) {
+				if (pred(mod)) {
+					return mod.GetHandle();
+				}
+			}
+			return std::nullopt;
+		}
+		template <std::invocable<SfModulator&> F>
+		void ForEachModulators(F&& f) {
+			for (SfModulator& mod : MutableModulators()) {
+				f(mod);
+			}
+			NotifyEdited();
+		}
+		template <std::invocable<const SfModulator&> F>
+		void ForEachModulators(F&& f) const {
+			for (const SfModulator& mod : Modulators()) {
+				f(mod);
+			}
+		}
+		/// @brief contiguous view of the zone's modulators in file order (invalidated when modulators are added/removed)
+		auto Modulators() const noexcept -> std::span<const SfModulator>;
 		auto GetModIndex(ModHandle handle) const -> std::optional<std::uint16_t>;
 
 		DWORD GeneratorCount() const noexcept;
 		bool HasGenerator(SFGenerator type) const;
 		auto SetGenerator(SFGenerator type, std::optional<SfGenAmount> amt) -> SfInstrumentZone&;
 		auto GetGenerator(SFGenerator type) const -> SfGenAmount;
+		/// @brief contiguous view of the set generators with their raw amounts, sorted by generator type
+		/// (invalidated when generators are set/reset)
+		auto Generators() const noexcept -> std::span<const SfGenEntry>;
+		/// @brief bit i is set when generator i is set; the k-th entry of Generators() is the k-th set bit
+		auto GeneratorMask() const noexcept -> std::uint64_t;
 
 		SfInstrumentZone& CopyProperties(const SfInstrumentZone& zone);
 		SfInstrumentZone& MoveProperties(SfInstrumentZone&& zone);
@@ -264,8 +302,15 @@ namespace SF2ML {
 		auto SetOverridingRootKey(std::optional<std::int16_t> x) -> SfInstrumentZone&;
 
 	private:
-		// Modulators are currently not defined...
-		std::unique_ptr<class SfInstrumentZoneImpl> pimpl;
+		// attaches the zone to the observer of its owner (edits made afterwards are reported to it)
+		void Attach(SfObserver* observer, InstHandle owner);
+		// reports that the zone no longer references anything and stops reporting (the zone is being removed)
+		void Detach();
+		auto MutableModulators() noexcept -> std::span<SfModulator>;
+		// reports an edit made through MutableModulators()
+		void NotifyEdited();
+
+		PmrUniquePtr<class SfInstrumentZoneImpl> pimpl;
 	};
 }
 
@@ -0,0 +1,33 @@
+#ifndef SF2ML_SFMEMORY_HPP_
+#define SF2ML_SFMEMORY_HPP_
+
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+namespace SF2ML {
+
+	/// Deleter for objects created by MakePmrUnique.
+	/// The storage is returned to the memory resource it was obtained from.
+	template <typename T>
+	struct PmrDeleter {
+		std::pmr::memory_resource* resource = nullptr;
+
+		void operator()(T* ptr) const {
+			std::pmr::polymorphic_allocator<>(resource).delete_object(ptr);
+		}
+	};
+
+	/// std::unique_ptr whose storage is owned by a std::pmr::memory_resource.
+	template <typename T>
+	using PmrUniquePtr = std::unique_ptr<T, PmrDeleter<T>>;
+
+	/// std::make_unique counterpart for PmrUniquePtr.
+	template <typename T, typename... Args>
+	PmrUniquePtr<T> MakePmrUnique(std::pmr::memory_resource* resource, Args&&... args) {
+		T* ptr = std::pmr::polymorphic_allocator<>(resource).new_object<T>(std::forward<Args>(args)...);
+		return PmrUniquePtr<T>(ptr, PmrDeleter<T>{ resource });
+	}
+}
+
+#endif
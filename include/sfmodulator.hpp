@@ -3,19 +3,17 @@
 
 #include "sfhandle.hpp"
 #include "sfspec.hpp"
-#include <memory>
+#include <type_traits>
 #include <variant>
 
 namespace SF2ML {
+	/// A single modulator record.
+	/// Modulators are plain 16-byte values stored contiguously in their zone,
+	/// so copying, iterating and serializing them never touches the heap.
 	class SfModulator {
 	public:
 		SfModulator(ModHandle handle);
-		~SfModulator();
 		ModHandle GetHandle() const;
-		SfModulator(const SfModulator&);
-		SfModulator(SfModulator&&) noexcept;
-		SfModulator& operator=(const SfModulator&);
-		SfModulator& operator=(SfModulator&&) noexcept;
 
 		auto SetSource(SFModulator bits) -> SfModulator&;
 		
@@ -49,6 +47,11 @@ namespace SF2ML {
 
 		auto SetModAmount(std::int16_t amt)-> SfModulator&;
 
+		/// @brief raw SFModulator bits of the source (as stored in pmod/imod)
+		auto GetSourceBits() const -> SFModulator;
+		/// @brief raw SFModulator bits of the amount source (as stored in pmod/imod)
+		auto GetAmtSourceBits() const -> SFModulator;
+
 		auto GetSourceController() const -> std::variant<GeneralController, MidiController>;
 		auto GetAmtSourceController() const -> std::variant<GeneralController, MidiController>;
 		auto GetSourcePolarity() const -> bool;
@@ -62,9 +65,18 @@ namespace SF2ML {
 		auto GetDestination() const -> std::variant<SFGenerator, ModHandle>;
 		auto GetModAmount() const -> std::int16_t;
 	private:
-		std::unique_ptr<class SfModulatorImpl> pimpl;
+		ModHandle self_handle;
+
+		SFModulator src = 0;
+		SFModulator amt_src = 0;
+		SHORT mod_amt = 0;
+		SFTransform trans = SFTransform::SfModLinearTransform;
+		SFGenerator dst = static_cast<SFGenerator>(0);
 	};
 
+	static_assert(std::is_trivially_copyable_v<SfModulator>);
+	static_assert(sizeof(SfModulator) == 16);
+
 	inline bool MatchController(const std::variant<GeneralController, MidiController>& x,
 								const std::variant<GeneralController, MidiController>& y) {
 		return x == y;
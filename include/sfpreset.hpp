@@ -3,19 +3,27 @@
 
 #include "sfhandle.hpp"
 #include "sfpresetzone.hpp"
+#include "sfmemory.hpp"
 
 #include <cstdint>
+#include <concepts>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <optional>
+#include <span>
 #include <vector>
 #include <string>
 #include <string_view>
 
 namespace SF2ML {
+	class SfObserver;
+
 	class SfPreset {
+		friend class SoundFont;
+		friend class SoundFontImpl;
 	public:
-		SfPreset(PresetHandle handle);
+		SfPreset(PresetHandle handle, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 		~SfPreset();
 		SfPreset(const SfPreset&) = delete;
 		SfPreset(SfPreset&&) noexcept;
@@ -31,8 +39,34 @@ namespace SF2ML {
 
 		void ForEachZone(std::function<void(SfPresetZone&)> pred);
 		void ForEachZone(std::function<void(const SfPresetZone&)> pred) const;
+		/// @brief all zones in a contiguous view, the global zone first (invalidated by NewZone/RemoveZone)
+		auto Zones() const noexcept -> std::span<const SfPresetZone>;
+		// overloads of ForEachZone/FindZone taking the callable as is, so it can be inlined (picked for lambdas)
+		template <std::invocable<SfPresetZone&> F>
+		void ForEachZone(F&& f) {
+			for (SfPresetZone& zone : MutableZones()) {
+				f(zone);
+			}
+		}
+		template <std::invocable<const SfPresetZone&> F>
+		void ForEachZone(F&& f) const {
+			for (const SfPresetZone& zone : Zones()) {
+				f(zone);
+			}
+		}
+		template <std::predicate<const SfPresetZone&> Pred>
+		auto FindZone(Pred&& pred) -> std::optional<PZoneHandle> {
+			for (const SfPresetZone& zone : Zones()) {
+				if (pred(zone)) {
+					return zone.GetHandle();
+				}
+			}
+			return std::nullopt;
+		}
 
 		void RemoveZone(PZoneHandle zone_handle);
+		/// @brief removes several zones at once, in a single pass over the zones (non existing handles are ignored)
+		void RemoveZones(std::span<const PZoneHandle> zone_handles);
 
 		auto FindZone(std::function<bool(const SfPresetZone&)> pred)
 		-> std::optional<PZoneHandle>;
@@ -49,7 +83,13 @@ namespace SF2ML {
 		std::string GetName() const;
 
 	private:
-		std::unique_ptr<class SfPresetImpl> pimpl;
+		// attaches the object and its zones to the observer (edits made afterwards are reported to it)
+		void Attach(SfObserver* observer);
+		// reports that its zones no longer reference anything and stops reporting (the object is being removed)
+		void Detach();
+		auto MutableZones() noexcept -> std::span<SfPresetZone>;
+
+		PmrUniquePtr<class SfPresetImpl> pimpl;
 	};
 }
 
@@ -0,0 +1,97 @@
+#ifndef SF2ML_SFRESIDENCY_HPP_
+#define SF2ML_SFRESIDENCY_HPP_
+
+#include "sf2ml.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace SF2ML {
+	/// Counters of an SfResidencyManager (see SfResidencyManager::GetStats).
+	struct SfResidencyStats {
+		std::uint64_t hits { 0 };            // accesses to resident points(accesses to pinned samples are not counted)
+		std::uint64_t misses { 0 };          // accesses that read the points back
+		std::uint64_t failed_reads { 0 };    // misses whose points could not be read back
+		std::uint64_t evictions { 0 };       // samples whose points were dropped
+		std::uint64_t spills { 0 };          // evictions that wrote the points to the spill file
+		std::uint64_t bytes_read { 0 };      // read back by misses, from the bank files and the spill file
+		std::uint64_t bytes_spilled { 0 };
+		std::size_t resident_bytes { 0 };    // points of the managed samples held in memory, pinned ones included
+		std::size_t pinned_bytes { 0 };
+		std::size_t managed_samples { 0 };
+	};
+
+	/// Keeps the sample points of any number of banks within a memory budget.
+	///
+	///  - Managed samples hold their points until the resident points of every managed sample exceed the budget;
+	///    the least recently used ones are then evicted(dropped from memory), and read back on their next access:
+	///    GetWav, ReadWav and GetSampleAt fault them in transparently.
+	///  - Samples whose points are still those of the bank file are read back from their range of the sdta chunk.
+	///    Samples added or edited after Manage are written to a spill file when they are evicted, and read back from it.
+	///  - Pinned samples(Pin, PinPreset) are never evicted, and their points are read without locking;
+	///    they may hold the resident points above the budget. Real-time threads only see the points of pinned
+	///    samples(SoundFontRtView::GetSampleData is empty for the others): pin them from another thread.
+	///  - Any number of threads may read managed samples concurrently: ReadWav and GetSampleAt copy under the lock
+	///    of the manager. A span returned by GetWav stays valid until its sample is evicted, which may be by the next
+	///    access to another sample: pin the samples whose spans are kept(ex: the samples of the presets being played).
+	///  - Samples whose points come from a source(SfSample::SetWavSource) are not managed.
+	///  - A bank may be saved or frozen while it is managed(its samples are faulted in one by one),
+	///    but not over its own file: release it first, and manage the bank loaded back.
+	class SfResidencyManager {
+	public:
+		/// @param budget bytes of sample points held in memory, for every bank managed
+		/// @param spill_dir where the spill file is created(on the first spill), and removed with the manager
+		/// @param resource for the bookkeeping of the manager(the points stay in the memory resource of their bank)
+		explicit SfResidencyManager(std::size_t budget,
+									const std::filesystem::path& spill_dir = std::filesystem::temp_directory_path(),
+									std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		/// @brief releases every bank still managed (see Release)
+		~SfResidencyManager();
+		SfResidencyManager(const SfResidencyManager&) = delete;
+		SfResidencyManager& operator=(const SfResidencyManager&) = delete;
+
+		/// @brief Manages the samples of sf2, which must have just been loaded from sf2_path(sample handles are the
+		///        indices of the shdr records then). A sample whose record no longer matches(point count, bit depth)
+		///        is managed as an edited one. The file must not change while the bank is managed.
+		///        The samples are evicted down to the budget right away.
+		/// @retval SF2ML::SF2ML_FAILED when the file cannot be mapped, or is not a RIFF sfbk file
+		auto Manage(SoundFont& sf2, const std::filesystem::path& sf2_path) -> SF2MLError;
+
+		/// @brief Manages the samples of a bank that does not come from a file(built or imported):
+		///        evicted points always go to the spill file.
+		void Manage(SoundFont& sf2);
+
+		/// @brief Reads every evicted sample of sf2 back, and stops managing them.
+		///        Samples whose points cannot be read back are left empty.
+		void Release(SoundFont& sf2);
+
+		/// @brief Faults the sample in and keeps it resident until it is unpinned as many times.
+		///        Samples that are not managed are left as they are.
+		/// @return false when the points could not be read back(the sample is not pinned then)
+		auto Pin(const SfSample& smpl) -> bool;
+		void Unpin(const SfSample& smpl);
+
+		/// @brief Pins every sample played by the preset(the samples of the instrument zones of its zones).
+		/// @return the samples pinned(allocated from the resource of the manager), to be given back to Unpin
+		///         (the preset may be edited meanwhile)
+		auto PinPreset(SoundFont& sf2, PresetHandle preset) -> std::pmr::vector<SmplHandle>;
+		void Unpin(SoundFont& sf2, std::span<const SmplHandle> smpls);
+
+		auto GetBudget() const -> std::size_t;
+		/// @brief Changes the budget, evicting samples down to it.
+		void SetBudget(std::size_t budget);
+
+		auto GetStats() const -> SfResidencyStats;
+		/// @brief Resets the counters(resident_bytes, pinned_bytes and managed_samples are kept).
+		void ResetStats();
+
+	private:
+		PmrUniquePtr<class SfResidencyManagerImpl> pimpl;
+	};
+}
+
+#endif
@@ -4,19 +4,36 @@
 #include "wavspec.hpp"
 #include "sfspec.hpp"
 #include "sfhandle.hpp"
+#include "sfmemory.hpp"
 
 #include <cstdint>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <fstream>
+#include <functional>
 #include <vector>
+#include <span>
 #include <string>
 #include <string_view>
 
 namespace SF2ML {
+	class SfObserver;
+
+	/// Produces the sample points [first, first + out.size() / point size) of a sample,
+	/// in the layout SetWav takes (little endian, 2 or 3 bytes per point).
+	/// It may be called several times for the same points, and must give the same bytes every time.
+	using SfWavSource = std::function<void(std::uint32_t first, std::span<BYTE> out)>;
+
 	class SfSample {
+		friend class SoundFont;
+		friend class SoundFontImpl;
+		friend class SfResidencyManagerImpl;
+		friend class SoundFontRtView;
 	public:
-		SfSample(SmplHandle handle, SampleBitDepth bit_depth);
+		SfSample(SmplHandle handle,
+				 SampleBitDepth bit_depth,
+				 std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 		~SfSample();
 		SfSample(const SfSample&) = delete;
 		SfSample(SfSample&& rhs) noexcept;
@@ -30,13 +47,26 @@ namespace SF2ML {
 		SfSample& SetLink(std::optional<SmplHandle> smpl);
 		SfSample& SetSampleMode(SFSampleLink mode);
 		SfSample& SetSampleRate(std::uint32_t smpl_rate);
-		SfSample& SetWav(std::vector<BYTE>&& wav) noexcept;
-		SfSample& SetWav(const std::vector<BYTE>& wav);
+		SfSample& SetWav(std::pmr::vector<BYTE>&& wav);
+		SfSample& SetWav(std::span<const BYTE> wav);
+		/// @brief Makes the `count` sample points come from `source` instead of a buffer:
+		///        they are produced on demand (GetSampleAt, ReadWav, and Save, which writes them block by block),
+		///        so that banks larger than memory can be written. SetWav replaces the source.
+		SfSample& SetWavSource(std::uint32_t count, SfWavSource source);
 
 		SmplHandle GetHandle() const;
 
 		std::string GetName() const;
-		const std::vector<BYTE>& GetWav() const;
+		/// @note empty when the sample points come from a source (see SetWavSource).
+		///       The points of a sample managed by an SfResidencyManager are read back if they were evicted.
+		std::span<const BYTE> GetWav() const;
+		/// @brief Copies the sample points [first, first + out.size() / point size) into out,
+		///        from the buffer or from the source.
+		void ReadWav(std::uint32_t first, std::span<BYTE> out) const;
+		bool HasWavSource() const;
+		/// @brief Whether an SfResidencyManager manages the sample points: another thread may then evict them
+		///        at any time, so they are only safe to read through ReadWav, or while the sample is pinned.
+		bool IsManaged() const;
 		int32_t GetSampleAt(uint32_t pos) const;
 		std::size_t GetSampleCount() const;
 		int32_t GetSampleRate() const;
@@ -49,7 +79,13 @@ namespace SF2ML {
 
 		SF2MLError Serialize(std::ofstream& ofs) const;
 	private:
-		std::unique_ptr<class SfSampleImpl> pimpl;
+		// attaches the object to the observer (edits made afterwards are reported to it)
+		void Attach(SfObserver* observer);
+		// the points as they are, without reading them back: empty while an SfResidencyManager manages them
+		// and they are not pinned(see SoundFontRtView::GetSampleData)
+		std::span<const BYTE> GetResidentWav() const noexcept;
+
+		PmrUniquePtr<class SfSampleImpl> pimpl;
 	};
 }
 
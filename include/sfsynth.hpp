@@ -0,0 +1,56 @@
+#ifndef SF2ML_SFSYNTH_HPP_
+#define SF2ML_SFSYNTH_HPP_
+
+#include "sf2ml.hpp"
+
+#include <cstdint>
+
+namespace SF2ML {
+	/// Shape of a synthetic bank, for load testing and benchmarks.
+	/// Every name, value and sample point is derived from `seed`, so the same spec builds the same bank
+	/// (and saves the same file) on every run and platform.
+	struct SfSynthSpec {
+		std::uint64_t seed = 1;
+		std::uint32_t instruments = 1;
+		std::uint32_t zones_per_instrument = 100;  // besides the global zone
+		std::uint32_t modulator_chain = 0;         // modulators of each instrument zone, each one feeding the previous one
+		std::uint32_t presets = 0;                 // one zone each, cycling over the instruments (0: one per instrument)
+		std::uint32_t samples = 256;               // mono samples, or left/right pairs when stereo
+		std::uint32_t sample_points = 20480;       // per sample
+		SampleBitDepth bit_depth = SampleBitDepth::Signed16;
+		bool stereo = false;
+		bool stream_samples = true;                // produce the points while saving(SfSample::SetWavSource) instead of holding them
+
+		auto PresetCount() const noexcept -> std::uint32_t { return presets ? presets : instruments; }
+		auto InstrumentZones() const noexcept -> std::uint64_t { return std::uint64_t(instruments) * zones_per_instrument; }
+	};
+
+	/// records the bank puts in the pdta chunks, terminal records included
+	struct SfSynthRecords {
+		std::uint64_t preset_bags = 0;
+		std::uint64_t preset_mods = 0;
+		std::uint64_t preset_gens = 0;
+		std::uint64_t inst_bags = 0;
+		std::uint64_t inst_mods = 0;
+		std::uint64_t inst_gens = 0;
+	};
+
+	auto CountSynthRecords(const SfSynthSpec& spec) noexcept -> SfSynthRecords;
+
+	/// @brief whether the saved bank fits the 16-bit bag/generator/modulator/sample indexes of the format
+	///        (larger banks can be saved, but not loaded back)
+	bool SynthFitsFileIndexes(const SfSynthSpec& spec) noexcept;
+
+	/// @brief Grows spec to the largest bank of its shape that still fits the 16-bit indexes:
+	///        as many instruments as the instrument bags, generators and modulators allow,
+	///        and as many presets as the preset bags and generators allow.
+	auto MaximizeSynthIndexes(SfSynthSpec spec) noexcept -> SfSynthSpec;
+
+	/// @brief Fills an empty SoundFont with the bank described by spec, through the public API:
+	///        samples of a triangle wave plus noise, instruments whose zones spread over key ranges and samples,
+	///        then the presets.
+	/// @retval SF2ML::SF2ML_INCOMPATIBLE_BIT_DEPTH when sf2 already has samples of another bit depth
+	auto BuildSynthBank(SoundFont& sf2, const SfSynthSpec& spec) -> SF2MLError;
+}
+
+#endif
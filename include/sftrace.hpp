@@ -0,0 +1,33 @@
+#ifndef SF2ML_SFTRACE_HPP_
+#define SF2ML_SFTRACE_HPP_
+
+#include "sftypes.hpp"
+
+#include <cstddef>
+#include <ostream>
+
+namespace SF2ML {
+	/// @brief Starts recording trace events of the library(Load and its phases, Save and its sections,
+	///        sample imports, batch removals, sample conversions) for every thread.
+	///        Each thread records into a ring of its own, allocated on its first event;
+	///        when a ring is full, its oldest events are overwritten.
+	/// @param events_per_thread size of the rings(rounded up to a power of two); rings of another size are
+	///        replaced on the next event of their thread
+	/// @note  While tracing is disabled, a traced operation costs one relaxed load and one branch.
+	void EnableTrace(std::size_t events_per_thread = 1 << 16);
+
+	/// @brief Stops recording. The events already recorded are kept until the next FlushTrace.
+	void DisableTrace() noexcept;
+
+	auto IsTraceEnabled() noexcept -> bool;
+
+	/// @brief Writes the recorded events as Chrome trace-event JSON(chrome://tracing, ui.perfetto.dev),
+	///        then forgets them.
+	///        Events are complete("X") events whose timestamps are the steady clock in microseconds
+	///        (CLOCK_MONOTONIC on Linux), so they line up with host traces taken on the same clock.
+	/// @note  Events recorded by other threads during the flush are either written whole or left for the next flush.
+	/// @retval SF2ML::SF2ML_FAILED when the stream fails
+	auto FlushTrace(std::ostream& os) -> SF2MLError;
+}
+
+#endif
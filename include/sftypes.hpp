@@ -32,6 +32,11 @@ namespace SF2ML {
 		SF2ML_UNIMPLEMENTED,
 		SF2ML_MIXED_BIT_DEPTH,
 		SF2ML_NO_SUCH_MODULATORS,
+		SF2ML_STILL_REFERENCED,
+		SF2ML_STALE_CACHE,
+		SF2ML_BAD_CACHE,
+		SF2ML_INDEX_OVERFLOW,
+		SF2ML_FILE_TOO_LARGE,
 		SF2ML_END_OF_ERRCODE
 	};
 
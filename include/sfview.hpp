@@ -0,0 +1,125 @@
+#ifndef SF2ML_SFVIEW_HPP_
+#define SF2ML_SFVIEW_HPP_
+
+#include "sfspec.hpp"
+#include "wavspec.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace SF2ML {
+	/// Read-only view of the records of a .sf2 file, for programs that only play banks.
+	///
+	/// Unlike SoundFont::Load, opening a view builds no object model: the file is mapped into memory,
+	/// the chunks are located(a few dozen chunk headers are read), and the records are handed out as spans
+	/// of the file itself. Opening takes the same time whatever the size of the bank, and allocates nothing
+	/// per preset, instrument or sample.
+	///
+	///  - Chunk accessors(Phdr, Pbag, ...) return every record of the chunk, terminal record included.
+	///  - Record accessors(PresetBags, InstrumentGenerators, SampleData, ...) are bounds checked: they return
+	///    an empty span when the index, or an index found in the file, is out of range.
+	///  - The spans are valid until the view is closed, reopened or destroyed.
+	///  - The view is never written to, so any number of threads may read it concurrently.
+	class SoundFontView {
+	public:
+		SoundFontView() noexcept = default;
+		~SoundFontView();
+		SoundFontView(SoundFontView&& other) noexcept;
+		SoundFontView& operator=(SoundFontView&& other) noexcept;
+		SoundFontView(const SoundFontView&) = delete;
+		SoundFontView& operator=(const SoundFontView&) = delete;
+
+		/// @brief Maps the file at path(read-only) and opens it. The view keeps the mapping until it is closed.
+		/// @retval SF2ML::SF2ML_FAILED when the file cannot be mapped, or is not a RIFF sfbk file
+		/// @retval SF2ML::SF2ML_INVALID_CK_SIZE when a hydra chunk is not a whole number of records
+		/// @retval SF2ML::SF2ML_MISSING_TERMINAL_RECORD when a hydra chunk is empty
+		auto Open(const std::filesystem::path& path) -> SF2MLError;
+
+		/// @brief Opens a file already in memory. file must outlive the view(or its next Open/Close).
+		auto Open(std::span<const BYTE> file) -> SF2MLError;
+
+		void Close() noexcept;
+
+		auto IsOpen() const noexcept -> bool { return !phdr.empty(); }
+
+		/// RIFF/pdta chunks
+		auto Phdr() const noexcept -> std::span<const spec::SfPresetHeader> { return phdr; }
+		auto Pbag() const noexcept -> std::span<const spec::SfPresetBag> { return pbag; }
+		auto Pmod() const noexcept -> std::span<const spec::SfModList> { return pmod; }
+		auto Pgen() const noexcept -> std::span<const spec::SfGenList> { return pgen; }
+		auto Inst() const noexcept -> std::span<const spec::SfInst> { return inst; }
+		auto Ibag() const noexcept -> std::span<const spec::SfInstBag> { return ibag; }
+		auto Imod() const noexcept -> std::span<const spec::SfInstModList> { return imod; }
+		auto Igen() const noexcept -> std::span<const spec::SfInstGenList> { return igen; }
+		auto Shdr() const noexcept -> std::span<const spec::SfSample> { return shdr; }
+
+		/// numbers of records, without the terminal ones
+		auto PresetCount() const noexcept -> std::size_t { return phdr.empty() ? 0 : phdr.size() - 1; }
+		auto InstrumentCount() const noexcept -> std::size_t { return inst.empty() ? 0 : inst.size() - 1; }
+		auto SampleCount() const noexcept -> std::size_t { return shdr.empty() ? 0 : shdr.size() - 1; }
+
+		/// @brief zones(bags) of the preset record phdr[preset]
+		auto PresetBags(std::size_t preset) const noexcept -> std::span<const spec::SfPresetBag>;
+		/// @brief generators/modulators of the preset zone pbag[bag]
+		auto PresetGenerators(std::size_t bag) const noexcept -> std::span<const spec::SfGenList>;
+		auto PresetModulators(std::size_t bag) const noexcept -> std::span<const spec::SfModList>;
+
+		/// @brief zones(bags) of the instrument record inst[inst_no]
+		auto InstrumentBags(std::size_t inst_no) const noexcept -> std::span<const spec::SfInstBag>;
+		/// @brief generators/modulators of the instrument zone ibag[bag]
+		auto InstrumentGenerators(std::size_t bag) const noexcept -> std::span<const spec::SfInstGenList>;
+		auto InstrumentModulators(std::size_t bag) const noexcept -> std::span<const spec::SfInstModList>;
+
+		auto GetBitDepth() const noexcept -> SampleBitDepth {
+			return sm24.empty() ? SampleBitDepth::Signed16 : SampleBitDepth::Signed24;
+		}
+		/// @brief 16-bit little endian points of the sample record shdr[sample]
+		///        (the upper 16 bits of the points in 24-bit banks); empty for ROM samples
+		auto SampleData(std::size_t sample) const noexcept -> std::span<const BYTE>;
+		/// @brief lower 8 bits of the points of shdr[sample], in 24-bit banks(empty otherwise)
+		auto SampleData24(std::size_t sample) const noexcept -> std::span<const BYTE>;
+
+		/// @brief index of the first preset record with this bank and program(a linear search)
+		auto FindPreset(std::uint16_t bank, std::uint16_t program) const noexcept -> std::optional<std::size_t>;
+
+		/// @brief record names are 20 characters, zero terminated unless they are 20 characters long
+		template <std::size_t N>
+		static auto Name(const CHAR (&name)[N]) noexcept -> std::string_view {
+			const char* chars = reinterpret_cast<const char*>(name);
+			std::size_t len = 0;
+			while (len < N && chars[len] != '\0') {
+				len++;
+			}
+			return { chars, len };
+		}
+
+	private:
+		auto MapChunks(std::span<const BYTE> file) -> SF2MLError;
+		void Unmap() noexcept;
+
+		// the mapping of Open(path); nothing after Open(span)
+		struct Mapping {
+			void* address = nullptr;
+			std::size_t size = 0;
+			void* handle = nullptr; // the file mapping object on Windows
+		} mapping;
+
+		std::span<const spec::SfPresetHeader> phdr;
+		std::span<const spec::SfPresetBag> pbag;
+		std::span<const spec::SfModList> pmod;
+		std::span<const spec::SfGenList> pgen;
+		std::span<const spec::SfInst> inst;
+		std::span<const spec::SfInstBag> ibag;
+		std::span<const spec::SfInstModList> imod;
+		std::span<const spec::SfInstGenList> igen;
+		std::span<const spec::SfSample> shdr;
+		std::span<const BYTE> smpl;
+		std::span<const BYTE> sm24;
+	};
+}
+
+#endif
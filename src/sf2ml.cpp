@@ -1,6 +1,13 @@
 #include "sfmap.hpp"
 #include "sfloader.hpp"
 #include "sfserializer.hpp"
+#include "sfobserver.hpp"
+#include "sfnoteindex.hpp"
+#include "sflookupindex.hpp"
+#include "sfrefindex.hpp"
+#include "sfsizecache.hpp"
+#include "sfstats.hpp"
+#include "sftracing.hpp"
 
 #include <sfinstrument.hpp>
 #include <sfpreset.hpp>
@@ -24,8 +31,70 @@ namespace SF2ML {
 		return sz;
 	}
 
-	class SoundFontImpl {
+	class SoundFontImpl : public SfObserver {
 		friend class SoundFont;
+		friend class SoundFontRtView;
+	public:
+		SoundFontImpl(std::pmr::memory_resource* resource)
+			: resource{resource},
+			  samples(resource),
+			  instruments(resource),
+			  presets(resource),
+			  infos(resource),
+			  note_index(resource),
+			  sample_names(resource),
+			  inst_names(resource),
+			  preset_names(resource),
+			  preset_programs(resource),
+			  sample_refs(resource),
+			  inst_refs(resource),
+			  size_cache(resource) {}
+
+		void OnPresetChanged(PresetHandle preset) override {
+			note_index.MarkPreset(preset);
+			size_cache.MarkPreset(preset);
+		}
+		void OnPresetRenumbered(PresetHandle preset) override {
+			note_index.MarkRenumbered(preset);
+			const SfPreset& obj = *presets.Get(preset);
+			preset_programs.Update(preset, ProgramKey(obj.GetBankNumber(), obj.GetPresetNumber()));
+		}
+		void OnInstrumentChanged(InstHandle inst) override {
+			note_index.MarkInstrument(inst);
+			size_cache.MarkInstrument(inst);
+		}
+		void OnSampleChanged(SmplHandle smpl) override {
+			size_cache.MarkSample(smpl);
+		}
+		void OnPresetRenamed(PresetHandle preset) override {
+			preset_names.Update(preset, MakeNameKey(presets.Get(preset)->GetName()));
+		}
+		void OnInstrumentRenamed(InstHandle inst) override {
+			inst_names.Update(inst, MakeNameKey(instruments.Get(inst)->GetName()));
+		}
+		void OnSampleRenamed(SmplHandle smpl) override {
+			sample_names.Update(smpl, MakeNameKey(samples.Get(smpl)->GetName()));
+		}
+		void OnZoneSampleChanged(InstHandle inst, IZoneHandle zone, std::optional<SmplHandle> smpl) override {
+			sample_refs.Set(inst, zone, smpl);
+		}
+		void OnZoneInstrumentChanged(PresetHandle preset, PZoneHandle zone, std::optional<InstHandle> inst) override {
+			inst_refs.Set(preset, zone, inst);
+		}
+	private:
+		// the full program number is kept, so that out of range programs never alias onto valid ones
+		// (the same key as FrozenSoundFont)
+		static DWORD ProgramKey(WORD bank, WORD program) noexcept {
+			return (static_cast<DWORD>(bank) << 16) | program;
+		}
+
+		// attaches every object(and their zones) to this object, and rebuilds the lookup indexes
+		void AttachAll();
+
+		// loads a file into this(empty) object, the file contents and the working buffers of the load
+		// coming from scratch; stats is only touched when Collect is set
+		template <bool Collect>
+		auto LoadFile(std::ifstream& ifs, std::pmr::memory_resource* scratch, SfLoadStats* stats) -> SF2MLError;
 
 		auto AddMono(const void* wav_data,
 					 std::size_t wav_size,
@@ -47,22 +116,73 @@ namespace SF2ML {
 
 		auto LinkStereo(SmplHandle left, SmplHandle right) -> SF2MLError;
 		void Remove(SmplHandle target, RemovalMode rm_mode);
+		auto Remove(std::span<const SmplHandle> targets, RemovalMode rm_mode, ReferenceMode ref_mode) -> SF2MLError;
+		auto Remove(std::span<const InstHandle> targets, ReferenceMode ref_mode) -> SF2MLError;
+		void Remove(std::span<const PresetHandle> targets);
+		auto CollectGarbage() -> SfGarbageReport;
+		auto SavedSize() -> std::uint64_t;
+
+		// removes the given zones, with one RemoveZones call per owner
+		template <typename Container, typename OwnerT, typename ZoneT>
+		void RemoveZones(Container& owners, std::pmr::vector<std::pair<OwnerT, ZoneT>>& zones);
 
+		std::pmr::memory_resource* resource;
 		SfHandleInterface<SfSample, SmplHandle> samples;
 		SfHandleInterface<SfInstrument, InstHandle> instruments;
 		SfHandleInterface<SfPreset, PresetHandle> presets;
 		SfInfo infos;
+		SfNoteIndex note_index;
+		// name -> handles, (bank, program) -> presets
+		SfLookupIndex<SmplHandle, SfNameKey, SfNameKeyHash> sample_names;
+		SfLookupIndex<InstHandle, SfNameKey, SfNameKeyHash> inst_names;
+		SfLookupIndex<PresetHandle, SfNameKey, SfNameKeyHash> preset_names;
+		SfLookupIndex<PresetHandle, DWORD> preset_programs;
+		// sample -> instrument zones using it, instrument -> preset zones using it
+		SfReferenceIndex<SmplHandle, InstHandle, IZoneHandle> sample_refs;
+		SfReferenceIndex<InstHandle, PresetHandle, PZoneHandle> inst_refs;
+		// record counts for the size of the saved file
+		SfSizeCache size_cache;
 	};
 
-	SoundFont::SoundFont() {
-		pimpl = std::make_unique<SoundFontImpl>();
+	void SoundFontImpl::AttachAll() {
+		sample_names.Clear();
+		inst_names.Clear();
+		preset_names.Clear();
+		preset_programs.Clear();
+		sample_refs.Clear();
+		inst_refs.Clear();
+		for (SfPreset& preset : presets) {
+			preset.Attach(this);
+			OnPresetRenamed(preset.GetHandle());
+			preset_programs.Update(preset.GetHandle(), ProgramKey(preset.GetBankNumber(), preset.GetPresetNumber()));
+			for (const SfPresetZone& zone : preset.Zones()) {
+				inst_refs.Set(preset.GetHandle(), zone.GetHandle(), zone.GetInstrument());
+			}
+		}
+		for (SfInstrument& inst : instruments) {
+			inst.Attach(this);
+			OnInstrumentRenamed(inst.GetHandle());
+			for (const SfInstrumentZone& zone : inst.Zones()) {
+				sample_refs.Set(inst.GetHandle(), zone.GetHandle(), zone.GetSample());
+			}
+		}
+		for (SfSample& smpl : samples) {
+			smpl.Attach(this);
+			OnSampleRenamed(smpl.GetHandle());
+		}
+		note_index.MarkAll();
+		size_cache.MarkAll();
+	}
+
+	SoundFont::SoundFont(std::pmr::memory_resource* resource) {
+		pimpl = MakePmrUnique<SoundFontImpl>(resource, resource);
 	}
 	SoundFont::~SoundFont() {}
 
-	SF2MLError SoundFont::Load(std::ifstream& ifs)
-	{
-		// reset state
-		pimpl = std::make_unique<SoundFontImpl>();
+	template <bool Collect>
+	auto SoundFontImpl::LoadFile(std::ifstream& ifs, std::pmr::memory_resource* scratch, SfLoadStats* stats) -> SF2MLError {
+		trace::Scope trace("Load");
+		stats::Stopwatch<Collect, SfLoadStats> watch(stats);
 
 		std::size_t sz = GetFileSize(ifs);
 
@@ -70,8 +190,13 @@ namespace SF2ML {
 			return SF2ML_FAILED;
 		}
 
-		std::vector<BYTE> riff_content(sz);
-		ifs.read(reinterpret_cast<char*>(riff_content.data()), sz);
+		std::pmr::vector<BYTE> riff_content(sz, scratch);
+		{
+			trace::Scope trace_read("ReadFile", "bytes", static_cast<std::int64_t>(sz));
+			ifs.read(reinterpret_cast<char*>(riff_content.data()), sz);
+		}
+		watch.Lap(&SfLoadStats::read_ns);
+		stats::Count<Collect>(stats, &SfLoadStats::bytes_read, sz);
 		ChunkHead riff_head;
 		std::memcpy(&riff_head, &riff_content[0], sizeof(riff_head));
 		
@@ -80,50 +205,103 @@ namespace SF2ML {
 		}
 
 		SfbkMap sfbk_map;
-		if (auto err = GetSfbkMap(sfbk_map, &riff_content[8], riff_head.ck_size)) {
-			return err;
+		{
+			trace::Scope trace_map("GetSfbkMap");
+			if (auto err = GetSfbkMap(sfbk_map, &riff_content[8], riff_head.ck_size)) {
+				return err;
+			}
 		}
-		if (auto err = loader::LoadSfbk(pimpl->infos,
-										pimpl->presets,
-										pimpl->instruments,
-										pimpl->samples,
-										sfbk_map)) {
-			return err;
+		watch.Lap(&SfLoadStats::map_ns);
+		SF2MLError err = loader::LoadSfbk<Collect>(infos,
+												   presets,
+												   instruments,
+												   samples,
+												   sfbk_map,
+												   scratch,
+												   stats);
+		watch.Skip(); // the phases of LoadSfbk are timed on their own
+		// the loader builds the objects silently; start tracking the edits from here
+		{
+			trace::Scope trace_attach("AttachAll");
+			AttachAll();
 		}
-
-		return SF2ML_SUCCESS;
+		watch.Lap(&SfLoadStats::index_ns);
+		return err;
 	}
 
-	SF2MLError SoundFont::Save(std::ofstream& ofs) {
-		DWORD riff_size = serializer::CalculateRiffSize(pimpl->infos,
-														pimpl->presets,
-														pimpl->instruments,
-														pimpl->samples, 46);
+	SF2MLError SoundFont::Load(std::ifstream& ifs)
+	{
+		// reset state
+		std::pmr::memory_resource* resource = pimpl->resource;
+		pimpl = MakePmrUnique<SoundFontImpl>(resource, resource);
+		return pimpl->LoadFile<false>(ifs, resource, nullptr);
+	}
 
-		std::vector<BYTE> bytes(riff_size);
+	SF2MLError SoundFont::Load(std::ifstream& ifs, SfLoadStats& stats) {
+		stats = SfLoadStats{};
+		stats::Stopwatch<true, SfLoadStats> watch(&stats);
+		// reset state; the objects are built on the resource of the SoundFont, as by the plain Load,
+		// and only the working buffers of this call go through the counter
+		std::pmr::memory_resource* resource = pimpl->resource;
+		pimpl = MakePmrUnique<SoundFontImpl>(resource, resource);
+		stats::CountingResource counter(resource);
+		SF2MLError err = pimpl->LoadFile<true>(ifs, &counter, &stats);
+		stats.allocations = counter.allocations;
+		stats.allocated_bytes = counter.bytes;
+		watch.Lap(&SfLoadStats::total_ns);
+		return err;
+	}
 
-		BYTE* end = nullptr;
-		if (auto err = serializer::SerializeRiff(bytes.data(),
-												 &end,
-												 pimpl->infos,
-												 pimpl->presets,
-												 pimpl->instruments,
-												 pimpl->samples, 46)) {
-			return err;
-		}
+	auto SoundFont::GetSavedSize() -> std::uint64_t {
+		return pimpl->SavedSize();
+	}
 
-		if (riff_size != end - bytes.data()) {
-			return SF2ML_FAILED;
-		}
+	auto SoundFont::CollectGarbage() -> SfGarbageReport {
+		return pimpl->CollectGarbage();
+	}
 
-		ofs.write(reinterpret_cast<char*>(bytes.data()), bytes.size());		
-		return SF2ML_SUCCESS;
+	SF2MLError SoundFont::Save(std::ofstream& ofs) {
+		trace::Scope trace("Save");
+		// the file is streamed: only the INFO and pdta chunks and a block of sample data are buffered
+		return serializer::WriteRiff<false>(ofs,
+											pimpl->infos,
+											pimpl->presets,
+											pimpl->instruments,
+											pimpl->samples,
+											pimpl->size_cache.Counts(pimpl->presets, pimpl->instruments, pimpl->samples),
+											46,
+											pimpl->resource,
+											nullptr);
+	}
+
+	SF2MLError SoundFont::Save(std::ofstream& ofs, SfSaveStats& stats) {
+		trace::Scope trace("Save");
+		stats = SfSaveStats{};
+		stats::Stopwatch<true, SfSaveStats> watch(&stats);
+		stats::CountingResource counter(pimpl->resource);
+		SF2MLError err = serializer::WriteRiff<true>(ofs,
+													 pimpl->infos,
+													 pimpl->presets,
+													 pimpl->instruments,
+													 pimpl->samples,
+													 pimpl->size_cache.Counts(pimpl->presets, pimpl->instruments, pimpl->samples),
+													 46,
+													 &counter,
+													 &stats);
+		watch.Lap(&SfSaveStats::total_ns);
+		stats.allocations = counter.allocations;
+		stats.allocated_bytes = counter.bytes;
+		return err;
 	}
 
 	SF2MLError SoundFont::ExportWav(std::ofstream& ofs, SmplHandle sample) {
 		return SF2ML_UNIMPLEMENTED;
 	}
 
+	auto SoundFont::GetMemoryResource() const -> std::pmr::memory_resource* {
+		return pimpl->resource;
+	}
+
 	SfInfo& SoundFont::Info() {
 		return pimpl->infos;
 	}
@@ -136,7 +314,7 @@ namespace SF2ML {
 								  SampleChannel ch)
 								  -> SF2MLResult<SmplHandle> {
 		std::size_t size = GetFileSize(ifs);
-		std::vector<char> buf(size);
+		std::pmr::vector<char> buf(size, pimpl->resource);
 		ifs.read(buf.data(), size);
 	
 		return AddMonoSample(
@@ -176,7 +354,7 @@ namespace SF2ML {
 									std::optional<CHAR> pitch_correction)
 									-> SF2MLResult<std::pair<SmplHandle, SmplHandle>> {
 		std::size_t size = GetFileSize(ifs);
-		std::vector<char> buf(size);
+		std::pmr::vector<char> buf(size, pimpl->resource);
 		ifs.read(buf.data(), size);
 
 		return AddStereoSample(buf.data(), size, left, right, loop, root_key, pitch_correction);
@@ -205,6 +383,17 @@ namespace SF2ML {
 		return pimpl->LinkStereo(left, right);
 	}
 
+	auto SoundFont::NewSample(std::string_view name, SampleBitDepth bit_depth) -> SF2MLResult<SmplHandle> {
+		if (pimpl->samples.Count() != 0 && GetBitDepth(pimpl->samples) != bit_depth) {
+			return { SmplHandle{0}, SF2ML_INCOMPATIBLE_BIT_DEPTH };
+		}
+		SfSample& rec = pimpl->samples.NewItem(bit_depth);
+		rec.Attach(pimpl.get());
+		rec.SetName(name);
+		rec.SetSampleRate(44100);
+		return { rec.GetHandle(), SF2ML_SUCCESS };
+	}
+
 	auto SoundFont::GetSample(SmplHandle smpl) -> SfSample& {
 		return *pimpl->samples.Get(smpl);
 	}
@@ -213,6 +402,30 @@ namespace SF2ML {
 		pimpl->Remove(smpl, rm_mode);
 	}
 
+	void SoundFont::RemoveSamples(std::span<const SmplHandle> smpls, RemovalMode rm_mode) {
+		static_cast<void>(pimpl->Remove(smpls, rm_mode, ReferenceMode::Keep));
+	}
+
+	auto SoundFont::RemoveSample(SmplHandle smpl, RemovalMode rm_mode, ReferenceMode ref_mode) -> SF2MLError {
+		return pimpl->Remove(std::span<const SmplHandle>(&smpl, 1), rm_mode, ref_mode);
+	}
+
+	auto SoundFont::RemoveSamples(std::span<const SmplHandle> smpls, RemovalMode rm_mode, ReferenceMode ref_mode) -> SF2MLError {
+		return pimpl->Remove(smpls, rm_mode, ref_mode);
+	}
+
+	auto SoundFont::CountSampleUsers(SmplHandle smpl) -> std::uint32_t {
+		return pimpl->sample_refs.Count(smpl);
+	}
+
+	auto SoundFont::FindSampleUsers(SmplHandle smpl) -> std::vector<std::pair<InstHandle, IZoneHandle>> {
+		std::vector<std::pair<InstHandle, IZoneHandle>> users;
+		pimpl->sample_refs.ForEachUser(smpl, [&](InstHandle inst, IZoneHandle zone) {
+			users.emplace_back(inst, zone);
+		});
+		return users;
+	}
+
 	auto SoundFont::FindSample(std::function<bool(const SfSample &)> pred) -> std::optional<SmplHandle> {
 		for (const auto& sample : pimpl->samples) {
 			if (pred(sample)) {
@@ -232,13 +445,23 @@ namespace SF2ML {
 		return handles;
 	}
 
+	auto SoundFont::FindSampleByName(std::string_view name) -> std::optional<SmplHandle> {
+		return pimpl->sample_names.Find(MakeNameKey(name));
+	}
+
+	auto SoundFont::Samples() const noexcept -> std::span<const SfSample> {
+		return pimpl->samples.Items();
+	}
+
 	auto SoundFont::AllSamples() -> std::vector<SmplHandle> {
 		auto [first, last] = pimpl->samples.GetAllHandles();
 		return std::vector<SmplHandle>(first, last);
 	}
 
 	SfInstrument& SoundFont::NewInstrument(std::string_view name) {
-		return pimpl->instruments.NewItem().SetName(name);
+		SfInstrument& inst = pimpl->instruments.NewItem();
+		inst.Attach(pimpl.get());
+		return inst.SetName(name);
 	}
 
 	auto SoundFont::GetInstrument(InstHandle inst) -> SfInstrument& {
@@ -246,7 +469,31 @@ namespace SF2ML {
 	}
 
 	void SoundFont::RemoveInstrument(InstHandle inst) {
-		pimpl->instruments.Remove(inst);
+		static_cast<void>(pimpl->Remove(std::span<const InstHandle>(&inst, 1), ReferenceMode::Keep));
+	}
+
+	void SoundFont::RemoveInstruments(std::span<const InstHandle> insts) {
+		static_cast<void>(pimpl->Remove(insts, ReferenceMode::Keep));
+	}
+
+	auto SoundFont::RemoveInstrument(InstHandle inst, ReferenceMode ref_mode) -> SF2MLError {
+		return pimpl->Remove(std::span<const InstHandle>(&inst, 1), ref_mode);
+	}
+
+	auto SoundFont::RemoveInstruments(std::span<const InstHandle> insts, ReferenceMode ref_mode) -> SF2MLError {
+		return pimpl->Remove(insts, ref_mode);
+	}
+
+	auto SoundFont::CountInstrumentUsers(InstHandle inst) -> std::uint32_t {
+		return pimpl->inst_refs.Count(inst);
+	}
+
+	auto SoundFont::FindInstrumentUsers(InstHandle inst) -> std::vector<std::pair<PresetHandle, PZoneHandle>> {
+		std::vector<std::pair<PresetHandle, PZoneHandle>> users;
+		pimpl->inst_refs.ForEachUser(inst, [&](PresetHandle preset, PZoneHandle zone) {
+			users.emplace_back(preset, zone);
+		});
+		return users;
 	}
 
 	auto SoundFont::FindInstrument(std::function<bool(const SfInstrument &)> pred) -> std::optional<InstHandle> {
@@ -268,6 +515,14 @@ namespace SF2ML {
 		return handles;
 	}
 
+	auto SoundFont::FindInstrumentByName(std::string_view name) -> std::optional<InstHandle> {
+		return pimpl->inst_names.Find(MakeNameKey(name));
+	}
+
+	auto SoundFont::Instruments() const noexcept -> std::span<const SfInstrument> {
+		return pimpl->instruments.Items();
+	}
+
 	auto SoundFont::AllInstruments() -> std::vector<InstHandle> {
 		auto [first, last] = pimpl->instruments.GetAllHandles();
 		return std::vector<InstHandle>(first, last);
@@ -276,7 +531,9 @@ namespace SF2ML {
 	SfPreset& SoundFont::NewPreset(std::uint16_t preset_number,
 	                               std::uint16_t bank_number,
 		                           std::string_view name) {
-		return pimpl->presets.NewItem()
+		SfPreset& preset = pimpl->presets.NewItem();
+		preset.Attach(pimpl.get());
+		return preset
 			.SetPresetNumber(preset_number)
 			.SetBankNumber(bank_number)
 			.SetName(name);
@@ -287,7 +544,11 @@ namespace SF2ML {
 	}
 
 	void SoundFont::RemovePreset(PresetHandle preset) {
-		pimpl->presets.Remove(preset);
+		pimpl->Remove(std::span<const PresetHandle>(&preset, 1));
+	}
+
+	void SoundFont::RemovePresets(std::span<const PresetHandle> presets) {
+		pimpl->Remove(presets);
 	}
 
 	auto SoundFont::FindPreset(std::function<bool(const SfPreset &)> pred) -> std::optional<PresetHandle> {
@@ -309,11 +570,103 @@ namespace SF2ML {
 		return handles;
 	}
 
+	auto SoundFont::FindPresetByName(std::string_view name) -> std::optional<PresetHandle> {
+		return pimpl->preset_names.Find(MakeNameKey(name));
+	}
+
+	auto SoundFont::FindPreset(std::uint16_t bank, std::uint16_t program) -> std::optional<PresetHandle> {
+		return pimpl->preset_programs.Find(SoundFontImpl::ProgramKey(bank, program));
+	}
+
+	auto SoundFont::Presets() const noexcept -> std::span<const SfPreset> {
+		return pimpl->presets.Items();
+	}
+
 	auto SoundFont::AllPresets() -> std::vector<PresetHandle> {
 		auto [first, last] = pimpl->presets.GetAllHandles();
 		return std::vector<PresetHandle>(first, last);
 	}
 
+	auto SoundFont::FindNoteZones(std::uint16_t bank,
+								  std::uint16_t program,
+								  std::uint8_t key,
+								  std::uint8_t velocity,
+								  std::span<SfNoteZone> out) -> std::size_t {
+		pimpl->note_index.Refresh(pimpl->presets, pimpl->instruments);
+		return pimpl->note_index.Find(bank, program, key, velocity, out);
+	}
+
+	auto SoundFont::FindNoteZones(std::uint16_t bank,
+								  std::uint16_t program,
+								  std::uint8_t key,
+								  std::uint8_t velocity) -> std::vector<SfNoteZone> {
+		std::vector<SfNoteZone> zones(16);
+		std::size_t count = FindNoteZones(bank, program, key, velocity, zones);
+		if (count > zones.size()) {
+			zones.resize(count);
+			FindNoteZones(bank, program, key, velocity, zones);
+		}
+		zones.resize(count);
+		return zones;
+	}
+
+	auto SoundFont::GetVoiceParams(const SfNoteZone& zone) -> std::optional<SfVoiceParams> {
+		pimpl->note_index.Refresh(pimpl->presets, pimpl->instruments);
+		SfVoiceParams params;
+		if (!pimpl->note_index.GetVoice(zone, params)) {
+			return std::nullopt;
+		}
+		return params;
+	}
+
+	auto SoundFont::GetRtView() -> SoundFontRtView {
+		pimpl->note_index.Refresh(pimpl->presets, pimpl->instruments);
+		return SoundFontRtView(pimpl.get());
+	}
+
+	auto SoundFontRtView::FindNoteZones(std::uint16_t bank,
+										std::uint16_t program,
+										std::uint8_t key,
+										std::uint8_t velocity,
+										std::span<SfNoteZone> out) const noexcept -> std::size_t {
+		return impl->note_index.Find(bank, program, key, velocity, out);
+	}
+
+	auto SoundFontRtView::GetVoiceParams(const SfNoteZone& zone, SfVoiceParams& out) const noexcept -> bool {
+		return impl->note_index.GetVoice(zone, out);
+	}
+
+	auto SoundFontRtView::Presets() const noexcept -> std::span<const SfPreset> {
+		return impl->presets.Items();
+	}
+
+	auto SoundFontRtView::Instruments() const noexcept -> std::span<const SfInstrument> {
+		return impl->instruments.Items();
+	}
+
+	auto SoundFontRtView::Samples() const noexcept -> std::span<const SfSample> {
+		return impl->samples.Items();
+	}
+
+	auto SoundFontRtView::GetPreset(PresetHandle handle) const noexcept -> const SfPreset* {
+		return impl->presets.Get(handle);
+	}
+
+	auto SoundFontRtView::GetInstrument(InstHandle handle) const noexcept -> const SfInstrument* {
+		return impl->instruments.Get(handle);
+	}
+
+	auto SoundFontRtView::GetSample(SmplHandle handle) const noexcept -> const SfSample* {
+		return impl->samples.Get(handle);
+	}
+
+	auto SoundFontRtView::GetSampleData(SmplHandle handle) const noexcept -> std::span<const std::uint8_t> {
+		if (const SfSample* sample = impl->samples.Get(handle)) {
+			return sample->GetResidentWav();
+		}
+		return {};
+	}
+
 	auto SoundFontImpl::AddMono(const void* wav_data,
 								std::size_t wav_size,
 								std::string_view name,
@@ -322,6 +675,7 @@ namespace SF2ML {
 								std::optional<CHAR> pitch_correction,
 								SampleChannel sample_type)
 								-> SF2MLResult<SmplHandle> {
+		trace::Scope trace("ImportSample", "bytes", static_cast<std::int64_t>(wav_size));
 		auto [wav_info, err] = wav::ValidateWav(wav_data, wav_size);
 		if (err) {
 			return { SmplHandle{0}, err };
@@ -347,7 +701,9 @@ namespace SF2ML {
 
 		const size_t bytes_per_sample = wav_info.bit_depth == SampleBitDepth::Signed16 ? 2 : 3;
 
-		SfSample& rec = samples.NewItem(bit_depth).SetName(name);
+		SfSample& rec = samples.NewItem(bit_depth);
+		rec.Attach(this);
+		rec.SetName(name);
 
 		if (loop) {
 			rec.SetLoop(loop->start, loop->end);
@@ -363,10 +719,11 @@ namespace SF2ML {
 		rec.SetSampleRate(wav_info.sample_rate);
 
 		if (sample_type == SampleChannel::Mono) {
-			rec.SetWav(std::vector<BYTE>(wav_info.wav_data, wav_info.wav_data + wav_info.wav_size));
+			rec.SetWav(std::span<const BYTE>(wav_info.wav_data, wav_info.wav_size));
 		} else {
 			const size_t buf_size = wav_info.wav_size / 2;
-			std::vector<BYTE> buf(buf_size);
+			trace::Scope trace_split("DeinterleaveWav", "bytes", static_cast<std::int64_t>(buf_size));
+			std::pmr::vector<BYTE> buf(buf_size, resource);
 			const size_t offset = (sample_type == SampleChannel::Left) ? 0 : bytes_per_sample;
 			for (size_t buf_idx = 0, blk_idx = 0; buf_idx < buf_size; buf_idx += bytes_per_sample, blk_idx++) {
 				std::memcpy(
@@ -441,6 +798,8 @@ namespace SF2ML {
 
 		if (!IsMonoSample(smpl_ptr->GetSampleMode())) {
 			if (rm_mode == RemovalMode::Recursive) {
+				sample_names.Erase(*smpl_ptr->GetLink());
+				size_cache.MarkSample(*smpl_ptr->GetLink());
 				samples.Remove(*smpl_ptr->GetLink());
 			} else {
 				SfSample* smpl2_ptr = samples.Get(*smpl_ptr->GetLink());
@@ -450,5 +809,159 @@ namespace SF2ML {
 			}
 		}
 		samples.Remove(target);
+		sample_names.Erase(target);
+		size_cache.MarkSample(target);
+	}
+
+	template <typename Container, typename OwnerT, typename ZoneT>
+	void SoundFontImpl::RemoveZones(Container& owners, std::pmr::vector<std::pair<OwnerT, ZoneT>>& zones) {
+		std::sort(zones.begin(), zones.end());
+		std::pmr::vector<ZoneT> group(resource);
+		for (std::size_t i = 0; i < zones.size(); ) {
+			const OwnerT owner = zones[i].first;
+			group.clear();
+			for (; i < zones.size() && zones[i].first == owner; i++) {
+				group.push_back(zones[i].second);
+			}
+			if (auto* obj = owners.Get(owner)) {
+				obj->RemoveZones(group);
+			}
+		}
+	}
+
+	auto SoundFontImpl::Remove(std::span<const SmplHandle> targets, RemovalMode rm_mode, ReferenceMode ref_mode) -> SF2MLError {
+		trace::Scope trace("RemoveSamples", "count", static_cast<std::int64_t>(targets.size()));
+		std::pmr::vector<SmplHandle> doomed(targets.begin(), targets.end(), resource);
+		if (rm_mode == RemovalMode::Recursive) {
+			for (SmplHandle target : targets) {
+				const SfSample* smpl_ptr = samples.Get(target);
+				if (smpl_ptr && !IsMonoSample(smpl_ptr->GetSampleMode())) {
+					doomed.push_back(*smpl_ptr->GetLink());
+				}
+			}
+		}
+
+		if (ref_mode == ReferenceMode::Reject) {
+			for (SmplHandle target : doomed) {
+				if (samples.Get(target) && sample_refs.Count(target) > 0) {
+					return SF2ML_STILL_REFERENCED;
+				}
+			}
+		} else if (ref_mode == ReferenceMode::Cascade) {
+			std::pmr::vector<std::pair<InstHandle, IZoneHandle>> users(resource);
+			for (SmplHandle target : doomed) {
+				sample_refs.ForEachUser(target, [&](InstHandle inst, IZoneHandle zone) {
+					users.emplace_back(inst, zone);
+				});
+			}
+			RemoveZones(instruments, users);
+		}
+
+		if (samples.RemoveMany(doomed) == 0) {
+			return SF2ML_SUCCESS;
+		}
+		for (SmplHandle target : doomed) {
+			sample_names.Erase(target);
+			size_cache.MarkSample(target);
+		}
+
+		// unlink the remaining samples whose partner was removed
+		for (SfSample& smpl : samples) {
+			auto link = smpl.GetLink();
+			if (link && !samples.Get(*link)) {
+				smpl.SetLink(std::nullopt);
+			}
+		}
+		return SF2ML_SUCCESS;
+	}
+
+	auto SoundFontImpl::Remove(std::span<const InstHandle> targets, ReferenceMode ref_mode) -> SF2MLError {
+		trace::Scope trace("RemoveInstruments", "count", static_cast<std::int64_t>(targets.size()));
+		if (ref_mode == ReferenceMode::Reject) {
+			for (InstHandle target : targets) {
+				if (instruments.Get(target) && inst_refs.Count(target) > 0) {
+					return SF2ML_STILL_REFERENCED;
+				}
+			}
+		} else if (ref_mode == ReferenceMode::Cascade) {
+			std::pmr::vector<std::pair<PresetHandle, PZoneHandle>> users(resource);
+			for (InstHandle target : targets) {
+				inst_refs.ForEachUser(target, [&](PresetHandle preset, PZoneHandle zone) {
+					users.emplace_back(preset, zone);
+				});
+			}
+			RemoveZones(presets, users);
+		}
+
+		for (InstHandle target : targets) {
+			if (SfInstrument* inst = instruments.Get(target)) {
+				inst->Detach();
+			}
+		}
+		if (instruments.RemoveMany(targets) == 0) {
+			return SF2ML_SUCCESS;
+		}
+		for (InstHandle target : targets) {
+			note_index.MarkInstrument(target);
+			inst_names.Erase(target);
+			size_cache.MarkInstrument(target);
+		}
+		return SF2ML_SUCCESS;
+	}
+
+	void SoundFontImpl::Remove(std::span<const PresetHandle> targets) {
+		trace::Scope trace("RemovePresets", "count", static_cast<std::int64_t>(targets.size()));
+		for (PresetHandle target : targets) {
+			if (SfPreset* preset = presets.Get(target)) {
+				preset->Detach();
+			}
+		}
+		if (presets.RemoveMany(targets) == 0) {
+			return;
+		}
+		for (PresetHandle target : targets) {
+			note_index.MarkRenumbered(target);
+			preset_names.Erase(target);
+			preset_programs.Erase(target);
+			size_cache.MarkPreset(target);
+		}
+	}
+
+	auto SoundFontImpl::SavedSize() -> std::uint64_t {
+		return serializer::CalculateRiffSize(infos, size_cache.Counts(presets, instruments, samples), 46);
+	}
+
+	auto SoundFontImpl::CollectGarbage() -> SfGarbageReport {
+		trace::Scope trace("CollectGarbage");
+		// the reverse references tell what is reachable: an instrument is used by presets when
+		// some preset zone references it, and a sample when some zone of a used instrument does
+		// (the zones of removed instruments stop referencing anything)
+		SfGarbageReport report;
+		const std::uint64_t size_before = SavedSize();
+
+		std::pmr::vector<InstHandle> dead_insts(resource);
+		for (const SfInstrument& inst : instruments) {
+			if (inst_refs.Count(inst.GetHandle()) == 0) {
+				dead_insts.push_back(inst.GetHandle());
+			}
+		}
+		static_cast<void>(Remove(dead_insts, ReferenceMode::Keep));
+
+		auto is_used = [this](SmplHandle smpl) {
+			return sample_refs.Count(smpl) > 0;
+		};
+		std::pmr::vector<SmplHandle> dead_smpls(resource);
+		for (const SfSample& smpl : samples) {
+			auto link = smpl.GetLink();
+			if (!is_used(smpl.GetHandle()) && !(link && samples.Get(*link) && is_used(*link))) {
+				dead_smpls.push_back(smpl.GetHandle());
+			}
+		}
+		static_cast<void>(Remove(dead_smpls, RemovalMode::Normal, ReferenceMode::Keep));
+
+		report.instruments = static_cast<std::uint32_t>(dead_insts.size());
+		report.samples = static_cast<std::uint32_t>(dead_smpls.size());
+		report.bytes = size_before - SavedSize();
+		return report;
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,347 @@
+#include "sffrozenimpl.hpp"
+#include "sftracing.hpp"
+#include <sfview.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace SF2ML;
+
+namespace {
+	constexpr char cache_magic[8] = { 'S', 'F', '2', 'M', 'L', 'F', 'R', 'Z' };
+	constexpr std::uint32_t cache_version = 1;
+	// the records are stored as they are in memory: a cache is only read back with the same sizes and byte order
+	constexpr std::uint32_t cache_layout = (sizeof(frozen::Layer) << 24) | (sizeof(spec::SfModList) << 16)
+		| (sizeof(SfGenEntry) << 8) | (sizeof(SFSampleLink) << 4) | (std::endian::native == std::endian::little ? 1 : 2);
+
+	// Cache file: the header, the column table, then the arena(see sffrozenimpl.hpp) on a 64-byte boundary.
+	struct CacheHeader {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t layout;
+		std::uint64_t key_size;
+		std::int64_t key_mtime;
+		std::uint64_t key_hash;
+		std::uint32_t bit_depth;
+		std::uint32_t column_count;
+		std::uint64_t arena_offset;
+		std::uint64_t arena_size;
+		std::uint64_t pool_offset;  // in the arena
+		std::uint64_t checksum;     // of the column table, and of the arena up to the pool
+	};
+
+	// position of a column in the arena
+	struct CacheColumn {
+		std::uint64_t offset;
+		std::uint64_t count;
+	};
+
+	constexpr std::uint64_t fnv_basis = 14695981039346656037ull;
+	constexpr std::uint64_t fnv_prime = 1099511628211ull;
+
+	// FNV-1a over 8-byte words, then over the remaining bytes
+	std::uint64_t Hash(std::span<const BYTE> bytes, std::uint64_t hash = fnv_basis) noexcept {
+		std::size_t i = 0;
+		for (; i + sizeof(std::uint64_t) <= bytes.size(); i += sizeof(std::uint64_t)) {
+			std::uint64_t word;
+			std::memcpy(&word, bytes.data() + i, sizeof(word));
+			hash = (hash ^ word) * fnv_prime;
+		}
+		for (; i < bytes.size(); i++) {
+			hash = (hash ^ bytes[i]) * fnv_prime;
+		}
+		return hash;
+	}
+
+	template <typename T>
+	std::span<const BYTE> Bytes(std::span<const T> records) noexcept {
+		return { reinterpret_cast<const BYTE*>(records.data()), records.size_bytes() };
+	}
+
+	std::size_t ColumnCount() noexcept {
+		frozen::Tables tables;
+		std::size_t count = 0;
+		frozen::ForEachColumn(tables, [&count](auto&) { count++; });
+		return count;
+	}
+
+	// offsets into a column of size elements: ascending, and none past its end
+	bool AreOffsets(std::span<const std::uint32_t> offsets, std::size_t size) noexcept {
+		return std::is_sorted(offsets.begin(), offsets.end()) && (offsets.empty() || offsets.back() <= size);
+	}
+
+	// indexes of count items(no_target allowed when nullable)
+	bool AreIndexes(std::span<const std::uint32_t> ids, std::size_t count, bool nullable = false) noexcept {
+		return std::all_of(ids.begin(), ids.end(), [count, nullable](std::uint32_t id) {
+			return id < count || (nullable && id == SfFrozenZones::no_target);
+		});
+	}
+
+	// zones whose targets are indexes of target_count items(instruments or samples)
+	bool IsValid(const SfFrozenZones& zones, std::size_t target_count) noexcept {
+		const std::size_t size = zones.Size();
+		return zones.key_lo.size() == size && zones.key_hi.size() == size
+			&& zones.vel_lo.size() == size && zones.vel_hi.size() == size
+			&& zones.gen_begin.size() == size + 1 && zones.mod_begin.size() == size + 1
+			&& AreOffsets(zones.gen_begin, zones.generators.size()) && AreOffsets(zones.mod_begin, zones.modulators.size())
+			&& AreIndexes(zones.target, target_count, true);
+	}
+
+	// checks everything the accessors of FrozenSoundFont index without checking: the sizes of the columns,
+	// the offset tables(ascending, within the column they point into) and the indexes between the tables
+	bool IsValid(const frozen::Tables& t) noexcept {
+		const std::size_t presets = t.preset_names.size();
+		const std::size_t insts = t.inst_names.size();
+		const std::size_t samples = t.sample_names.size();
+		if (t.name_begin.empty() || !AreOffsets(t.name_begin, t.name_chars.size())) {
+			return false;
+		}
+		const std::size_t names = t.name_begin.size() - 1;
+		if (!AreIndexes(t.preset_names, names) || !AreIndexes(t.inst_names, names) || !AreIndexes(t.sample_names, names)) {
+			return false;
+		}
+
+		if (t.preset_banks.size() != presets || t.preset_programs.size() != presets
+			|| t.preset_zone_begin.size() != presets + 1 || !AreOffsets(t.preset_zone_begin, t.preset_zones.Size())
+			|| !IsValid(t.preset_zones, insts)) {
+			return false;
+		}
+		if (t.inst_zone_begin.size() != insts + 1 || !AreOffsets(t.inst_zone_begin, t.inst_zones.Size())
+			|| !IsValid(t.inst_zones, samples)) {
+			return false;
+		}
+
+		if (t.sample_rates.size() != samples || t.loop_starts.size() != samples || t.loop_ends.size() != samples
+			|| t.root_keys.size() != samples || t.pitch_corrections.size() != samples || t.sample_modes.size() != samples
+			|| t.sample_links.size() != samples || !AreIndexes(t.sample_links, samples, true)
+			|| t.sample_begin.size() != samples || t.sample_size.size() != samples) {
+			return false;
+		}
+		for (std::size_t s = 0; s < samples; s++) {
+			if (t.sample_begin[s] > t.pool.size() || t.sample_size[s] > t.pool.size() - t.sample_begin[s]) {
+				return false;
+			}
+		}
+
+		if (t.program_keys.size() != presets || t.program_presets.size() != presets
+			|| !AreIndexes(t.program_presets, presets)) {
+			return false;
+		}
+
+		if (t.layer_begin.size() != presets + 1 || !AreOffsets(t.layer_begin, t.layers.size())
+			|| t.key_offsets.size() != presets * 129
+			|| t.raw.size() != t.layers.size() * SfGenEndOper || t.physical.size() != t.layers.size() * SfGenEndOper) {
+			return false;
+		}
+		for (const frozen::Layer& layer : t.layers) {
+			if (layer.preset_zone >= t.preset_zones.Size() || layer.instrument >= insts
+				|| layer.instrument_zone >= t.inst_zones.Size() || layer.sample >= samples) {
+				return false;
+			}
+		}
+		// the key items of preset p index its own layers
+		for (std::size_t p = 0; p < presets; p++) {
+			const auto offsets = t.key_offsets.subspan(p * 129, 129);
+			if (!AreOffsets(offsets, t.key_items.size())) {
+				return false;
+			}
+			const auto items = t.key_items.subspan(offsets.front(), offsets.back() - offsets.front());
+			if (!AreIndexes(items, t.layer_begin[p + 1] - t.layer_begin[p])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// points the tables of impl into the cache file(written for key, when there is one)
+	SF2MLError MapCache(FrozenSoundFontImpl& impl, std::span<const BYTE> file, const SfCacheKey* key) {
+		CacheHeader header;
+		if (file.size() < sizeof(header)) {
+			return SF2ML_BAD_CACHE;
+		}
+		std::memcpy(&header, file.data(), sizeof(header));
+		if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0
+			|| header.version != cache_version || header.layout != cache_layout) {
+			return SF2ML_BAD_CACHE;
+		}
+		if (key && SfCacheKey{ header.key_size, header.key_mtime, header.key_hash } != *key) {
+			return SF2ML_STALE_CACHE;
+		}
+		const std::size_t table_end = sizeof(header) + ColumnCount() * sizeof(CacheColumn);
+		if (header.column_count != ColumnCount() || header.arena_offset % frozen::column_alignment != 0
+			|| header.arena_offset < table_end || header.arena_offset > file.size()
+			|| header.arena_size > file.size() - header.arena_offset || header.pool_offset > header.arena_size) {
+			return SF2ML_BAD_CACHE;
+		}
+
+		std::pmr::vector<CacheColumn> columns(header.column_count, impl.resource);
+		std::memcpy(columns.data(), file.data() + sizeof(header), columns.size() * sizeof(CacheColumn));
+		const std::span<const BYTE> arena = file.subspan(header.arena_offset, header.arena_size);
+		if (Hash(arena.first(header.pool_offset), Hash(Bytes(std::span<const CacheColumn>(columns)))) != header.checksum) {
+			return SF2ML_BAD_CACHE;
+		}
+
+		frozen::Tables& t = impl.tables;
+		bool fits = true;
+		std::size_t i = 0;
+		frozen::ForEachColumn(t, [&](auto& column) {
+			using Column = std::remove_reference_t<decltype(column)>;
+			const CacheColumn& pos = columns[i++];
+			if (pos.offset % alignof(typename Column::element_type) != 0 || pos.offset > header.pool_offset
+				|| pos.count > (header.pool_offset - pos.offset) / sizeof(typename Column::element_type)) {
+				fits = false;
+				return;
+			}
+			column = Column(reinterpret_cast<typename Column::pointer>(arena.data() + pos.offset), pos.count);
+		});
+		t.pool = arena.subspan(header.pool_offset);
+		t.bit_depth = static_cast<SampleBitDepth>(header.bit_depth);
+		impl.arena = arena;
+		if (!fits) {
+			return SF2ML_BAD_CACHE;
+		}
+
+		if (arena.empty()) { // an empty snapshot
+			return SF2ML_SUCCESS;
+		}
+		return IsValid(t) ? SF2ML_SUCCESS : SF2ML_BAD_CACHE;
+	}
+}
+
+auto SF2ML::GetCacheKey(const std::filesystem::path& sf2_path) -> SF2MLResult<SfCacheKey> {
+	SoundFontView view;
+	if (auto err = view.Open(sf2_path)) {
+		return { {}, err };
+	}
+	std::error_code ec;
+	const auto size = std::filesystem::file_size(sf2_path, ec);
+	if (ec) {
+		return { {}, SF2ML_FAILED };
+	}
+	const auto mtime = std::filesystem::last_write_time(sf2_path, ec);
+	if (ec) {
+		return { {}, SF2ML_FAILED };
+	}
+
+	std::uint64_t hash = fnv_basis;
+	for (auto records : { Bytes(view.Phdr()), Bytes(view.Pbag()), Bytes(view.Pmod()), Bytes(view.Pgen()),
+						  Bytes(view.Inst()), Bytes(view.Ibag()), Bytes(view.Imod()), Bytes(view.Igen()), Bytes(view.Shdr()) }) {
+		hash = Hash(records, hash);
+	}
+	return { { static_cast<std::uint64_t>(size), static_cast<std::int64_t>(mtime.time_since_epoch().count()), hash }, SF2ML_SUCCESS };
+}
+
+auto FrozenSoundFont::SaveCache(std::ostream& os, const SfCacheKey& key) const -> SF2MLError {
+	trace::Scope trace("SaveCache");
+	frozen::Tables tables = pimpl ? pimpl->tables : frozen::Tables{};
+	const std::span<const BYTE> arena = pimpl ? pimpl->arena : std::span<const BYTE>();
+	auto offset_of = [&arena](const void* data) -> std::uint64_t {
+		return data ? static_cast<const BYTE*>(data) - arena.data() : 0;
+	};
+
+	std::vector<CacheColumn> columns;
+	frozen::ForEachColumn(tables, [&](auto& column) {
+		columns.push_back({ offset_of(column.data()), column.size() });
+	});
+
+	CacheHeader header {};
+	std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	header.version = cache_version;
+	header.layout = cache_layout;
+	header.key_size = key.size;
+	header.key_mtime = key.mtime;
+	header.key_hash = key.hash;
+	header.bit_depth = static_cast<std::uint32_t>(tables.bit_depth);
+	header.column_count = static_cast<std::uint32_t>(columns.size());
+	header.arena_offset = frozen::AlignUp(sizeof(header) + columns.size() * sizeof(CacheColumn));
+	header.arena_size = arena.size();
+	header.pool_offset = offset_of(tables.pool.data());
+	header.checksum = Hash(arena.first(header.pool_offset), Hash(Bytes(std::span<const CacheColumn>(columns))));
+
+	const char padding[frozen::column_alignment] {};
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	os.write(reinterpret_cast<const char*>(columns.data()), std::streamsize(columns.size() * sizeof(CacheColumn)));
+	os.write(padding, std::streamsize(header.arena_offset - sizeof(header) - columns.size() * sizeof(CacheColumn)));
+	os.write(reinterpret_cast<const char*>(arena.data()), std::streamsize(arena.size()));
+	return os ? SF2ML_SUCCESS : SF2ML_FAILED;
+}
+
+auto FrozenSoundFont::SaveCache(const std::filesystem::path& cache_path, const SfCacheKey& key) const -> SF2MLError {
+	// written aside, then renamed over the cache: a snapshot may still be mapping the previous file
+	std::filesystem::path tmp_path = cache_path;
+	tmp_path += ".tmp";
+	std::error_code ec;
+	{
+		std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+		if (SaveCache(ofs, key) || !ofs.flush()) {
+			ofs.close();
+			std::filesystem::remove(tmp_path, ec);
+			return SF2ML_FAILED;
+		}
+	}
+	std::filesystem::rename(tmp_path, cache_path, ec);
+	if (ec) {
+		std::filesystem::remove(tmp_path, ec);
+		return SF2ML_FAILED;
+	}
+	return SF2ML_SUCCESS;
+}
+
+auto FrozenSoundFont::LoadCache(const std::filesystem::path& cache_path,
+								const SfCacheKey& key,
+								std::pmr::memory_resource* resource) -> SF2MLResult<FrozenSoundFont> {
+	trace::Scope trace("LoadCache");
+	auto impl = MakePmrUnique<FrozenSoundFontImpl>(resource, resource);
+	if (auto err = MapFile(cache_path, impl->mapping)) {
+		return { FrozenSoundFont(), err };
+	}
+	const std::span<const BYTE> file(static_cast<const BYTE*>(impl->mapping.address), impl->mapping.size);
+	if (auto err = MapCache(*impl, file, &key)) {
+		return { FrozenSoundFont(), err };
+	}
+	return { FrozenSoundFont(std::move(impl)), SF2ML_SUCCESS };
+}
+
+auto FrozenSoundFont::FromImage(std::span<const BYTE> image, std::pmr::memory_resource* resource) -> SF2MLResult<FrozenSoundFont> {
+	trace::Scope trace("FromImage");
+	if (reinterpret_cast<std::uintptr_t>(image.data()) % frozen::column_alignment != 0) {
+		return { FrozenSoundFont(), SF2ML_BAD_CACHE };
+	}
+	auto impl = MakePmrUnique<FrozenSoundFontImpl>(resource, resource);
+	if (auto err = MapCache(*impl, image, nullptr)) {
+		return { FrozenSoundFont(), err };
+	}
+	return { FrozenSoundFont(std::move(impl)), SF2ML_SUCCESS };
+}
+
+auto FrozenSoundFont::LoadCached(const std::filesystem::path& sf2_path,
+								 const std::filesystem::path& cache_path,
+								 std::pmr::memory_resource* resource) -> SF2MLResult<FrozenSoundFont> {
+	auto [key, err] = GetCacheKey(sf2_path);
+	if (err) {
+		return { FrozenSoundFont(), err };
+	}
+	auto cached = LoadCache(cache_path, key, resource);
+	if (!cached.error) {
+		return cached;
+	}
+
+	SoundFont sf2(resource);
+	std::ifstream ifs(sf2_path, std::ios::binary);
+	if (!ifs.is_open()) {
+		return { FrozenSoundFont(), SF2ML_FAILED };
+	}
+	if (auto load_err = sf2.Load(ifs)) {
+		return { FrozenSoundFont(), load_err };
+	}
+	FrozenSoundFont frozen = sf2.Freeze(resource);
+	static_cast<void>(frozen.SaveCache(cache_path, key));
+	return { std::move(frozen), SF2ML_SUCCESS };
+}
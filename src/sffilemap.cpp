@@ -0,0 +1,71 @@
+#include "sffilemap.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace SF2ML;
+
+auto SF2ML::MapFile(const std::filesystem::path& path, FileMapping& dst) -> SF2MLError {
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return SF2ML_FAILED;
+	}
+	LARGE_INTEGER size;
+	HANDLE map = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		map = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	CloseHandle(file);
+	if (!map) {
+		return SF2ML_FAILED;
+	}
+	void* address = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+	if (!address) {
+		CloseHandle(map);
+		return SF2ML_FAILED;
+	}
+	dst = { address, static_cast<std::size_t>(size.QuadPart), map };
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return SF2ML_FAILED;
+	}
+	struct stat st;
+	void* address = MAP_FAILED;
+	if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+		address = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	::close(fd);
+	if (address == MAP_FAILED) {
+		return SF2ML_FAILED;
+	}
+	dst = { address, static_cast<std::size_t>(st.st_size), nullptr };
+#endif
+	return SF2ML_SUCCESS;
+}
+
+void SF2ML::UnmapFile(FileMapping& mapping) noexcept {
+	if (!mapping.address) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(mapping.address);
+	CloseHandle(static_cast<HANDLE>(mapping.handle));
+#else
+	::munmap(mapping.address, mapping.size);
+#endif
+	mapping = {};
+}
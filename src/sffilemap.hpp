@@ -0,0 +1,22 @@
+#ifndef SF2ML_SFFILEMAP_HPP_
+#define SF2ML_SFFILEMAP_HPP_
+
+#include <sftypes.hpp>
+
+#include <cstddef>
+#include <filesystem>
+
+namespace SF2ML {
+	// read-only mapping of a whole file
+	struct FileMapping {
+		void* address = nullptr;
+		std::size_t size = 0;
+		void* handle = nullptr; // the file mapping object on Windows
+	};
+
+	// maps the file at path; fails for files that cannot be opened and for empty files
+	auto MapFile(const std::filesystem::path& path, FileMapping& dst) -> SF2MLError;
+	void UnmapFile(FileMapping& mapping) noexcept;
+}
+
+#endif
@@ -0,0 +1,497 @@
+#include "sffrozenimpl.hpp"
+#include "sfnoteindex.hpp"
+#include "sftracing.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace SF2ML;
+using namespace SF2ML::noteindex;
+using frozen::Layer;
+
+namespace {
+	constexpr std::uint32_t no_target = SfFrozenZones::no_target;
+
+	DWORD ProgramKey(WORD bank, WORD program) noexcept {
+		return (static_cast<DWORD>(bank) << 16) | program;
+	}
+
+	// zones of the presets or of the instruments, while they are being built
+	struct ZoneColumns {
+		explicit ZoneColumns(std::pmr::memory_resource* resource)
+			: key_lo(resource), key_hi(resource), vel_lo(resource), vel_hi(resource), target(resource),
+			  gen_begin(1, 0, resource), mod_begin(1, 0, resource), generators(resource), modulators(resource) {}
+
+		std::pmr::vector<BYTE> key_lo;
+		std::pmr::vector<BYTE> key_hi;
+		std::pmr::vector<BYTE> vel_lo;
+		std::pmr::vector<BYTE> vel_hi;
+		std::pmr::vector<std::uint32_t> target;
+		std::pmr::vector<std::uint32_t> gen_begin;
+		std::pmr::vector<std::uint32_t> mod_begin;
+		std::pmr::vector<SfGenEntry> generators;
+		std::pmr::vector<spec::SfModList> modulators;
+
+		auto View() const noexcept -> SfFrozenZones {
+			return { key_lo, key_hi, vel_lo, vel_hi, target, gen_begin, mod_begin, generators, modulators };
+		}
+
+		// appends the zone, with the ranges resolved against global(the ranges of the global zone of its object)
+		template <typename ZoneType>
+		void Append(const ZoneType& zone, const KeyVelRanges& global, std::uint32_t target_index) {
+			const KeyVelRanges ranges = zone.GetHandle().value == 0 ? global : GetZoneRanges(zone, global);
+			key_lo.push_back(ranges.first.start);
+			key_hi.push_back(ranges.first.end);
+			vel_lo.push_back(ranges.second.start);
+			vel_hi.push_back(ranges.second.end);
+			target.push_back(target_index);
+
+			const auto gens = zone.Generators();
+			generators.insert(generators.end(), gens.begin(), gens.end());
+			gen_begin.push_back(static_cast<std::uint32_t>(generators.size()));
+
+			for (const SfModulator& mod : zone.Modulators()) {
+				spec::SfModList bits;
+				bits.sf_mod_src_oper = mod.GetSourceBits();
+				bits.sf_mod_amt_src_oper = mod.GetAmtSourceBits();
+				bits.mod_amount = mod.GetModAmount();
+				bits.sf_mod_trans_oper = mod.GetTransform();
+				auto dest = mod.GetDestination();
+				if (std::holds_alternative<ModHandle>(dest)) {
+					auto index = zone.GetModIndex(std::get<ModHandle>(dest));
+					bits.sf_mod_dest_oper = static_cast<SFGenerator>(index ? (1 << 15) | *index : 0xFFFF);
+				} else {
+					bits.sf_mod_dest_oper = std::get<SFGenerator>(dest);
+				}
+				modulators.push_back(bits);
+			}
+			mod_begin.push_back(static_cast<std::uint32_t>(modulators.size()));
+		}
+	};
+
+
+	// the columns of a snapshot while they are being built(the sample points excepted)
+	struct Columns {
+		explicit Columns(std::pmr::memory_resource* resource)
+			: resource{resource},
+			  name_chars(resource), name_begin(1, 0, resource),
+			  preset_names(resource), preset_banks(resource), preset_programs(resource), preset_zone_begin(1, 0, resource),
+			  preset_zones(resource),
+			  inst_names(resource), inst_zone_begin(1, 0, resource), inst_zones(resource),
+			  sample_names(resource), sample_rates(resource), loop_starts(resource), loop_ends(resource),
+			  root_keys(resource), pitch_corrections(resource), sample_modes(resource), sample_links(resource),
+			  sample_begin(resource), sample_size(resource),
+			  program_keys(resource), program_presets(resource),
+			  layers(resource), layer_begin(1, 0, resource), key_offsets(resource), key_items(resource),
+			  raw(resource), physical(resource) {}
+
+		void Fill(const SoundFont& sf2);
+
+		// points the columns of tables at the vectors
+		void Expose(frozen::Tables& t) const noexcept {
+			t.bit_depth = bit_depth;
+			t.name_chars = name_chars;
+			t.name_begin = name_begin;
+			t.preset_names = preset_names;
+			t.preset_banks = preset_banks;
+			t.preset_programs = preset_programs;
+			t.preset_zone_begin = preset_zone_begin;
+			t.preset_zones = preset_zones.View();
+			t.inst_names = inst_names;
+			t.inst_zone_begin = inst_zone_begin;
+			t.inst_zones = inst_zones.View();
+			t.sample_names = sample_names;
+			t.sample_rates = sample_rates;
+			t.loop_starts = loop_starts;
+			t.loop_ends = loop_ends;
+			t.root_keys = root_keys;
+			t.pitch_corrections = pitch_corrections;
+			t.sample_modes = sample_modes;
+			t.sample_links = sample_links;
+			t.sample_begin = sample_begin;
+			t.sample_size = sample_size;
+			t.program_keys = program_keys;
+			t.program_presets = program_presets;
+			t.layers = layers;
+			t.layer_begin = layer_begin;
+			t.key_offsets = key_offsets;
+			t.key_items = key_items;
+			t.raw = raw;
+			t.physical = physical;
+		}
+
+		std::pmr::memory_resource* resource;
+		SampleBitDepth bit_depth = SampleBitDepth::Signed16;
+		std::pmr::vector<char> name_chars;
+		std::pmr::vector<std::uint32_t> name_begin;
+		std::pmr::vector<std::uint32_t> preset_names;
+		std::pmr::vector<WORD> preset_banks;
+		std::pmr::vector<WORD> preset_programs;
+		std::pmr::vector<std::uint32_t> preset_zone_begin;
+		ZoneColumns preset_zones;
+		std::pmr::vector<std::uint32_t> inst_names;
+		std::pmr::vector<std::uint32_t> inst_zone_begin;
+		ZoneColumns inst_zones;
+		std::pmr::vector<std::uint32_t> sample_names;
+		std::pmr::vector<std::uint32_t> sample_rates;
+		std::pmr::vector<std::uint32_t> loop_starts;
+		std::pmr::vector<std::uint32_t> loop_ends;
+		std::pmr::vector<BYTE> root_keys;
+		std::pmr::vector<CHAR> pitch_corrections;
+		std::pmr::vector<SFSampleLink> sample_modes;
+		std::pmr::vector<std::uint32_t> sample_links;
+		std::pmr::vector<std::uint64_t> sample_begin;
+		std::pmr::vector<std::uint64_t> sample_size;
+		std::uint64_t pool_size = 0;
+		std::pmr::vector<DWORD> program_keys;
+		std::pmr::vector<std::uint32_t> program_presets;
+		std::pmr::vector<Layer> layers;
+		std::pmr::vector<std::uint32_t> layer_begin;
+		std::pmr::vector<std::uint32_t> key_offsets;
+		std::pmr::vector<std::uint32_t> key_items;
+		std::pmr::vector<SHORT> raw;
+		std::pmr::vector<float> physical;
+	};
+
+	auto Name(const frozen::Tables& t, std::uint32_t id) noexcept -> std::string_view {
+		return { t.name_chars.data() + t.name_begin[id], t.name_begin[id + 1] - t.name_begin[id] };
+	}
+
+	// an empty snapshot(default constructed or moved from)
+	const frozen::Tables empty_tables {};
+
+	const frozen::Tables& TablesOf(const PmrUniquePtr<FrozenSoundFontImpl>& pimpl) noexcept {
+		return pimpl ? pimpl->tables : empty_tables;
+	}
+}
+
+void Columns::Fill(const SoundFont& sf2) {
+	const auto presets = sf2.Presets();
+	const auto insts = sf2.Instruments();
+	const auto samples = sf2.Samples();
+
+	std::pmr::unordered_map<std::pmr::string, std::uint32_t> name_ids(resource);
+	auto intern = [&](const std::string& name) {
+		auto [it, inserted] = name_ids.try_emplace(std::pmr::string(name, resource), static_cast<std::uint32_t>(name_begin.size() - 1));
+		if (inserted) {
+			name_chars.insert(name_chars.end(), name.begin(), name.end());
+			name_begin.push_back(static_cast<std::uint32_t>(name_chars.size()));
+		}
+		return it->second;
+	};
+
+	// handle values -> indices
+	std::pmr::unordered_map<DWORD, std::uint32_t> sample_index(resource);
+	for (std::uint32_t i = 0; i < samples.size(); i++) {
+		sample_index.emplace(samples[i].GetHandle().value, i);
+	}
+	std::pmr::unordered_map<DWORD, std::uint32_t> inst_index(resource);
+	for (std::uint32_t i = 0; i < insts.size(); i++) {
+		inst_index.emplace(insts[i].GetHandle().value, i);
+	}
+	auto find_index = [](const auto& index, auto handle) {
+		if (!handle) {
+			return no_target;
+		}
+		auto it = index.find(handle->value);
+		return it == index.end() ? no_target : it->second;
+	};
+
+	// samples, and their points in the pool
+	if (!samples.empty()) {
+		bit_depth = samples.front().GetBitDepth();
+	}
+	const std::size_t point_size = bit_depth == SampleBitDepth::Signed24 ? 3 : 2;
+	for (const SfSample& sample : samples) {
+		sample_names.push_back(intern(sample.GetName()));
+		sample_rates.push_back(static_cast<std::uint32_t>(sample.GetSampleRate()));
+		const auto [loop_start, loop_end] = sample.GetLoop();
+		loop_starts.push_back(loop_start);
+		loop_ends.push_back(loop_end);
+		root_keys.push_back(sample.GetRootKey());
+		pitch_corrections.push_back(sample.GetPitchCorrection());
+		sample_modes.push_back(sample.GetSampleMode());
+		sample_links.push_back(find_index(sample_index, sample.GetLink()));
+		sample_begin.push_back(pool_size);
+		sample_size.push_back(sample.GetSampleCount() * point_size);
+		pool_size += frozen::AlignUp(sample_size.back());
+	}
+
+	// instruments and their zones
+	for (const SfInstrument& inst : insts) {
+		inst_names.push_back(intern(inst.GetName()));
+		const auto zones = inst.Zones();
+		const KeyVelRanges global = GetGlobalRanges(zones.front());
+		for (const SfInstrumentZone& zone : zones) {
+			inst_zones.Append(zone, global, zone.GetHandle().value == 0 ? no_target : find_index(sample_index, zone.GetSample()));
+		}
+		inst_zone_begin.push_back(static_cast<std::uint32_t>(inst_zones.target.size()));
+	}
+
+	// presets, their zones and layers
+	GenRow row;
+	for (std::uint32_t p = 0; p < presets.size(); p++) {
+		const SfPreset& preset = presets[p];
+		preset_names.push_back(intern(preset.GetName()));
+		preset_banks.push_back(preset.GetBankNumber());
+		preset_programs.push_back(preset.GetPresetNumber());
+
+		const auto zones = preset.Zones();
+		const KeyVelRanges pglobal = GetGlobalRanges(zones.front());
+		const std::uint32_t first_zone = static_cast<std::uint32_t>(preset_zones.target.size());
+		for (const SfPresetZone& zone : zones) {
+			preset_zones.Append(zone, pglobal, zone.GetHandle().value == 0 ? no_target : find_index(inst_index, zone.GetInstrument()));
+		}
+		preset_zone_begin.push_back(static_cast<std::uint32_t>(preset_zones.target.size()));
+
+		const std::uint32_t first_layer = static_cast<std::uint32_t>(layers.size());
+		for (std::uint32_t pz = first_zone + 1; pz < preset_zone_begin.back(); pz++) {
+			const std::uint32_t inst = preset_zones.target[pz];
+			if (inst == no_target) {
+				continue;
+			}
+			const std::uint32_t iglobal = inst_zone_begin[inst];
+			for (std::uint32_t iz = iglobal + 1; iz < inst_zone_begin[inst + 1]; iz++) {
+				const std::uint32_t sample = inst_zones.target[iz];
+				if (sample == no_target) {
+					continue;
+				}
+				const Ranges<BYTE> key = Intersect({ preset_zones.key_lo[pz], preset_zones.key_hi[pz] }, { inst_zones.key_lo[iz], inst_zones.key_hi[iz] });
+				const Ranges<BYTE> vel = Intersect({ preset_zones.vel_lo[pz], preset_zones.vel_hi[pz] }, { inst_zones.vel_lo[iz], inst_zones.vel_hi[iz] });
+				if (key.start > key.end || vel.start > vel.end) {
+					continue;
+				}
+				layers.push_back({ key.start, key.end, vel.start, vel.end, pz, inst, iz, sample });
+
+				ResolveVoice(row, preset_zones.View().Generators(first_zone), preset_zones.View().Generators(pz),
+							 inst_zones.View().Generators(iglobal), inst_zones.View().Generators(iz));
+				row[SfGenKeyRange] = static_cast<SHORT>(key.start | (key.end << 8));
+				row[SfGenVelRange] = static_cast<SHORT>(vel.start | (vel.end << 8));
+				row[SfGenInstrument] = static_cast<SHORT>(inst);
+				row[SfGenSampleID] = static_cast<SHORT>(sample);
+				raw.insert(raw.end(), row.begin(), row.end());
+				for (std::size_t g = 0; g < SfGenEndOper; g++) {
+					physical.push_back(GenAmountToPhysical(static_cast<SFGenerator>(g), row[g]));
+				}
+			}
+		}
+		layer_begin.push_back(static_cast<std::uint32_t>(layers.size()));
+
+		// bucket the layers of the preset by key (counting sort)
+		const std::size_t offsets = key_offsets.size();
+		key_offsets.resize(offsets + 129, 0);
+		std::uint32_t* key_offset = key_offsets.data() + offsets;
+		key_offset[0] = static_cast<std::uint32_t>(key_items.size());
+		for (std::uint32_t l = first_layer; l < layers.size(); l++) {
+			for (std::uint32_t k = layers[l].key_lo; k <= layers[l].key_hi; k++) {
+				key_offset[k + 1]++;
+			}
+		}
+		for (std::uint32_t k = 0; k < 128; k++) {
+			key_offset[k + 1] += key_offset[k];
+		}
+		key_items.resize(key_offset[128]);
+		std::array<std::uint32_t, 128> fill_pos;
+		std::copy_n(key_offset, 128, fill_pos.begin());
+		for (std::uint32_t l = first_layer; l < layers.size(); l++) {
+			for (std::uint32_t k = layers[l].key_lo; k <= layers[l].key_hi; k++) {
+				key_items[fill_pos[k]++] = l - first_layer;
+			}
+		}
+	}
+
+	// (bank, program) table; when (bank, program) is duplicated, the first preset wins
+	program_presets.resize(presets.size());
+	for (std::uint32_t p = 0; p < presets.size(); p++) {
+		program_presets[p] = p;
+	}
+	std::stable_sort(program_presets.begin(), program_presets.end(), [this](std::uint32_t x, std::uint32_t y) {
+		return ProgramKey(preset_banks[x], preset_programs[x]) < ProgramKey(preset_banks[y], preset_programs[y]);
+	});
+	for (std::uint32_t p : program_presets) {
+		program_keys.push_back(ProgramKey(preset_banks[p], preset_programs[p]));
+	}
+}
+
+void FrozenSoundFontImpl::Build(const SoundFont& sf2) {
+	Columns columns(resource);
+	columns.Fill(sf2);
+	columns.Expose(tables);
+
+	// the arena: every column, then the sample points
+	std::size_t size = 0;
+	frozen::ForEachColumn(tables, [&size](auto& column) {
+		size = frozen::AlignUp(size) + column.size_bytes();
+	});
+	const std::size_t pool_offset = frozen::AlignUp(size);
+	BYTE* block = static_cast<BYTE*>(resource->allocate(pool_offset + columns.pool_size, frozen::column_alignment));
+	arena = { block, pool_offset + columns.pool_size };
+	arena_owned = true;
+
+	// the padding is zeroed, so that the same bank gives the same bytes(see SaveCache)
+	std::memset(block, 0, arena.size());
+	std::size_t offset = 0;
+	frozen::ForEachColumn(tables, [&](auto& column) {
+		using Column = std::remove_reference_t<decltype(column)>;
+		offset = frozen::AlignUp(offset);
+		if (!column.empty()) {
+			std::memcpy(block + offset, column.data(), column.size_bytes());
+		}
+		column = Column(reinterpret_cast<typename Column::pointer>(block + offset), column.size());
+		offset += column.size_bytes();
+	});
+
+	const auto samples = sf2.Samples();
+	for (std::size_t i = 0; i < samples.size(); i++) {
+		samples[i].ReadWav(0, { block + pool_offset + columns.sample_begin[i], columns.sample_size[i] });
+	}
+	tables.pool = arena.subspan(pool_offset);
+}
+
+auto SoundFont::Freeze(std::pmr::memory_resource* resource) const -> FrozenSoundFont {
+	trace::Scope trace("Freeze");
+	auto impl = MakePmrUnique<FrozenSoundFontImpl>(resource, resource);
+	impl->Build(*this);
+	return FrozenSoundFont(std::move(impl));
+}
+
+FrozenSoundFont::FrozenSoundFont() noexcept {}
+FrozenSoundFont::FrozenSoundFont(PmrUniquePtr<FrozenSoundFontImpl> pimpl) noexcept : pimpl{std::move(pimpl)} {}
+FrozenSoundFont::~FrozenSoundFont() {}
+FrozenSoundFont::FrozenSoundFont(FrozenSoundFont&& other) noexcept = default;
+FrozenSoundFont& FrozenSoundFont::operator=(FrozenSoundFont&& other) noexcept = default;
+
+auto FrozenSoundFont::PresetCount() const noexcept -> std::size_t {
+	return TablesOf(pimpl).preset_names.size();
+}
+auto FrozenSoundFont::PresetName(std::size_t preset) const noexcept -> std::string_view {
+	const frozen::Tables& t = TablesOf(pimpl);
+	return preset < t.preset_names.size() ? Name(t, t.preset_names[preset]) : std::string_view();
+}
+auto FrozenSoundFont::PresetBanks() const noexcept -> std::span<const WORD> {
+	return TablesOf(pimpl).preset_banks;
+}
+auto FrozenSoundFont::PresetPrograms() const noexcept -> std::span<const WORD> {
+	return TablesOf(pimpl).preset_programs;
+}
+auto FrozenSoundFont::PresetZoneBegin() const noexcept -> std::span<const std::uint32_t> {
+	return TablesOf(pimpl).preset_zone_begin;
+}
+auto FrozenSoundFont::PresetZones() const noexcept -> SfFrozenZones {
+	return TablesOf(pimpl).preset_zones;
+}
+
+auto FrozenSoundFont::InstrumentCount() const noexcept -> std::size_t {
+	return TablesOf(pimpl).inst_names.size();
+}
+auto FrozenSoundFont::InstrumentName(std::size_t inst) const noexcept -> std::string_view {
+	const frozen::Tables& t = TablesOf(pimpl);
+	return inst < t.inst_names.size() ? Name(t, t.inst_names[inst]) : std::string_view();
+}
+auto FrozenSoundFont::InstrumentZoneBegin() const noexcept -> std::span<const std::uint32_t> {
+	return TablesOf(pimpl).inst_zone_begin;
+}
+auto FrozenSoundFont::InstrumentZones() const noexcept -> SfFrozenZones {
+	return TablesOf(pimpl).inst_zones;
+}
+
+auto FrozenSoundFont::SampleCount() const noexcept -> std::size_t {
+	return TablesOf(pimpl).sample_names.size();
+}
+auto FrozenSoundFont::SampleName(std::size_t sample) const noexcept -> std::string_view {
+	const frozen::Tables& t = TablesOf(pimpl);
+	return sample < t.sample_names.size() ? Name(t, t.sample_names[sample]) : std::string_view();
+}
+auto FrozenSoundFont::SampleRates() const noexcept -> std::span<const std::uint32_t> {
+	return TablesOf(pimpl).sample_rates;
+}
+auto FrozenSoundFont::LoopStarts() const noexcept -> std::span<const std::uint32_t> {
+	return TablesOf(pimpl).loop_starts;
+}
+auto FrozenSoundFont::LoopEnds() const noexcept -> std::span<const std::uint32_t> {
+	return TablesOf(pimpl).loop_ends;
+}
+auto FrozenSoundFont::RootKeys() const noexcept -> std::span<const BYTE> {
+	return TablesOf(pimpl).root_keys;
+}
+auto FrozenSoundFont::PitchCorrections() const noexcept -> std::span<const CHAR> {
+	return TablesOf(pimpl).pitch_corrections;
+}
+auto FrozenSoundFont::SampleModes() const noexcept -> std::span<const SFSampleLink> {
+	return TablesOf(pimpl).sample_modes;
+}
+auto FrozenSoundFont::SampleLinks() const noexcept -> std::span<const std::uint32_t> {
+	return TablesOf(pimpl).sample_links;
+}
+auto FrozenSoundFont::GetBitDepth() const noexcept -> SampleBitDepth {
+	return TablesOf(pimpl).bit_depth;
+}
+auto FrozenSoundFont::SampleData(std::size_t sample) const noexcept -> std::span<const BYTE> {
+	const frozen::Tables& t = TablesOf(pimpl);
+	if (sample >= t.sample_names.size()) {
+		return {};
+	}
+	return t.pool.subspan(t.sample_begin[sample], t.sample_size[sample]);
+}
+
+auto FrozenSoundFont::FindPreset(std::uint16_t bank, std::uint16_t program) const noexcept -> std::optional<std::size_t> {
+	const frozen::Tables& t = TablesOf(pimpl);
+	const DWORD key = ProgramKey(bank, program);
+	auto it = std::lower_bound(t.program_keys.begin(), t.program_keys.end(), key);
+	if (it == t.program_keys.end() || *it != key) {
+		return std::nullopt;
+	}
+	return t.program_presets[it - t.program_keys.begin()];
+}
+
+auto FrozenSoundFont::FindNoteZones(std::uint16_t bank,
+									std::uint16_t program,
+									std::uint8_t key,
+									std::uint8_t velocity,
+									std::span<SfFrozenNoteZone> out) const noexcept -> std::size_t {
+	if (key > 127) {
+		return 0;
+	}
+	auto preset = FindPreset(bank, program);
+	if (!preset) {
+		return 0;
+	}
+
+	const frozen::Tables& t = TablesOf(pimpl);
+	const std::uint32_t first_layer = t.layer_begin[*preset];
+	const std::uint32_t* key_offset = t.key_offsets.data() + *preset * 129;
+	std::size_t count = 0;
+	for (std::uint32_t i = key_offset[key]; i < key_offset[key + 1]; i++) {
+		const std::uint32_t l = first_layer + t.key_items[i];
+		const Layer& layer = t.layers[l];
+		if (layer.vel_lo <= velocity && velocity <= layer.vel_hi) {
+			if (count < out.size()) {
+				out[count] = { static_cast<std::uint32_t>(*preset), layer.preset_zone, layer.instrument,
+							   layer.instrument_zone, layer.sample, l };
+			}
+			count++;
+		}
+	}
+	return count;
+}
+
+auto FrozenSoundFont::GetVoiceParams(const SfFrozenNoteZone& zone, SfVoiceParams& out) const noexcept -> bool {
+	const frozen::Tables& t = TablesOf(pimpl);
+	if (zone.voice >= t.layers.size() || zone.preset >= t.preset_names.size()) {
+		return false;
+	}
+	const Layer& layer = t.layers[zone.voice];
+	if (zone.voice < t.layer_begin[zone.preset] || zone.voice >= t.layer_begin[zone.preset + 1]
+		|| layer.preset_zone != zone.preset_zone || layer.instrument_zone != zone.instrument_zone) {
+		return false;
+	}
+	const std::size_t row = std::size_t(zone.voice) * SfGenEndOper;
+	std::copy_n(t.raw.begin() + row, SfGenEndOper, out.raw.begin());
+	std::copy_n(t.physical.begin() + row, SfGenEndOper, out.physical.begin());
+	return true;
+}
@@ -0,0 +1,149 @@
+#ifndef SF2ML_SFFROZENIMPL_HPP_
+#define SF2ML_SFFROZENIMPL_HPP_
+
+#include <sffrozen.hpp>
+#include "sffilemap.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+
+// Storage of FrozenSoundFont. Every column of a snapshot lives in a single block(the arena):
+// allocated and filled by SoundFont::Freeze, or mapped from a cache file(see sfcache.cpp),
+// where the arena is stored as is. Columns start on 64-byte boundaries, the sample pool comes last.
+namespace SF2ML::frozen {
+	constexpr std::size_t column_alignment = 64;
+
+	inline auto AlignUp(std::size_t size) noexcept -> std::size_t {
+		return (size + column_alignment - 1) & ~(column_alignment - 1);
+	}
+
+	// a preset zone x instrument zone pair, with its intersected ranges
+	struct Layer {
+		BYTE key_lo;
+		BYTE key_hi;
+		BYTE vel_lo;
+		BYTE vel_hi;
+		std::uint32_t preset_zone;
+		std::uint32_t instrument;
+		std::uint32_t instrument_zone;
+		std::uint32_t sample;
+	};
+
+	struct Tables {
+		SampleBitDepth bit_depth = SampleBitDepth::Signed16;
+
+		// interned names: name i is name_chars[name_begin[i], name_begin[i + 1])
+		std::span<const char> name_chars;
+		std::span<const std::uint32_t> name_begin;
+
+		std::span<const std::uint32_t> preset_names;
+		std::span<const WORD> preset_banks;
+		std::span<const WORD> preset_programs;
+		std::span<const std::uint32_t> preset_zone_begin;
+		SfFrozenZones preset_zones;
+
+		std::span<const std::uint32_t> inst_names;
+		std::span<const std::uint32_t> inst_zone_begin;
+		SfFrozenZones inst_zones;
+
+		std::span<const std::uint32_t> sample_names;
+		std::span<const std::uint32_t> sample_rates;
+		std::span<const std::uint32_t> loop_starts;
+		std::span<const std::uint32_t> loop_ends;
+		std::span<const BYTE> root_keys;
+		std::span<const CHAR> pitch_corrections;
+		std::span<const SFSampleLink> sample_modes;
+		std::span<const std::uint32_t> sample_links;
+		// points of sample i: pool[sample_begin[i], sample_begin[i] + sample_size[i])
+		std::span<const std::uint64_t> sample_begin;
+		std::span<const std::uint64_t> sample_size;
+
+		// (bank, program) keys in ascending order, and their presets
+		std::span<const DWORD> program_keys;
+		std::span<const std::uint32_t> program_presets;
+
+		// layers of preset p: layers[layer_begin[p], layer_begin[p + 1]);
+		// those playing key k: layers[layer_begin[p] + key_items[i]] for i in [key_offsets[p * 129 + k], key_offsets[p * 129 + k + 1])
+		std::span<const Layer> layers;
+		std::span<const std::uint32_t> layer_begin;
+		std::span<const std::uint32_t> key_offsets;
+		std::span<const std::uint32_t> key_items;
+		// voice table: one row of SfGenEndOper values per layer
+		std::span<const SHORT> raw;
+		std::span<const float> physical;
+
+		// the sample points, 64-byte aligned(the last column of the arena)
+		std::span<const BYTE> pool;
+	};
+
+	// calls f(column) for every column of tables but the pool, in the order of the arena
+	template <typename F>
+	void ForEachColumn(Tables& t, F&& f) {
+		f(t.name_chars);
+		f(t.name_begin);
+		f(t.preset_names);
+		f(t.preset_banks);
+		f(t.preset_programs);
+		f(t.preset_zone_begin);
+		f(t.inst_names);
+		f(t.inst_zone_begin);
+		for (SfFrozenZones* zones : { &t.preset_zones, &t.inst_zones }) {
+			f(zones->key_lo);
+			f(zones->key_hi);
+			f(zones->vel_lo);
+			f(zones->vel_hi);
+			f(zones->target);
+			f(zones->gen_begin);
+			f(zones->mod_begin);
+			f(zones->generators);
+			f(zones->modulators);
+		}
+		f(t.sample_names);
+		f(t.sample_rates);
+		f(t.loop_starts);
+		f(t.loop_ends);
+		f(t.root_keys);
+		f(t.pitch_corrections);
+		f(t.sample_modes);
+		f(t.sample_links);
+		f(t.sample_begin);
+		f(t.sample_size);
+		f(t.program_keys);
+		f(t.program_presets);
+		f(t.layers);
+		f(t.layer_begin);
+		f(t.key_offsets);
+		f(t.key_items);
+		f(t.raw);
+		f(t.physical);
+	}
+}
+
+namespace SF2ML {
+	class FrozenSoundFontImpl {
+	public:
+		explicit FrozenSoundFontImpl(std::pmr::memory_resource* resource) noexcept : resource{resource} {}
+		~FrozenSoundFontImpl() {
+			if (arena_owned) {
+				resource->deallocate(const_cast<BYTE*>(arena.data()), arena.size(), frozen::column_alignment);
+			}
+			UnmapFile(mapping);
+		}
+		FrozenSoundFontImpl(const FrozenSoundFontImpl&) = delete;
+		FrozenSoundFontImpl& operator=(const FrozenSoundFontImpl&) = delete;
+
+		// fills the tables from sf2(see SoundFont::Freeze)
+		void Build(const SoundFont& sf2);
+
+		std::pmr::memory_resource* resource;
+		frozen::Tables tables;
+		// the block every column points into
+		std::span<const BYTE> arena;
+		bool arena_owned = false;  // allocated from resource by Build
+		FileMapping mapping;       // the cache file the arena is part of
+	};
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef SF2ML_SFGENERATORSET_HPP_
+#define SF2ML_SFGENERATORSET_HPP_
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+#include "sfgenerator.hpp"
+
+namespace SF2ML {
+
+	/// Compact generator storage of a single zone.
+	/// Only the generators that are actually set are stored, as (type, raw amount) pairs sorted by type.
+	/// The presence mask answers "is this generator set?" without touching the entries,
+	/// and the amount interpretation comes from GetGenValueType(sfgenerator.hpp).
+	class SfGeneratorSet {
+	public:
+		using Entry = SfGenEntry;
+
+		explicit SfGeneratorSet(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: entries(resource) {}
+
+		SfGeneratorSet(const SfGeneratorSet&) = default;
+		SfGeneratorSet& operator=(const SfGeneratorSet&) = default;
+		// the moved-from set is left empty (the mask must agree with the entries)
+		SfGeneratorSet(SfGeneratorSet&& rhs) noexcept
+			: mask{std::exchange(rhs.mask, 0)}, entries(std::move(rhs.entries)) {}
+		SfGeneratorSet& operator=(SfGeneratorSet&& rhs) {
+			mask = std::exchange(rhs.mask, 0);
+			entries = std::move(rhs.entries);
+			rhs.entries.clear();
+			return *this;
+		}
+
+		bool Has(SFGenerator type) const noexcept {
+			return type < SfGenEndOper && (mask >> type) & 1;
+		}
+
+		/// @return raw amount of the generator / std::nullopt when it is not set
+		std::optional<WORD> Get(SFGenerator type) const noexcept {
+			if (!Has(type)) {
+				return std::nullopt;
+			}
+			for (const Entry& e : entries) {
+				if (e.type == type) {
+					return e.raw;
+				}
+			}
+			return std::nullopt;
+		}
+
+		void Set(SFGenerator type, WORD raw) {
+			if (type >= SfGenEndOper) {
+				return;
+			}
+			auto it = std::find_if(entries.begin(), entries.end(), [type](const Entry& e) { return e.type >= type; });
+			if (Has(type)) {
+				it->raw = raw;
+			} else {
+				entries.insert(it, Entry{ type, raw });
+				mask |= std::uint64_t(1) << type;
+			}
+		}
+
+		void Reset(SFGenerator type) noexcept {
+			if (!Has(type)) {
+				return;
+			}
+			auto it = std::find_if(entries.begin(), entries.end(), [type](const Entry& e) { return e.type == type; });
+			entries.erase(it);
+			mask &= ~(std::uint64_t(1) << type);
+		}
+
+		DWORD Count() const noexcept {
+			return std::popcount(mask);
+		}
+
+		/// @brief all set generators, sorted by generator type
+		auto Entries() const noexcept -> std::span<const Entry> {
+			return entries;
+		}
+
+		/// @brief presence mask (bit i: generator i is set), Entries()[k] is the k-th set bit
+		std::uint64_t Mask() const noexcept {
+			return mask;
+		}
+
+	private:
+		static_assert(SfGenEndOper <= 64, "generator mask is too narrow");
+
+		std::uint64_t mask = 0;
+		std::pmr::vector<Entry> entries;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -3,12 +3,15 @@
 
 #include <vector>
 #include <map>
+#include <memory_resource>
 #include <algorithm>
 #include <optional>
 #include <cassert>
 #include <utility>
 #include <limits>
 #include <concepts>
+#include <span>
+#include <type_traits>
 #include "sfspec.hpp"
 #include "sfhandle.hpp"
 
@@ -26,7 +29,15 @@ namespace SF2ML {
 	requires SfHandle<HandleT> && DataTypeRequirements<DataType, HandleT>
 	class SfHandleInterface {
 	public:
+		/** @brief creates an empty interface
+		 *  @param resource memory resource from which the items and the lookup tables are allocated
+		*/
+		explicit SfHandleInterface(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: interface(resource), data(resource), handles(resource) {}
+
 		/** @brief creates new item with corresponding new handle
+		 *         (the item is constructed with DataType(handle, args..., GetResource()),
+		 *          or DataType(handle, args...) when it does not take a memory resource)
 		 *  @throw throws std::length_error when item can no longer be created
 		 *  @return reference to the newly created object
 		*/
@@ -42,7 +53,7 @@ namespace SF2ML {
 
 			HandleT handle(next_key++);
 			interface.emplace(handle, static_cast<DWORD>(this->data.size()));
-			data.emplace_back(handle, std::forward<Args>(args)...);
+			EmplaceItem(handle, std::forward<Args>(args)...);
 			handles.push_back(handle);
 			return data.back();
 		}
@@ -59,7 +70,7 @@ namespace SF2ML {
 
 			HandleT handle(key);
 			interface.emplace(handle, static_cast<DWORD>(this->data.size()));
-			data.emplace_back(handle, std::forward<Args>(args)...);
+			EmplaceItem(handle, std::forward<Args>(args)...);
 			handles.push_back(handle);
 
 			next_key = key + 1;
@@ -91,6 +102,43 @@ namespace SF2ML {
 			return false;
 		}
 
+		/** @brief removes every item in targets with one stable compaction pass and one rebuild of the lookup table
+		 *         (handles of non existing items, and duplicates, are ignored)
+		 *  @return number of removed items
+		*/
+		DWORD RemoveMany(std::span<const HandleT> targets) {
+			std::pmr::vector<bool> doomed(data.size(), false, GetResource());
+			DWORD count = 0;
+			for (HandleT handle : targets) {
+				if (auto it = interface.find(handle); it != interface.end() && !doomed[it->second]) {
+					doomed[it->second] = true;
+					count++;
+				}
+			}
+			if (count == 0) {
+				return 0;
+			}
+
+			DWORD kept = 0;
+			for (DWORD id = 0; id < data.size(); id++) {
+				if (!doomed[id]) {
+					if (kept != id) {
+						data[kept] = std::move(data[id]);
+						handles[kept] = handles[id];
+					}
+					kept++;
+				}
+			}
+			data.erase(data.begin() + kept, data.end());
+			handles.erase(handles.begin() + kept, handles.end());
+
+			interface.clear();
+			for (DWORD id = 0; id < kept; id++) {
+				interface.emplace(handles[id], id);
+			}
+			return count;
+		}
+
 		/** @brief gets pointer to the item with corresponding handle (invalidated when NewItem/Remove is called)
 		 *  @return pointer to the existing item / nullptr when it does not exist
 		 */
@@ -128,10 +176,25 @@ namespace SF2ML {
 		 *  @return first, last const_iterator pair of all valid handles
 		*/
 		auto GetAllHandles() const noexcept
-		-> std::pair<typename std::vector<HandleT>::const_iterator, typename std::vector<HandleT>::const_iterator> {
+		-> std::pair<typename std::pmr::vector<HandleT>::const_iterator, typename std::pmr::vector<HandleT>::const_iterator> {
 			return std::make_pair(handles.cbegin(), handles.cend());
 		}
 
+		// @brief contiguous view of all items (invalidated when NewItem/Remove is called)
+		auto Items() const noexcept -> std::span<const DataType> {
+			return data;
+		}
+
+		// @brief contiguous mutable view of all items (the items must not be reassigned through it)
+		auto Items() noexcept -> std::span<DataType> {
+			return data;
+		}
+
+		// @brief memory resource used by this interface (and passed down to newly created items)
+		std::pmr::memory_resource* GetResource() const noexcept {
+			return data.get_allocator().resource();
+		}
+
 		// @brief counts all items in interface
 		DWORD Count() const noexcept {
 			return data.size();
@@ -149,23 +212,32 @@ namespace SF2ML {
 			return sz;
 		}
 
-		auto begin() noexcept -> typename std::vector<DataType>::iterator {
+		auto begin() noexcept -> typename std::pmr::vector<DataType>::iterator {
 			return data.begin();
 		}
-		auto end() noexcept -> typename std::vector<DataType>::iterator {
+		auto end() noexcept -> typename std::pmr::vector<DataType>::iterator {
 			return data.end();
 		}
-		auto begin() const noexcept -> typename std::vector<DataType>::const_iterator {
+		auto begin() const noexcept -> typename std::pmr::vector<DataType>::const_iterator {
 			return data.begin();
 		}
-		auto end() const noexcept -> typename std::vector<DataType>::const_iterator {
+		auto end() const noexcept -> typename std::pmr::vector<DataType>::const_iterator {
 			return data.end();
 		}
 	private:
+		template <typename... Args>
+		void EmplaceItem(HandleT handle, Args&&... args) {
+			if constexpr (std::is_constructible_v<DataType, HandleT, Args&&..., std::pmr::memory_resource*>) {
+				data.emplace_back(handle, std::forward<Args>(args)..., GetResource());
+			} else {
+				data.emplace_back(handle, std::forward<Args>(args)...);
+			}
+		}
+
 		decltype(HandleT::value) next_key = 0;
-		std::map<HandleT, DWORD> interface;
-		std::vector<DataType> data;
-		std::vector<HandleT> handles;
+		std::pmr::map<HandleT, DWORD> interface;
+		std::pmr::vector<DataType> data;
+		std::pmr::vector<HandleT> handles;
 	};
 }
 
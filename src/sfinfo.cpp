@@ -8,19 +8,24 @@ using namespace SF2ML;
 
 namespace SF2ML {
 	class SfInfoImpl {
+		std::pmr::memory_resource* resource;
+
 		VersionTag sf_version;
-		std::string target_sound_engine;
-		std::string sf_bank_name;
-		std::optional<std::string> sound_rom_name;
+		std::pmr::string target_sound_engine;
+		std::pmr::string sf_bank_name;
+		std::optional<std::pmr::string> sound_rom_name;
 		std::optional<VersionTag> sound_rom_version;
-		std::optional<std::string> creation_date;
-		std::optional<std::string> author;
-		std::optional<std::string> target_product;
-		std::optional<std::string> copyright_msg;
-		std::optional<std::string> comments;
-		std::optional<std::string> sf_tools;
+		std::optional<std::pmr::string> creation_date;
+		std::optional<std::pmr::string> author;
+		std::optional<std::pmr::string> target_product;
+		std::optional<std::pmr::string> copyright_msg;
+		std::optional<std::pmr::string> comments;
+		std::optional<std::pmr::string> sf_tools;
 
 		friend SfInfo;
+	public:
+		SfInfoImpl(std::pmr::memory_resource* resource)
+			: resource{resource}, target_sound_engine(resource), sf_bank_name(resource) {}
 	};
 }
 
@@ -34,7 +39,7 @@ namespace {
 		return h16;
 	}
 
-	void SetStr255(std::string& dst, std::string_view sv) {
+	void SetStr255(std::pmr::string& dst, std::string_view sv) {
 		constexpr std::size_t LIMIT = 255;
 		const char* hex = "0123456789abcdef";
 
@@ -53,9 +58,11 @@ namespace {
 		}
 	}
 
-	void SetStr255(std::optional<std::string>& dst, std::optional<std::string_view> sv) {
+	void SetStr255(std::optional<std::pmr::string>& dst,
+				   std::optional<std::string_view> sv,
+				   std::pmr::memory_resource* resource) {
 		if (sv) {
-			dst = "";
+			dst.emplace(resource);
 			SetStr255(*dst, *sv);
 		} else {
 			dst = std::nullopt;
@@ -63,8 +70,18 @@ namespace {
 	}
 }
 
-SfInfo::SfInfo() {
-	pimpl = std::make_unique<SfInfoImpl>();
+namespace {
+	std::optional<std::string> ToStdString(const std::optional<std::pmr::string>& str) {
+		if (str) {
+			return std::string(*str);
+		} else {
+			return std::nullopt;
+		}
+	}
+}
+
+SfInfo::SfInfo(std::pmr::memory_resource* resource) {
+	pimpl = MakePmrUnique<SfInfoImpl>(resource, resource);
 }
 
 SfInfo::~SfInfo() {
@@ -97,7 +114,7 @@ SfInfo& SfInfo::SetBankName(std::string_view bank_name) {
 }
 
 SfInfo& SfInfo::SetSoundRomName(std::optional<std::string_view> rom_name) {
-	SetStr255(pimpl->sound_rom_name, rom_name);
+	SetStr255(pimpl->sound_rom_name, rom_name, pimpl->resource);
 	return *this;
 }
 
@@ -107,32 +124,32 @@ SfInfo& SfInfo::SetSoundRomVersion(std::optional<VersionTag> rom_version) {
 }
 
 SfInfo& SfInfo::SetCreationDate(std::optional<std::string_view> date) {
-	SetStr255(pimpl->creation_date, date);
+	SetStr255(pimpl->creation_date, date, pimpl->resource);
 	return *this;
 }
 
 SfInfo& SfInfo::SetAuthor(std::optional<std::string_view> author) {
-	SetStr255(pimpl->author, author);
+	SetStr255(pimpl->author, author, pimpl->resource);
 	return *this;
 }
 
 SfInfo& SfInfo::SetTargetProduct(std::optional<std::string_view> target_product) {
-	SetStr255(pimpl->target_product, target_product);
+	SetStr255(pimpl->target_product, target_product, pimpl->resource);
 	return *this;
 }
 
 SfInfo& SfInfo::SetCopyrightMessage(std::optional<std::string_view> message) {
-	SetStr255(pimpl->copyright_msg, message);
+	SetStr255(pimpl->copyright_msg, message, pimpl->resource);
 	return *this;
 }
 
 SfInfo& SfInfo::SetComments(std::optional<std::string_view> comments) {
-	SetStr255(pimpl->comments, comments);
+	SetStr255(pimpl->comments, comments, pimpl->resource);
 	return *this;
 }
 
 SfInfo& SfInfo::SetToolUsed(std::optional<std::string_view> sf_tools) {
-	SetStr255(pimpl->sf_tools, sf_tools);
+	SetStr255(pimpl->sf_tools, sf_tools, pimpl->resource);
 	return *this;
 }
 
@@ -141,15 +158,15 @@ auto SfInfo::GetSoundFontVersion() const -> VersionTag {
 }
 
 auto SfInfo::GetSoundEngine() const -> std::string {
-	return pimpl->target_sound_engine;
+	return std::string(pimpl->target_sound_engine);
 }
 
 auto SfInfo::GetBankName() const -> std::string {
-	return pimpl->sf_bank_name;
+	return std::string(pimpl->sf_bank_name);
 }
 
 auto SfInfo::GetSoundRomName() const -> std::optional<std::string> {
-	return pimpl->sound_rom_name;
+	return ToStdString(pimpl->sound_rom_name);
 }
 
 auto SfInfo::GetSoundRomVersion() const -> std::optional<VersionTag> {
@@ -157,25 +174,25 @@ auto SfInfo::GetSoundRomVersion() const -> std::optional<VersionTag> {
 }
 
 auto SfInfo::GetCreationDate() const -> std::optional<std::string> {
-	return pimpl->creation_date;
+	return ToStdString(pimpl->creation_date);
 }
 
 auto SfInfo::GetAuthor() const -> std::optional<std::string> {
-	return pimpl->author;
+	return ToStdString(pimpl->author);
 }
 
 auto SfInfo::GetTargetProduct() const -> std::optional<std::string> {
-	return pimpl->target_product;
+	return ToStdString(pimpl->target_product);
 }
 
 auto SfInfo::GetCopyrightMessage() const -> std::optional<std::string> {
-	return pimpl->copyright_msg;
+	return ToStdString(pimpl->copyright_msg);
 }
 
 auto SfInfo::GetComments() const -> std::optional<std::string> {
-	return pimpl->comments;
+	return ToStdString(pimpl->comments);
 }
 
 auto SfInfo::GetToolUsed() const -> std::optional<std::string> {
-	return pimpl->sf_tools;
+	return ToStdString(pimpl->sf_tools);
 }
@@ -1,5 +1,6 @@
 #include <sfinstrument.hpp>
 #include "sfhandleinterface.hpp"
+#include "sfobserver.hpp"
 
 using namespace SF2ML;
 
@@ -9,13 +10,21 @@ namespace SF2ML {
 		InstHandle self_handle;
 		char inst_name[21] {};
 		SfHandleInterface<SfInstrumentZone, IZoneHandle> zones;
+		SfObserver* observer = nullptr;
 	public:
-		SfInstrumentImpl(InstHandle handle) : self_handle(handle) {}
+		SfInstrumentImpl(InstHandle handle, std::pmr::memory_resource* resource)
+			: self_handle(handle), zones(resource) {}
+
+		void Touch() {
+			if (observer) {
+				observer->OnInstrumentChanged(self_handle);
+			}
+		}
 	};
 }
 
-SfInstrument::SfInstrument(InstHandle handle) {
-	pimpl = std::make_unique<SfInstrumentImpl>(handle);
+SfInstrument::SfInstrument(InstHandle handle, std::pmr::memory_resource* resource) {
+	pimpl = MakePmrUnique<SfInstrumentImpl>(resource, handle, resource);
 
 	// global zone
 	pimpl->zones.NewItem();
@@ -47,7 +56,10 @@ SfInstrumentZone& SfInstrument::GetGlobalZone() {
 }
 
 SfInstrumentZone& SfInstrument::NewZone() {
-	return pimpl->zones.NewItem();
+	SfInstrumentZone& zone = pimpl->zones.NewItem();
+	zone.Attach(pimpl->observer, pimpl->self_handle);
+	pimpl->Touch();
+	return zone;
 }
 
 std::uint32_t SfInstrument::CountZones(bool count_empty) const {
@@ -75,8 +87,32 @@ void SfInstrument::ForEachZone(std::function<void(const SfInstrumentZone &)> pre
 	}
 }
 
+auto SfInstrument::Zones() const noexcept -> std::span<const SfInstrumentZone> {
+	return pimpl->zones.Items();
+}
+
+auto SfInstrument::MutableZones() noexcept -> std::span<SfInstrumentZone> {
+	return pimpl->zones.Items();
+}
+
 void SfInstrument::RemoveZone(IZoneHandle zone_handle) {
-	pimpl->zones.Remove(zone_handle);
+	if (SfInstrumentZone* zone = pimpl->zones.Get(zone_handle)) {
+		zone->Detach();
+	}
+	if (pimpl->zones.Remove(zone_handle)) {
+		pimpl->Touch();
+	}
+}
+
+void SfInstrument::RemoveZones(std::span<const IZoneHandle> zone_handles) {
+	for (IZoneHandle zone_handle : zone_handles) {
+		if (SfInstrumentZone* zone = pimpl->zones.Get(zone_handle)) {
+			zone->Detach();
+		}
+	}
+	if (pimpl->zones.RemoveMany(zone_handles) > 0) {
+		pimpl->Touch();
+	}
 }
 
 auto SfInstrument::FindZone(std::function<bool(const SfInstrumentZone &)> pred) -> std::optional<IZoneHandle> {
@@ -101,9 +137,26 @@ auto SfInstrument::FindZones(std::function<bool(const SfInstrumentZone &)> pred)
 SfInstrument& SfInstrument::SetName(std::string_view x) {
 	std::memset(pimpl->inst_name, 0, 21);
 	std::memcpy(pimpl->inst_name, x.data(), std::min<size_t>(x.length(), 20));
+	if (pimpl->observer) {
+		pimpl->observer->OnInstrumentRenamed(pimpl->self_handle);
+	}
 	return *this;
 }
 
 std::string SF2ML::SfInstrument::GetName() const {
 	return pimpl->inst_name;
 }
+
+void SfInstrument::Attach(SfObserver* observer) {
+	pimpl->observer = observer;
+	for (auto& zone : pimpl->zones) {
+		zone.Attach(observer, pimpl->self_handle);
+	}
+}
+
+void SfInstrument::Detach() {
+	for (auto& zone : pimpl->zones) {
+		zone.Detach();
+	}
+	pimpl->observer = nullptr;
+}
\ No newline at end of file
@@ -5,10 +5,10 @@
 #include <climits>
 #include <cassert>
 #include <utility>
-#include <bitset>
-#include <array>
 
-#include "sfhandleinterface.hpp"
+#include "sfmodulatorlist.hpp"
+#include "sfgeneratorset.hpp"
+#include "sfobserver.hpp"
 
 using namespace SF2ML;
 
@@ -17,17 +17,40 @@ namespace SF2ML {
 		friend SfInstrumentZone;
 		IZoneHandle self_handle;
 		// generators
-		std::bitset<SfGenEndOper> active_gens {};
-		std::array<SfGenAmount, SfGenEndOper> generators;
+		SfGeneratorSet generators;
 		// modulators
-		SfHandleInterface<SfModulator, ModHandle> modulators;
+		SfModulatorList modulators;
+		// edit notification
+		SfObserver* observer = nullptr;
+		InstHandle owner {0};
 	public:
-		SfInstrumentZoneImpl(IZoneHandle handle) : self_handle{handle} {}
+		SfInstrumentZoneImpl(IZoneHandle handle, std::pmr::memory_resource* resource)
+			: self_handle{handle}, generators(resource), modulators(resource) {}
+
+		// amount of the generator clamped into its legal range(or its default when the zone does not set it)
+		SHORT Amount(SFGenerator type) const noexcept {
+			const auto raw = generators.Get(type);
+			return raw ? ClampGenAmount(type, static_cast<SHORT>(*raw)) : GetGenTraits(type).default_value;
+		}
+
+		void Touch() {
+			if (observer) {
+				observer->OnInstrumentChanged(owner);
+				observer->OnZoneSampleChanged(owner, self_handle, ReferencedSample());
+			}
+		}
+
+		std::optional<SmplHandle> ReferencedSample() const noexcept {
+			if (auto raw = generators.Get(SfGenSampleID)) {
+				return SmplHandle(*raw);
+			}
+			return std::nullopt;
+		}
 	};
 }
 
-SfInstrumentZone::SfInstrumentZone(IZoneHandle handle) {
-	pimpl = std::make_unique<SfInstrumentZoneImpl>(handle);
+SfInstrumentZone::SfInstrumentZone(IZoneHandle handle, std::pmr::memory_resource* resource) {
+	pimpl = MakePmrUnique<SfInstrumentZoneImpl>(resource, handle, resource);
 }
 
 SfInstrumentZone::~SfInstrumentZone() {
@@ -49,14 +72,14 @@ IZoneHandle SfInstrumentZone::GetHandle() const {
 
 bool SfInstrumentZone::IsEmpty() const noexcept {
 	if (pimpl->self_handle.value == 0) {
-		return pimpl->active_gens.count() == 0 && pimpl->modulators.Count() == 0;
+		return pimpl->generators.Count() == 0 && pimpl->modulators.Count() == 0;
 	} else {
-		return pimpl->active_gens.count() == 0;
+		return pimpl->generators.Count() == 0;
 	}
 }
 
 DWORD SfInstrumentZone::GeneratorCount() const noexcept {
-	return pimpl->active_gens.count();
+	return pimpl->generators.Count();
 }
 
 DWORD SF2ML::SfInstrumentZone::ModulatorCount() const noexcept {
@@ -65,40 +88,28 @@ DWORD SF2ML::SfInstrumentZone::ModulatorCount() const noexcept {
 
 bool SfInstrumentZone::HasGenerator(SFGenerator type) const {
 	assert(static_cast<WORD>(type) < SfGenEndOper);
-	return pimpl->active_gens[static_cast<WORD>(type)];
+	return pimpl->generators.Has(type);
 }
 
-#define IZONE_S16_PLAIN_GETTER_IMPL(GeneratorType, DefaultBits) \
+#define IZONE_S16_PLAIN_GETTER_IMPL(GeneratorType) \
 	auto SfInstrumentZone::Get##GeneratorType() const -> std::int16_t { \
-		if (HasGenerator(SfGen##GeneratorType)) { \
-			return std::get<SHORT>(pimpl->generators[SfGen##GeneratorType]); \
-		} else { \
-			return DefaultBits; \
-		} \
+		return pimpl->Amount(SfGen##GeneratorType); \
 	}
 
-#define IZONE_TIME_CENT_GETTER_IMPL(GeneratorType, DefaultBits) \
+#define IZONE_TIME_CENT_GETTER_IMPL(GeneratorType) \
 	auto SfInstrumentZone::Get##GeneratorType() const -> double { \
-		if (HasGenerator(SfGen##GeneratorType)) { \
-			return TimeCentToSeconds(std::get<SHORT>(pimpl->generators[SfGen##GeneratorType])); \
-		} else { \
-			return TimeCentToSeconds(DefaultBits); \
-		} \
+		return TimeCentToSeconds(pimpl->Amount(SfGen##GeneratorType)); \
 	}
 
-#define IZONE_ABSL_CENT_GETTER_IMPL(GeneratorType, DefaultBits) \
+#define IZONE_ABSL_CENT_GETTER_IMPL(GeneratorType) \
 	auto SfInstrumentZone::Get##GeneratorType() const -> double { \
-		if (HasGenerator(SfGen##GeneratorType)) { \
-			return AbsoluteCentToHertz(std::get<SHORT>(pimpl->generators[SfGen##GeneratorType])); \
-		} else { \
-			return AbsoluteCentToHertz(DefaultBits); \
-		} \
+		return AbsoluteCentToHertz(pimpl->Amount(SfGen##GeneratorType)); \
 	}
 
 #define IZONE_RANGE_GETTER_IMPL(GeneratorType) \
 	auto SfInstrumentZone::Get##GeneratorType() const -> Ranges<std::uint8_t> { \
 		if (HasGenerator(SfGen##GeneratorType)) { \
-			return std::get<Ranges<BYTE>>(pimpl->generators[SfGen##GeneratorType]); \
+			return std::get<Ranges<BYTE>>(DecodeGenAmount(SfGen##GeneratorType, *pimpl->generators.Get(SfGen##GeneratorType))); \
 		} else { \
 			return { 0, 127 }; \
 		} \
@@ -107,45 +118,35 @@ bool SfInstrumentZone::HasGenerator(SFGenerator type) const {
 #define IZONE_S16_PLAIN_SETTER_IMPL(GeneratorType) \
 	auto SfInstrumentZone::Set##GeneratorType(std::optional<std::int16_t> x) -> SfInstrumentZone& { \
 		if (x.has_value()) { \
-			pimpl->generators[SfGen##GeneratorType] = x.value(); \
-			pimpl->active_gens.set(SfGen##GeneratorType); \
+			pimpl->generators.Set(SfGen##GeneratorType, static_cast<WORD>(ClampGenAmount(SfGen##GeneratorType, x.value()))); \
 		} else { \
-			pimpl->active_gens.reset(SfGen##GeneratorType); \
+			pimpl->generators.Reset(SfGen##GeneratorType); \
 		} \
+		pimpl->Touch(); \
 		return *this; \
 	}
 
-#define IZONE_TIME_CENT_SETTER_IMPL(GeneratorType, MinVal, MaxVal) \
+#define IZONE_TIME_CENT_SETTER_IMPL(GeneratorType) \
 	auto SfInstrumentZone::Set##GeneratorType(std::optional<double> x) -> SfInstrumentZone& { \
 		if (x.has_value()) { \
-			SHORT cent = SecondsToTimeCent(x.value()); \
-			if (cent < (MinVal)) { \
-				cent = (MinVal); \
-			} else if (cent > (MaxVal)) { \
-				cent = (MaxVal); \
-			} \
-			pimpl->generators[SfGen##GeneratorType] = cent; \
-			pimpl->active_gens.set(SfGen##GeneratorType); \
+			const SHORT cent = ClampGenAmount(SfGen##GeneratorType, SecondsToTimeCent(x.value())); \
+			pimpl->generators.Set(SfGen##GeneratorType, static_cast<WORD>(cent)); \
 		} else { \
-			pimpl->active_gens.reset(SfGen##GeneratorType); \
+			pimpl->generators.Reset(SfGen##GeneratorType); \
 		} \
+		pimpl->Touch(); \
 		return *this; \
 	}
 
-#define IZONE_ABSL_CENT_SETTER_IMPL(GeneratorType, MinVal, MaxVal) \
+#define IZONE_ABSL_CENT_SETTER_IMPL(GeneratorType) \
 	auto SfInstrumentZone::Set##GeneratorType(std::optional<double> x) -> SfInstrumentZone& { \
 		if (x.has_value()) { \
-			SHORT cent = HertzToAbsoluteCent(x.value()); \
-			if (cent < (MinVal)) { \
-				cent = (MinVal); \
-			} else if (cent > (MaxVal)) { \
-				cent = (MaxVal); \
-			} \
-			pimpl->generators[SfGen##GeneratorType] = cent; \
-			pimpl->active_gens.set(SfGen##GeneratorType); \
+			const SHORT cent = ClampGenAmount(SfGen##GeneratorType, HertzToAbsoluteCent(x.value())); \
+			pimpl->generators.Set(SfGen##GeneratorType, static_cast<WORD>(cent)); \
 		} else { \
-			pimpl->active_gens.reset(SfGen##GeneratorType); \
+			pimpl->generators.Reset(SfGen##GeneratorType); \
 		} \
+		pimpl->Touch(); \
 		return *this; \
 	}
 
@@ -153,56 +154,56 @@ bool SfInstrumentZone::HasGenerator(SFGenerator type) const {
 	auto SfInstrumentZone::Set##GeneratorType(std::optional<Ranges<std::uint8_t>> x) -> SfInstrumentZone& { \
 		if (x.has_value()) { \
 			Ranges<BYTE> ranges { x->start, x->end }; \
-			pimpl->generators[SfGen##GeneratorType] = ranges; \
-			pimpl->active_gens.set(SfGen##GeneratorType); \
+			pimpl->generators.Set(SfGen##GeneratorType, EncodeGenAmount(ranges)); \
 		} else { \
-			pimpl->active_gens.reset(SfGen##GeneratorType); \
+			pimpl->generators.Reset(SfGen##GeneratorType); \
 		} \
+		pimpl->Touch(); \
 		return *this; \
 	}
 
-IZONE_S16_PLAIN_GETTER_IMPL(ModLfoToPitch,       0)
-IZONE_S16_PLAIN_GETTER_IMPL(VibLfoToPitch,       0)
-IZONE_S16_PLAIN_GETTER_IMPL(ModEnvToPitch,       0)
-IZONE_ABSL_CENT_GETTER_IMPL(InitialFilterFc, 13500)
-IZONE_S16_PLAIN_GETTER_IMPL(InitialFilterQ,      0)
-IZONE_S16_PLAIN_GETTER_IMPL(ModLfoToFilterFc,    0)
-IZONE_S16_PLAIN_GETTER_IMPL(ModEnvToFilterFc,    0)
-IZONE_S16_PLAIN_GETTER_IMPL(ModLfoToVolume,      0)
-IZONE_S16_PLAIN_GETTER_IMPL(ChorusEffectsSend,   0)
-IZONE_S16_PLAIN_GETTER_IMPL(ReverbEffectsSend,   0)
-IZONE_S16_PLAIN_GETTER_IMPL(Pan,                 0)
-IZONE_TIME_CENT_GETTER_IMPL(DelayModLFO,    -12000)
-IZONE_ABSL_CENT_GETTER_IMPL(FreqModLFO,          0)
-IZONE_TIME_CENT_GETTER_IMPL(DelayVibLFO,    -12000)
-IZONE_ABSL_CENT_GETTER_IMPL(FreqVibLFO,          0)  
-IZONE_TIME_CENT_GETTER_IMPL(DelayModEnv,    -12000)
-IZONE_TIME_CENT_GETTER_IMPL(AttackModEnv,   -12000)
-IZONE_TIME_CENT_GETTER_IMPL(HoldModEnv,     -12000)
-IZONE_TIME_CENT_GETTER_IMPL(DecayModEnv,    -12000)
-IZONE_S16_PLAIN_GETTER_IMPL(SustainModEnv,       0)
-IZONE_TIME_CENT_GETTER_IMPL(ReleaseModEnv,  -12000)
-IZONE_S16_PLAIN_GETTER_IMPL(KeynumToModEnvHold,  0)
-IZONE_S16_PLAIN_GETTER_IMPL(KeynumToModEnvDecay, 0)
-IZONE_TIME_CENT_GETTER_IMPL(DelayVolEnv,    -12000)
-IZONE_TIME_CENT_GETTER_IMPL(AttackVolEnv,   -12000)
-IZONE_TIME_CENT_GETTER_IMPL(HoldVolEnv,     -12000)
-IZONE_TIME_CENT_GETTER_IMPL(DecayVolEnv,    -12000)
-IZONE_S16_PLAIN_GETTER_IMPL(SustainVolEnv,       0)
-IZONE_TIME_CENT_GETTER_IMPL(ReleaseVolEnv,  -12000)
-IZONE_S16_PLAIN_GETTER_IMPL(KeynumToVolEnvHold,  0)
-IZONE_S16_PLAIN_GETTER_IMPL(KeynumToVolEnvDecay, 0)
+IZONE_S16_PLAIN_GETTER_IMPL(ModLfoToPitch)
+IZONE_S16_PLAIN_GETTER_IMPL(VibLfoToPitch)
+IZONE_S16_PLAIN_GETTER_IMPL(ModEnvToPitch)
+IZONE_ABSL_CENT_GETTER_IMPL(InitialFilterFc)
+IZONE_S16_PLAIN_GETTER_IMPL(InitialFilterQ)
+IZONE_S16_PLAIN_GETTER_IMPL(ModLfoToFilterFc)
+IZONE_S16_PLAIN_GETTER_IMPL(ModEnvToFilterFc)
+IZONE_S16_PLAIN_GETTER_IMPL(ModLfoToVolume)
+IZONE_S16_PLAIN_GETTER_IMPL(ChorusEffectsSend)
+IZONE_S16_PLAIN_GETTER_IMPL(ReverbEffectsSend)
+IZONE_S16_PLAIN_GETTER_IMPL(Pan)
+IZONE_TIME_CENT_GETTER_IMPL(DelayModLFO)
+IZONE_ABSL_CENT_GETTER_IMPL(FreqModLFO)
+IZONE_TIME_CENT_GETTER_IMPL(DelayVibLFO)
+IZONE_ABSL_CENT_GETTER_IMPL(FreqVibLFO)
+IZONE_TIME_CENT_GETTER_IMPL(DelayModEnv)
+IZONE_TIME_CENT_GETTER_IMPL(AttackModEnv)
+IZONE_TIME_CENT_GETTER_IMPL(HoldModEnv)
+IZONE_TIME_CENT_GETTER_IMPL(DecayModEnv)
+IZONE_S16_PLAIN_GETTER_IMPL(SustainModEnv)
+IZONE_TIME_CENT_GETTER_IMPL(ReleaseModEnv)
+IZONE_S16_PLAIN_GETTER_IMPL(KeynumToModEnvHold)
+IZONE_S16_PLAIN_GETTER_IMPL(KeynumToModEnvDecay)
+IZONE_TIME_CENT_GETTER_IMPL(DelayVolEnv)
+IZONE_TIME_CENT_GETTER_IMPL(AttackVolEnv)
+IZONE_TIME_CENT_GETTER_IMPL(HoldVolEnv)
+IZONE_TIME_CENT_GETTER_IMPL(DecayVolEnv)
+IZONE_S16_PLAIN_GETTER_IMPL(SustainVolEnv)
+IZONE_TIME_CENT_GETTER_IMPL(ReleaseVolEnv)
+IZONE_S16_PLAIN_GETTER_IMPL(KeynumToVolEnvHold)
+IZONE_S16_PLAIN_GETTER_IMPL(KeynumToVolEnvDecay)
 IZONE_RANGE_GETTER_IMPL(KeyRange)
 IZONE_RANGE_GETTER_IMPL(VelRange)
-IZONE_S16_PLAIN_GETTER_IMPL(InitialAttenuation,  0)
-IZONE_S16_PLAIN_GETTER_IMPL(CoarseTune,          0)
-IZONE_S16_PLAIN_GETTER_IMPL(FineTune,            0)
-IZONE_S16_PLAIN_GETTER_IMPL(ScaleTuning,       100)
+IZONE_S16_PLAIN_GETTER_IMPL(InitialAttenuation)
+IZONE_S16_PLAIN_GETTER_IMPL(CoarseTune)
+IZONE_S16_PLAIN_GETTER_IMPL(FineTune)
+IZONE_S16_PLAIN_GETTER_IMPL(ScaleTuning)
 
 IZONE_S16_PLAIN_SETTER_IMPL(ModLfoToPitch)
 IZONE_S16_PLAIN_SETTER_IMPL(VibLfoToPitch)
 IZONE_S16_PLAIN_SETTER_IMPL(ModEnvToPitch)
-IZONE_ABSL_CENT_SETTER_IMPL(InitialFilterFc, 1500, 13500)
+IZONE_ABSL_CENT_SETTER_IMPL(InitialFilterFc)
 IZONE_S16_PLAIN_SETTER_IMPL(InitialFilterQ)
 IZONE_S16_PLAIN_SETTER_IMPL(ModLfoToFilterFc)
 IZONE_S16_PLAIN_SETTER_IMPL(ModEnvToFilterFc)
@@ -210,24 +211,24 @@ IZONE_S16_PLAIN_SETTER_IMPL(ModLfoToVolume)
 IZONE_S16_PLAIN_SETTER_IMPL(ChorusEffectsSend)
 IZONE_S16_PLAIN_SETTER_IMPL(ReverbEffectsSend)
 IZONE_S16_PLAIN_SETTER_IMPL(Pan)
-IZONE_TIME_CENT_SETTER_IMPL(DelayModLFO,   -12000, 5000)
-IZONE_ABSL_CENT_SETTER_IMPL(FreqModLFO,     -1600, 4500)
-IZONE_TIME_CENT_SETTER_IMPL(DelayVibLFO,   -12000, 5000)
-IZONE_ABSL_CENT_SETTER_IMPL(FreqVibLFO,    -16000, 4500)  
-IZONE_TIME_CENT_SETTER_IMPL(DelayModEnv,   -12000, 5000)
-IZONE_TIME_CENT_SETTER_IMPL(AttackModEnv,  -12000, 8000)
-IZONE_TIME_CENT_SETTER_IMPL(HoldModEnv,    -12000, 5000)
-IZONE_TIME_CENT_SETTER_IMPL(DecayModEnv,   -12000, 8000)
+IZONE_TIME_CENT_SETTER_IMPL(DelayModLFO)
+IZONE_ABSL_CENT_SETTER_IMPL(FreqModLFO)
+IZONE_TIME_CENT_SETTER_IMPL(DelayVibLFO)
+IZONE_ABSL_CENT_SETTER_IMPL(FreqVibLFO)
+IZONE_TIME_CENT_SETTER_IMPL(DelayModEnv)
+IZONE_TIME_CENT_SETTER_IMPL(AttackModEnv)
+IZONE_TIME_CENT_SETTER_IMPL(HoldModEnv)
+IZONE_TIME_CENT_SETTER_IMPL(DecayModEnv)
 IZONE_S16_PLAIN_SETTER_IMPL(SustainModEnv)
-IZONE_TIME_CENT_SETTER_IMPL(ReleaseModEnv, -12000, 8000)
+IZONE_TIME_CENT_SETTER_IMPL(ReleaseModEnv)
 IZONE_S16_PLAIN_SETTER_IMPL(KeynumToModEnvHold)
 IZONE_S16_PLAIN_SETTER_IMPL(KeynumToModEnvDecay)
-IZONE_TIME_CENT_SETTER_IMPL(DelayVolEnv,   -12000, 5000)
-IZONE_TIME_CENT_SETTER_IMPL(AttackVolEnv,  -12000, 8000)
-IZONE_TIME_CENT_SETTER_IMPL(HoldVolEnv,    -12000, 5000)
-IZONE_TIME_CENT_SETTER_IMPL(DecayVolEnv,   -12000, 8000)
+IZONE_TIME_CENT_SETTER_IMPL(DelayVolEnv)
+IZONE_TIME_CENT_SETTER_IMPL(AttackVolEnv)
+IZONE_TIME_CENT_SETTER_IMPL(HoldVolEnv)
+IZONE_TIME_CENT_SETTER_IMPL(DecayVolEnv)
 IZONE_S16_PLAIN_SETTER_IMPL(SustainVolEnv)
-IZONE_TIME_CENT_SETTER_IMPL(ReleaseVolEnv, -12000, 8000)
+IZONE_TIME_CENT_SETTER_IMPL(ReleaseVolEnv)
 IZONE_S16_PLAIN_SETTER_IMPL(KeynumToVolEnvHold)
 IZONE_S16_PLAIN_SETTER_IMPL(KeynumToVolEnvDecay)
 IZONE_RANGE_SETTER_IMPL(KeyRange)
@@ -237,18 +238,18 @@ IZONE_S16_PLAIN_SETTER_IMPL(CoarseTune)
 IZONE_S16_PLAIN_SETTER_IMPL(FineTune)
 IZONE_S16_PLAIN_SETTER_IMPL(ScaleTuning)
 
-IZONE_S16_PLAIN_GETTER_IMPL(StartAddrsOffset,           0)
-IZONE_S16_PLAIN_GETTER_IMPL(EndAddrsOffset,             0)
-IZONE_S16_PLAIN_GETTER_IMPL(StartloopAddrsOffset,       0)
-IZONE_S16_PLAIN_GETTER_IMPL(EndloopAddrsOffset,         0)
-IZONE_S16_PLAIN_GETTER_IMPL(StartAddrsCoarseOffset,     0)
-IZONE_S16_PLAIN_GETTER_IMPL(EndAddrsCoarseOffset,       0)
-IZONE_S16_PLAIN_GETTER_IMPL(StartloopAddrsCoarseOffset, 0)
-IZONE_S16_PLAIN_GETTER_IMPL(EndloopAddrsCoarseOffset,   0)
-IZONE_S16_PLAIN_GETTER_IMPL(Keynum,            -1)
-IZONE_S16_PLAIN_GETTER_IMPL(Velocity,          -1)
-IZONE_S16_PLAIN_GETTER_IMPL(ExclusiveClass,     0)
-IZONE_S16_PLAIN_GETTER_IMPL(OverridingRootKey, -1)
+IZONE_S16_PLAIN_GETTER_IMPL(StartAddrsOffset)
+IZONE_S16_PLAIN_GETTER_IMPL(EndAddrsOffset)
+IZONE_S16_PLAIN_GETTER_IMPL(StartloopAddrsOffset)
+IZONE_S16_PLAIN_GETTER_IMPL(EndloopAddrsOffset)
+IZONE_S16_PLAIN_GETTER_IMPL(StartAddrsCoarseOffset)
+IZONE_S16_PLAIN_GETTER_IMPL(EndAddrsCoarseOffset)
+IZONE_S16_PLAIN_GETTER_IMPL(StartloopAddrsCoarseOffset)
+IZONE_S16_PLAIN_GETTER_IMPL(EndloopAddrsCoarseOffset)
+IZONE_S16_PLAIN_GETTER_IMPL(Keynum)
+IZONE_S16_PLAIN_GETTER_IMPL(Velocity)
+IZONE_S16_PLAIN_GETTER_IMPL(ExclusiveClass)
+IZONE_S16_PLAIN_GETTER_IMPL(OverridingRootKey)
 
 IZONE_S16_PLAIN_SETTER_IMPL(StartAddrsOffset)
 IZONE_S16_PLAIN_SETTER_IMPL(EndAddrsOffset)
@@ -265,7 +266,7 @@ IZONE_S16_PLAIN_SETTER_IMPL(OverridingRootKey)
 
 auto SfInstrumentZone::GetSample() const -> std::optional<SmplHandle> {
 	if (HasGenerator(SfGenSampleID)) {
-		return std::get<SmplHandle>(pimpl->generators[SfGenSampleID]);
+		return SmplHandle(*pimpl->generators.Get(SfGenSampleID));
 	} else {
 		return std::nullopt;
 	}
@@ -273,7 +274,7 @@ auto SfInstrumentZone::GetSample() const -> std::optional<SmplHandle> {
 
 auto SfInstrumentZone::GetSampleModes() const -> LoopMode {
 	if (HasGenerator(SfGenSampleModes)) {
-		WORD mode = std::get<WORD>(pimpl->generators[SfGenSampleModes]);
+		WORD mode = *pimpl->generators.Get(SfGenSampleModes);
 		switch (mode) {
 			case 0: return LoopMode::NoLoop;
 			case 1: case 2: return LoopMode::Loop;
@@ -287,58 +288,69 @@ auto SfInstrumentZone::GetSampleModes() const -> LoopMode {
 
 auto SfInstrumentZone::SetSample(std::optional<SmplHandle> x) -> SfInstrumentZone& {
 	if (x.has_value()) {
-		pimpl->active_gens.set(SfGenSampleID);
-		pimpl->generators[SfGenSampleID] = x.value();
+		pimpl->generators.Set(SfGenSampleID, x->value);
 	} else {
-		pimpl->active_gens.reset(SfGenSampleID);
+		pimpl->generators.Reset(SfGenSampleID);
 	}
+	pimpl->Touch();
 	return *this;
 }
 
 auto SfInstrumentZone::SetSampleModes(std::optional<LoopMode> x) -> SfInstrumentZone& {
 	if (x.has_value()) {
-		pimpl->active_gens.set(SfGenSampleModes);
 		switch (x.value()) {
 			case LoopMode::NoLoop:
-				pimpl->generators[SfGenSampleModes] = WORD(0);
+				pimpl->generators.Set(SfGenSampleModes, 0);
 				break;
 			case LoopMode::Loop:
-				pimpl->generators[SfGenSampleModes] = WORD(1);
+				pimpl->generators.Set(SfGenSampleModes, 1);
 				break;
 			case LoopMode::LoopWithRemainder:
-				pimpl->generators[SfGenSampleModes] = WORD(3);
+				pimpl->generators.Set(SfGenSampleModes, 3);
 				break;
 		}
 	} else {
-		pimpl->active_gens.reset(SfGenSampleModes);
+		pimpl->generators.Reset(SfGenSampleModes);
 	}
+	pimpl->Touch();
 	return *this;
 }
 
 auto SfInstrumentZone::SetGenerator(SFGenerator type, std::optional<SfGenAmount> amt) -> SfInstrumentZone& {
 	if (amt.has_value()) {
-		pimpl->active_gens.set(type);
-		pimpl->generators[type] = amt.value();
+		pimpl->generators.Set(type, EncodeGenAmount(amt.value()));
 	} else {
-		pimpl->active_gens.reset(type);
+		pimpl->generators.Reset(type);
 	}
+	pimpl->Touch();
 	return *this;
 }
 
 auto SfInstrumentZone::GetGenerator(SFGenerator type) const -> SfGenAmount {
-	return pimpl->generators[type];
+	return DecodeGenAmount(type, pimpl->generators.Get(type).value_or(0));
+}
+
+auto SfInstrumentZone::Generators() const noexcept -> std::span<const SfGenEntry> {
+	return pimpl->generators.Entries();
+}
+
+auto SfInstrumentZone::GeneratorMask() const noexcept -> std::uint64_t {
+	return pimpl->generators.Mask();
 }
 
 auto SfInstrumentZone::NewModulator() -> SfModulator& {
-	return pimpl->modulators.NewItem();
+	pimpl->Touch();
+	return pimpl->modulators.New();
 }
 
 auto SF2ML::SfInstrumentZone::NewModulatorWithKey(ModHandle handle) -> SfModulator& {
-	return pimpl->modulators.NewItemWithKey(handle.value);
+	pimpl->Touch();
+	return pimpl->modulators.NewWithKey(handle.value);
 }
 
 void SfInstrumentZone::RemoveModulator(ModHandle handle) {
 	pimpl->modulators.Remove(handle);
+	pimpl->Touch();
 }
 
 auto SfInstrumentZone::GetModulator(ModHandle handle) -> SfModulator& {
@@ -370,6 +382,7 @@ void SfInstrumentZone::ForEachModulators(std::function<void(SfModulator&)> pred)
 	for (auto& mod : pimpl->modulators) {
 		pred(mod);
 	}
+	pimpl->Touch();
 }
 
 void SfInstrumentZone::ForEachModulators(std::function<void(const SfModulator&)> pred) const {
@@ -378,20 +391,45 @@ void SfInstrumentZone::ForEachModulators(std::function<void(const SfModulator&)>
 	}
 }
 
+auto SfInstrumentZone::Modulators() const noexcept -> std::span<const SfModulator> {
+	return pimpl->modulators.Items();
+}
+
+auto SfInstrumentZone::MutableModulators() noexcept -> std::span<SfModulator> {
+	return pimpl->modulators.Items();
+}
+
+void SfInstrumentZone::NotifyEdited() {
+	pimpl->Touch();
+}
+
 auto SfInstrumentZone::GetModIndex(ModHandle handle) const -> std::optional<std::uint16_t> {
 	return pimpl->modulators.GetID(handle);
 }
 
 SfInstrumentZone& SfInstrumentZone::CopyProperties(const SfInstrumentZone& zone) {
-	pimpl->active_gens = zone.pimpl->active_gens;
 	pimpl->generators  = zone.pimpl->generators;
 	pimpl->modulators  = zone.pimpl->modulators;
+	pimpl->Touch();
 	return *this;
 }
 
 SfInstrumentZone& SfInstrumentZone::MoveProperties(SfInstrumentZone&& zone) {
-	pimpl->active_gens = std::move(zone.pimpl->active_gens);
 	pimpl->generators  = std::move(zone.pimpl->generators);
 	pimpl->modulators  = std::move(zone.pimpl->modulators);
+	pimpl->Touch();
+	zone.pimpl->Touch();
 	return *this;
 }
+
+void SfInstrumentZone::Attach(SfObserver* observer, InstHandle owner) {
+	pimpl->observer = observer;
+	pimpl->owner = owner;
+}
+
+void SfInstrumentZone::Detach() {
+	if (pimpl->observer) {
+		pimpl->observer->OnZoneSampleChanged(pimpl->owner, pimpl->self_handle, std::nullopt);
+	}
+	pimpl->observer = nullptr;
+}
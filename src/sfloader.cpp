@@ -1,7 +1,9 @@
 #include "sfloader.hpp"
+#include "sftracing.hpp"
 #include <sfgenerator.hpp>
 #include <tuple>
 #include <map>
+#include <memory_resource>
 #include <stack>
 #include <bit>
 #include <set>
@@ -17,70 +19,15 @@ namespace {
 
 	using ModID = std::tuple<SF2ML::SFModulator, SF2ML::SFGenerator, SF2ML::SFModulator>;
 
-	SF2ML::SfGenAmount InterpretGenerator(SF2ML::spec::SfGenList gen_entry) {
-		using namespace SF2ML;
-		switch (gen_entry.sf_gen_oper) {
-			case SfGenKeyRange:
-			case SfGenVelRange: {
-				Ranges<BYTE> res = {
-					gen_entry.gen_amount.ranges.by_lo,
-					gen_entry.gen_amount.ranges.by_hi
-				};
-				return SfGenAmount{res};
-			}
-			case SfGenSampleID: {
-				SmplHandle res(gen_entry.gen_amount.w_amount);
-				return SfGenAmount{res};
-			}
-			case SfGenInstrument: {
-				InstHandle res(gen_entry.gen_amount.w_amount);
-				return SfGenAmount{res};
-			}
-			case SfGenSampleModes: {
-				WORD w_amount = gen_entry.gen_amount.w_amount;
-				return SfGenAmount{w_amount};
-			}
-			default: {
-				SHORT sh_amount = gen_entry.gen_amount.sh_amount;
-				return SfGenAmount{sh_amount};
-			}
-		}
-	}
-
-	SF2ML::SfGenAmount InterpretGenerator(SF2ML::spec::SfInstGenList gen_entry) {
-		using namespace SF2ML;
-		switch (gen_entry.sf_gen_oper) {
-			case SfGenKeyRange:
-			case SfGenVelRange: {
-				Ranges<BYTE> res = {
-					gen_entry.gen_amount.ranges.by_lo,
-					gen_entry.gen_amount.ranges.by_hi
-				};
-				return SfGenAmount{res};
-			}
-			case SfGenSampleID: {
-				SmplHandle res(gen_entry.gen_amount.w_amount);
-				return SfGenAmount{res};
-			}
-			case SfGenInstrument: {
-				InstHandle res(gen_entry.gen_amount.w_amount);
-				return SfGenAmount{res};
-			}
-			case SfGenSampleModes: {
-				WORD w_amount = gen_entry.gen_amount.w_amount;
-				return SfGenAmount{w_amount};
-			}
-			default: {
-				SHORT sh_amount = gen_entry.gen_amount.sh_amount;
-				return SfGenAmount{sh_amount};
+	// checks the modulator links of a single zone (dangling/circular links are rejected)
+	class ModLinkValidator {
+	public:
+		ModLinkValidator(const std::pmr::map<ModID, SF2ML::WORD>& actives, std::pmr::memory_resource* resource)
+			: state(resource), valid(resource), in_range(resource) {
+			for (const auto& [mod_op, mod_ndx] : actives) {
+				in_range.insert(mod_ndx);
 			}
 		}
-	}
-
-	namespace recursive {
-		std::map<SF2ML::WORD, char> state;
-		std::map<SF2ML::WORD, bool> valid;
-		std::set<SF2ML::WORD> in_range;
 
 		bool DFSModulators(SF2ML::WORD cur_mod_idx, const SF2ML::BYTE* buf) {
 			using namespace SF2ML;
@@ -133,43 +80,77 @@ namespace {
 			}
 		}
 
-		void InitDFS(const std::map<ModID, SF2ML::WORD>& actives) {
-			state.clear();
-			valid.clear();
-			in_range.clear();
-			for (const auto& [mod_op, mod_ndx] : actives) {
-				in_range.insert(mod_ndx);
-			}
-		}
+	private:
+		std::pmr::map<SF2ML::WORD, char> state;
+		std::pmr::map<SF2ML::WORD, bool> valid;
+		std::pmr::set<SF2ML::WORD> in_range;
+	};
+
+	// LoadModulators, timed, with the modulators dropped by the link validation counted
+	template <bool Collect, typename ZoneT>
+	SF2ML::SF2MLError LoadZoneModulators(ZoneT& zone,
+										 const SF2ML::BYTE* buf,
+										 SF2ML::DWORD count,
+										 std::pmr::memory_resource* resource,
+										 SF2ML::SfLoadStats* stats) {
+		using namespace SF2ML;
+		stats::Stopwatch<Collect, SfLoadStats> watch(stats);
+		SF2MLError err = loader::LoadModulators(zone, buf, count, resource);
+		watch.Lap(&SfLoadStats::modulators_ns);
+		stats::Count<Collect>(stats, &SfLoadStats::modulators_rejected, count - zone.ModulatorCount());
+		return err;
+	}
+
+	template <bool Collect, typename ZoneT>
+	void CountZone(const ZoneT& zone, SF2ML::SfLoadStats* stats) {
+		using namespace SF2ML;
+		stats::Count<Collect>(stats, &SfLoadStats::zones);
+		stats::Count<Collect>(stats, &SfLoadStats::generators, zone.GeneratorCount());
+		stats::Count<Collect>(stats, &SfLoadStats::modulators, zone.ModulatorCount());
 	}
 	
 }
 
+template <bool Collect>
 auto SF2ML::loader::LoadSfbk(SfInfo& infos,
 							 PresetContainer& presets,
 							 InstContainer& insts,
 							 SmplContainer& smpls,
-							 const SfbkMap& sfbk)
+							 const SfbkMap& sfbk,
+							 std::pmr::memory_resource* scratch,
+							 SfLoadStats* stats)
 							 -> SF2ML::SF2MLError {
-	
+	trace::Scope trace("LoadSfbk");
+	stats::Stopwatch<Collect, SfLoadStats> watch(stats);
+
 	if (auto err = LoadInfos(infos, sfbk)) {
 		return err;
 	}
-	if (auto err = LoadSamples(smpls, sfbk)) {
+	watch.Lap(&SfLoadStats::info_ns);
+	if (auto err = LoadSamples<Collect>(smpls, sfbk, stats)) {
 		return err;
 	}
-	if (auto err = LoadPresets(presets, sfbk)) {
+	watch.Lap(&SfLoadStats::samples_ns);
+	if (auto err = LoadPresets<Collect>(presets, sfbk, scratch, stats)) {
 		return err;
 	}
-	if (auto err = LoadInstruments(insts, sfbk)) {
+	watch.Lap(&SfLoadStats::presets_ns);
+	if (auto err = LoadInstruments<Collect>(insts, sfbk, scratch, stats)) {
 		return err;
 	}
+	watch.Lap(&SfLoadStats::instruments_ns);
 	
 	return SF2ML_SUCCESS;
 }
 
+template SF2ML::SF2MLError SF2ML::loader::LoadSfbk<false>(SfInfo&, PresetContainer&, InstContainer&, SmplContainer&,
+														 const SfbkMap&, std::pmr::memory_resource*, SfLoadStats*);
+template SF2ML::SF2MLError SF2ML::loader::LoadSfbk<true>(SfInfo&, PresetContainer&, InstContainer&, SmplContainer&,
+														const SfbkMap&, std::pmr::memory_resource*, SfLoadStats*);
+
 auto SF2ML::loader::LoadInfos(SfInfo& infos, const SfbkMap& sfbk) -> SF2ML::SF2MLError
 {
+	trace::Scope trace("LoadInfos");
 	const auto& info = sfbk.info;
 
 	ChunkHead ck_head;
@@ -241,7 +222,12 @@ auto SF2ML::loader::LoadInfos(SfInfo& infos, const SfbkMap& sfbk) -> SF2ML::SF2M
 	return SF2ML_SUCCESS;
 }
 
-auto SF2ML::loader::LoadPresets(PresetContainer& presets, const SfbkMap& sfbk) -> SF2ML::SF2MLError {
+template <bool Collect>
+auto SF2ML::loader::LoadPresets(PresetContainer& presets,
+								const SfbkMap& sfbk,
+								std::pmr::memory_resource* scratch,
+								SfLoadStats* stats) -> SF2ML::SF2MLError {
+	trace::Scope trace("LoadPresets");
 	const auto& pdta = sfbk.pdta;
 
 	DWORD phdr_ck_size;
@@ -255,6 +241,7 @@ auto SF2ML::loader::LoadPresets(PresetContainer& presets, const SfbkMap& sfbk) -
 		std::memcpy(&next, cur_ptr + sizeof(spec::SfPresetHeader), sizeof(next));
 
 		SfPreset& rec = presets.NewItem();
+		stats::Count<Collect>(stats, &SfLoadStats::presets);
 		rec.SetName(std::string(reinterpret_cast<const char*>(cur.ach_preset_name), 20));
 		rec.SetPresetNumber(cur.w_preset);
 		rec.SetBankNumber(cur.w_bank);
@@ -275,8 +262,8 @@ auto SF2ML::loader::LoadPresets(PresetContainer& presets, const SfbkMap& sfbk) -
 
 			const BYTE* gen_ptr = pdta.pgen + 8 + gen_start * sizeof(spec::SfGenList);
 			const BYTE* mod_ptr = pdta.pmod + 8 + mod_start * sizeof(spec::SfModList);
-			SfPresetZone zone(PZoneHandle(0));
-			if (auto err = LoadModulators(zone, mod_ptr, mod_end - mod_start)) {
+			SfPresetZone zone(PZoneHandle(0), presets.GetResource());
+			if (auto err = LoadZoneModulators<Collect>(zone, mod_ptr, mod_end - mod_start, scratch, stats)) {
 				return err;
 			}
 			if (auto err = LoadGenerators(zone, gen_ptr, gen_end - gen_start)) {
@@ -284,6 +271,7 @@ auto SF2ML::loader::LoadPresets(PresetContainer& presets, const SfbkMap& sfbk) -
 			}
 
 			if (!zone.IsEmpty()) {
+				CountZone<Collect>(zone, stats);
 				if (bag_ndx == bag_start && !zone.HasGenerator(SfGenInstrument)) {
 					rec.GetGlobalZone().MoveProperties(std::move(zone));
 				} else if (zone.HasGenerator(SfGenInstrument)) {
@@ -296,7 +284,12 @@ auto SF2ML::loader::LoadPresets(PresetContainer& presets, const SfbkMap& sfbk) -
 	return SF2ML_SUCCESS;
 }
 
-auto SF2ML::loader::LoadInstruments(InstContainer& insts, const SfbkMap& sfbk) -> SF2ML::SF2MLError {
+template <bool Collect>
+auto SF2ML::loader::LoadInstruments(InstContainer& insts,
+									const SfbkMap& sfbk,
+									std::pmr::memory_resource* scratch,
+									SfLoadStats* stats) -> SF2ML::SF2MLError {
+	trace::Scope trace("LoadInstruments");
 	const auto& pdta = sfbk.pdta;
 
 	DWORD inst_ck_size;
@@ -304,12 +297,14 @@ auto SF2ML::loader::LoadInstruments(InstContainer& insts, const SfbkMap& sfbk) -
 
 	size_t inst_count = inst_ck_size / sizeof(spec::SfInst) - 1;
 	for (DWORD id = 0; id < inst_count; id++) {
+		trace::Scope trace_inst("LoadInstrument", "index", id);
 		const BYTE* cur_ptr = pdta.inst + 8 + id * sizeof(spec::SfInst);
 		spec::SfInst cur, next;
 		std::memcpy(&cur, cur_ptr, sizeof(spec::SfInst));
 		std::memcpy(&next, cur_ptr + sizeof(spec::SfInst), sizeof(spec::SfInst));
 
 		SfInstrument& rec = insts.NewItem();
+		stats::Count<Collect>(stats, &SfLoadStats::instruments);
 		rec.SetName(std::string(reinterpret_cast<const char*>(cur.ach_inst_name), 20));
 
 		const size_t bag_start = cur.w_inst_bag_ndx;
@@ -328,8 +323,8 @@ auto SF2ML::loader::LoadInstruments(InstContainer& insts, const SfbkMap& sfbk) -
 
 			const BYTE* mod_ptr = pdta.imod + 8 + mod_start * sizeof(spec::SfInstModList);
 			const BYTE* gen_ptr = pdta.igen + 8 + gen_start * sizeof(spec::SfInstGenList);
-			SfInstrumentZone zone(IZoneHandle(0));
-			if (auto err = LoadModulators(zone, mod_ptr, mod_end - mod_start)) {
+			SfInstrumentZone zone(IZoneHandle(0), insts.GetResource());
+			if (auto err = LoadZoneModulators<Collect>(zone, mod_ptr, mod_end - mod_start, scratch, stats)) {
 				return err;
 			}
 			if (auto err = LoadGenerators(zone, gen_ptr, gen_end - gen_start)) {
@@ -337,6 +332,7 @@ auto SF2ML::loader::LoadInstruments(InstContainer& insts, const SfbkMap& sfbk) -
 			}
 			
 			if (!zone.IsEmpty()) {
+				CountZone<Collect>(zone, stats);
 				if (bag_ndx == bag_start && !zone.HasGenerator(SfGenSampleID)) {
 					rec.GetGlobalZone().MoveProperties(std::move(zone));
 				} else if (zone.HasGenerator(SfGenSampleID)) {
@@ -348,7 +344,9 @@ auto SF2ML::loader::LoadInstruments(InstContainer& insts, const SfbkMap& sfbk) -
 	return SF2ML_SUCCESS;
 }
 
-auto SF2ML::loader::LoadSamples(SmplContainer& smpls, const SfbkMap& sfbk) -> SF2ML::SF2MLError {
+template <bool Collect>
+auto SF2ML::loader::LoadSamples(SmplContainer& smpls, const SfbkMap& sfbk, SfLoadStats* stats) -> SF2ML::SF2MLError {
+	trace::Scope trace("LoadSamples");
 	SampleBitDepth bit_depth = SampleBitDepth::Signed16;
 	const auto& sdta = sfbk.sdta;
 	const auto& pdta = sfbk.pdta;
@@ -387,6 +385,7 @@ auto SF2ML::loader::LoadSamples(SmplContainer& smpls, const SfbkMap& sfbk) -> SF
 		std::memcpy(&cur_shdr, shdr_data + id * sizeof(spec::SfSample), sizeof(spec::SfSample));
 
 		SfSample& rec = smpls.NewItem(bit_depth);
+		stats::Count<Collect>(stats, &SfLoadStats::samples);
 		rec.SetName(std::string(reinterpret_cast<const char*>(cur_shdr.ach_sample_name), 20));
 		rec.SetSampleRate(cur_shdr.dw_sample_rate);
 		rec.SetLoop(
@@ -402,21 +401,24 @@ auto SF2ML::loader::LoadSamples(SmplContainer& smpls, const SfbkMap& sfbk) -> SF
 		}
 
 		if (IsRamSample(cur_shdr.sf_sample_type)) {
-			if (smpl_data && cur_shdr.dw_start < cur_shdr.dw_end && cur_shdr.dw_end <= smpl_size / 2) {
-				std::vector<BYTE> wav_data;
+			if (smpl_data && cur_shdr.dw_start < cur_shdr.dw_end && cur_shdr.dw_end <= smpl_size / 2
+				&& (bit_depth == SampleBitDepth::Signed16 || cur_shdr.dw_end <= sm24_size)) {
+				std::pmr::vector<BYTE> wav_data(smpls.GetResource());
 
 				if (bit_depth == SampleBitDepth::Signed16) {
 					wav_data.resize((cur_shdr.dw_end - cur_shdr.dw_start) * 2);
 					std::memcpy(wav_data.data(), &smpl_data[cur_shdr.dw_start * 2], wav_data.size());
 				} else { // SampleBitDepth::Signed24
+					trace::Scope trace_merge("MergeSm24", "sample", id);
 					wav_data.resize((cur_shdr.dw_end - cur_shdr.dw_start) * 3);
-					for (size_t i = cur_shdr.dw_start; i < cur_shdr.dw_end; i++) {
-						wav_data[3 * i + 0] = sm24_data[i];
-						wav_data[3 * i + 1] = smpl_data[2 * i + 0];
-						wav_data[3 * i + 2] = smpl_data[2 * i + 1];
+					for (size_t i = cur_shdr.dw_start, j = 0; i < cur_shdr.dw_end; i++, j++) {
+						wav_data[3 * j + 0] = sm24_data[i];
+						wav_data[3 * j + 1] = smpl_data[2 * i + 0];
+						wav_data[3 * j + 2] = smpl_data[2 * i + 1];
 					}
 				}
 
+				stats::Count<Collect>(stats, &SfLoadStats::bytes_copied, wav_data.size());
 				rec.SetWav(std::move(wav_data));
 			}
 		}
@@ -430,7 +432,11 @@ auto SF2ML::loader::LoadGenerators(SfPresetZone& dst, const BYTE* buf, DWORD cou
 		spec::SfGenList gen;
 		std::memcpy(&gen, gen_ptr, sizeof(spec::SfGenList));
 
-		dst.SetGenerator(gen.sf_gen_oper, InterpretGenerator(gen));
+		// unknown generators are ignored
+		if (gen.sf_gen_oper >= SfGenEndOper) {
+			continue;
+		}
+		dst.SetGenerator(gen.sf_gen_oper, DecodeGenAmount(gen.sf_gen_oper, gen.gen_amount.w_amount));
 	}
 	return SF2ML_SUCCESS;
 }
@@ -441,13 +447,20 @@ auto SF2ML::loader::LoadGenerators(SfInstrumentZone& dst, const BYTE* buf, DWORD
 		spec::SfInstGenList gen;
 		std::memcpy(&gen, gen_ptr, sizeof(spec::SfInstGenList));
 
-		dst.SetGenerator(gen.sf_gen_oper, InterpretGenerator(gen));
+		// unknown generators are ignored
+		if (gen.sf_gen_oper >= SfGenEndOper) {
+			continue;
+		}
+		dst.SetGenerator(gen.sf_gen_oper, DecodeGenAmount(gen.sf_gen_oper, gen.gen_amount.w_amount));
 	}
 	return SF2ML_SUCCESS;
 }
 
-auto SF2ML::loader::LoadModulators(SfPresetZone& dst, const BYTE* buf, DWORD count) -> SF2ML::SF2MLError {
-	std::map<ModID, WORD> active_mod_idx;
+auto SF2ML::loader::LoadModulators(SfPresetZone& dst,
+									 const BYTE* buf,
+									 DWORD count,
+									 std::pmr::memory_resource* resource) -> SF2ML::SF2MLError {
+	std::pmr::map<ModID, WORD> active_mod_idx(resource);
 
 	for (size_t mod_ndx = 0; mod_ndx < count; mod_ndx++) {
 		auto mod = BitArrCast<spec::SfModList>(buf, mod_ndx);
@@ -464,9 +477,9 @@ auto SF2ML::loader::LoadModulators(SfPresetZone& dst, const BYTE* buf, DWORD cou
 		);
 	}
 
-	recursive::InitDFS(active_mod_idx);
+	ModLinkValidator validator(active_mod_idx, resource);
 	for (size_t mod_ndx = 0; mod_ndx < count; mod_ndx++) {
-		if (recursive::DFSModulators(mod_ndx, buf)) {
+		if (validator.DFSModulators(mod_ndx, buf)) {
 			auto mod = BitArrCast<spec::SfModList>(buf, mod_ndx);
 			
 			SfModulator& r = dst.NewModulatorWithKey(ModHandle(mod_ndx));
@@ -486,8 +499,11 @@ auto SF2ML::loader::LoadModulators(SfPresetZone& dst, const BYTE* buf, DWORD cou
 	return SF2ML_SUCCESS;
 }
 
-auto SF2ML::loader::LoadModulators(SfInstrumentZone& dst, const BYTE* buf, DWORD count) -> SF2ML::SF2MLError {
-	std::map<ModID, WORD> active_mod_idx;
+auto SF2ML::loader::LoadModulators(SfInstrumentZone& dst,
+									 const BYTE* buf,
+									 DWORD count,
+									 std::pmr::memory_resource* resource) -> SF2ML::SF2MLError {
+	std::pmr::map<ModID, WORD> active_mod_idx(resource);
 
 	for (size_t mod_ndx = 0; mod_ndx < count; mod_ndx++) {
 		auto mod = BitArrCast<spec::SfInstModList>(buf, mod_ndx);
@@ -504,9 +520,9 @@ auto SF2ML::loader::LoadModulators(SfInstrumentZone& dst, const BYTE* buf, DWORD
 		);
 	}
 
-	recursive::InitDFS(active_mod_idx);
+	ModLinkValidator validator(active_mod_idx, resource);
 	for (size_t mod_ndx = 0; mod_ndx < count; mod_ndx++) {
-		if (recursive::DFSModulators(mod_ndx, buf)) {
+		if (validator.DFSModulators(mod_ndx, buf)) {
 			auto mod = BitArrCast<spec::SfInstModList>(buf, mod_ndx);
 			
 			SfModulator& r = dst.NewModulatorWithKey(ModHandle(mod_ndx));
@@ -8,21 +8,34 @@
 #include <sfinfo.hpp>
 #include "sfcontainers.hpp"
 #include "sfmap.hpp"
+#include "sfstats.hpp"
+
+#include <memory_resource>
 
 namespace SF2ML::loader {
+	/// Builds the objects of a mapped file.
+	/// The objects allocate from their containers; the working buffers of the load(modulator link validation)
+	/// come from scratch.
+	/// With Collect, each phase is timed and counted into *stats; without it, stats is not used (see sfstats.hpp).
+	template <bool Collect>
 	SF2MLError LoadSfbk(SfInfo& infos,
 						PresetContainer& presets,
 						InstContainer& insts,
 						SmplContainer& smpls,
-						const SfbkMap& sfbk);
+						const SfbkMap& sfbk,
+						std::pmr::memory_resource* scratch,
+						SfLoadStats* stats);
 	SF2MLError LoadInfos(SfInfo& infos, const SfbkMap& sfbk);
-	SF2MLError LoadPresets(PresetContainer& presets, const SfbkMap& sfbk);
-	SF2MLError LoadInstruments(InstContainer& insts, const SfbkMap& sfbk);
-	SF2MLError LoadSamples(SmplContainer& smpls, const SfbkMap& sfbk);
+	template <bool Collect>
+	SF2MLError LoadPresets(PresetContainer& presets, const SfbkMap& sfbk, std::pmr::memory_resource* scratch, SfLoadStats* stats);
+	template <bool Collect>
+	SF2MLError LoadInstruments(InstContainer& insts, const SfbkMap& sfbk, std::pmr::memory_resource* scratch, SfLoadStats* stats);
+	template <bool Collect>
+	SF2MLError LoadSamples(SmplContainer& smpls, const SfbkMap& sfbk, SfLoadStats* stats);
 	SF2MLError LoadGenerators(SfPresetZone& dst, const BYTE* buf, DWORD count);
 	SF2MLError LoadGenerators(SfInstrumentZone& dst, const BYTE* buf, DWORD count);
-	SF2MLError LoadModulators(SfPresetZone& dst, const BYTE* buf, DWORD count);
-	SF2MLError LoadModulators(SfInstrumentZone& dst, const BYTE* buf, DWORD count);
+	SF2MLError LoadModulators(SfPresetZone& dst, const BYTE* buf, DWORD count, std::pmr::memory_resource* resource);
+	SF2MLError LoadModulators(SfInstrumentZone& dst, const BYTE* buf, DWORD count, std::pmr::memory_resource* resource);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef SF2ML_SFLOOKUPINDEX_HPP_
+#define SF2ML_SFLOOKUPINDEX_HPP_
+
+#include <sftypes.hpp>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory_resource>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+namespace SF2ML {
+	/// object name as it is stored in the file: at most 20 characters, zero padded
+	using SfNameKey = std::array<char, 20>;
+
+	/// makes the key of a name (truncated the same way SetName truncates it)
+	inline SfNameKey MakeNameKey(std::string_view name) noexcept {
+		SfNameKey key {};
+		name = name.substr(0, std::min(name.find('\0'), key.size()));
+		std::copy(name.begin(), name.end(), key.begin());
+		return key;
+	}
+
+	struct SfNameKeyHash {
+		std::size_t operator()(const SfNameKey& key) const noexcept {
+			return std::hash<std::string_view>{}(std::string_view(key.data(), key.size()));
+		}
+	};
+
+	/// Secondary index (key -> handles) maintained incrementally by the owner of the objects.
+	/// Several objects may share a key; Find returns the smallest handle, which is the object
+	/// that was created (or loaded) first.
+	template <typename HandleT, typename KeyT, typename Hash = std::hash<KeyT>>
+	class SfLookupIndex {
+	public:
+		explicit SfLookupIndex(std::pmr::memory_resource* resource)
+			: by_key(resource), keys(resource) {}
+
+		void Clear() noexcept {
+			by_key.clear();
+			keys.clear();
+		}
+
+		// inserts the object, or moves it to the new key
+		void Update(HandleT handle, const KeyT& key) {
+			auto [it, inserted] = keys.try_emplace(handle.value, key);
+			if (!inserted) {
+				if (it->second == key) {
+					return;
+				}
+				EraseEntry(handle, it->second);
+				it->second = key;
+			}
+			by_key.emplace(key, handle);
+		}
+
+		void Erase(HandleT handle) noexcept {
+			if (auto it = keys.find(handle.value); it != keys.end()) {
+				EraseEntry(handle, it->second);
+				keys.erase(it);
+			}
+		}
+
+		std::optional<HandleT> Find(const KeyT& key) const noexcept {
+			auto [first, last] = by_key.equal_range(key);
+			std::optional<HandleT> res;
+			for (auto it = first; it != last; ++it) {
+				if (!res || it->second < *res) {
+					res = it->second;
+				}
+			}
+			return res;
+		}
+
+	private:
+		void EraseEntry(HandleT handle, const KeyT& key) noexcept {
+			auto [first, last] = by_key.equal_range(key);
+			for (auto it = first; it != last; ++it) {
+				if (it->second == handle) {
+					by_key.erase(it);
+					return;
+				}
+			}
+		}
+
+		std::pmr::unordered_multimap<KeyT, HandleT, Hash> by_key;
+		// handle value -> current key
+		std::pmr::unordered_map<decltype(HandleT::value), KeyT> keys;
+	};
+}
+
+#endif
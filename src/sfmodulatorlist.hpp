@@ -0,0 +1,111 @@
+#ifndef SF2ML_SFMODULATORLIST_HPP_
+#define SF2ML_SFMODULATORLIST_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "sfmodulator.hpp"
+
+namespace SF2ML {
+
+	/// Compact modulator storage of a single zone.
+	/// The modulators are kept in insertion order in one vector, and each record carries its own handle:
+	/// a zone holds a handful of modulators, so handles are looked up linearly, and copying the list
+	/// copies one flat array.
+	class SfModulatorList {
+	public:
+		explicit SfModulatorList(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: mods(resource) {}
+
+		/// @throw std::length_error when no more modulators can be created
+		SfModulator& New() {
+			CheckLength();
+			while (Find(ModHandle(next_key)) != mods.end()) {
+				++next_key;
+			}
+			return mods.emplace_back(ModHandle(next_key++));
+		}
+
+		/// @throw std::runtime_error when the key is already used
+		SfModulator& NewWithKey(std::uint32_t key) {
+			CheckLength();
+			if (Find(ModHandle(key)) != mods.end()) {
+				throw std::runtime_error("Tried to add item with existing key.");
+			}
+			next_key = key + 1;
+			return mods.emplace_back(ModHandle(key));
+		}
+
+		/// @return false when there is no such modulator
+		bool Remove(ModHandle handle) noexcept {
+			if (auto it = Find(handle); it != mods.end()) {
+				mods.erase(it);
+				return true;
+			}
+			return false;
+		}
+
+		/// @return nullptr when there is no such modulator (invalidated when New/Remove is called)
+		SfModulator* Get(ModHandle handle) noexcept {
+			auto it = Find(handle);
+			return it != mods.end() ? &*it : nullptr;
+		}
+
+		const SfModulator* Get(ModHandle handle) const noexcept {
+			auto it = Find(handle);
+			return it != mods.end() ? &*it : nullptr;
+		}
+
+		// index of the modulator in the zone(its order in the pmod/imod chunk)
+		std::optional<DWORD> GetID(ModHandle handle) const noexcept {
+			if (auto it = Find(handle); it != mods.end()) {
+				return static_cast<DWORD>(it - mods.begin());
+			}
+			return std::nullopt;
+		}
+
+		auto Items() const noexcept -> std::span<const SfModulator> {
+			return mods;
+		}
+
+		// the modulators must not be reassigned through it(their handles are their keys)
+		auto Items() noexcept -> std::span<SfModulator> {
+			return mods;
+		}
+
+		DWORD Count() const noexcept {
+			return static_cast<DWORD>(mods.size());
+		}
+
+		auto begin() noexcept { return mods.begin(); }
+		auto end() noexcept { return mods.end(); }
+		auto begin() const noexcept { return mods.begin(); }
+		auto end() const noexcept { return mods.end(); }
+	private:
+		void CheckLength() const {
+			if (mods.size() >= std::numeric_limits<decltype(ModHandle::value)>::max()) {
+				throw std::length_error("Cannot create more items!");
+			}
+		}
+
+		auto Find(ModHandle handle) noexcept -> std::pmr::vector<SfModulator>::iterator {
+			return std::find_if(mods.begin(), mods.end(),
+								[handle](const SfModulator& mod) { return mod.GetHandle() == handle; });
+		}
+
+		auto Find(ModHandle handle) const noexcept -> std::pmr::vector<SfModulator>::const_iterator {
+			return std::find_if(mods.begin(), mods.end(),
+								[handle](const SfModulator& mod) { return mod.GetHandle() == handle; });
+		}
+
+		std::uint32_t next_key = 0;
+		std::pmr::vector<SfModulator> mods;
+	};
+}
+
+#endif
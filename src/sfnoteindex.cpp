@@ -0,0 +1,269 @@
+#include "sfnoteindex.hpp"
+
+#include <algorithm>
+
+using namespace SF2ML;
+using namespace SF2ML::noteindex;
+
+namespace {
+	// 1 for the generators whose preset value is added to the instrument value, else 0
+	constexpr auto additive = [] {
+		std::array<std::int32_t, SfGenEndOper> column {};
+		for (std::size_t g = 0; g < SfGenEndOper; g++) {
+			column[g] = GetGenTraits(static_cast<SFGenerator>(g)).additive;
+		}
+		return column;
+	}();
+}
+
+void SF2ML::noteindex::ResolveVoice(GenRow& out,
+									std::span<const SfGenEntry> pglobal, std::span<const SfGenEntry> plocal,
+									std::span<const SfGenEntry> iglobal, std::span<const SfGenEntry> ilocal) noexcept {
+	std::array<std::int32_t, SfGenEndOper> inst;
+	std::array<std::int32_t, SfGenEndOper> offset {};
+	for (std::size_t g = 0; g < SfGenEndOper; g++) {
+		inst[g] = GetGenTraits(static_cast<SFGenerator>(g)).default_value;
+	}
+	for (const SfGenEntry& e : iglobal) { inst[e.type] = static_cast<SHORT>(e.raw); }
+	for (const SfGenEntry& e : ilocal)  { inst[e.type] = static_cast<SHORT>(e.raw); }
+	for (const SfGenEntry& e : pglobal) { offset[e.type] = static_cast<SHORT>(e.raw); }
+	for (const SfGenEntry& e : plocal)  { offset[e.type] = static_cast<SHORT>(e.raw); }
+
+	// additive generators take the preset offset, then every value is clamped into its legal range
+	for (std::size_t g = 0; g < SfGenEndOper; g++) {
+		const std::int32_t value = inst[g] + additive[g] * offset[g];
+		out[g] = static_cast<SHORT>(std::clamp<std::int32_t>(value, detail::gen_min_values[g], detail::gen_max_values[g]));
+	}
+}
+
+SfNoteIndex::SfNoteIndex(std::pmr::memory_resource* resource)
+	: resource{resource}, compiled(resource), dirty(resource), programs(resource), inst_users(resource) {}
+
+void SfNoteIndex::MarkAll() noexcept {
+	all_dirty = true;
+}
+
+void SfNoteIndex::MarkPreset(PresetHandle preset) {
+	if (all_dirty) {
+		return;
+	}
+	auto [it, inserted] = compiled.try_emplace(preset.value, resource);
+	if (inserted || !it->second.dirty) {
+		it->second.dirty = true;
+		dirty.push_back(preset);
+	}
+}
+
+void SfNoteIndex::MarkRenumbered(PresetHandle preset) {
+	programs_dirty = true;
+	MarkPreset(preset);
+}
+
+void SfNoteIndex::MarkInstrument(InstHandle inst) {
+	if (all_dirty) {
+		return;
+	}
+	auto first = inst_users.lower_bound({ inst.value, 0 });
+	auto last = inst_users.upper_bound({ inst.value, std::numeric_limits<DWORD>::max() });
+	for (auto it = first; it != last; ++it) {
+		MarkPreset(PresetHandle(it->second));
+	}
+}
+
+void SfNoteIndex::Refresh(const PresetContainer& presets, const InstContainer& insts) {
+	if (all_dirty) {
+		compiled.clear();
+		inst_users.clear();
+		dirty.clear();
+		for (const SfPreset& preset : presets) {
+			auto [it, inserted] = compiled.try_emplace(preset.GetHandle().value, resource);
+			Compile(it->second, preset, insts);
+		}
+		all_dirty = false;
+		programs_dirty = true;
+	} else {
+		for (PresetHandle handle : dirty) {
+			auto it = compiled.find(handle.value);
+			if (it == compiled.end() || !it->second.dirty) {
+				continue;
+			}
+			for (InstHandle inst : it->second.instruments) {
+				inst_users.erase({ inst.value, handle.value });
+			}
+			if (const SfPreset* preset = presets.Get(handle)) {
+				Compile(it->second, *preset, insts);
+			} else { // removed
+				compiled.erase(it);
+				programs_dirty = true;
+			}
+		}
+		dirty.clear();
+	}
+
+	if (programs_dirty) {
+		programs.clear();
+		for (const SfPreset& preset : presets) {
+			// when (bank, program) is duplicated, the first preset wins
+			programs.try_emplace(
+				ProgramKey(preset.GetBankNumber(), preset.GetPresetNumber()),
+				&compiled.at(preset.GetHandle().value)
+			);
+		}
+		programs_dirty = false;
+	}
+}
+
+void SfNoteIndex::Compile(CompiledPreset& dst, const SfPreset& preset, const InstContainer& insts) {
+	dst.layers.clear();
+	dst.key_items.clear();
+	dst.instruments.clear();
+	dst.key_offsets.fill(0);
+	dst.raw.clear();
+	dst.physical.clear();
+	dst.dirty = false;
+
+	// voice table rows, transposed into columns once the layer count is known
+	std::pmr::vector<GenRow> rows(resource);
+
+	const PresetHandle preset_handle = preset.GetHandle();
+	KeyVelRanges preset_global { { 0, 127 }, { 0, 127 } };
+	std::span<const SfGenEntry> preset_global_gens;
+	preset.ForEachZone([&](const SfPresetZone& pzone) {
+		if (pzone.GetHandle().value == 0) { // global zone always comes first
+			preset_global = GetGlobalRanges(pzone);
+			preset_global_gens = pzone.Generators();
+			return;
+		}
+		auto inst_handle = pzone.GetInstrument();
+		if (!inst_handle) {
+			return;
+		}
+		const SfInstrument* inst = insts.Get(*inst_handle);
+		if (!inst) { // dangling instrument reference
+			return;
+		}
+		if (std::find(dst.instruments.begin(), dst.instruments.end(), *inst_handle) == dst.instruments.end()) {
+			dst.instruments.push_back(*inst_handle);
+		}
+
+		const KeyVelRanges pranges = GetZoneRanges(pzone, preset_global);
+		KeyVelRanges inst_global { { 0, 127 }, { 0, 127 } };
+		std::span<const SfGenEntry> inst_global_gens;
+		inst->ForEachZone([&](const SfInstrumentZone& izone) {
+			if (izone.GetHandle().value == 0) {
+				inst_global = GetGlobalRanges(izone);
+				inst_global_gens = izone.Generators();
+				return;
+			}
+			auto sample = izone.GetSample();
+			if (!sample) {
+				return;
+			}
+			const KeyVelRanges iranges = GetZoneRanges(izone, inst_global);
+			Ranges<BYTE> key = Intersect(pranges.first, iranges.first);
+			Ranges<BYTE> vel = Intersect(pranges.second, iranges.second);
+			if (key.start > key.end || vel.start > vel.end) {
+				return;
+			}
+
+			Layer layer { SfNoteZone{}, vel.start, vel.end, key.start, key.end };
+			layer.zone.preset = preset_handle;
+			layer.zone.preset_zone = pzone.GetHandle();
+			layer.zone.instrument = *inst_handle;
+			layer.zone.instrument_zone = izone.GetHandle();
+			layer.zone.sample = *sample;
+			layer.zone.voice = static_cast<std::uint32_t>(dst.layers.size());
+			dst.layers.push_back(layer);
+
+			GenRow& row = rows.emplace_back();
+			ResolveVoice(row, preset_global_gens, pzone.Generators(), inst_global_gens, izone.Generators());
+			row[SfGenKeyRange] = static_cast<SHORT>(key.start | (key.end << 8));
+			row[SfGenVelRange] = static_cast<SHORT>(vel.start | (vel.end << 8));
+			row[SfGenInstrument] = static_cast<SHORT>(inst_handle->value);
+			row[SfGenSampleID] = static_cast<SHORT>(sample->value);
+		});
+	});
+
+	const std::size_t layer_count = rows.size();
+	dst.raw.resize(layer_count * SfGenEndOper);
+	dst.physical.resize(layer_count * SfGenEndOper);
+	for (std::size_t g = 0; g < SfGenEndOper; g++) {
+		const SFGenerator type = static_cast<SFGenerator>(g);
+		for (std::size_t i = 0; i < layer_count; i++) {
+			dst.raw[g * layer_count + i] = rows[i][g];
+			dst.physical[g * layer_count + i] = GenAmountToPhysical(type, rows[i][g]);
+		}
+	}
+
+	// bucket the layers by key (counting sort)
+	for (const Layer& layer : dst.layers) {
+		for (DWORD k = layer.key_lo; k <= layer.key_hi; k++) {
+			dst.key_offsets[k + 1]++;
+		}
+	}
+	for (DWORD k = 0; k < 128; k++) {
+		dst.key_offsets[k + 1] += dst.key_offsets[k];
+	}
+	dst.key_items.resize(dst.key_offsets[128]);
+	std::array<DWORD, 128> fill_pos;
+	std::copy_n(dst.key_offsets.begin(), 128, fill_pos.begin());
+	for (DWORD i = 0; i < dst.layers.size(); i++) {
+		for (DWORD k = dst.layers[i].key_lo; k <= dst.layers[i].key_hi; k++) {
+			dst.key_items[fill_pos[k]++] = i;
+		}
+	}
+
+	for (InstHandle inst : dst.instruments) {
+		inst_users.insert({ inst.value, preset_handle.value });
+	}
+}
+
+std::size_t SfNoteIndex::Find(WORD bank, WORD program, BYTE key, BYTE velocity, std::span<SfNoteZone> out) const noexcept {
+	if (key > 127) {
+		return 0;
+	}
+	auto it = programs.find(ProgramKey(bank, program));
+	if (it == programs.end()) {
+		return 0;
+	}
+
+	const CompiledPreset& preset = *it->second;
+	std::size_t count = 0;
+	for (DWORD i = preset.key_offsets[key]; i < preset.key_offsets[key + 1]; i++) {
+		const Layer& layer = preset.layers[preset.key_items[i]];
+		if (layer.vel_lo <= velocity && velocity <= layer.vel_hi) {
+			if (count < out.size()) {
+				out[count] = layer.zone;
+			}
+			count++;
+		}
+	}
+	return count;
+}
+bool SfNoteIndex::GetVoice(const SfNoteZone& zone, SfVoiceParams& out) const noexcept {
+	auto it = compiled.find(zone.preset.value);
+	if (it == compiled.end()) {
+		return false;
+	}
+	const CompiledPreset& preset = it->second;
+	auto same_pair = [&zone](const Layer& layer) {
+		return layer.zone.preset_zone == zone.preset_zone && layer.zone.instrument_zone == zone.instrument_zone
+			&& layer.zone.instrument == zone.instrument;
+	};
+
+	std::size_t i = zone.voice;
+	if (i >= preset.layers.size() || !same_pair(preset.layers[i])) { // stale position
+		auto layer = std::find_if(preset.layers.begin(), preset.layers.end(), same_pair);
+		if (layer == preset.layers.end()) {
+			return false;
+		}
+		i = layer - preset.layers.begin();
+	}
+
+	const std::size_t layer_count = preset.layers.size();
+	for (std::size_t g = 0; g < SfGenEndOper; g++) {
+		out.raw[g] = preset.raw[g * layer_count + i];
+		out.physical[g] = preset.physical[g * layer_count + i];
+	}
+	return true;
+}
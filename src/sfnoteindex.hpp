@@ -0,0 +1,123 @@
+#ifndef SF2ML_SFNOTEINDEX_HPP_
+#define SF2ML_SFNOTEINDEX_HPP_
+
+#include <sf2ml.hpp>
+#include "sfcontainers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory_resource>
+#include <set>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace SF2ML::noteindex {
+	using KeyVelRanges = std::pair<Ranges<BYTE>, Ranges<BYTE>>;
+	using GenRow = std::array<SHORT, SfGenEndOper>;
+
+	// ranges of a local zone (falls back to the ranges of the global zone when not set)
+	template <typename ZoneType>
+	KeyVelRanges GetZoneRanges(const ZoneType& zone, const KeyVelRanges& global) {
+		return {
+			zone.HasGenerator(SfGenKeyRange) ? zone.GetKeyRange() : global.first,
+			zone.HasGenerator(SfGenVelRange) ? zone.GetVelRange() : global.second,
+		};
+	}
+
+	template <typename ZoneType>
+	KeyVelRanges GetGlobalRanges(const ZoneType& zone) {
+		return { zone.GetKeyRange(), zone.GetVelRange() };
+	}
+
+	inline Ranges<BYTE> Intersect(Ranges<BYTE> x, Ranges<BYTE> y) {
+		return { std::max(x.start, y.start), std::min<BYTE>(std::min(x.end, y.end), 127) };
+	}
+
+	// resolves the generator values of a preset zone x instrument zone pair (sfspec24 9.4):
+	// local zones override global zones, and preset values are added to the instrument values
+	void ResolveVoice(GenRow& out,
+					  std::span<const SfGenEntry> pglobal, std::span<const SfGenEntry> plocal,
+					  std::span<const SfGenEntry> iglobal, std::span<const SfGenEntry> ilocal) noexcept;
+}
+
+namespace SF2ML {
+	/// Note-on lookup index: (bank, program, key, velocity) -> (preset zone, instrument zone, sample) triples.
+	/// Every preset is compiled into a flat list of layers(preset zone x instrument zone pairs
+	/// with their intersected key/velocity ranges) plus a per-key bucket table over those layers,
+	/// so a lookup is one hash probe, one bucket slice and a velocity check per candidate.
+	/// Each compiled preset also keeps a voice table: the resolved generator values of its layers,
+	/// stored column-wise(one contiguous column per generator) in raw and physical units.
+	/// Edits only mark the affected presets dirty; they are recompiled on the next Refresh().
+	class SfNoteIndex {
+	public:
+		explicit SfNoteIndex(std::pmr::memory_resource* resource);
+
+		// everything has to be recompiled (ex: after loading)
+		void MarkAll() noexcept;
+		void MarkPreset(PresetHandle preset);
+		void MarkRenumbered(PresetHandle preset);
+		// marks every preset that references the instrument
+		void MarkInstrument(InstHandle inst);
+
+		// recompiles the dirty presets (and the (bank, program) table when needed)
+		void Refresh(const PresetContainer& presets, const InstContainer& insts);
+
+		/** @brief looks up the zones to play; the index must be up to date(see Refresh)
+		 *  @return number of matching zones(only the first out.size() of them are written)
+		*/
+		std::size_t Find(WORD bank, WORD program, BYTE key, BYTE velocity, std::span<SfNoteZone> out) const noexcept;
+
+		/// gathers the voice table row of the zone pair; the index must be up to date(see Refresh)
+		/// @return false if the zone pair is not in the index
+		bool GetVoice(const SfNoteZone& zone, SfVoiceParams& out) const noexcept;
+
+	private:
+		struct Layer {
+			SfNoteZone zone;
+			BYTE vel_lo;
+			BYTE vel_hi;
+			BYTE key_lo;
+			BYTE key_hi;
+		};
+
+		struct CompiledPreset {
+			explicit CompiledPreset(std::pmr::memory_resource* resource)
+				: layers(resource), key_items(resource), instruments(resource), raw(resource), physical(resource) {}
+
+			std::pmr::vector<Layer> layers;
+			// layers playing key k: layers[key_items[key_offsets[k]]] ... layers[key_items[key_offsets[k+1]-1]]
+			std::pmr::vector<DWORD> key_items;
+			std::array<DWORD, 129> key_offsets {};
+			// instruments referenced by the layers (for invalidation)
+			std::pmr::vector<InstHandle> instruments;
+			// voice table: value of generator g for layer i is at [g * layers.size() + i]
+			std::pmr::vector<SHORT> raw;
+			std::pmr::vector<float> physical;
+			bool dirty = true;
+		};
+
+		// the full program number is kept, so that out of range programs never alias onto valid ones
+		// (the same key as FrozenSoundFont)
+		static DWORD ProgramKey(WORD bank, WORD program) noexcept {
+			return (static_cast<DWORD>(bank) << 16) | program;
+		}
+
+		void Compile(CompiledPreset& dst, const SfPreset& preset, const InstContainer& insts);
+
+		std::pmr::memory_resource* resource;
+		bool all_dirty = true;
+		bool programs_dirty = true;
+		// keyed by PresetHandle::value
+		std::pmr::unordered_map<DWORD, CompiledPreset> compiled;
+		std::pmr::vector<PresetHandle> dirty;
+		// (bank, program) -> compiled preset
+		std::pmr::unordered_map<DWORD, const CompiledPreset*> programs;
+		// (InstHandle::value, PresetHandle::value) pairs of instrument references
+		std::pmr::set<std::pair<WORD, DWORD>> inst_users;
+	};
+}
+
+#endif
\ No newline at end of file
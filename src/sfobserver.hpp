@@ -0,0 +1,38 @@
+#ifndef SF2ML_SFOBSERVER_HPP_
+#define SF2ML_SFOBSERVER_HPP_
+
+#include <sfhandle.hpp>
+
+#include <optional>
+
+namespace SF2ML {
+	/// Receives edit notifications from the objects owned by a SoundFont.
+	/// Objects only notify after they were attached to an observer (SoundFont attaches every object it owns),
+	/// so standalone objects and objects being loaded from file never call into it.
+	/// Implementations should only record what changed; the heavy work is done lazily.
+	class SfObserver {
+	public:
+		virtual ~SfObserver() = default;
+
+		/// zones(or their generators/modulators) of the preset were edited
+		virtual void OnPresetChanged(PresetHandle preset) = 0;
+		/// bank number/preset number of the preset was edited
+		virtual void OnPresetRenumbered(PresetHandle preset) = 0;
+		/// zones(or their generators/modulators) of the instrument were edited
+		virtual void OnInstrumentChanged(InstHandle inst) = 0;
+		/// sample data of the sample was replaced
+		virtual void OnSampleChanged(SmplHandle smpl) = 0;
+
+		/// name of the object was edited
+		virtual void OnPresetRenamed(PresetHandle preset) = 0;
+		virtual void OnInstrumentRenamed(InstHandle inst) = 0;
+		virtual void OnSampleRenamed(SmplHandle smpl) = 0;
+
+		/// sample referenced by the instrument zone after an edit (std::nullopt: none, or the zone is being removed)
+		virtual void OnZoneSampleChanged(InstHandle inst, IZoneHandle zone, std::optional<SmplHandle> smpl) = 0;
+		/// instrument referenced by the preset zone after an edit (std::nullopt: none, or the zone is being removed)
+		virtual void OnZoneInstrumentChanged(PresetHandle preset, PZoneHandle zone, std::optional<InstHandle> inst) = 0;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef SF2ML_SFPARALLEL_HPP_
+#define SF2ML_SFPARALLEL_HPP_
+
+#include "sftracing.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace SF2ML {
+	/// number of threads worth using for `work` units of work, when one thread should get at least `grain` units
+	inline unsigned ParallelThreads(std::size_t work, std::size_t grain) noexcept {
+		const std::size_t hw = std::max(1u, std::thread::hardware_concurrency());
+		return static_cast<unsigned>(std::clamp<std::size_t>(work / std::max<std::size_t>(grain, 1), 1, hw));
+	}
+
+	/// Calls f(i) for every i in [0, count), with the range split in contiguous parts over `threads` threads
+	/// (the calling thread takes the first part). f must be safe to call concurrently for different i.
+	/// The first exception thrown by f is rethrown once every thread has finished.
+	template <typename F>
+	void ParallelFor(std::size_t count, unsigned threads, F&& f) {
+		threads = static_cast<unsigned>(std::min<std::size_t>(threads, count));
+		if (threads <= 1) {
+			for (std::size_t i = 0; i < count; i++) {
+				f(i);
+			}
+			return;
+		}
+
+		std::vector<std::exception_ptr> errors(threads);
+		auto run = [&](unsigned part) {
+			const std::size_t first = count * part / threads;
+			const std::size_t last = count * (part + 1) / threads;
+			trace::Scope trace("ParallelFor part", "part", part);
+			try {
+				for (std::size_t i = first; i < last; i++) {
+					f(i);
+				}
+			} catch (...) {
+				errors[part] = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> workers;
+		workers.reserve(threads - 1);
+		for (unsigned part = 1; part < threads; part++) {
+			try {
+				workers.emplace_back(run, part);
+			} catch (const std::system_error&) {
+				run(part); // no thread available: do the part here
+			}
+		}
+		run(0);
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		for (const std::exception_ptr& error : errors) {
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+	}
+}
+
+#endif
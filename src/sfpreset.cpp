@@ -1,5 +1,6 @@
 #include <sfpreset.hpp>
 #include "sfhandleinterface.hpp"
+#include "sfobserver.hpp"
 
 using namespace SF2ML;
 
@@ -11,13 +12,21 @@ namespace SF2ML {
 		std::uint16_t preset_number;
 		std::uint16_t bank_number;
 		SfHandleInterface<SfPresetZone, PZoneHandle> zones;
+		SfObserver* observer = nullptr;
 	public:
-		SfPresetImpl(PresetHandle handle) : self_handle(handle) {}
+		SfPresetImpl(PresetHandle handle, std::pmr::memory_resource* resource)
+			: self_handle(handle), zones(resource) {}
+
+		void Touch() {
+			if (observer) {
+				observer->OnPresetChanged(self_handle);
+			}
+		}
 	};
 }
 
-SfPreset::SfPreset(PresetHandle handle) {
-	pimpl = std::make_unique<SfPresetImpl>(handle);
+SfPreset::SfPreset(PresetHandle handle, std::pmr::memory_resource* resource) {
+	pimpl = MakePmrUnique<SfPresetImpl>(resource, handle, resource);
 	
 	// global zone
 	pimpl->zones.NewItem();
@@ -53,7 +62,10 @@ SfPresetZone& SfPreset::GetGlobalZone() {
 }
 
 SfPresetZone& SfPreset::NewZone() {
-	return pimpl->zones.NewItem();
+	SfPresetZone& zone = pimpl->zones.NewItem();
+	zone.Attach(pimpl->observer, pimpl->self_handle);
+	pimpl->Touch();
+	return zone;
 }
 
 std::uint32_t SfPreset::CountZones(bool count_empty) const {
@@ -81,8 +93,32 @@ void SfPreset::ForEachZone(std::function<void(const SfPresetZone &)> pred) const
 	}
 }
 
+auto SfPreset::Zones() const noexcept -> std::span<const SfPresetZone> {
+	return pimpl->zones.Items();
+}
+
+auto SfPreset::MutableZones() noexcept -> std::span<SfPresetZone> {
+	return pimpl->zones.Items();
+}
+
 void SfPreset::RemoveZone(PZoneHandle zone_handle) {
-	pimpl->zones.Remove(zone_handle);
+	if (SfPresetZone* zone = pimpl->zones.Get(zone_handle)) {
+		zone->Detach();
+	}
+	if (pimpl->zones.Remove(zone_handle)) {
+		pimpl->Touch();
+	}
+}
+
+void SfPreset::RemoveZones(std::span<const PZoneHandle> zone_handles) {
+	for (PZoneHandle zone_handle : zone_handles) {
+		if (SfPresetZone* zone = pimpl->zones.Get(zone_handle)) {
+			zone->Detach();
+		}
+	}
+	if (pimpl->zones.RemoveMany(zone_handles) > 0) {
+		pimpl->Touch();
+	}
 }
 
 auto SfPreset::FindZone(std::function<bool(const SfPresetZone &)> pred) -> std::optional<PZoneHandle> {
@@ -106,17 +142,26 @@ auto SfPreset::FindZones(std::function<bool(const SfPresetZone &)> pred) -> std:
 
 SfPreset& SfPreset::SetPresetNumber(std::uint16_t x) {
 	pimpl->preset_number = std::min<std::uint16_t>(x, 127);
+	if (pimpl->observer) {
+		pimpl->observer->OnPresetRenumbered(pimpl->self_handle);
+	}
 	return *this;
 }
 
 SfPreset& SfPreset::SetBankNumber(std::uint16_t x) {
 	pimpl->bank_number = std::min<std::uint16_t>(x, 0x3FFF);
+	if (pimpl->observer) {
+		pimpl->observer->OnPresetRenumbered(pimpl->self_handle);
+	}
 	return *this;
 }
 
 SfPreset& SfPreset::SetName(std::string_view x) {
 	std::memset(pimpl->preset_name, 0, 21);
 	std::memcpy(pimpl->preset_name, x.data(), std::min<size_t>(x.length(), 20));
+	if (pimpl->observer) {
+		pimpl->observer->OnPresetRenamed(pimpl->self_handle);
+	}
 	return *this;
 }
 
@@ -127,3 +172,17 @@ std::uint16_t SfPreset::GetPresetNumber() const {
 std::uint16_t SfPreset::GetBankNumber() const {
 	return pimpl->bank_number;
 }
+
+void SfPreset::Attach(SfObserver* observer) {
+	pimpl->observer = observer;
+	for (auto& zone : pimpl->zones) {
+		zone.Attach(observer, pimpl->self_handle);
+	}
+}
+
+void SfPreset::Detach() {
+	for (auto& zone : pimpl->zones) {
+		zone.Detach();
+	}
+	pimpl->observer = nullptr;
+}
\ No newline at end of file
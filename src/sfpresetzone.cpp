@@ -5,10 +5,10 @@
 #include <climits>
 #include <cassert>
 #include <utility>
-#include <bitset>
-#include <array>
 
-#include "sfhandleinterface.hpp"
+#include "sfmodulatorlist.hpp"
+#include "sfgeneratorset.hpp"
+#include "sfobserver.hpp"
 
 using namespace SF2ML;
 
@@ -17,17 +17,41 @@ namespace SF2ML {
 		friend SfPresetZone;
 		PZoneHandle self_handle;
 		// generators
-		std::bitset<SfGenEndOper> active_gens {};
-		std::array<SfGenAmount, SfGenEndOper> generators;
+		SfGeneratorSet generators;
 		// modulators
-		SfHandleInterface<SfModulator, ModHandle> modulators;
+		SfModulatorList modulators;
+		// edit notification
+		SfObserver* observer = nullptr;
+		PresetHandle owner {0};
 	public:
-		SfPresetZoneImpl(PZoneHandle handle) : self_handle{handle} {}
+		SfPresetZoneImpl(PZoneHandle handle, std::pmr::memory_resource* resource)
+			: self_handle{handle}, generators(resource), modulators(resource) {}
+
+		// amount of the generator(or its default when the zone does not set it); preset amounts are
+		// offsets added to the instrument value, so they are not clamped to the instrument range
+		SHORT Amount(SFGenerator type) const noexcept {
+			const auto raw = generators.Get(type);
+			return raw ? static_cast<SHORT>(*raw) : GetGenTraits(type).default_value;
+		}
+
+		void Touch() {
+			if (observer) {
+				observer->OnPresetChanged(owner);
+				observer->OnZoneInstrumentChanged(owner, self_handle, ReferencedInstrument());
+			}
+		}
+
+		std::optional<InstHandle> ReferencedInstrument() const noexcept {
+			if (auto raw = generators.Get(SfGenInstrument)) {
+				return InstHandle(*raw);
+			}
+			return std::nullopt;
+		}
 	};
 }
 
-SfPresetZone::SfPresetZone(PZoneHandle handle) {
-	pimpl = std::make_unique<SfPresetZoneImpl>(handle);
+SfPresetZone::SfPresetZone(PZoneHandle handle, std::pmr::memory_resource* resource) {
+	pimpl = MakePmrUnique<SfPresetZoneImpl>(resource, handle, resource);
 }
 
 SfPresetZone::~SfPresetZone() {
@@ -49,14 +73,14 @@ PZoneHandle SfPresetZone::GetHandle() const {
 
 bool SfPresetZone::IsEmpty() const noexcept {
 	if (pimpl->self_handle.value == 0) {
-		return pimpl->active_gens.count() == 0 && pimpl->modulators.Count() == 0;
+		return pimpl->generators.Count() == 0 && pimpl->modulators.Count() == 0;
 	} else {
-		return pimpl->active_gens.count() == 0;
+		return pimpl->generators.Count() == 0;
 	}
 }
 
 DWORD SfPresetZone::GeneratorCount() const noexcept {
-	return pimpl->active_gens.count();
+	return pimpl->generators.Count();
 }
 
 DWORD SF2ML::SfPresetZone::ModulatorCount() const noexcept {
@@ -65,40 +89,28 @@ DWORD SF2ML::SfPresetZone::ModulatorCount() const noexcept {
 
 bool SfPresetZone::HasGenerator(SFGenerator type) const {
 	assert(static_cast<WORD>(type) < SfGenEndOper);
-	return pimpl->active_gens[static_cast<WORD>(type)];
+	return pimpl->generators.Has(type);
 }
 
-#define PZONE_S16_PLAIN_GETTER_IMPL(GeneratorType, DefaultBits) \
+#define PZONE_S16_PLAIN_GETTER_IMPL(GeneratorType) \
 	auto SfPresetZone::Get##GeneratorType() const -> std::int16_t { \
-		if (HasGenerator(SfGen##GeneratorType)) { \
-			return std::get<SHORT>(pimpl->generators[SfGen##GeneratorType]); \
-		} else { \
-			return DefaultBits; \
-		} \
+		return pimpl->Amount(SfGen##GeneratorType); \
 	}
 
-#define PZONE_TIME_CENT_GETTER_IMPL(GeneratorType, DefaultBits) \
+#define PZONE_TIME_CENT_GETTER_IMPL(GeneratorType) \
 	auto SfPresetZone::Get##GeneratorType() const -> double { \
-		if (HasGenerator(SfGen##GeneratorType)) { \
-			return TimeCentToSeconds(std::get<SHORT>(pimpl->generators[SfGen##GeneratorType])); \
-		} else { \
-			return TimeCentToSeconds(DefaultBits); \
-		} \
+		return TimeCentToSeconds(pimpl->Amount(SfGen##GeneratorType)); \
 	}
 
-#define PZONE_ABSL_CENT_GETTER_IMPL(GeneratorType, DefaultBits) \
+#define PZONE_ABSL_CENT_GETTER_IMPL(GeneratorType) \
 	auto SfPresetZone::Get##GeneratorType() const -> double { \
-		if (HasGenerator(SfGen##GeneratorType)) { \
-			return AbsoluteCentToHertz(std::get<SHORT>(pimpl->generators[SfGen##GeneratorType])); \
-		} else { \
-			return AbsoluteCentToHertz(DefaultBits); \
-		} \
+		return AbsoluteCentToHertz(pimpl->Amount(SfGen##GeneratorType)); \
 	}
 
 #define PZONE_RANGE_GETTER_IMPL(GeneratorType) \
 	auto SfPresetZone::Get##GeneratorType() const -> Ranges<std::uint8_t> { \
 		if (HasGenerator(SfGen##GeneratorType)) { \
-			return std::get<Ranges<BYTE>>(pimpl->generators[SfGen##GeneratorType]); \
+			return std::get<Ranges<BYTE>>(DecodeGenAmount(SfGen##GeneratorType, *pimpl->generators.Get(SfGen##GeneratorType))); \
 		} else { \
 			return { 0, 127 }; \
 		} \
@@ -107,45 +119,35 @@ bool SfPresetZone::HasGenerator(SFGenerator type) const {
 #define PZONE_S16_PLAIN_SETTER_IMPL(GeneratorType) \
 	auto SfPresetZone::Set##GeneratorType(std::optional<std::int16_t> x) -> SfPresetZone& { \
 		if (x.has_value()) { \
-			pimpl->generators[SfGen##GeneratorType] = x.value(); \
-			pimpl->active_gens.set(SfGen##GeneratorType); \
+			pimpl->generators.Set(SfGen##GeneratorType, static_cast<WORD>(x.value())); \
 		} else { \
-			pimpl->active_gens.reset(SfGen##GeneratorType); \
+			pimpl->generators.Reset(SfGen##GeneratorType); \
 		} \
+		pimpl->Touch(); \
 		return *this; \
 	}
 
-#define PZONE_TIME_CENT_SETTER_IMPL(GeneratorType, MinVal, MaxVal) \
+#define PZONE_TIME_CENT_SETTER_IMPL(GeneratorType) \
 	auto SfPresetZone::Set##GeneratorType(std::optional<double> x) -> SfPresetZone& { \
 		if (x.has_value()) { \
-			SHORT cent = SecondsToTimeCent(x.value()); \
-			if (cent < (MinVal)) { \
-				cent = (MinVal); \
-			} else if (cent > (MaxVal)) { \
-				cent = (MaxVal); \
-			} \
-			pimpl->generators[SfGen##GeneratorType] = cent; \
-			pimpl->active_gens.set(SfGen##GeneratorType); \
+			const SHORT cent = ClampGenAmount(SfGen##GeneratorType, SecondsToTimeCent(x.value())); \
+			pimpl->generators.Set(SfGen##GeneratorType, static_cast<WORD>(cent)); \
 		} else { \
-			pimpl->active_gens.reset(SfGen##GeneratorType); \
+			pimpl->generators.Reset(SfGen##GeneratorType); \
 		} \
+		pimpl->Touch(); \
 		return *this; \
 	}
 
-#define PZONE_ABSL_CENT_SETTER_IMPL(GeneratorType, MinVal, MaxVal) \
+#define PZONE_ABSL_CENT_SETTER_IMPL(GeneratorType) \
 	auto SfPresetZone::Set##GeneratorType(std::optional<double> x) -> SfPresetZone& { \
 		if (x.has_value()) { \
-			SHORT cent = HertzToAbsoluteCent(x.value()); \
-			if (cent < (MinVal)) { \
-				cent = (MinVal); \
-			} else if (cent > (MaxVal)) { \
-				cent = (MaxVal); \
-			} \
-			pimpl->generators[SfGen##GeneratorType] = cent; \
-			pimpl->active_gens.set(SfGen##GeneratorType); \
+			const SHORT cent = ClampGenAmount(SfGen##GeneratorType, HertzToAbsoluteCent(x.value())); \
+			pimpl->generators.Set(SfGen##GeneratorType, static_cast<WORD>(cent)); \
 		} else { \
-			pimpl->active_gens.reset(SfGen##GeneratorType); \
+			pimpl->generators.Reset(SfGen##GeneratorType); \
 		} \
+		pimpl->Touch(); \
 		return *this; \
 	}
 
@@ -153,56 +155,56 @@ bool SfPresetZone::HasGenerator(SFGenerator type) const {
 	auto SfPresetZone::Set##GeneratorType(std::optional<Ranges<std::uint8_t>> x) -> SfPresetZone& { \
 		if (x.has_value()) { \
 			Ranges<BYTE> ranges { x->start, x->end }; \
-			pimpl->generators[SfGen##GeneratorType] = ranges; \
-			pimpl->active_gens.set(SfGen##GeneratorType); \
+			pimpl->generators.Set(SfGen##GeneratorType, EncodeGenAmount(ranges)); \
 		} else { \
-			pimpl->active_gens.reset(SfGen##GeneratorType); \
+			pimpl->generators.Reset(SfGen##GeneratorType); \
 		} \
+		pimpl->Touch(); \
 		return *this; \
 	}
 
-PZONE_S16_PLAIN_GETTER_IMPL(ModLfoToPitch,       0)
-PZONE_S16_PLAIN_GETTER_IMPL(VibLfoToPitch,       0)
-PZONE_S16_PLAIN_GETTER_IMPL(ModEnvToPitch,       0)
-PZONE_ABSL_CENT_GETTER_IMPL(InitialFilterFc, 13500)
-PZONE_S16_PLAIN_GETTER_IMPL(InitialFilterQ,      0)
-PZONE_S16_PLAIN_GETTER_IMPL(ModLfoToFilterFc,    0)
-PZONE_S16_PLAIN_GETTER_IMPL(ModEnvToFilterFc,    0)
-PZONE_S16_PLAIN_GETTER_IMPL(ModLfoToVolume,      0)
-PZONE_S16_PLAIN_GETTER_IMPL(ChorusEffectsSend,   0)
-PZONE_S16_PLAIN_GETTER_IMPL(ReverbEffectsSend,   0)
-PZONE_S16_PLAIN_GETTER_IMPL(Pan,                 0)
-PZONE_TIME_CENT_GETTER_IMPL(DelayModLFO,    -12000)
-PZONE_ABSL_CENT_GETTER_IMPL(FreqModLFO,          0)
-PZONE_TIME_CENT_GETTER_IMPL(DelayVibLFO,    -12000)
-PZONE_ABSL_CENT_GETTER_IMPL(FreqVibLFO,          0)  
-PZONE_TIME_CENT_GETTER_IMPL(DelayModEnv,    -12000)
-PZONE_TIME_CENT_GETTER_IMPL(AttackModEnv,   -12000)
-PZONE_TIME_CENT_GETTER_IMPL(HoldModEnv,     -12000)
-PZONE_TIME_CENT_GETTER_IMPL(DecayModEnv,    -12000)
-PZONE_S16_PLAIN_GETTER_IMPL(SustainModEnv,       0)
-PZONE_TIME_CENT_GETTER_IMPL(ReleaseModEnv,  -12000)
-PZONE_S16_PLAIN_GETTER_IMPL(KeynumToModEnvHold,  0)
-PZONE_S16_PLAIN_GETTER_IMPL(KeynumToModEnvDecay, 0)
-PZONE_TIME_CENT_GETTER_IMPL(DelayVolEnv,    -12000)
-PZONE_TIME_CENT_GETTER_IMPL(AttackVolEnv,   -12000)
-PZONE_TIME_CENT_GETTER_IMPL(HoldVolEnv,     -12000)
-PZONE_TIME_CENT_GETTER_IMPL(DecayVolEnv,    -12000)
-PZONE_S16_PLAIN_GETTER_IMPL(SustainVolEnv,       0)
-PZONE_TIME_CENT_GETTER_IMPL(ReleaseVolEnv,  -12000)
-PZONE_S16_PLAIN_GETTER_IMPL(KeynumToVolEnvHold,  0)
-PZONE_S16_PLAIN_GETTER_IMPL(KeynumToVolEnvDecay, 0)
+PZONE_S16_PLAIN_GETTER_IMPL(ModLfoToPitch)
+PZONE_S16_PLAIN_GETTER_IMPL(VibLfoToPitch)
+PZONE_S16_PLAIN_GETTER_IMPL(ModEnvToPitch)
+PZONE_ABSL_CENT_GETTER_IMPL(InitialFilterFc)
+PZONE_S16_PLAIN_GETTER_IMPL(InitialFilterQ)
+PZONE_S16_PLAIN_GETTER_IMPL(ModLfoToFilterFc)
+PZONE_S16_PLAIN_GETTER_IMPL(ModEnvToFilterFc)
+PZONE_S16_PLAIN_GETTER_IMPL(ModLfoToVolume)
+PZONE_S16_PLAIN_GETTER_IMPL(ChorusEffectsSend)
+PZONE_S16_PLAIN_GETTER_IMPL(ReverbEffectsSend)
+PZONE_S16_PLAIN_GETTER_IMPL(Pan)
+PZONE_TIME_CENT_GETTER_IMPL(DelayModLFO)
+PZONE_ABSL_CENT_GETTER_IMPL(FreqModLFO)
+PZONE_TIME_CENT_GETTER_IMPL(DelayVibLFO)
+PZONE_ABSL_CENT_GETTER_IMPL(FreqVibLFO)
+PZONE_TIME_CENT_GETTER_IMPL(DelayModEnv)
+PZONE_TIME_CENT_GETTER_IMPL(AttackModEnv)
+PZONE_TIME_CENT_GETTER_IMPL(HoldModEnv)
+PZONE_TIME_CENT_GETTER_IMPL(DecayModEnv)
+PZONE_S16_PLAIN_GETTER_IMPL(SustainModEnv)
+PZONE_TIME_CENT_GETTER_IMPL(ReleaseModEnv)
+PZONE_S16_PLAIN_GETTER_IMPL(KeynumToModEnvHold)
+PZONE_S16_PLAIN_GETTER_IMPL(KeynumToModEnvDecay)
+PZONE_TIME_CENT_GETTER_IMPL(DelayVolEnv)
+PZONE_TIME_CENT_GETTER_IMPL(AttackVolEnv)
+PZONE_TIME_CENT_GETTER_IMPL(HoldVolEnv)
+PZONE_TIME_CENT_GETTER_IMPL(DecayVolEnv)
+PZONE_S16_PLAIN_GETTER_IMPL(SustainVolEnv)
+PZONE_TIME_CENT_GETTER_IMPL(ReleaseVolEnv)
+PZONE_S16_PLAIN_GETTER_IMPL(KeynumToVolEnvHold)
+PZONE_S16_PLAIN_GETTER_IMPL(KeynumToVolEnvDecay)
 PZONE_RANGE_GETTER_IMPL(KeyRange)
 PZONE_RANGE_GETTER_IMPL(VelRange)
-PZONE_S16_PLAIN_GETTER_IMPL(InitialAttenuation,  0)
-PZONE_S16_PLAIN_GETTER_IMPL(CoarseTune,          0)
-PZONE_S16_PLAIN_GETTER_IMPL(FineTune,            0)
-PZONE_S16_PLAIN_GETTER_IMPL(ScaleTuning,       100)
+PZONE_S16_PLAIN_GETTER_IMPL(InitialAttenuation)
+PZONE_S16_PLAIN_GETTER_IMPL(CoarseTune)
+PZONE_S16_PLAIN_GETTER_IMPL(FineTune)
+PZONE_S16_PLAIN_GETTER_IMPL(ScaleTuning)
 
 PZONE_S16_PLAIN_SETTER_IMPL(ModLfoToPitch)
 PZONE_S16_PLAIN_SETTER_IMPL(VibLfoToPitch)
 PZONE_S16_PLAIN_SETTER_IMPL(ModEnvToPitch)
-PZONE_ABSL_CENT_SETTER_IMPL(InitialFilterFc, 1500, 13500)
+PZONE_ABSL_CENT_SETTER_IMPL(InitialFilterFc)
 PZONE_S16_PLAIN_SETTER_IMPL(InitialFilterQ)
 PZONE_S16_PLAIN_SETTER_IMPL(ModLfoToFilterFc)
 PZONE_S16_PLAIN_SETTER_IMPL(ModEnvToFilterFc)
@@ -210,24 +212,24 @@ PZONE_S16_PLAIN_SETTER_IMPL(ModLfoToVolume)
 PZONE_S16_PLAIN_SETTER_IMPL(ChorusEffectsSend)
 PZONE_S16_PLAIN_SETTER_IMPL(ReverbEffectsSend)
 PZONE_S16_PLAIN_SETTER_IMPL(Pan)
-PZONE_TIME_CENT_SETTER_IMPL(DelayModLFO,   -12000, 5000)
-PZONE_ABSL_CENT_SETTER_IMPL(FreqModLFO,     -1600, 4500)
-PZONE_TIME_CENT_SETTER_IMPL(DelayVibLFO,   -12000, 5000)
-PZONE_ABSL_CENT_SETTER_IMPL(FreqVibLFO,    -16000, 4500)  
-PZONE_TIME_CENT_SETTER_IMPL(DelayModEnv,   -12000, 5000)
-PZONE_TIME_CENT_SETTER_IMPL(AttackModEnv,  -12000, 8000)
-PZONE_TIME_CENT_SETTER_IMPL(HoldModEnv,    -12000, 5000)
-PZONE_TIME_CENT_SETTER_IMPL(DecayModEnv,   -12000, 8000)
+PZONE_TIME_CENT_SETTER_IMPL(DelayModLFO)
+PZONE_ABSL_CENT_SETTER_IMPL(FreqModLFO)
+PZONE_TIME_CENT_SETTER_IMPL(DelayVibLFO)
+PZONE_ABSL_CENT_SETTER_IMPL(FreqVibLFO)
+PZONE_TIME_CENT_SETTER_IMPL(DelayModEnv)
+PZONE_TIME_CENT_SETTER_IMPL(AttackModEnv)
+PZONE_TIME_CENT_SETTER_IMPL(HoldModEnv)
+PZONE_TIME_CENT_SETTER_IMPL(DecayModEnv)
 PZONE_S16_PLAIN_SETTER_IMPL(SustainModEnv)
-PZONE_TIME_CENT_SETTER_IMPL(ReleaseModEnv, -12000, 8000)
+PZONE_TIME_CENT_SETTER_IMPL(ReleaseModEnv)
 PZONE_S16_PLAIN_SETTER_IMPL(KeynumToModEnvHold)
 PZONE_S16_PLAIN_SETTER_IMPL(KeynumToModEnvDecay)
-PZONE_TIME_CENT_SETTER_IMPL(DelayVolEnv,   -12000, 5000)
-PZONE_TIME_CENT_SETTER_IMPL(AttackVolEnv,  -12000, 8000)
-PZONE_TIME_CENT_SETTER_IMPL(HoldVolEnv,    -12000, 5000)
-PZONE_TIME_CENT_SETTER_IMPL(DecayVolEnv,   -12000, 8000)
+PZONE_TIME_CENT_SETTER_IMPL(DelayVolEnv)
+PZONE_TIME_CENT_SETTER_IMPL(AttackVolEnv)
+PZONE_TIME_CENT_SETTER_IMPL(HoldVolEnv)
+PZONE_TIME_CENT_SETTER_IMPL(DecayVolEnv)
 PZONE_S16_PLAIN_SETTER_IMPL(SustainVolEnv)
-PZONE_TIME_CENT_SETTER_IMPL(ReleaseVolEnv, -12000, 8000)
+PZONE_TIME_CENT_SETTER_IMPL(ReleaseVolEnv)
 PZONE_S16_PLAIN_SETTER_IMPL(KeynumToVolEnvHold)
 PZONE_S16_PLAIN_SETTER_IMPL(KeynumToVolEnvDecay)
 PZONE_RANGE_SETTER_IMPL(KeyRange)
@@ -239,7 +241,7 @@ PZONE_S16_PLAIN_SETTER_IMPL(ScaleTuning)
 
 auto SfPresetZone::GetInstrument() const -> std::optional<InstHandle> {
 	if (HasGenerator(SfGenInstrument)) {
-		return std::get<InstHandle>(pimpl->generators[SfGenInstrument]);
+		return InstHandle(*pimpl->generators.Get(SfGenInstrument));
 	} else {
 		return std::nullopt;
 	}
@@ -247,38 +249,49 @@ auto SfPresetZone::GetInstrument() const -> std::optional<InstHandle> {
 
 auto SfPresetZone::SetInstrument(std::optional<InstHandle> x) -> SfPresetZone& {
 	if (x.has_value()) {
-		pimpl->active_gens.set(SfGenInstrument);
-		pimpl->generators[SfGenInstrument] = x.value();
+		pimpl->generators.Set(SfGenInstrument, x->value);
 	} else {
-		pimpl->active_gens.reset(SfGenInstrument);
+		pimpl->generators.Reset(SfGenInstrument);
 	}
+	pimpl->Touch();
 	return *this;
 }
 
 auto SF2ML::SfPresetZone::SetGenerator(SFGenerator type, std::optional<SfGenAmount> amt) -> SfPresetZone& {
 	if (amt.has_value()) {
-		pimpl->active_gens.set(type);
-		pimpl->generators[type] = amt.value();
+		pimpl->generators.Set(type, EncodeGenAmount(amt.value()));
 	} else {
-		pimpl->active_gens.reset(type);
+		pimpl->generators.Reset(type);
 	}
+	pimpl->Touch();
 	return *this;
 }
 
 auto SF2ML::SfPresetZone::GetGenerator(SFGenerator type) const -> SfGenAmount {
-	return pimpl->generators[type];
+	return DecodeGenAmount(type, pimpl->generators.Get(type).value_or(0));
+}
+
+auto SF2ML::SfPresetZone::Generators() const noexcept -> std::span<const SfGenEntry> {
+	return pimpl->generators.Entries();
+}
+
+auto SF2ML::SfPresetZone::GeneratorMask() const noexcept -> std::uint64_t {
+	return pimpl->generators.Mask();
 }
 
 auto SfPresetZone::NewModulator() -> SfModulator& {
-	return pimpl->modulators.NewItem();
+	pimpl->Touch();
+	return pimpl->modulators.New();
 }
 
 auto SF2ML::SfPresetZone::NewModulatorWithKey(ModHandle handle) -> SfModulator& {
-	return pimpl->modulators.NewItemWithKey(handle.value);
+	pimpl->Touch();
+	return pimpl->modulators.NewWithKey(handle.value);
 }
 
 void SfPresetZone::RemoveModulator(ModHandle handle) {
 	pimpl->modulators.Remove(handle);
+	pimpl->Touch();
 }
 
 auto SfPresetZone::GetModulator(ModHandle handle) -> SfModulator& {
@@ -310,6 +323,7 @@ void SfPresetZone::ForEachModulators(std::function<void(SfModulator&)> pred) {
 	for (auto& mod : pimpl->modulators) {
 		pred(mod);
 	}
+	pimpl->Touch();
 }
 
 void SfPresetZone::ForEachModulators(std::function<void(const SfModulator&)> pred) const {
@@ -318,20 +332,45 @@ void SfPresetZone::ForEachModulators(std::function<void(const SfModulator&)> pre
 	}
 }
 
+auto SfPresetZone::Modulators() const noexcept -> std::span<const SfModulator> {
+	return pimpl->modulators.Items();
+}
+
+auto SfPresetZone::MutableModulators() noexcept -> std::span<SfModulator> {
+	return pimpl->modulators.Items();
+}
+
+void SfPresetZone::NotifyEdited() {
+	pimpl->Touch();
+}
+
 auto SfPresetZone::GetModIndex(ModHandle handle) const -> std::optional<std::uint16_t> {
 	return pimpl->modulators.GetID(handle);
 }
 
 SfPresetZone& SfPresetZone::CopyProperties(const SfPresetZone& zone) {
-	pimpl->active_gens = zone.pimpl->active_gens;
 	pimpl->generators  = zone.pimpl->generators;
 	pimpl->modulators  = zone.pimpl->modulators;
+	pimpl->Touch();
 	return *this;
 }
 
 SfPresetZone& SfPresetZone::MoveProperties(SfPresetZone&& zone) {
-	pimpl->active_gens = std::move(zone.pimpl->active_gens);
 	pimpl->generators  = std::move(zone.pimpl->generators);
 	pimpl->modulators  = std::move(zone.pimpl->modulators);
+	pimpl->Touch();
+	zone.pimpl->Touch();
 	return *this;
 }
+
+void SfPresetZone::Attach(SfObserver* observer, PresetHandle owner) {
+	pimpl->observer = observer;
+	pimpl->owner = owner;
+}
+
+void SfPresetZone::Detach() {
+	if (pimpl->observer) {
+		pimpl->observer->OnZoneInstrumentChanged(pimpl->owner, pimpl->self_handle, std::nullopt);
+	}
+	pimpl->observer = nullptr;
+}
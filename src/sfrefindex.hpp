@@ -0,0 +1,82 @@
+#ifndef SF2ML_SFREFINDEX_HPP_
+#define SF2ML_SFREFINDEX_HPP_
+
+#include <sftypes.hpp>
+
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+namespace SF2ML {
+	/// Reverse-reference index: target object(sample/instrument) -> zones that reference it.
+	/// Zones report the object they reference after every edit (see SfObserver);
+	/// the last reported reference of each zone is kept so the zone can be moved between targets.
+	template <typename TargetT, typename OwnerT, typename ZoneT>
+	class SfReferenceIndex {
+	public:
+		explicit SfReferenceIndex(std::pmr::memory_resource* resource)
+			: refs(resource), users(resource), counts(resource) {}
+
+		void Clear() noexcept {
+			refs.clear();
+			users.clear();
+			counts.clear();
+		}
+
+		// records that the zone references target from now on (std::nullopt: nothing)
+		void Set(OwnerT owner, ZoneT zone, std::optional<TargetT> target) {
+			const QWORD key = ZoneKey(owner, zone);
+			auto it = refs.find(key);
+			if (it != refs.end()) {
+				if (target && it->second == target->value) {
+					return;
+				}
+				users.erase({ it->second, key });
+				if (--counts[it->second] == 0) {
+					counts.erase(it->second);
+				}
+				refs.erase(it);
+			}
+			if (target) {
+				refs.emplace(key, target->value);
+				users.insert({ target->value, key });
+				counts[target->value]++;
+			}
+		}
+
+		// number of zones referencing target
+		DWORD Count(TargetT target) const noexcept {
+			auto it = counts.find(target.value);
+			return it != counts.end() ? it->second : 0;
+		}
+
+		// calls f(owner, zone) for every zone referencing target, in (owner, zone) order
+		template <typename F>
+		void ForEachUser(TargetT target, F&& f) const {
+			auto first = users.lower_bound({ target.value, 0 });
+			auto last = users.upper_bound({ target.value, std::numeric_limits<QWORD>::max() });
+			for (auto it = first; it != last; ++it) {
+				f(OwnerT(static_cast<decltype(OwnerT::value)>(it->second >> 32)),
+				  ZoneT(static_cast<decltype(ZoneT::value)>(it->second & 0xFFFFFFFF)));
+			}
+		}
+
+	private:
+		using TargetValue = decltype(TargetT::value);
+
+		static QWORD ZoneKey(OwnerT owner, ZoneT zone) noexcept {
+			return (static_cast<QWORD>(owner.value) << 32) | zone.value;
+		}
+
+		// (owner, zone) key -> referenced target
+		std::pmr::unordered_map<QWORD, TargetValue> refs;
+		// (target, (owner, zone) key) pairs
+		std::pmr::set<std::pair<TargetValue, QWORD>> users;
+		std::pmr::unordered_map<TargetValue, DWORD> counts;
+	};
+}
+
+#endif
@@ -0,0 +1,575 @@
+#include <sfresidency.hpp>
+#include <sfview.hpp>
+#include "sffilemap.hpp"
+#include "sfsampleimpl.hpp"
+#include "sftracing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+using namespace SF2ML;
+
+namespace SF2ML::residency {
+	struct Bank;
+
+	struct Entry {
+		SfResidencyManagerImpl* manager = nullptr;
+		Bank* bank = nullptr;
+		SfSampleImpl* sample = nullptr;
+		// bytes of the points(written under the lock, read without it by SfSample::GetSampleCount)
+		std::atomic<std::size_t> size { 0 };
+		bool resident = true;
+		std::atomic<std::uint32_t> pins { 0 };
+
+		// where evicted points are read back from: their range of the bank file while they are those of the file,
+		// otherwise the spill file once they were written there
+		bool in_file = false;
+		std::uint64_t smpl_offset = 0;
+		std::uint64_t sm24_offset = 0;
+		bool spilled = false;
+		std::uint64_t spill_offset = 0;
+		std::uint64_t spill_capacity = 0;  // size of the slot of the spill file, reused by the next spills
+
+		// least recently used list of the resident, unpinned entries
+		bool linked = false;
+		Entry* older = nullptr;
+		Entry* newer = nullptr;
+	};
+
+	struct Bank {
+		explicit Bank(std::pmr::memory_resource* resource) : entries(resource) {}
+
+		std::filesystem::path path;  // empty for banks that do not come from a file
+		std::uintmax_t file_size = 0;
+		std::filesystem::file_time_type file_time;
+		std::ifstream file;  // opened on the first miss
+		bool stale = false;  // the file changed since Manage
+		std::pmr::unordered_map<const SfSampleImpl*, Entry> entries;
+	};
+}
+
+using namespace SF2ML::residency;
+
+namespace SF2ML {
+	class SfResidencyManagerImpl {
+	public:
+		SfResidencyManagerImpl(std::size_t budget, const std::filesystem::path& spill_dir, std::pmr::memory_resource* resource)
+			: resource{resource}, budget{budget}, spill_dir{spill_dir}, banks(resource), scratch(resource) {}
+		~SfResidencyManagerImpl() {
+			std::lock_guard lock(mutex);
+			for (Bank& bank : banks) {
+				while (!bank.entries.empty()) {
+					Detach(bank.entries.begin()->second, true);
+				}
+			}
+			banks.clear();
+			if (spill.is_open()) {
+				spill.close();
+				std::error_code ec;
+				std::filesystem::remove(spill_path, ec);
+			}
+		}
+		SfResidencyManagerImpl(const SfResidencyManagerImpl&) = delete;
+		SfResidencyManagerImpl& operator=(const SfResidencyManagerImpl&) = delete;
+
+		// the samples of sf2 not managed yet; view is the bank file mapped at base, if there is one
+		void ManageSamples(SoundFont& sf2, const std::filesystem::path& path, const SoundFontView* view, const BYTE* base) {
+			std::lock_guard lock(mutex);
+			Bank& bank = banks.emplace_back(resource);
+			if (view) {
+				std::error_code ec;
+				bank.path = path;
+				bank.file_size = std::filesystem::file_size(path, ec);
+				bank.file_time = std::filesystem::last_write_time(path, ec);
+			}
+			for (const SfSample& smpl : sf2.Samples()) {
+				SfSampleImpl* sample = SampleOf(smpl);
+				if (sample->residency || sample->wav_source) {
+					continue;
+				}
+				Entry& entry = bank.entries.try_emplace(sample).first->second;
+				entry.manager = this;
+				entry.bank = &bank;
+				entry.sample = sample;
+				entry.size = sample->wav_data.size();
+				if (view) {
+					LocateInFile(entry, *view, base);
+				}
+				sample->residency = &entry;
+				stats.resident_bytes += entry.size;
+				stats.managed_samples++;
+				Link(entry);
+			}
+			if (bank.entries.empty()) {
+				banks.pop_back();
+			}
+			MakeRoom(0);
+		}
+
+		void Release(SoundFont& sf2) {
+			std::lock_guard lock(mutex);
+			for (const SfSample& smpl : sf2.Samples()) {
+				SfSampleImpl* sample = SampleOf(smpl);
+				if (sample->residency && sample->residency->manager == this) {
+					Detach(*sample->residency, true);
+				}
+			}
+			RemoveEmptyBanks();
+		}
+
+		auto Pin(const SfSample& smpl) -> bool {
+			std::lock_guard lock(mutex);
+			Entry* entry = EntryOf(smpl);
+			if (!entry) {
+				return true;
+			}
+			if (!FaultIn(*entry)) {
+				return false;
+			}
+			if (entry->pins.load(std::memory_order_relaxed) == 0) {
+				Unlink(*entry);
+				stats.pinned_bytes += entry->size;
+			}
+			entry->pins.fetch_add(1, std::memory_order_release);
+			return true;
+		}
+
+		void Unpin(const SfSample& smpl) {
+			std::lock_guard lock(mutex);
+			Entry* entry = EntryOf(smpl);
+			if (!entry || entry->pins.load(std::memory_order_relaxed) == 0) {
+				return;
+			}
+			if (entry->pins.fetch_sub(1, std::memory_order_release) == 1) {
+				stats.pinned_bytes -= entry->size;
+				Link(*entry);
+				MakeRoom(0);
+			}
+		}
+
+		void SetBudget(std::size_t new_budget) {
+			std::lock_guard lock(mutex);
+			budget = new_budget;
+			MakeRoom(0);
+		}
+
+		// the hooks of SfSample(see sfsampleimpl.hpp)
+		auto Access(Entry& entry) noexcept -> std::span<const BYTE> {
+			std::lock_guard lock(mutex);
+			if (!FaultIn(entry)) {
+				return {};
+			}
+			return entry.sample->wav_data;
+		}
+
+		void Read(Entry& entry, std::size_t offset, std::span<BYTE> out) noexcept {
+			std::lock_guard lock(mutex);
+			const auto& wav = entry.sample->wav_data;
+			if (FaultIn(entry) && offset <= wav.size() && out.size() <= wav.size() - offset) {
+				std::memcpy(out.data(), wav.data() + offset, out.size());
+			} else {
+				std::memset(out.data(), 0, out.size());
+			}
+		}
+
+		void Edit(Entry& entry, const std::function<void()>& edit) {
+			std::lock_guard lock(mutex);
+			edit();
+			SfSampleImpl& sample = *entry.sample;
+			Unlink(entry);
+			if (entry.resident) {
+				stats.resident_bytes -= entry.size;
+			}
+			const bool pinned = entry.pins.load(std::memory_order_relaxed) > 0;
+			if (pinned) {
+				stats.pinned_bytes -= entry.size;
+			}
+			if (sample.wav_source) {
+				// the points come from the source from now on
+				entry.resident = false;
+				Erase(entry);
+				RemoveEmptyBanks();
+				return;
+			}
+			// the new points are resident, and only ever in the spill file from now on
+			entry.size = sample.wav_data.size();
+			entry.resident = true;
+			entry.in_file = false;
+			entry.spilled = false;
+			if (pinned) {
+				stats.pinned_bytes += entry.size;
+			}
+			MakeRoom(entry.size);
+			stats.resident_bytes += entry.size;
+			if (!pinned) {
+				Link(entry);
+			}
+		}
+
+		void Forget(Entry& entry) noexcept {
+			std::lock_guard lock(mutex);
+			Unlink(entry);
+			if (entry.resident) {
+				stats.resident_bytes -= entry.size;
+			}
+			if (entry.pins.load(std::memory_order_relaxed) > 0) {
+				stats.pinned_bytes -= entry.size;
+			}
+			Erase(entry);
+			RemoveEmptyBanks();
+		}
+
+		std::pmr::memory_resource* resource;
+		mutable std::mutex mutex;
+		std::size_t budget;
+		SfResidencyStats stats;
+
+	private:
+		static auto SampleOf(const SfSample& smpl) noexcept -> SfSampleImpl* {
+			return smpl.pimpl.get();
+		}
+
+		auto EntryOf(const SfSample& smpl) const noexcept -> Entry* {
+			Entry* entry = SampleOf(smpl)->residency;
+			return entry && entry->manager == this ? entry : nullptr;
+		}
+
+		// finds the range of the sdta chunk the points were loaded from(sample handles are shdr indices after Load)
+		static void LocateInFile(Entry& entry, const SoundFontView& view, const BYTE* base) {
+			const SfSampleImpl& sample = *entry.sample;
+			const std::size_t index = sample.self_handle.value;
+			if (index >= view.SampleCount() || view.GetBitDepth() != sample.sample_bit_depth || entry.size == 0) {
+				return;
+			}
+			const auto smpl = view.SampleData(index);
+			const std::size_t points = smpl.size() / 2;
+			if (points * sample.PointSize() != entry.size) {
+				return;
+			}
+			if (sample.sample_bit_depth == SampleBitDepth::Signed24) {
+				const auto sm24 = view.SampleData24(index);
+				if (sm24.size() != points) {
+					return;
+				}
+				entry.sm24_offset = static_cast<std::uint64_t>(sm24.data() - base);
+			}
+			entry.smpl_offset = static_cast<std::uint64_t>(smpl.data() - base);
+			entry.in_file = true;
+		}
+
+		void Link(Entry& entry) noexcept {
+			if (entry.linked || !entry.resident || entry.pins.load(std::memory_order_relaxed) > 0) {
+				return;
+			}
+			entry.older = newest;
+			entry.newer = nullptr;
+			(newest ? newest->newer : oldest) = &entry;
+			newest = &entry;
+			entry.linked = true;
+		}
+
+		void Unlink(Entry& entry) noexcept {
+			if (!entry.linked) {
+				return;
+			}
+			(entry.older ? entry.older->newer : oldest) = entry.newer;
+			(entry.newer ? entry.newer->older : newest) = entry.older;
+			entry.older = entry.newer = nullptr;
+			entry.linked = false;
+		}
+
+		// evicts the least recently used entries until incoming more bytes fit in the budget
+		void MakeRoom(std::size_t incoming) noexcept {
+			for (Entry* entry = oldest; entry && stats.resident_bytes + incoming > budget; ) {
+				Entry* next = entry->newer;
+				Evict(*entry);  // entries that cannot be spilled stay resident
+				entry = next;
+			}
+		}
+
+		auto FaultIn(Entry& entry) noexcept -> bool {
+			if (entry.resident) {
+				stats.hits++;
+				if (entry.linked) {
+					Unlink(entry);
+					Link(entry);
+				}
+				return true;
+			}
+			stats.misses++;
+			trace::Scope trace("FaultIn", "bytes", static_cast<std::int64_t>(entry.size));
+			MakeRoom(entry.size);
+			if (!ReadBack(entry, entry.sample->wav_data)) {
+				stats.failed_reads++;
+				return false;
+			}
+			entry.resident = true;
+			stats.resident_bytes += entry.size;
+			stats.bytes_read += entry.size;
+			Link(entry);
+			return true;
+		}
+
+		void Evict(Entry& entry) noexcept {
+			if (!entry.in_file && !entry.spilled && !Spill(entry)) {
+				return;
+			}
+			Unlink(entry);
+			std::pmr::vector<BYTE>(entry.sample->wav_data.get_allocator()).swap(entry.sample->wav_data);
+			entry.resident = false;
+			stats.resident_bytes -= entry.size;
+			stats.evictions++;
+		}
+
+		auto Spill(Entry& entry) noexcept -> bool {
+			trace::Scope trace("Spill", "bytes", static_cast<std::int64_t>(entry.size));
+			try {
+				if (!spill.is_open()) {
+					// one file per manager, named after the manager and the time it was first needed
+					spill_path = spill_dir / ("sf2ml-" + std::to_string(reinterpret_cast<std::uintptr_t>(this)) + "-"
+											  + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+											  + ".spill");
+					spill.open(spill_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+					if (!spill.is_open()) {
+						return false;
+					}
+				}
+				if (entry.spill_capacity < entry.size) {
+					entry.spill_offset = spill_end;
+					entry.spill_capacity = entry.size;
+					spill_end += entry.size;
+				}
+				spill.seekp(static_cast<std::streamoff>(entry.spill_offset));
+				spill.write(reinterpret_cast<const char*>(entry.sample->wav_data.data()), static_cast<std::streamsize>(entry.size));
+				if (!spill) {
+					spill.clear();
+					return false;
+				}
+			} catch (...) {
+				return false;
+			}
+			entry.spilled = true;
+			stats.spills++;
+			stats.bytes_spilled += entry.size;
+			return true;
+		}
+
+		auto ReadBack(Entry& entry, std::pmr::vector<BYTE>& dst) noexcept -> bool {
+			try {
+				if (entry.in_file) {
+					return ReadFromFile(entry, dst);
+				}
+				if (entry.spilled) {
+					dst.resize(entry.size);
+					spill.seekg(static_cast<std::streamoff>(entry.spill_offset));
+					if (!spill.read(reinterpret_cast<char*>(dst.data()), static_cast<std::streamsize>(entry.size))) {
+						spill.clear();
+						return false;
+					}
+					return true;
+				}
+			} catch (...) {
+			}
+			return false;
+		}
+
+		auto ReadFromFile(Entry& entry, std::pmr::vector<BYTE>& dst) -> bool {
+			Bank& bank = *entry.bank;
+			if (!bank.file.is_open() && !bank.stale) {
+				std::error_code ec;
+				bank.stale = std::filesystem::file_size(bank.path, ec) != bank.file_size
+							 || std::filesystem::last_write_time(bank.path, ec) != bank.file_time || ec;
+				if (!bank.stale) {
+					bank.file.open(bank.path, std::ios::binary);
+				}
+			}
+			if (bank.stale || !bank.file.is_open()) {
+				return false;
+			}
+			auto read = [&bank](std::uint64_t offset, BYTE* out, std::size_t size) {
+				bank.file.seekg(static_cast<std::streamoff>(offset));
+				if (!bank.file.read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(size))) {
+					bank.file.clear();
+					return false;
+				}
+				return true;
+			};
+
+			const std::size_t points = entry.size / entry.sample->PointSize();
+			dst.resize(entry.size);
+			if (entry.sample->sample_bit_depth == SampleBitDepth::Signed16) {
+				return read(entry.smpl_offset, dst.data(), entry.size);
+			}
+			// 24-bit points: the upper 16 bits from smpl, the lower 8 bits from sm24
+			scratch.resize(points * 3);
+			if (!read(entry.smpl_offset, scratch.data(), points * 2) || !read(entry.sm24_offset, scratch.data() + points * 2, points)) {
+				return false;
+			}
+			for (std::size_t i = 0; i < points; i++) {
+				dst[3 * i + 0] = scratch[points * 2 + i];
+				dst[3 * i + 1] = scratch[2 * i + 0];
+				dst[3 * i + 2] = scratch[2 * i + 1];
+			}
+			return true;
+		}
+
+		// stops managing the sample, reading its points back first if restore is set
+		void Detach(Entry& entry, bool restore) noexcept {
+			Unlink(entry);
+			if (entry.resident) {
+				stats.resident_bytes -= entry.size;
+			} else if (restore && !ReadBack(entry, entry.sample->wav_data)) {
+				stats.failed_reads++;
+			}
+			if (entry.pins.load(std::memory_order_relaxed) > 0) {
+				stats.pinned_bytes -= entry.size;
+			}
+			Erase(entry);
+		}
+
+		void Erase(Entry& entry) noexcept {
+			entry.sample->residency = nullptr;
+			stats.managed_samples--;
+			entry.bank->entries.erase(entry.sample);
+		}
+
+		void RemoveEmptyBanks() noexcept {
+			banks.remove_if([](const Bank& bank) { return bank.entries.empty(); });
+		}
+
+		std::filesystem::path spill_dir;
+		std::filesystem::path spill_path;
+		std::fstream spill;
+		std::uint64_t spill_end = 0;
+		std::pmr::list<Bank> banks;
+		Entry* oldest = nullptr;
+		Entry* newest = nullptr;
+		std::pmr::vector<BYTE> scratch;  // 24-bit points read back from the bank file
+	};
+}
+
+auto SF2ML::residency::Access(const SfSampleImpl& smpl) noexcept -> std::span<const BYTE> {
+	return smpl.residency->manager->Access(*smpl.residency);
+}
+
+void SF2ML::residency::Read(const SfSampleImpl& smpl, std::size_t offset, std::span<BYTE> out) noexcept {
+	smpl.residency->manager->Read(*smpl.residency, offset, out);
+}
+
+auto SF2ML::residency::IsPinned(const Entry& entry) noexcept -> bool {
+	return entry.pins.load(std::memory_order_acquire) > 0;
+}
+
+auto SF2ML::residency::Size(const Entry& entry) noexcept -> std::size_t {
+	return entry.size.load(std::memory_order_relaxed);
+}
+
+void SF2ML::residency::Edit(SfSampleImpl& smpl, const std::function<void()>& edit) {
+	smpl.residency->manager->Edit(*smpl.residency, edit);
+}
+
+void SF2ML::residency::Forget(SfSampleImpl& smpl) noexcept {
+	smpl.residency->manager->Forget(*smpl.residency);
+}
+
+SfResidencyManager::SfResidencyManager(std::size_t budget,
+									   const std::filesystem::path& spill_dir,
+									   std::pmr::memory_resource* resource) {
+	pimpl = MakePmrUnique<SfResidencyManagerImpl>(resource, budget, spill_dir, resource);
+}
+
+SfResidencyManager::~SfResidencyManager() {}
+
+auto SfResidencyManager::Manage(SoundFont& sf2, const std::filesystem::path& sf2_path) -> SF2MLError {
+	trace::Scope trace("Manage");
+	FileMapping mapping;
+	if (auto err = MapFile(sf2_path, mapping)) {
+		return err;
+	}
+	SoundFontView view;
+	SF2MLError err = view.Open({ static_cast<const BYTE*>(mapping.address), mapping.size });
+	if (!err) {
+		pimpl->ManageSamples(sf2, sf2_path, &view, static_cast<const BYTE*>(mapping.address));
+	}
+	view.Close();
+	UnmapFile(mapping);
+	return err;
+}
+
+void SfResidencyManager::Manage(SoundFont& sf2) {
+	pimpl->ManageSamples(sf2, {}, nullptr, nullptr);
+}
+
+void SfResidencyManager::Release(SoundFont& sf2) {
+	pimpl->Release(sf2);
+}
+
+auto SfResidencyManager::Pin(const SfSample& smpl) -> bool {
+	return pimpl->Pin(smpl);
+}
+
+void SfResidencyManager::Unpin(const SfSample& smpl) {
+	pimpl->Unpin(smpl);
+}
+
+auto SfResidencyManager::PinPreset(SoundFont& sf2, PresetHandle preset) -> std::pmr::vector<SmplHandle> {
+	const SoundFontRtView view = sf2.GetRtView();
+	std::pmr::vector<SmplHandle> smpls(pimpl->resource);
+	if (const SfPreset* rec = view.GetPreset(preset)) {
+		for (const SfPresetZone& zone : rec->Zones()) {
+			const auto inst = zone.GetInstrument();
+			const SfInstrument* inst_rec = inst ? view.GetInstrument(*inst) : nullptr;
+			if (!inst_rec) {
+				continue;
+			}
+			for (const SfInstrumentZone& inst_zone : inst_rec->Zones()) {
+				if (auto smpl = inst_zone.GetSample(); smpl && std::find(smpls.begin(), smpls.end(), *smpl) == smpls.end()) {
+					smpls.push_back(*smpl);
+				}
+			}
+		}
+	}
+	std::erase_if(smpls, [&](SmplHandle smpl) {
+		const SfSample* rec = view.GetSample(smpl);
+		return !rec || !pimpl->Pin(*rec);
+	});
+	return smpls;
+}
+
+void SfResidencyManager::Unpin(SoundFont& sf2, std::span<const SmplHandle> smpls) {
+	const SoundFontRtView view = sf2.GetRtView();
+	for (SmplHandle smpl : smpls) {
+		if (const SfSample* rec = view.GetSample(smpl)) {
+			pimpl->Unpin(*rec);
+		}
+	}
+}
+
+auto SfResidencyManager::GetBudget() const -> std::size_t {
+	std::lock_guard lock(pimpl->mutex);
+	return pimpl->budget;
+}
+
+void SfResidencyManager::SetBudget(std::size_t budget) {
+	pimpl->SetBudget(budget);
+}
+
+auto SfResidencyManager::GetStats() const -> SfResidencyStats {
+	std::lock_guard lock(pimpl->mutex);
+	return pimpl->stats;
+}
+
+void SfResidencyManager::ResetStats() {
+	std::lock_guard lock(pimpl->mutex);
+	SfResidencyStats& stats = pimpl->stats;
+	stats = { .resident_bytes = stats.resident_bytes, .pinned_bytes = stats.pinned_bytes, .managed_samples = stats.managed_samples };
+}
@@ -1,33 +1,26 @@
 #include <sfsample.hpp>
+#include "sfobserver.hpp"
+#include "sfsampleimpl.hpp"
 
 #include <cassert>
+#include <cstring>
 
 using namespace SF2ML;
 
-namespace SF2ML {
-	class SfSampleImpl {
-		friend SfSample;
-
-		const SmplHandle self_handle;
-		const SampleBitDepth sample_bit_depth;
-
-		char sample_name[21] {};
-		std::vector<BYTE> wav_data {};
-		DWORD sample_rate = 0;
-		DWORD start_loop = 0;
-		DWORD end_loop = 0;
-		BYTE root_key = 60;
-		CHAR pitch_correction = 0;
-		SmplHandle linked_sample { 0 };
-		SFSampleLink sample_type = monoSample;
-	public:
-		SfSampleImpl(SmplHandle handle, SampleBitDepth bit_depth)
-			: self_handle{handle}, sample_bit_depth{bit_depth} {}
-	};
+namespace {
+	// edits of the points of a managed sample go through its residency manager
+	template <typename F>
+	void EditWav(SfSampleImpl& impl, bool managed, F&& edit) {
+		if (managed) {
+			residency::Edit(impl, edit);
+		} else {
+			edit();
+		}
+	}
 }
 
-SfSample::SfSample(SmplHandle handle, SampleBitDepth bit_depth) {
-	pimpl = std::make_unique<SfSampleImpl>(handle, bit_depth);
+SfSample::SfSample(SmplHandle handle, SampleBitDepth bit_depth, std::pmr::memory_resource* resource) {
+	pimpl = MakePmrUnique<SfSampleImpl>(resource, handle, bit_depth, resource);
 }
 
 SfSample::~SfSample() {
@@ -44,7 +37,11 @@ SfSample& SfSample::operator=(SfSample&& rhs) noexcept {
 }
 
 SfSample& SfSample::SetName(std::string_view name) {
-	std::memcpy(pimpl->sample_name, &name[0], std::min<std::size_t>(name.length(), 20));
+	std::memset(pimpl->sample_name, 0, 21);
+	std::memcpy(pimpl->sample_name, name.data(), std::min<std::size_t>(name.length(), 20));
+	if (pimpl->observer) {
+		pimpl->observer->OnSampleRenamed(pimpl->self_handle);
+	}
 	return *this;
 }
 
@@ -103,13 +100,39 @@ SfSample& SfSample::SetSampleRate(std::uint32_t smpl_rate) {
 	return *this;
 }
 
-SfSample& SfSample::SetWav(std::vector<BYTE>&& wav) noexcept {
-	pimpl->wav_data = std::move(wav);
+SfSample& SfSample::SetWav(std::pmr::vector<BYTE>&& wav) {
+	// the buffer is adopted only if it lives in the same memory resource (copied otherwise)
+	EditWav(*pimpl, pimpl->residency != nullptr, [&] {
+		pimpl->wav_data = std::move(wav);
+		pimpl->wav_source = nullptr;
+	});
+	if (pimpl->observer) {
+		pimpl->observer->OnSampleChanged(pimpl->self_handle);
+	}
+	return *this;
+}
+
+SfSample& SfSample::SetWav(std::span<const BYTE> wav) {
+	EditWav(*pimpl, pimpl->residency != nullptr, [&] {
+		pimpl->wav_data.assign(wav.begin(), wav.end());
+		pimpl->wav_source = nullptr;
+	});
+	if (pimpl->observer) {
+		pimpl->observer->OnSampleChanged(pimpl->self_handle);
+	}
 	return *this;
 }
 
-SfSample& SfSample::SetWav(const std::vector<BYTE>& wav) {
-	pimpl->wav_data = wav;
+SfSample& SfSample::SetWavSource(std::uint32_t count, SfWavSource source) {
+	EditWav(*pimpl, pimpl->residency != nullptr, [&] {
+		pimpl->wav_data.clear();
+		pimpl->wav_data.shrink_to_fit();
+		pimpl->wav_source = std::move(source);
+		pimpl->source_count = pimpl->wav_source ? count : 0;
+	});
+	if (pimpl->observer) {
+		pimpl->observer->OnSampleChanged(pimpl->self_handle);
+	}
 	return *this;
 }
 
@@ -121,21 +144,60 @@ std::string SfSample::GetName() const {
 	return pimpl->sample_name;
 }
 
-const std::vector<BYTE>& SfSample::GetWav() const {
+std::span<const BYTE> SfSample::GetWav() const {
+	if (pimpl->residency && !residency::IsPinned(*pimpl->residency)) {
+		return residency::Access(*pimpl);
+	}
 	return pimpl->wav_data;
 }
 
+std::span<const BYTE> SfSample::GetResidentWav() const noexcept {
+	if (pimpl->residency && !residency::IsPinned(*pimpl->residency)) {
+		return {};
+	}
+	return pimpl->wav_data;
+}
+
+void SfSample::ReadWav(std::uint32_t first, std::span<BYTE> out) const {
+	if (pimpl->wav_source) {
+		pimpl->wav_source(first, out);
+	} else if (pimpl->residency && !residency::IsPinned(*pimpl->residency)) {
+		residency::Read(*pimpl, first * pimpl->PointSize(), out);
+	} else {
+		std::memcpy(out.data(), &pimpl->wav_data[first * pimpl->PointSize()], out.size());
+	}
+}
+
+bool SfSample::HasWavSource() const {
+	return static_cast<bool>(pimpl->wav_source);
+}
+
+bool SfSample::IsManaged() const {
+	return pimpl->residency != nullptr;
+}
+
 int32_t SfSample::GetSampleAt(uint32_t pos) const {
 	int32_t res = 0;
-	if (pimpl->sample_bit_depth == SampleBitDepth::Signed16) {
-		std::memcpy(&res, &pimpl->wav_data[pos * 2], 2);
+	const std::size_t size = pimpl->PointSize();
+	if (pimpl->wav_source) {
+		BYTE point[3];
+		pimpl->wav_source(pos, std::span<BYTE>(point, size));
+		std::memcpy(&res, point, size);
+	} else if (pimpl->residency && !residency::IsPinned(*pimpl->residency)) {
+		residency::Read(*pimpl, pos * size, std::span<BYTE>(reinterpret_cast<BYTE*>(&res), size));
 	} else {
-		std::memcpy(&res, &pimpl->wav_data[pos * 3], 3);
+		std::memcpy(&res, &pimpl->wav_data[pos * size], size);
 	}
 	return res;
 }
 
 std::size_t SfSample::GetSampleCount() const {
+	if (pimpl->wav_source) {
+		return pimpl->source_count;
+	}
+	if (pimpl->residency) {
+		return residency::Size(*pimpl->residency) / pimpl->PointSize();
+	}
 	if (pimpl->sample_bit_depth == SampleBitDepth::Signed16) {
 		return pimpl->wav_data.size() / 2;
 	} else {
@@ -178,4 +240,8 @@ SampleBitDepth SfSample::GetBitDepth() const {
 SF2MLError SfSample::Serialize(std::ofstream& ofs) const {
 	assert(false && "Not Implemented");
 	return SF2MLError();
-}
\ No newline at end of file
+}
+
+void SfSample::Attach(SfObserver* observer) {
+	pimpl->observer = observer;
+}
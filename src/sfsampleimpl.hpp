@@ -0,0 +1,78 @@
+#ifndef SF2ML_SFSAMPLEIMPL_HPP_
+#define SF2ML_SFSAMPLEIMPL_HPP_
+
+#include <sfsample.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace SF2ML {
+	class SfSampleImpl;
+
+	// Hooks of SfSample into the SfResidencyManager managing its points(see sfresidency.cpp).
+	// They are only called for samples whose residency entry is set.
+	namespace residency {
+		struct Entry;
+
+		// makes the points of smpl resident(reading them back if they were evicted), as the most recently used;
+		// the span is taken under the lock(empty when the points cannot be read back)
+		auto Access(const SfSampleImpl& smpl) noexcept -> std::span<const BYTE>;
+		// same as Access, then copies the bytes [offset, offset + out.size()) of the points into out(zeros if
+		// they cannot be read back); under the lock, so that the points cannot be evicted while they are copied
+		void Read(const SfSampleImpl& smpl, std::size_t offset, std::span<BYTE> out) noexcept;
+		// pinned samples stay resident: their points are read without the lock of the manager
+		auto IsPinned(const Entry& entry) noexcept -> bool;
+		// size of the points in bytes, resident or not
+		auto Size(const Entry& entry) noexcept -> std::size_t;
+		// runs edit, which replaces the points of smpl, under the lock of the manager, then accounts for the new points
+		void Edit(SfSampleImpl& smpl, const std::function<void()>& edit);
+		// smpl is being destroyed
+		void Forget(SfSampleImpl& smpl) noexcept;
+	}
+
+	class SfSampleImpl {
+		friend SfSample;
+		friend class SfResidencyManagerImpl;
+		friend auto residency::Access(const SfSampleImpl&) noexcept -> std::span<const BYTE>;
+		friend void residency::Read(const SfSampleImpl&, std::size_t, std::span<BYTE>) noexcept;
+		friend void residency::Edit(SfSampleImpl&, const std::function<void()>&);
+		friend void residency::Forget(SfSampleImpl&) noexcept;
+
+		const SmplHandle self_handle;
+		const SampleBitDepth sample_bit_depth;
+
+		char sample_name[21] {};
+		std::pmr::vector<BYTE> wav_data;
+		SfWavSource wav_source;  // replaces wav_data when set
+		DWORD source_count = 0;
+		DWORD sample_rate = 0;
+		DWORD start_loop = 0;
+		DWORD end_loop = 0;
+		BYTE root_key = 60;
+		CHAR pitch_correction = 0;
+		SmplHandle linked_sample { 0 };
+		SFSampleLink sample_type = monoSample;
+		SfObserver* observer = nullptr;
+		// set while an SfResidencyManager manages wav_data(which is empty while the points are evicted)
+		residency::Entry* residency = nullptr;
+	public:
+		SfSampleImpl(SmplHandle handle, SampleBitDepth bit_depth, std::pmr::memory_resource* resource)
+			: self_handle{handle}, sample_bit_depth{bit_depth}, wav_data(resource) {}
+		~SfSampleImpl() {
+			if (residency) {
+				residency::Forget(*this);
+			}
+		}
+		SfSampleImpl(const SfSampleImpl&) = delete;
+		SfSampleImpl& operator=(const SfSampleImpl&) = delete;
+
+		std::size_t PointSize() const noexcept {
+			return sample_bit_depth == SampleBitDepth::Signed16 ? 2 : 3;
+		}
+	};
+}
+
+#endif
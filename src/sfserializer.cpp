@@ -1,14 +1,23 @@
 #include "sfserializer.hpp"
+#include "sfparallel.hpp"
+#include "sftracing.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <memory_resource>
+#include <span>
 
 SF2ML::DWORD CalculateInfoSize(const SF2ML::SfInfo& infos) {
 	using namespace SF2ML;
+	// terminated by at least one zero, padded to an even size
 	auto sizeof_zstr_ck = [](const auto& zstr) -> DWORD {
-		return sizeof(ChunkHead) + zstr.length() + 1;
+		return sizeof(ChunkHead) + ((zstr.length() + 2) & ~std::size_t(1));
 	};
 	
-	auto sizeof_opt_zstr_ck = []<typename T>(const std::optional<T> zstr_opt) -> DWORD {
+	auto sizeof_opt_zstr_ck = [&]<typename T>(const std::optional<T> zstr_opt) -> DWORD {
 		if (zstr_opt) {
-			return sizeof(ChunkHead) + zstr_opt->length() + 1;
+			return sizeof_zstr_ck(*zstr_opt);
 		} else {
 			return 0;
 		}
@@ -28,167 +37,247 @@ SF2ML::DWORD CalculateInfoSize(const SF2ML::SfInfo& infos) {
 		+ sizeof_opt_zstr_ck(infos.GetToolUsed());
 }
 
-SF2ML::DWORD CalculatePresetSize(const SF2ML::PresetContainer& presets) {
+// size of the 4 chunks of presets(phdr/pbag/pmod/pgen) or instruments(inst/ibag/imod/igen)
+template <typename HeaderT>
+SF2ML::DWORD CalculateHydraSize(SF2ML::DWORD count, const SF2ML::serializer::HydraCounts& records) {
 	using namespace SF2ML;
-	DWORD pdhr_ck_size = sizeof(ChunkHead) + (presets.Count() + 1) * sizeof(spec::SfPresetHeader);
-	DWORD pbag_ck_size = sizeof(ChunkHead);
-	DWORD pmod_ck_size = sizeof(ChunkHead);
-	DWORD pgen_ck_size = sizeof(ChunkHead);
-
-	DWORD bag_count = 0;
-	for (const SfPreset& preset : presets) {
-		preset.ForEachZone([&](const SfPresetZone& zone) {
-			if (!zone.IsEmpty()) {
-				bag_count++;
-				pgen_ck_size += zone.GeneratorCount() * sizeof(spec::SfInstGenList);
-				pmod_ck_size += zone.ModulatorCount() * sizeof(spec::SfInstModList);
-			}
-		});
-	}
-	
-	pbag_ck_size += (bag_count + 1) * sizeof(spec::SfPresetBag);
-	pgen_ck_size += sizeof(spec::SfGenList);
-	pmod_ck_size += sizeof(spec::SfModList);
-
-	return pdhr_ck_size + pbag_ck_size + pmod_ck_size + pgen_ck_size;
+	// the preset and instrument variants of the bag/mod/gen records have the same size
+	static_assert(sizeof(spec::SfPresetBag) == sizeof(spec::SfInstBag));
+	static_assert(sizeof(spec::SfModList) == sizeof(spec::SfInstModList));
+	static_assert(sizeof(spec::SfGenList) == sizeof(spec::SfInstGenList));
+	// every chunk ends with a terminal record
+	return sizeof(ChunkHead) + (count + 1) * sizeof(HeaderT)
+		 + sizeof(ChunkHead) + (records.bags + 1) * sizeof(spec::SfPresetBag)
+		 + sizeof(ChunkHead) + (records.mods + 1) * sizeof(spec::SfModList)
+		 + sizeof(ChunkHead) + (records.gens + 1) * sizeof(spec::SfGenList);
 }
 
-SF2ML::DWORD CalculateInstSize(const SF2ML::InstContainer& insts) {
+// (in 64 bits, as the sample data of a bank can exceed what a DWORD holds)
+std::uint64_t CalculateSdtaSize(SF2ML::DWORD sample_count, const SF2ML::serializer::SdtaCounts& data, unsigned z_zone) {
 	using namespace SF2ML;
-	DWORD inst_ck_size = sizeof(ChunkHead) + (insts.Count() + 1) * sizeof(spec::SfInst);
-	DWORD ibag_ck_size = sizeof(ChunkHead);
-	DWORD imod_ck_size = sizeof(ChunkHead);
-	DWORD igen_ck_size = sizeof(ChunkHead);
+	// every sample is followed by z_zone bytes of zeros in smpl, and z_zone/2 in sm24
+	const bool is_24bit = data.signed24 > 0;
+	std::uint64_t sample16_sz = data.frames * 2 + std::uint64_t(sample_count) * z_zone;
+	std::uint64_t sample24_sz = is_24bit ? data.frames + std::uint64_t(sample_count) * (z_zone / 2) : 0;
 
-	DWORD bag_count = 0;
-	for (const SfInstrument& inst : insts) {
-		inst.ForEachZone([&](const SfInstrumentZone& zone) {
-			if (!zone.IsEmpty()) {
-				bag_count++;
-				igen_ck_size += zone.GeneratorCount() * sizeof(spec::SfInstGenList);
-				imod_ck_size += zone.ModulatorCount() * sizeof(spec::SfInstModList);
-			}
-		});
+	std::uint64_t smpl_size = sizeof(ChunkHead) + sample16_sz;
+	std::uint64_t sm24_size = is_24bit ? sizeof(ChunkHead) + sample24_sz : 0;
+	if (sm24_size % 2 == 1) {
+		sm24_size++;
 	}
-	
-	ibag_ck_size += (bag_count + 1) * sizeof(spec::SfInstBag);
-	igen_ck_size += sizeof(spec::SfInstGenList);
-	imod_ck_size += sizeof(spec::SfModList);
 
-	return inst_ck_size + ibag_ck_size + imod_ck_size + igen_ck_size;
+	std::uint64_t sdta_size = sizeof(ChunkHead) + sizeof(FOURCC) + smpl_size + sm24_size;
+	return sdta_size;
 }
 
-SF2ML::DWORD CalculateShdrSize(const SF2ML::SmplContainer& smpls, unsigned z_zone) {
+SF2ML::DWORD CalculatePdtaSize(const SF2ML::serializer::RiffCounts& counts) {
 	using namespace SF2ML;
-	return sizeof(ChunkHead) + (smpls.Count() + 1) * sizeof(spec::SfSample);
+	return sizeof(ChunkHead) + sizeof(FOURCC)
+		 + CalculateHydraSize<spec::SfPresetHeader>(counts.presets, counts.preset_records)
+		 + CalculateHydraSize<spec::SfInst>(counts.insts, counts.inst_records)
+		 + sizeof(ChunkHead) + (counts.samples + 1) * sizeof(spec::SfSample);
 }
 
-SF2ML::DWORD CalculateSdtaSize(const SF2ML::SmplContainer& smpls, unsigned z_zone) {
-	using namespace SF2ML;
-	DWORD sample16_sz = 0;
-	DWORD sample24_sz = 0;
-
-	SampleBitDepth bit_depth = GetBitDepth(smpls);
-
-	for (const auto& sample : smpls) {
-		if (bit_depth == SampleBitDepth::Signed16) {
-			sample16_sz += sample.GetSampleCount() * 2 + z_zone;
-		} else {
-			sample16_sz += sample.GetSampleCount() * 2 + z_zone;
-			sample24_sz += sample.GetSampleCount() + z_zone / 2;
-		}
-	}
-
-	DWORD smpl_size = sizeof(ChunkHead) + sample16_sz;
-	DWORD sm24_size = (bit_depth == SampleBitDepth::Signed24) ? sizeof(ChunkHead) + sample24_sz : 0;
-	if (sm24_size % 2 == 1) {
-		sm24_size++;
-	}
+auto SF2ML::serializer::CalculateRiffSize(const SfInfo& infos, const RiffCounts& counts, unsigned z_zone) -> std::uint64_t {
+	DWORD info_size = CalculateInfoSize(infos);
+	std::uint64_t sdta_size = CalculateSdtaSize(counts.samples, counts.sample_data, z_zone);
+	DWORD pdta_size = CalculatePdtaSize(counts);
 
-	DWORD sdta_size = sizeof(ChunkHead) + sizeof(FOURCC) + smpl_size + sm24_size;
-	return sdta_size;
+	return sizeof(ChunkHead) + sizeof(FOURCC) + info_size + sdta_size + pdta_size;
 }
 
 auto SF2ML::serializer::CalculateRiffSize(const SfInfo& infos,
 										  const PresetContainer& presets,
 										  const InstContainer& insts,
 										  const SmplContainer& smpls,
-										  unsigned z_zone) -> SF2ML::DWORD {
+										  unsigned z_zone) -> std::uint64_t {
+	static_cast<void>(GetBitDepth(smpls)); // throws on mixed bit depths, as the serializer does
 
-	DWORD info_size = CalculateInfoSize(infos);
-	DWORD sdta_size = CalculateSdtaSize(smpls, z_zone);
-	DWORD pdta_size = sizeof(ChunkHead) + sizeof(FOURCC)
-					+ CalculatePresetSize(presets)
-					+ CalculateInstSize(insts)
-					+ CalculateShdrSize(smpls, z_zone);
-
-	return sizeof(ChunkHead) + sizeof(FOURCC) + info_size + sdta_size + pdta_size;
+	RiffCounts counts;
+	counts.presets = presets.Count();
+	for (const SfPreset& preset : presets) {
+		counts.preset_records += CountRecords(preset);
+	}
+	counts.insts = insts.Count();
+	for (const SfInstrument& inst : insts) {
+		counts.inst_records += CountRecords(inst);
+	}
+	counts.samples = smpls.Count();
+	for (const SfSample& smpl : smpls) {
+		counts.sample_data += CountRecords(smpl);
+	}
+	return CalculateRiffSize(infos, counts, z_zone);
 }
 
-auto SF2ML::serializer::SerializeRiff(BYTE* dst,
-									  BYTE** end,
-									  const SfInfo& infos,
-									  const PresetContainer& presets,
-									  const InstContainer& insts,
-									  const SmplContainer& smpls,
-									  unsigned z_zone)
-									  -> SF2ML::SF2MLError {
+namespace {
+	using namespace SF2ML;
 
-	BYTE* pos = dst;
-	
-	// serialize RIFF/*
-	std::memcpy(pos, "RIFF", 4);
-	BYTE* riff_ck_size_ptr = pos + 4;
-	std::memcpy(pos + 8, "sfbk", 4);
-	pos += 12;
-	BYTE* next = pos;
+	// checks that the modulators of the zone only link to modulators of the zone
+	template <typename ZoneT>
+	bool HasValidModulatorLinks(const ZoneT& zone) {
+		for (const SfModulator& mod : zone.Modulators()) {
+			auto dest = mod.GetDestination();
+			if (std::holds_alternative<ModHandle>(dest) && !zone.GetModIndex(std::get<ModHandle>(dest))) {
+				return false;
+			}
+		}
+		return true;
+	}
 
-	// serialize RIFF/INFO/*
-	if (auto err = SerializeInfos(pos, &next, infos)) {
-		return err;
+	// the headers and bags index the records with WORDs, the terminal records included
+	bool FitsWordIndexes(const serializer::HydraCounts& records) noexcept {
+		constexpr DWORD limit = std::numeric_limits<WORD>::max();
+		return records.bags <= limit && records.mods <= limit && records.gens <= limit;
 	}
-	pos = next;
+}
 
-	// serialize RIFF/sdta/*
-	if (auto err = SerializeSDTA(pos, &next, smpls, z_zone)) {
+auto SF2ML::serializer::ValidateReferences(const PresetContainer& presets,
+										   const InstContainer& insts,
+										   const SmplContainer& smpls,
+										   const RiffCounts& counts,
+										   const IdRemap<InstHandle>& inst_ids,
+										   const IdRemap<SmplHandle>& smpl_ids)
+										   -> SF2ML::SF2MLError {
+	trace::Scope trace("ValidateReferences");
+	if (!FitsWordIndexes(counts.preset_records) || !FitsWordIndexes(counts.inst_records)) {
+		return SF2ML_INDEX_OVERFLOW;
+	}
+	for (const SfPreset& preset : presets) {
+		for (const SfPresetZone& zone : preset.Zones()) {
+			if (zone.IsEmpty()) {
+				continue;
+			}
+			if (!HasValidModulatorLinks(zone)) {
+				return SF2ML_NO_SUCH_MODULATORS;
+			}
+			if (auto inst = zone.GetInstrument(); inst && !inst_ids.GetID(*inst)) {
+				return SF2ML_NO_SUCH_INSTRUMENT;
+			}
+		}
+	}
+	for (const SfInstrument& inst : insts) {
+		for (const SfInstrumentZone& zone : inst.Zones()) {
+			if (zone.IsEmpty()) {
+				continue;
+			}
+			if (!HasValidModulatorLinks(zone)) {
+				return SF2ML_NO_SUCH_MODULATORS;
+			}
+			if (auto smpl = zone.GetSample(); smpl && !smpl_ids.GetID(*smpl)) {
+				return SF2ML_NO_SUCH_SAMPLE;
+			}
+		}
+	}
+	for (const SfSample& smpl : smpls) {
+		if (!IsMonoSample(smpl.GetSampleMode()) && !(smpl.GetLink() && smpl_ids.GetID(*smpl.GetLink()))) {
+			return SF2ML_NO_SUCH_SAMPLE;
+		}
+	}
+	return SF2ML_SUCCESS;
+}
+
+template <bool Collect>
+auto SF2ML::serializer::WriteRiff(std::ostream& os,
+								  const SfInfo& infos,
+								  const PresetContainer& presets,
+								  const InstContainer& insts,
+								  const SmplContainer& smpls,
+								  const RiffCounts& counts,
+								  unsigned z_zone,
+								  std::pmr::memory_resource* resource,
+								  SfSaveStats* stats)
+								  -> SF2ML::SF2MLError {
+	trace::Scope trace("WriteRiff");
+	stats::Stopwatch<Collect, SfSaveStats> watch(stats);
+
+	// everything the chunks reference is checked before anything is written
+	const IdRemap<InstHandle> inst_ids(insts, resource);
+	const IdRemap<SmplHandle> smpl_ids(smpls, resource);
+	if (auto err = ValidateReferences(presets, insts, smpls, counts, inst_ids, smpl_ids)) {
 		return err;
 	}
-	pos = next;
+	// the size of the RIFF chunk is a DWORD
+	const std::uint64_t riff_size = CalculateRiffSize(infos, counts, z_zone);
+	if (riff_size - sizeof(ChunkHead) > std::numeric_limits<DWORD>::max()) {
+		return SF2ML_FILE_TOO_LARGE;
+	}
+	watch.Lap(&SfSaveStats::validate_ns);
 
-	// serialize RIFF/pdta/*
+	// serialize RIFF/pdta/* (the only chunk that can still fail)
+	std::pmr::vector<BYTE> pdta(CalculatePdtaSize(counts), resource);
+	BYTE* pos = pdta.data();
+	BYTE* next = pos;
 	std::memcpy(pos, "LIST", 4);
-	BYTE* pdta_ck_size_ptr = pos + 4;
+	DWORD pdta_ck_size = static_cast<DWORD>(pdta.size() - sizeof(ChunkHead));
+	std::memcpy(pos + 4, &pdta_ck_size, sizeof(DWORD));
 	std::memcpy(pos + 8, "pdta", 4);
 	pos += 12;
 
-	if (auto err = SerializePresets(pos, &next, presets, insts)) {
+	if (auto err = SerializePresets(pos, &next, presets, inst_ids)) {
 		return err;
 	}
 	pos = next;
-	if (auto err = SerializeInstruments(pos, &next, insts, smpls)) {
+	if (auto err = SerializeInstruments(pos, &next, insts, smpl_ids)) {
 		return err;
 	}
 	pos = next;
-	if (auto err = SerializeSHDR(pos, &next, smpls, z_zone)) {
+	if (auto err = SerializeSHDR(pos, &next, smpls, smpl_ids, z_zone)) {
 		return err;
 	}
 	pos = next;
-	
-	DWORD pdta_ck_size = pos - pdta_ck_size_ptr - 4;
-	std::memcpy(pdta_ck_size_ptr, &pdta_ck_size, sizeof(DWORD));
+	if (pos != pdta.data() + pdta.size()) {
+		return SF2ML_FAILED;
+	}
 
-	DWORD riff_ck_size = pos - riff_ck_size_ptr - 4;
-	std::memcpy(riff_ck_size_ptr, &riff_ck_size, sizeof(DWORD));
+	// serialize RIFF/* and RIFF/INFO/*
+	std::pmr::vector<BYTE> head(12 + CalculateInfoSize(infos), resource);
+	std::memcpy(head.data(), "RIFF", 4);
+	DWORD riff_ck_size = static_cast<DWORD>(riff_size - sizeof(ChunkHead));
+	std::memcpy(head.data() + 4, &riff_ck_size, sizeof(DWORD));
+	std::memcpy(head.data() + 8, "sfbk", 4);
+	if (auto err = SerializeInfos(head.data() + 12, &next, infos)) {
+		return err;
+	}
+	if (next != head.data() + head.size()) {
+		return SF2ML_FAILED;
+	}
+	watch.Lap(&SfSaveStats::serialize_ns);
+	os.write(reinterpret_cast<const char*>(head.data()), head.size());
+	watch.Lap(&SfSaveStats::write_ns);
 
-	if (end) {
-		*end = pos;
+	// serialize RIFF/sdta/*, straight to the stream
+	if (auto err = WriteSDTA(os, smpls, z_zone, resource)) {
+		return err;
+	}
+	watch.Lap(&SfSaveStats::sdta_ns);
+
+	os.write(reinterpret_cast<const char*>(pdta.data()), pdta.size());
+	watch.Lap(&SfSaveStats::write_ns);
+	if (!os) {
+		return SF2ML_FAILED;
+	}
+	if constexpr (Collect) {
+		stats->bytes_written = riff_size;
+		stats->sample_bytes = CalculateSdtaSize(counts.samples, counts.sample_data, z_zone);
+		for (const SfSample& smpl : smpls) {
+			if (smpl.HasWavSource()) {
+				stats->streamed_samples++;
+			}
+		}
 	}
-	
 	return SF2ML_SUCCESS;
 }
 
+template SF2ML::SF2MLError SF2ML::serializer::WriteRiff<false>(std::ostream&, const SfInfo&, const PresetContainer&,
+															   const InstContainer&, const SmplContainer&, const RiffCounts&,
+															   unsigned, std::pmr::memory_resource*, SfSaveStats*);
+template SF2ML::SF2MLError SF2ML::serializer::WriteRiff<true>(std::ostream&, const SfInfo&, const PresetContainer&,
+															  const InstContainer&, const SmplContainer&, const RiffCounts&,
+															  unsigned, std::pmr::memory_resource*, SfSaveStats*);
+
 
 auto SF2ML::serializer::SerializeInfos(BYTE* dst, BYTE** end, const SfInfo& src) -> SF2ML::SF2MLError {
+	trace::Scope trace("SerializeInfos");
 	BYTE* pos = dst;
 
 	std::memcpy(pos, "LIST", 4);
@@ -199,13 +288,13 @@ auto SF2ML::serializer::SerializeInfos(BYTE* dst, BYTE** end, const SfInfo& src)
 	auto serialize_zstr = [&pos](const char* fourcc, const std::string& name) {
 		std::memcpy(pos, fourcc, 4);
 		pos += 4;
-		DWORD len = name.length() + 1; // std::min<std::size_t>(name.length(), 255);
+		// chunks must have an even size: the terminating zero is doubled for even length strings
+		DWORD len = (name.length() + 2) & ~DWORD(1);
 		std::memcpy(pos, &len, sizeof(DWORD));
 		pos += 4;
-		std::memcpy(pos, name.c_str(), len-1);
-		pos += len-1;
-		*pos = 0;
-		pos++;
+		std::memcpy(pos, name.c_str(), name.length());
+		std::memset(pos + name.length(), 0, len - name.length());
+		pos += len;
 	};
 	auto serialize_vtag = [&pos](const char* fourcc, const VersionTag& vtag) {
 		std::memcpy(pos, fourcc, 4);
@@ -267,312 +356,270 @@ auto SF2ML::serializer::SerializeInfos(BYTE* dst, BYTE** end, const SfInfo& src)
 	return SF2ML_SUCCESS;
 }
 
-auto SF2ML::serializer::SerializePresets(BYTE* dst, BYTE** end,
-										 const PresetContainer& src,
-										 const InstContainer& inst_info) -> SF2ML::SF2MLError {
-	BYTE* pos = dst;
-
-	// serialize ./phdr
-	BYTE* const phdr_head = pos;
-	std::memcpy(phdr_head, "phdr", 4);
-	DWORD phdr_ck_size = (src.Count() + 1) * sizeof(spec::SfPresetHeader);
-	std::memcpy(phdr_head + 4, &phdr_ck_size, sizeof(DWORD));
-	pos += 8;
-	DWORD bag_idx = 0;
-	for (const SfPreset& preset : src) {
-		spec::SfPresetHeader bits {};
-		std::string name = preset.GetName();
-		std::memcpy(bits.ach_preset_name, name.c_str(), std::min<std::size_t>(name.length(), 20));
-		bits.w_preset_bag_ndx = bag_idx;
-		bits.w_preset = preset.GetPresetNumber();
-		bits.w_bank = preset.GetBankNumber();
-		std::memcpy(pos, &bits, sizeof(bits));
-		bag_idx += preset.CountZones();
-		pos += sizeof(bits);
-	}
-	spec::SfPresetHeader eop { "EOP" };
-	eop.w_preset_bag_ndx = bag_idx;
-	std::memcpy(pos, &eop, sizeof(eop));
-	pos += sizeof(eop);
-
-	// serialize ./pbag
-	BYTE* const pbag_head = pos;
-	std::memcpy(pbag_head, "pbag", 4);
-	DWORD pbag_ck_size = (bag_idx + 1) * sizeof(spec::SfPresetBag);
-	std::memcpy(pbag_head + 4, &pbag_ck_size, sizeof(DWORD));
-	pos += 8;
-	WORD gen_idx = 0;
-	WORD mod_idx = 0;
-	for (const SfPreset& preset : src) {
-		preset.ForEachZone([&](const SfPresetZone& zone) {
-			if (!zone.IsEmpty()) {
-				spec::SfPresetBag bits;
-				bits.w_gen_ndx = gen_idx;
-				bits.w_mod_ndx = mod_idx;
-				std::memcpy(pos, &bits, sizeof(bits));
-				gen_idx += zone.GeneratorCount();
-				mod_idx += zone.ModulatorCount();
-				pos += sizeof(bits);
-			}
-		});
-	}
-	spec::SfPresetBag end_of_pbag { gen_idx, mod_idx };
-	std::memcpy(pos, &end_of_pbag, sizeof(end_of_pbag));
-	pos += sizeof(end_of_pbag);
+namespace {
+	using namespace SF2ML;
 
-	// serialize ./pmod
-	BYTE* const pmod_head = pos;
-	std::memcpy(pmod_head, "pmod", 4);
-	DWORD pmod_ck_size = (mod_idx + 1) * sizeof(spec::SfModList);
-	std::memcpy(pmod_head + 4, &pmod_ck_size, sizeof(DWORD));
-	pos += 8;
-	for (const SfPreset& inst : src) {
-		SF2MLError failed = SF2ML_SUCCESS;
-		inst.ForEachZone([&](const SfPresetZone& zone) {
-			BYTE* next = pos;
-			if (!failed && !zone.IsEmpty()) {
-				if (auto err = SerializeModulators(pos, &next, zone)) {
-					failed = err;
-					if (end) {
-						*end = next;
-					}
-					return;
-				}
-				pos = next;
-			}
-		});
-		if (failed) {
-			return failed;
+	// zones at which filling the chunks is split over several threads
+	constexpr std::size_t parallel_grain = 2048;
+
+	// Serializes the 4 chunks of presets(phdr/pbag/pmod/pgen) or instruments(inst/ibag/imod/igen).
+	// The records of every object are counted once, the counts turned into offsets (prefix sums),
+	// then the objects are written independently, in parallel for large banks.
+	// The output is the same as writing the objects one after another.
+	template <typename HeaderT, typename BagT, typename ModT, typename GenT,
+			  typename Container, typename RefContainer, typename MakeHeader>
+	SF2MLError SerializeHydra(BYTE* dst, BYTE** end,
+							  const Container& src,
+							  const RefContainer& ref_info,
+							  const char* const (&ck_ids)[4],
+							  MakeHeader&& make_header) {
+		const auto objects = src.Items();
+		const std::size_t count = objects.size();
+
+		// offsets[i]: first records of object i, offsets[count]: record totals
+		std::pmr::vector<serializer::HydraCounts> offsets(count + 1, src.GetResource());
+		for (std::size_t i = 0; i < count; i++) {
+			offsets[i + 1] = offsets[i];
+			offsets[i + 1] += serializer::CountRecords(objects[i]);
 		}
-	}
-	spec::SfModList end_of_pmod {};
-	std::memcpy(pos, &end_of_pmod, sizeof(end_of_pmod));
-	pos += sizeof(end_of_pmod);
+		const serializer::HydraCounts total = offsets[count];
 
-	// serialize ./pgen
-	BYTE* const pgen_head = pos;
-	std::memcpy(pgen_head, "pgen", 4);
-	DWORD pgen_ck_size = (gen_idx + 1) * sizeof(spec::SfGenList);
-	std::memcpy(pgen_head + 4, &pgen_ck_size, sizeof(DWORD));
-	pos += 8;
-	for (const SfPreset& preset : src) {
-		SF2MLError failed = SF2ML_SUCCESS;
-		preset.ForEachZone([&](const SfPresetZone& zone) {
-			if (!failed && !zone.IsEmpty()) {
-				BYTE* next = pos;
-				if (auto err = SerializeGenerators(pos, &next, zone, inst_info)) {
-					failed = err;
-					if (end) {
-						*end = next;
-					}
-					return;
+		BYTE* const hdr_ck = dst;
+		BYTE* const bag_ck = hdr_ck + sizeof(ChunkHead) + (count + 1) * sizeof(HeaderT);
+		BYTE* const mod_ck = bag_ck + sizeof(ChunkHead) + (total.bags + 1) * sizeof(BagT);
+		BYTE* const gen_ck = mod_ck + sizeof(ChunkHead) + (total.mods + 1) * sizeof(ModT);
+		BYTE* const last = gen_ck + sizeof(ChunkHead) + (total.gens + 1) * sizeof(GenT);
+
+		const auto write_ck_head = [](BYTE* ck, const char* id, DWORD size) {
+			std::memcpy(ck, id, 4);
+			std::memcpy(ck + 4, &size, sizeof(size));
+		};
+		write_ck_head(hdr_ck, ck_ids[0], (count + 1) * sizeof(HeaderT));
+		write_ck_head(bag_ck, ck_ids[1], (total.bags + 1) * sizeof(BagT));
+		write_ck_head(mod_ck, ck_ids[2], (total.mods + 1) * sizeof(ModT));
+		write_ck_head(gen_ck, ck_ids[3], (total.gens + 1) * sizeof(GenT));
+
+		// errors of each object, reported in the order a sequential writer would meet them
+		std::pmr::vector<SF2MLError> mod_errors(count, SF2ML_SUCCESS, src.GetResource());
+		std::pmr::vector<SF2MLError> gen_errors(count, SF2ML_SUCCESS, src.GetResource());
+
+		const auto serialize_object = [&](std::size_t i) {
+			const serializer::HydraCounts& at = offsets[i];
+			const HeaderT header = make_header(&objects[i], at.bags);
+			std::memcpy(hdr_ck + sizeof(ChunkHead) + i * sizeof(HeaderT), &header, sizeof(header));
+
+			BYTE* bag_pos = bag_ck + sizeof(ChunkHead) + at.bags * sizeof(BagT);
+			BYTE* mod_pos = mod_ck + sizeof(ChunkHead) + at.mods * sizeof(ModT);
+			BYTE* gen_pos = gen_ck + sizeof(ChunkHead) + at.gens * sizeof(GenT);
+			DWORD mod_idx = at.mods;
+			DWORD gen_idx = at.gens;
+			for (const auto& zone : objects[i].Zones()) {
+				if (zone.IsEmpty()) {
+					continue;
+				}
+				const BagT bag { static_cast<WORD>(gen_idx), static_cast<WORD>(mod_idx) };
+				std::memcpy(bag_pos, &bag, sizeof(bag));
+				bag_pos += sizeof(bag);
+
+				const DWORD mod_count = zone.ModulatorCount();
+				const DWORD gen_count = zone.GeneratorCount();
+				if (mod_count > 0 && !mod_errors[i]) {
+					mod_errors[i] = serializer::SerializeModulators(mod_pos, nullptr, zone);
 				}
-				pos = next;
+				if (!gen_errors[i]) {
+					gen_errors[i] = serializer::SerializeGenerators(gen_pos, nullptr, zone, ref_info);
+				}
+				mod_pos += mod_count * sizeof(ModT);
+				gen_pos += gen_count * sizeof(GenT);
+				mod_idx += mod_count;
+				gen_idx += gen_count;
+			}
+		};
+		ParallelFor(count, ParallelThreads(total.bags, parallel_grain), serialize_object);
+
+		// terminal records
+		const HeaderT terminal = make_header(nullptr, total.bags);
+		std::memcpy(bag_ck - sizeof(HeaderT), &terminal, sizeof(terminal));
+		const BagT end_of_bags { static_cast<WORD>(total.gens), static_cast<WORD>(total.mods) };
+		std::memcpy(mod_ck - sizeof(BagT), &end_of_bags, sizeof(end_of_bags));
+		const ModT end_of_mods {};
+		std::memcpy(gen_ck - sizeof(ModT), &end_of_mods, sizeof(end_of_mods));
+		const GenT end_of_gens {};
+		std::memcpy(last - sizeof(GenT), &end_of_gens, sizeof(end_of_gens));
+
+		for (const auto* errors : { &mod_errors, &gen_errors }) {
+			auto failed = std::find_if(errors->begin(), errors->end(), [](SF2MLError err) { return err != SF2ML_SUCCESS; });
+			if (failed != errors->end()) {
+				return *failed;
 			}
-		});
-		if (failed) {
-			return failed;
 		}
-	}
-	spec::SfGenList end_of_pgen {};
-	std::memcpy(pos, &end_of_pgen, sizeof(end_of_pgen));
-	pos += sizeof(end_of_pgen);
 
-	if (end) {
-		*end = pos;
+		if (end) {
+			*end = last;
+		}
+		return SF2ML_SUCCESS;
 	}
+}
 
-	return SF2ML_SUCCESS;
+auto SF2ML::serializer::SerializePresets(BYTE* dst, BYTE** end,
+										 const PresetContainer& src,
+										 const IdRemap<InstHandle>& inst_ids) -> SF2ML::SF2MLError {
+	trace::Scope trace("SerializePresets");
+	static constexpr const char* ck_ids[4] { "phdr", "pbag", "pmod", "pgen" };
+	return SerializeHydra<spec::SfPresetHeader, spec::SfPresetBag, spec::SfModList, spec::SfGenList>(
+		dst, end, src, inst_ids, ck_ids,
+		[](const SfPreset* preset, DWORD bag_idx) {
+			if (!preset) {
+				spec::SfPresetHeader eop { "EOP" };
+				eop.w_preset_bag_ndx = bag_idx;
+				return eop;
+			}
+			spec::SfPresetHeader bits {};
+			std::string name = preset->GetName();
+			std::memcpy(bits.ach_preset_name, name.c_str(), std::min<std::size_t>(name.length(), 20));
+			bits.w_preset_bag_ndx = bag_idx;
+			bits.w_preset = preset->GetPresetNumber();
+			bits.w_bank = preset->GetBankNumber();
+			return bits;
+		});
 }
 
 auto SF2ML::serializer::SerializeInstruments(BYTE* dst, BYTE** end,
 											 const InstContainer& src,
-											 const SmplContainer& smpl_info) -> SF2ML::SF2MLError {
-	BYTE* pos = dst;
-
-	// serialize ./inst
-	BYTE* const inst_head = pos;
-	std::memcpy(inst_head, "inst", 4);
-	DWORD inst_ck_size = (src.Count() + 1) * sizeof(spec::SfInst);
-	std::memcpy(inst_head + 4, &inst_ck_size, sizeof(DWORD));
-	pos += 8;
-	WORD bag_idx = 0;
-	for (const SfInstrument& inst : src) {
-		spec::SfInst bits {};
-		std::string name = inst.GetName();
-		std::memcpy(bits.ach_inst_name, name.c_str(), std::min<std::size_t>(name.length(), 20));
-		bits.w_inst_bag_ndx = bag_idx;
-		std::memcpy(pos, &bits, sizeof(bits));
-		bag_idx += inst.CountZones();
-		pos += sizeof(bits);
-	}
-	spec::SfInst eoi { "EOI", bag_idx };
-	std::memcpy(pos, &eoi, sizeof(eoi));
-	pos += sizeof(eoi);
-
-	// serialize ./ibag
-	BYTE* const ibag_head = pos;
-	std::memcpy(ibag_head, "ibag", 4);
-	DWORD ibag_ck_size = (bag_idx + 1) * sizeof(spec::SfInstBag);
-	std::memcpy(ibag_head + 4, &ibag_ck_size, sizeof(DWORD));
-	pos += 8;
-	WORD gen_idx = 0;
-	WORD mod_idx = 0;
-	for (const SfInstrument& inst : src) {
-		inst.ForEachZone([&](const SfInstrumentZone& zone) {
-			if (!zone.IsEmpty()) {
-				spec::SfInstBag bits;
-				bits.w_inst_gen_ndx = gen_idx;
-				bits.w_inst_mod_ndx = mod_idx;
-				std::memcpy(pos, &bits, sizeof(bits));
-				gen_idx += zone.GeneratorCount();
-				mod_idx += zone.ModulatorCount();
-				pos += sizeof(bits);
+											 const IdRemap<SmplHandle>& smpl_ids) -> SF2ML::SF2MLError {
+	trace::Scope trace("SerializeInstruments");
+	static constexpr const char* ck_ids[4] { "inst", "ibag", "imod", "igen" };
+	return SerializeHydra<spec::SfInst, spec::SfInstBag, spec::SfInstModList, spec::SfInstGenList>(
+		dst, end, src, smpl_ids, ck_ids,
+		[](const SfInstrument* inst, DWORD bag_idx) {
+			if (!inst) {
+				return spec::SfInst { "EOI", static_cast<WORD>(bag_idx) };
 			}
+			spec::SfInst bits {};
+			std::string name = inst->GetName();
+			std::memcpy(bits.ach_inst_name, name.c_str(), std::min<std::size_t>(name.length(), 20));
+			bits.w_inst_bag_ndx = bag_idx;
+			return bits;
 		});
+}
+
+namespace {
+	using namespace SF2ML;
+
+	void WriteChunkHead(std::ostream& os, const char* fourcc, DWORD size) {
+		BYTE head[sizeof(ChunkHead)];
+		std::memcpy(head, fourcc, 4);
+		std::memcpy(head + 4, &size, sizeof(DWORD));
+		os.write(reinterpret_cast<const char*>(head), sizeof(head));
 	}
-	spec::SfInstBag end_of_ibag { gen_idx, mod_idx };
-	std::memcpy(pos, &end_of_ibag, sizeof(end_of_ibag));
-	pos += sizeof(end_of_ibag);
 
-	// serialize ./imod
-	BYTE* const imod_head = pos;
-	std::memcpy(imod_head, "imod", 4);
-	DWORD imod_ck_size = (mod_idx + 1) * sizeof(spec::SfInstModList);
-	std::memcpy(imod_head + 4, &imod_ck_size, sizeof(DWORD));
-	pos += 8;
-	for (const SfInstrument& inst : src) {
-		SF2MLError failed = SF2ML_SUCCESS;
-		inst.ForEachZone([&](const SfInstrumentZone& zone) {
-			BYTE* next = pos;
-			if (!failed && !zone.IsEmpty()) {
-				if (auto err = SerializeModulators(pos, &next, zone)) {
-					failed = err;
-					if (end) {
-						*end = next;
-					}
-					return;
-				}
-				pos = next;
-			}
-		});
-		if (failed) {
-			return failed;
+	void WriteZeros(std::ostream& os, std::size_t count) {
+		static constexpr char zeros[64] {};
+		for (; count > 0; count -= std::min(count, sizeof(zeros))) {
+			os.write(zeros, std::min(count, sizeof(zeros)));
 		}
 	}
-	spec::SfInstModList end_of_imod {};
-	std::memcpy(pos, &end_of_imod, sizeof(end_of_imod));
-	pos += sizeof(end_of_imod);
 
-	// serialize ./igen
-	BYTE* const igen_head = pos;
-	std::memcpy(igen_head, "igen", 4);
-	DWORD igen_ck_size = (gen_idx + 1) * sizeof(spec::SfInstGenList);
-	std::memcpy(igen_head + 4, &igen_ck_size, sizeof(DWORD));
-	pos += 8;
-	for (const SfInstrument& inst : src) {
-		SF2MLError failed = SF2ML_SUCCESS;
-		inst.ForEachZone([&](const SfInstrumentZone& zone) {
-			BYTE* next = pos;
-			if (!failed && !zone.IsEmpty()) {
-				if (auto err = SerializeGenerators(pos, &next, zone, smpl_info)) {
-					failed = err;
-					if (end) {
-						*end = next;
-					}
-					return;
-				}
-				pos = next;
-			}
-		});
-		if (failed) {
-			return failed;
+	// Writes the sample points of smpl, block by block: `pick` turns the points read into scratch
+	// (3 or 2 bytes each) into the bytes of the chunk, in place, and returns their size.
+	template <typename Pick>
+	void WriteSamplePoints(std::ostream& os, const SfSample& smpl, std::span<BYTE> scratch, std::size_t point_size, Pick&& pick) {
+		const auto count = static_cast<DWORD>(smpl.GetSampleCount());
+		const auto block = static_cast<DWORD>(scratch.size() / point_size);
+		trace::Scope trace("WriteSamplePoints", "points", count);
+		for (DWORD first = 0; first < count; first += block) {
+			const DWORD points = std::min(block, count - first);
+			smpl.ReadWav(first, scratch.first(points * point_size));
+			const std::size_t size = pick(scratch.data(), points);
+			os.write(reinterpret_cast<const char*>(scratch.data()), size);
 		}
 	}
-	spec::SfInstGenList end_of_igen {};
-	std::memcpy(pos, &end_of_igen, sizeof(end_of_igen));
-	pos += sizeof(end_of_igen);
+}
 
-	if (end) {
-		*end = pos;
+auto SF2ML::serializer::WriteSDTA(std::ostream& os,
+								  const SmplContainer& src,
+								  unsigned z_zone,
+								  std::pmr::memory_resource* resource) -> SF2ML::SF2MLError {
+	trace::Scope trace("WriteSDTA");
+	// at most 1 MiB of scratch: sample data is never held as a whole
+	constexpr std::size_t max_block_points = std::size_t(1) << 18;
+
+	const SampleBitDepth bit_depth = GetBitDepth(src);
+	const std::size_t point_size = bit_depth == SampleBitDepth::Signed16 ? 2 : 3;
+	// points held in a buffer of the sample are written as they are; the others(sources, 24 bit points, and
+	// managed samples, whose buffer another thread may evict) are copied out block by block
+	const auto in_blocks = [bit_depth](const SfSample& sample) {
+		return sample.HasWavSource() || sample.IsManaged() || bit_depth == SampleBitDepth::Signed24;
+	};
+	SdtaCounts data;
+	std::size_t block_points = 0;
+	for (const auto& sample : src) {
+		data += CountRecords(sample);
+		if (in_blocks(sample)) {
+			block_points = std::max(block_points, std::min(sample.GetSampleCount(), max_block_points));
+		}
 	}
+	std::pmr::vector<BYTE> scratch(block_points * point_size, resource);
 
-	return SF2ML_SUCCESS;
-}
-
-auto SF2ML::serializer::SerializeSDTA(BYTE* dst, BYTE** end, const SmplContainer& src, unsigned z_zone) -> SF2ML::SF2MLError {
-	BYTE* pos = dst;
+	// the sizes are summed in 64 bits, and fit their DWORDs once WriteRiff checked the size of the file
+	const std::uint64_t smpl_sz = data.frames * 2 + std::uint64_t(src.Count()) * z_zone;
+	const std::uint64_t sm24_sz = bit_depth == SampleBitDepth::Signed24 ? data.frames + std::uint64_t(src.Count()) * (z_zone / 2) : 0;
+	const std::uint64_t sm24_ck_sz = sm24_sz + sm24_sz % 2;
+	const std::uint64_t sdta_sz = sizeof(FOURCC) + sizeof(ChunkHead) + smpl_sz
+								+ (bit_depth == SampleBitDepth::Signed24 ? sizeof(ChunkHead) + sm24_ck_sz : 0);
+	if (sdta_sz > std::numeric_limits<DWORD>::max()) {
+		return SF2ML_FILE_TOO_LARGE;
+	}
 
-	SampleBitDepth bit_depth = GetBitDepth(src);
-	
 	// serialize ./sdta
-	BYTE* const sdta_head = pos;
-	std::memcpy(sdta_head, "LIST", 4);
-	pos += 8;
-	std::memcpy(pos, "sdta", 4);
-	pos += 4;
-	
-	// serialize ./sdta/smpl
-	BYTE* const smpl_head = pos;
-	std::memcpy(smpl_head, "smpl", 4);
-	pos += 8;
-	if (bit_depth == SampleBitDepth::Signed16) {
-		for (const auto& sample : src) {
-			std::memcpy(pos, sample.GetWav().data(), sample.GetWav().size());
-			pos += sample.GetWav().size();
-			std::memset(pos, 0, z_zone);
-			pos += z_zone;
-		}
-	} else {
-		for (const auto& sample : src) {
-			DWORD smpl_count = sample.GetWav().size() / 3;
-			for (DWORD idx = 0; idx < smpl_count; idx++) {
-				pos[0] = sample.GetWav()[3 * idx + 1];
-				pos[1] = sample.GetWav()[3 * idx + 2];
-				pos += 2;
-			}
-			std::memset(pos, 0, z_zone);
-			pos += z_zone;
+	WriteChunkHead(os, "LIST", static_cast<DWORD>(sdta_sz));
+	os.write("sdta", 4);
+
+	// serialize ./sdta/smpl (the upper 16 bits of 24 bit points)
+	WriteChunkHead(os, "smpl", static_cast<DWORD>(smpl_sz));
+	for (const auto& sample : src) {
+		if (!in_blocks(sample)) {
+			const auto wav = sample.GetWav();
+			os.write(reinterpret_cast<const char*>(wav.data()), wav.size());
+		} else if (bit_depth == SampleBitDepth::Signed16) {
+			WriteSamplePoints(os, sample, scratch, point_size, [](BYTE*, DWORD points) {
+				return std::size_t(points) * 2;
+			});
+		} else {
+			WriteSamplePoints(os, sample, scratch, point_size, [](BYTE* block, DWORD points) {
+				for (DWORD idx = 0; idx < points; idx++) {
+					block[2 * idx + 0] = block[3 * idx + 1];
+					block[2 * idx + 1] = block[3 * idx + 2];
+				}
+				return std::size_t(points) * 2;
+			});
 		}
+		WriteZeros(os, z_zone);
 	}
-	DWORD smpl_sz = pos - smpl_head - 8;
-	std::memcpy(smpl_head + 4, &smpl_sz, sizeof(smpl_sz));
 
-	// serialize ./sdta/sm24
+	// serialize ./sdta/sm24 (the lower 8 bits)
 	if (bit_depth == SampleBitDepth::Signed24) {
-		BYTE* const sm24_head = pos;
-		std::memcpy(sm24_head, "sm24", 4);
-		pos += 8;
+		WriteChunkHead(os, "sm24", static_cast<DWORD>(sm24_ck_sz));
 		for (const auto& sample : src) {
-			DWORD smpl_count = sample.GetWav().size() / 3;
-			for (DWORD idx = 0; idx < smpl_count; idx++) {
-				*pos = sample.GetWav()[3 * idx + 0];
-				pos++;
-			}
-			std::memset(pos, 0, z_zone / 2);
-			pos += z_zone / 2;
-		}
-		DWORD sm24_sz = pos - sm24_head - 8;
-		if (sm24_sz % 2 == 1) {
-			*pos = 0;
-			pos++;
-			sm24_sz++;
+			WriteSamplePoints(os, sample, scratch, point_size, [](BYTE* block, DWORD points) {
+				for (DWORD idx = 0; idx < points; idx++) {
+					block[idx] = block[3 * idx];
+				}
+				return std::size_t(points);
+			});
+			WriteZeros(os, z_zone / 2);
 		}
-		std::memcpy(sm24_head + 4, &sm24_sz, sizeof(sm24_sz));
+		WriteZeros(os, sm24_ck_sz - sm24_sz);
 	}
 
-	DWORD sdta_sz = pos - sdta_head - 8;
-	std::memcpy(sdta_head + 4, &sdta_sz, sizeof(sdta_sz));
-
-	if (end) {
-		*end = pos;
-	}
-	return SF2ML_SUCCESS;
+	return os ? SF2ML_SUCCESS : SF2ML_FAILED;
 }
 
 auto SF2ML::serializer::SerializeSHDR(BYTE* dst, BYTE** end,
 									  const SmplContainer& src,
+									  const IdRemap<SmplHandle>& smpl_ids,
 									  unsigned z_zone) -> SF2ML::SF2MLError {
+	trace::Scope trace("SerializeSHDR");
 	BYTE* pos = dst;
 
 	BYTE* const shdr_head = pos;
@@ -597,7 +644,7 @@ auto SF2ML::serializer::SerializeSHDR(BYTE* dst, BYTE** end,
 		if (IsMonoSample(shdr.sf_sample_type)) {
 			shdr.w_sample_link = 0;
 		} else {
-			auto smpl_id = src.GetID(*sample.GetLink());
+			auto smpl_id = smpl_ids.GetID(*sample.GetLink());
 			if (smpl_id) {
 				shdr.w_sample_link = smpl_id.value();
 			} else {
@@ -623,211 +670,96 @@ auto SF2ML::serializer::SerializeSHDR(BYTE* dst, BYTE** end,
 	return SF2ML_SUCCESS;
 }
 
-auto SF2ML::serializer::SerializeGenerators(BYTE* dst, BYTE** end,
-											const SfPresetZone& src,
-											const InstContainer& inst_info) -> SF2ML::SF2MLError {
-	// pointer to keep track on where to put generators
-	BYTE* pos = dst;
-	// helper function for serializing generators (except Instrument generator because that is a special case)
-	const auto append_generator = [&pos](SFGenerator type, SfGenAmount amt) {
-		spec::SfGenList bits;
-		bits.sf_gen_oper = type;
-		std::visit([&bits](auto&& arg) {
-			using T = std::decay_t<decltype(arg)>;
-			if constexpr (std::is_same_v<T, Ranges<BYTE>>) {
-				bits.gen_amount.ranges.by_lo = arg.start;
-				bits.gen_amount.ranges.by_hi = arg.end;
-			} else if constexpr (std::is_same_v<T, WORD>) {
-				bits.gen_amount.w_amount = arg;
-			} else if constexpr (std::is_same_v<T, SHORT>) {
-				bits.gen_amount.sh_amount = arg;
-			}
-		}, amt);
-		std::memcpy(pos, &bits, sizeof(bits));
-		pos += sizeof(bits);
-	};
+namespace {
+	using namespace SF2ML;
 
-	// if it exists, KeyRange generator should be the first entry in GenList
-	if (src.HasGenerator(SfGenKeyRange)) {
-		append_generator(SfGenKeyRange, src.GetGenerator(SfGenKeyRange));
-	}
-	// if it exists, VelRange generator should be preceded by KeyRange generator in GenList
-	// (though not sure about having VelRange in absence of KeyRange...)
-	if (src.HasGenerator(SfGenVelRange)) {
-		append_generator(SfGenVelRange, src.GetGenerator(SfGenVelRange));
-	}
-	// serialize other generators (except Instrument(ID/Handle) generator)
-	for (WORD gen_type = 0; gen_type < SfGenEndOper; gen_type++) {
-		if (   gen_type == SfGenKeyRange
-			|| gen_type == SfGenVelRange
-			|| gen_type == SfGenInstrument
-			|| !src.HasGenerator(static_cast<SFGenerator>(gen_type))
-		) {
-			continue;
+	// Writes the generators of a zone in the order the specification asks for: KeyRange, VelRange,
+	// the other generators by type, and the reference generator(Instrument/SampleID) last, translated to its file ID.
+	// The set bits of the presence mask are visited lowest first(the k-th one is the k-th entry, as the entries are
+	// sorted by type), and every record goes straight to its final slot: KeyRange/VelRange take the first slots,
+	// how many of them there are being known from the mask.
+	// The records are built on the stack and copied with a single memcpy.
+	template <typename GenT, typename HandleT>
+	SF2MLError WriteGenerators(BYTE* dst, BYTE** end,
+							   std::uint64_t mask,
+							   std::span<const SfGenEntry> gens,
+							   SFGenerator ref_type,
+							   const serializer::IdRemap<HandleT>& ref_ids,
+							   SF2MLError no_such_ref) {
+		constexpr std::uint64_t leading = detail::GenTypeMask(SfGenValueType::Range);
+		static_assert(leading == ((std::uint64_t(1) << SfGenKeyRange) | (std::uint64_t(1) << SfGenVelRange)));
+		GenT records[SfGenEndOper];
+		std::size_t lead_slot = 0;
+		std::size_t slot = ((mask >> SfGenKeyRange) & 1) + ((mask >> SfGenVelRange) & 1);
+		std::optional<WORD> ref_raw;
+		std::size_t k = 0;
+		for (std::uint64_t bits = mask; bits; bits &= bits - 1, k++) {
+			const auto type = static_cast<SFGenerator>(std::countr_zero(bits));
+			assert(gens[k].type == type);
+			if (type == ref_type) {
+				ref_raw = gens[k].raw; // written last
+				continue;
+			}
+			GenT& record = records[(leading >> type) & 1 ? lead_slot++ : slot++];
+			record.sf_gen_oper = type;
+			record.gen_amount.w_amount = gens[k].raw;
 		}
-		append_generator(
-			static_cast<SFGenerator>(gen_type),
-			src.GetGenerator(static_cast<SFGenerator>(gen_type))
-		);
-	}
-	// if it exists, Instrument generator should be the last entry in GenList
-	if (src.HasGenerator(SfGenInstrument)) {
-		spec::SfGenList bits;
-		bits.sf_gen_oper = SfGenInstrument;
-		auto inst_id = inst_info.GetID(*src.GetInstrument());
-
-		// failing condition for serialization: the zone holds an invalidated instrument handle
-		// (which means the zone references a deleted instrument that once existed)
-		if (inst_id.has_value() == false) {
-			if (end) {
-				*end = pos;
+		std::size_t count = slot;
+
+		if (ref_raw) {
+			// failing condition for serialization: the zone holds an invalidated handle
+			// (which means the zone references a deleted object that once existed)
+			auto id = ref_ids.GetID(HandleT(*ref_raw));
+			if (!id) {
+				if (end) {
+					*end = dst;
+				}
+				return no_such_ref;
 			}
-			return SF2ML_NO_SUCH_INSTRUMENT;
+			records[count].sf_gen_oper = ref_type;
+			records[count].gen_amount.w_amount = static_cast<WORD>(*id);
+			count++;
 		}
-		bits.gen_amount.w_amount = inst_id.value();
-		std::memcpy(pos, &bits, sizeof(bits));
-		pos += sizeof(bits);
-	}
 
-	if (end) {
-		*end = pos;
+		std::memcpy(dst, records, count * sizeof(GenT));
+		if (end) {
+			*end = dst + count * sizeof(GenT);
+		}
+		return SF2ML_SUCCESS;
 	}
-
-	return SF2ML_SUCCESS;
 }
 
 auto SF2ML::serializer::SerializeGenerators(BYTE* dst, BYTE** end,
-											const SfInstrumentZone& src,
-											const SmplContainer& smpl_info) -> SF2ML::SF2MLError {
-	// pointer to keep track on where to put generators
-	BYTE* pos = dst;
-	// helper function for serializing generators (except SampleID generator because that is a special case)
-	const auto append_generator = [&pos](SFGenerator type, SfGenAmount amt) {
-		spec::SfInstGenList bits;
-		bits.sf_gen_oper = type;
-		std::visit([&bits](auto&& arg) {
-			using T = std::decay_t<decltype(arg)>;
-			if constexpr (std::is_same_v<T, Ranges<BYTE>>) {
-				bits.gen_amount.ranges.by_lo = arg.start;
-				bits.gen_amount.ranges.by_hi = arg.end;
-			} else if constexpr (std::is_same_v<T, WORD>) {
-				bits.gen_amount.w_amount = arg;
-			} else if constexpr (std::is_same_v<T, SHORT>) {
-				bits.gen_amount.sh_amount = arg;
-			}
-		}, amt);
-		std::memcpy(pos, &bits, sizeof(bits));
-		pos += sizeof(bits);
-	};
-
-	// if it exists, KeyRange generator should be the first entry in GenList
-	if (src.HasGenerator(SfGenKeyRange)) {
-		append_generator(SfGenKeyRange, src.GetGenerator(SfGenKeyRange));
-	}
-	// if it exists, VelRange generator should be preceded by KeyRange generator in GenList
-	// (though not sure about having VelRange in absence of KeyRange...)
-	if (src.HasGenerator(SfGenVelRange)) {
-		append_generator(SfGenVelRange, src.GetGenerator(SfGenVelRange));
-	}
-	// serialize other generators (except Instrument(ID/Handle) generator)
-	for (WORD gen_type = 0; gen_type < SfGenEndOper; gen_type++) {
-		if (   gen_type == SfGenKeyRange
-			|| gen_type == SfGenVelRange
-			|| gen_type == SfGenSampleID
-			|| !src.HasGenerator(static_cast<SFGenerator>(gen_type))
-		) {
-			continue;
-		}
-		append_generator(
-			static_cast<SFGenerator>(gen_type),
-			src.GetGenerator(static_cast<SFGenerator>(gen_type))
-		);
-	}
-	if (src.HasGenerator(SfGenSampleID)) {
-		spec::SfInstGenList bits;
-		bits.sf_gen_oper = SfGenSampleID;
-		auto sample_id = smpl_info.GetID(*src.GetSample());
-		
-		// failing condition for serialization: the zone holds an invalidated instrument handle
-		// (which means the zone references a deleted instrument that once existed)
-		if (sample_id.has_value() == false) {
-			if (end) {
-				*end = pos;
-			}
-			return SF2ML_NO_SUCH_SAMPLE;
-		}
-		bits.gen_amount.w_amount = sample_id.value();
-		std::memcpy(pos, &bits, sizeof(bits));
-		pos += sizeof(bits);
-	}
-
-	if (end) {
-		*end = pos;
-	}
-
-	return SF2ML_SUCCESS;
+											const SfPresetZone& src,
+											const IdRemap<InstHandle>& inst_ids) -> SF2ML::SF2MLError {
+	return WriteGenerators<spec::SfGenList>(dst, end, src.GeneratorMask(), src.Generators(),
+											SfGenInstrument, inst_ids, SF2ML_NO_SUCH_INSTRUMENT);
 }
 
-namespace {
-	SF2ML::SFModulator CalcModSrcBits(SF2ML::GeneralController cc,
-									  bool polarity,
-									  bool direction,
-									  SF2ML::SfModSourceType shape) {
-
-		return static_cast<SF2ML::SFModulator>(cc)
-			| (0u << 7u)
-			| (direction << 8u)
-			| (polarity << 9u)
-			| (static_cast<SF2ML::SFModulator>(shape) << 10u);
-	}
-
-	SF2ML::SFModulator CalcModSrcBits(SF2ML::MidiController cc,
-									  bool polarity,
-									  bool direction,
-									  SF2ML::SfModSourceType shape) {
-
-		return static_cast<SF2ML::SFModulator>(cc)
-			| (1u << 7u)
-			| (direction << 8u)
-			| (polarity << 9u)
-			| (static_cast<SF2ML::SFModulator>(shape) << 10u);
-	}
+auto SF2ML::serializer::SerializeGenerators(BYTE* dst, BYTE** end,
+											const SfInstrumentZone& src,
+											const IdRemap<SmplHandle>& smpl_ids) -> SF2ML::SF2MLError {
+	return WriteGenerators<spec::SfInstGenList>(dst, end, src.GeneratorMask(), src.Generators(),
+												SfGenSampleID, smpl_ids, SF2ML_NO_SUCH_SAMPLE);
 }
 
 auto SF2ML::serializer::SerializeModulators(BYTE* dst, BYTE** end,
 											const SfPresetZone& src) -> SF2ML::SF2MLError {
-	
-	SF2MLError failure = SF2ML_SUCCESS;											
-	src.ForEachModulators([&](const SfModulator& mod) {
-		if (failure) {
-			return;
-		}
-
-		bool p1 = mod.GetSourcePolarity();
-		bool d1 = mod.GetSourceDirection();
-		auto s1 = mod.GetSourceShape();
-		bool p2 = mod.GetAmtSourcePolarity();
-		bool d2 = mod.GetAmtSourceDirection();
-		auto s2 = mod.GetAmtSourceShape();
 
+	SF2MLError failure = SF2ML_SUCCESS;
+	for (const SfModulator& mod : src.Modulators()) {
 		spec::SfModList bits;
+		bits.sf_mod_src_oper = mod.GetSourceBits();
+		bits.sf_mod_amt_src_oper = mod.GetAmtSourceBits();
 		bits.mod_amount = mod.GetModAmount();
 		bits.sf_mod_trans_oper = mod.GetTransform();
-		bits.sf_mod_src_oper = std::visit(
-			[&](auto&& cc) { return CalcModSrcBits(cc, p1, d1, s1); },
-			mod.GetSourceController()
-		);
-		bits.sf_mod_amt_src_oper = std::visit(
-			[&](auto&& cc) { return CalcModSrcBits(cc, p2, d2, s2); },
-			mod.GetAmtSourceController()
-		);
 
 		auto mod_dest = mod.GetDestination();
 		if (std::holds_alternative<ModHandle>(mod_dest)) {
 			auto dst_idx = src.GetModIndex(std::get<ModHandle>(mod_dest));
 			if (!dst_idx) {
 				failure = SF2ML_NO_SUCH_MODULATORS;
-				return;
+				break;
 			}
 
 			bits.sf_mod_dest_oper
@@ -839,7 +771,7 @@ auto SF2ML::serializer::SerializeModulators(BYTE* dst, BYTE** end,
 
 		std::memcpy(dst, &bits, sizeof(bits));
 		dst += sizeof(bits);
-	});
+	}
 
 	if (end) {
 		*end = dst;
@@ -851,37 +783,20 @@ auto SF2ML::serializer::SerializeModulators(BYTE* dst, BYTE** end,
 auto SF2ML::serializer::SerializeModulators(BYTE* dst, BYTE** end,
 											const SfInstrumentZone& src) -> SF2ML::SF2MLError {
 
-	SF2MLError failure = SF2ML_SUCCESS;											
-	src.ForEachModulators([&](const SfModulator& mod) {
-		if (failure) {
-			return;
-		}
-
-		bool p1 = mod.GetSourcePolarity();
-		bool d1 = mod.GetSourceDirection();
-		auto s1 = mod.GetSourceShape();
-		bool p2 = mod.GetAmtSourcePolarity();
-		bool d2 = mod.GetAmtSourceDirection();
-		auto s2 = mod.GetAmtSourceShape();
-
+	SF2MLError failure = SF2ML_SUCCESS;
+	for (const SfModulator& mod : src.Modulators()) {
 		spec::SfInstModList bits;
+		bits.sf_mod_src_oper = mod.GetSourceBits();
+		bits.sf_mod_amt_src_oper = mod.GetAmtSourceBits();
 		bits.mod_amount = mod.GetModAmount();
 		bits.sf_mod_trans_oper = mod.GetTransform();
-		bits.sf_mod_src_oper = std::visit(
-			[&](auto&& cc) { return CalcModSrcBits(cc, p1, d1, s1); },
-			mod.GetSourceController()
-		);
-		bits.sf_mod_amt_src_oper = std::visit(
-			[&](auto&& cc) { return CalcModSrcBits(cc, p2, d2, s2); },
-			mod.GetAmtSourceController()
-		);
 
 		auto mod_dest = mod.GetDestination();
 		if (std::holds_alternative<ModHandle>(mod_dest)) {
 			auto dst_idx = src.GetModIndex(std::get<ModHandle>(mod_dest));
 			if (!dst_idx) {
 				failure = SF2ML_NO_SUCH_MODULATORS;
-				return;
+				break;
 			}
 
 			bits.sf_mod_dest_oper
@@ -893,7 +808,7 @@ auto SF2ML::serializer::SerializeModulators(BYTE* dst, BYTE** end,
 
 		std::memcpy(dst, &bits, sizeof(bits));
 		dst += sizeof(bits);
-	});
+	}
 
 	if (end) {
 		*end = dst;
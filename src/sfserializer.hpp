@@ -3,27 +3,154 @@
 
 #include <sfinfo.hpp>
 #include "sfcontainers.hpp"
+#include "sfstats.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <ostream>
 
 namespace SF2ML::serializer {
-	DWORD CalculateRiffSize(const SfInfo& infos,
+	/// number of bag/modulator/generator records presets or instruments put in the pdta chunks
+	struct HydraCounts {
+		DWORD bags = 0;
+		DWORD mods = 0;
+		DWORD gens = 0;
+
+		HydraCounts& operator+=(const HydraCounts& rhs) noexcept {
+			bags += rhs.bags;
+			mods += rhs.mods;
+			gens += rhs.gens;
+			return *this;
+		}
+		HydraCounts& operator-=(const HydraCounts& rhs) noexcept {
+			bags -= rhs.bags;
+			mods -= rhs.mods;
+			gens -= rhs.gens;
+			return *this;
+		}
+	};
+
+	/// sample points samples put in the sdta chunk
+	/// (in 64 bits: the sum can exceed what a RIFF chunk size holds, see WriteRiff)
+	struct SdtaCounts {
+		std::uint64_t frames = 0;
+		DWORD signed24 = 0; // number of 24 bit samples
+
+		SdtaCounts& operator+=(const SdtaCounts& rhs) noexcept {
+			frames += rhs.frames;
+			signed24 += rhs.signed24;
+			return *this;
+		}
+		SdtaCounts& operator-=(const SdtaCounts& rhs) noexcept {
+			frames -= rhs.frames;
+			signed24 -= rhs.signed24;
+			return *this;
+		}
+	};
+
+	/// everything the size of the file depends on, besides the INFO chunk
+	struct RiffCounts {
+		DWORD presets = 0;
+		HydraCounts preset_records;
+		DWORD insts = 0;
+		HydraCounts inst_records;
+		DWORD samples = 0;
+		SdtaCounts sample_data;
+	};
+
+	/// records of a preset or an instrument (only non-empty zones are written)
+	template <typename ObjectT>
+	HydraCounts CountRecords(const ObjectT& obj) noexcept {
+		HydraCounts counts;
+		for (const auto& zone : obj.Zones()) {
+			if (!zone.IsEmpty()) {
+				counts.bags++;
+				counts.mods += zone.ModulatorCount();
+				counts.gens += zone.GeneratorCount();
+			}
+		}
+		return counts;
+	}
+
+	inline SdtaCounts CountRecords(const SfSample& smpl) {
+		return { static_cast<std::uint64_t>(smpl.GetSampleCount()), smpl.GetBitDepth() == SampleBitDepth::Signed24 ? 1u : 0u };
+	}
+
+	/// Dense handle -> file ID(position in the chunk) table of a container, built once per save
+	/// so that writing a reference is an array access instead of a search in the handle map.
+	template <typename HandleT>
+	class IdRemap {
+	public:
+		template <typename DataType>
+		IdRemap(const SfHandleInterface<DataType, HandleT>& src, std::pmr::memory_resource* resource)
+			: ids(resource) {
+			const auto items = src.Items();
+			std::size_t size = 0;
+			for (const DataType& item : items) {
+				size = std::max<std::size_t>(size, item.GetHandle().value + 1);
+			}
+			ids.assign(size, no_id);
+			for (std::size_t i = 0; i < items.size(); i++) {
+				ids[items[i].GetHandle().value] = static_cast<DWORD>(i);
+			}
+		}
+
+		std::optional<DWORD> GetID(HandleT handle) const noexcept {
+			if (handle.value < ids.size() && ids[handle.value] != no_id) {
+				return ids[handle.value];
+			}
+			return std::nullopt;
+		}
+
+	private:
+		static constexpr DWORD no_id = std::numeric_limits<DWORD>::max();
+		std::pmr::vector<DWORD> ids;
+	};
+
+	/// checks every reference the file would hold(preset zone -> instrument, instrument zone -> sample,
+	/// sample link, modulator -> modulator), so that nothing is written when one of them is dangling
+	/// @retval SF2ML_INDEX_OVERFLOW when the records of counts do not fit the 16-bit indexes of the bags and headers
+	/// @return otherwise, the error of the first dangling reference, in file order
+	SF2MLError ValidateReferences(const PresetContainer& presets,
+								  const InstContainer& insts,
+								  const SmplContainer& smpls,
+								  const RiffCounts& counts,
+								  const IdRemap<InstHandle>& inst_ids,
+								  const IdRemap<SmplHandle>& smpl_ids);
+	/// size of the file from counts kept by the caller (see SfSizeCache)
+	/// (in 64 bits: it exceeds 0xFFFFFFFF when the bank is too large to be saved)
+	std::uint64_t CalculateRiffSize(const SfInfo& infos, const RiffCounts& counts, unsigned z_zone);
+	/// size of the file, counting every object
+	std::uint64_t CalculateRiffSize(const SfInfo& infos,
 							const PresetContainer& presets,
 							const InstContainer& insts,
 							const SmplContainer& smpls,
 							unsigned z_zone);
-	SF2MLError SerializeRiff(BYTE* dst,
-							 BYTE** end,
-							 const SfInfo& infos,
-							 const PresetContainer& presets,
-							 const InstContainer& insts,
-							 const SmplContainer& smpls,
-							 unsigned z_zone);
+	/// @brief Writes the file to os, the sizes coming from counts kept by the caller (see SfSizeCache).
+	///        The pdta chunk is serialized first, so that nothing is written when a reference is dangling
+	///        or when the file would not fit the 32-bit size of the RIFF chunk(SF2ML_FILE_TOO_LARGE).
+	///        The sample data then goes from the samples to the stream through a scratch buffer of
+	///        bounded size (allocated from resource): memory use does not grow with the sample data.
+	///        With Collect, the phases are timed and counted into *stats (see sfstats.hpp).
+	template <bool Collect>
+	SF2MLError WriteRiff(std::ostream& os,
+						 const SfInfo& infos,
+						 const PresetContainer& presets,
+						 const InstContainer& insts,
+						 const SmplContainer& smpls,
+						 const RiffCounts& counts,
+						 unsigned z_zone,
+						 std::pmr::memory_resource* resource,
+						 SfSaveStats* stats);
 	SF2MLError SerializeInfos(BYTE* dst, BYTE** end, const SfInfo& src);
-	SF2MLError SerializePresets(BYTE* dst, BYTE** end, const PresetContainer& src, const InstContainer& inst_info);
-	SF2MLError SerializeInstruments(BYTE* dst, BYTE** end, const InstContainer& src, const SmplContainer& smpl_info);
-	SF2MLError SerializeSDTA(BYTE* dst, BYTE** end, const SmplContainer& src, unsigned z_zone);
-	SF2MLError SerializeSHDR(BYTE* dst, BYTE** end, const SmplContainer& src, unsigned z_zone);
-	SF2MLError SerializeGenerators(BYTE* dst, BYTE** end, const SfPresetZone& src, const InstContainer& inst_info);
-	SF2MLError SerializeGenerators(BYTE* dst, BYTE** end, const SfInstrumentZone& src, const SmplContainer& smpl_info);
+	SF2MLError SerializePresets(BYTE* dst, BYTE** end, const PresetContainer& src, const IdRemap<InstHandle>& inst_ids);
+	SF2MLError SerializeInstruments(BYTE* dst, BYTE** end, const InstContainer& src, const IdRemap<SmplHandle>& smpl_ids);
+	SF2MLError WriteSDTA(std::ostream& os, const SmplContainer& src, unsigned z_zone, std::pmr::memory_resource* resource);
+	SF2MLError SerializeSHDR(BYTE* dst, BYTE** end, const SmplContainer& src, const IdRemap<SmplHandle>& smpl_ids, unsigned z_zone);
+	SF2MLError SerializeGenerators(BYTE* dst, BYTE** end, const SfPresetZone& src, const IdRemap<InstHandle>& inst_ids);
+	SF2MLError SerializeGenerators(BYTE* dst, BYTE** end, const SfInstrumentZone& src, const IdRemap<SmplHandle>& smpl_ids);
 	SF2MLError SerializeModulators(BYTE* dst, BYTE** end, const SfPresetZone& src);
 	SF2MLError SerializeModulators(BYTE* dst, BYTE** end, const SfInstrumentZone& src);
 }
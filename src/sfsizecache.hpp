@@ -0,0 +1,109 @@
+#ifndef SF2ML_SFSIZECACHE_HPP_
+#define SF2ML_SFSIZECACHE_HPP_
+
+#include "sfserializer.hpp"
+
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+namespace SF2ML {
+	/// Record counts of every object of a SoundFont with their running totals, so that the size of
+	/// the saved file is known without walking the whole bank.
+	/// Objects reported as edited(or added/removed) are marked dirty and recounted on the next query only.
+	class SfSizeCache {
+	public:
+		explicit SfSizeCache(std::pmr::memory_resource* resource)
+			: presets(resource), insts(resource), samples(resource) {}
+
+		// everything is recounted on the next query (after loading)
+		void MarkAll() noexcept {
+			presets.MarkAll();
+			insts.MarkAll();
+			samples.MarkAll();
+		}
+		void MarkPreset(PresetHandle preset) { presets.Mark(preset); }
+		void MarkInstrument(InstHandle inst) { insts.Mark(inst); }
+		void MarkSample(SmplHandle smpl) { samples.Mark(smpl); }
+
+		// recounts the dirty objects and returns the up to date counts
+		auto Counts(const PresetContainer& preset_objs,
+					const InstContainer& inst_objs,
+					const SmplContainer& smpl_objs) -> serializer::RiffCounts {
+			serializer::RiffCounts counts;
+			counts.presets = preset_objs.Count();
+			counts.preset_records = presets.Refresh(preset_objs);
+			counts.insts = inst_objs.Count();
+			counts.inst_records = insts.Refresh(inst_objs);
+			counts.samples = smpl_objs.Count();
+			counts.sample_data = samples.Refresh(smpl_objs);
+			return counts;
+		}
+
+	private:
+		template <typename HandleT, typename CountsT>
+		class Tracker {
+		public:
+			explicit Tracker(std::pmr::memory_resource* resource)
+				: counted(resource), dirty(resource) {}
+
+			void MarkAll() noexcept {
+				all_dirty = true;
+				dirty.clear();
+			}
+
+			void Mark(HandleT handle) {
+				if (all_dirty) {
+					return;
+				}
+				// past this point recounting everything is cheaper than going through the list
+				if (dirty.size() > counted.size() + 64) {
+					MarkAll();
+					return;
+				}
+				dirty.push_back(handle);
+			}
+
+			template <typename Container>
+			auto Refresh(const Container& objects) -> const CountsT& {
+				if (all_dirty) {
+					counted.clear();
+					total = {};
+					for (const auto& obj : objects) {
+						const CountsT counts = serializer::CountRecords(obj);
+						counted.emplace(obj.GetHandle().value, counts);
+						total += counts;
+					}
+					all_dirty = false;
+					return total;
+				}
+				for (HandleT handle : dirty) {
+					if (auto it = counted.find(handle.value); it != counted.end()) {
+						total -= it->second;
+						counted.erase(it);
+					}
+					if (const auto* obj = objects.Get(handle)) {
+						const CountsT counts = serializer::CountRecords(*obj);
+						counted.emplace(handle.value, counts);
+						total += counts;
+					}
+				}
+				dirty.clear();
+				return total;
+			}
+
+		private:
+			// handle value -> counts of the object when it was last counted
+			std::pmr::unordered_map<decltype(HandleT::value), CountsT> counted;
+			std::pmr::vector<HandleT> dirty;
+			bool all_dirty = true;
+			CountsT total;
+		};
+
+		Tracker<PresetHandle, serializer::HydraCounts> presets;
+		Tracker<InstHandle, serializer::HydraCounts> insts;
+		Tracker<SmplHandle, serializer::SdtaCounts> samples;
+	};
+}
+
+#endif
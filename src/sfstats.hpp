@@ -0,0 +1,80 @@
+#ifndef SF2ML_SFSTATS_HPP_
+#define SF2ML_SFSTATS_HPP_
+
+#include <sf2ml.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+// Instrumentation of Load and Save (SfLoadStats/SfSaveStats).
+// The loader and the serializer take it as a `bool Collect` template parameter: the instantiations
+// used by the plain Load/Save get the empty versions below, so they do not even read the clock.
+namespace SF2ML::stats {
+	using Clock = std::chrono::steady_clock;
+
+	/// Lap(field) adds the wall time since the previous lap(or the construction) to stats->*field.
+	template <bool Collect, typename StatsT>
+	class Stopwatch {
+	public:
+		explicit Stopwatch(StatsT* stats) noexcept : stats{stats}, last{Clock::now()} {}
+
+		void Lap(std::uint64_t StatsT::* field) noexcept {
+			const Clock::time_point now = Clock::now();
+			stats->*field += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+			last = now;
+		}
+		/// starts the next lap without counting the time since the previous one
+		void Skip() noexcept {
+			last = Clock::now();
+		}
+
+	private:
+		StatsT* stats;
+		Clock::time_point last;
+	};
+
+	template <typename StatsT>
+	class Stopwatch<false, StatsT> {
+	public:
+		explicit Stopwatch(StatsT*) noexcept {}
+		void Lap(std::uint64_t StatsT::*) noexcept {}
+		void Skip() noexcept {}
+	};
+
+	/// stats->*field += n
+	template <bool Collect, typename StatsT, typename T>
+	inline void Count(StatsT* stats, T StatsT::* field, std::uint64_t n = 1) noexcept {
+		if constexpr (Collect) {
+			stats->*field += static_cast<T>(n);
+		}
+	}
+
+	/// Forwards to upstream, counting the allocations.
+	/// It only wraps the working buffers of a single call: nothing kept past the call allocates from it.
+	class CountingResource final : public std::pmr::memory_resource {
+	public:
+		explicit CountingResource(std::pmr::memory_resource* upstream) noexcept
+			: upstream{upstream} {}
+
+		std::pmr::memory_resource* upstream;
+		std::uint64_t allocations = 0;
+		std::uint64_t bytes = 0;
+
+	private:
+		void* do_allocate(std::size_t size, std::size_t alignment) override {
+			allocations++;
+			bytes += size;
+			return upstream->allocate(size, alignment);
+		}
+		void do_deallocate(void* p, std::size_t size, std::size_t alignment) override {
+			upstream->deallocate(p, size, alignment);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	};
+}
+
+#endif
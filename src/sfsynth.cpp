@@ -0,0 +1,216 @@
+#include <sfsynth.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace SF2ML;
+
+namespace {
+	// splitmix64: tiny, and the same sequence everywhere (unlike the std distributions)
+	std::uint64_t Mix(std::uint64_t z) noexcept {
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+		return z ^ (z >> 31);
+	}
+
+	struct SplitMix64 {
+		std::uint64_t state;
+
+		std::uint64_t Next() noexcept {
+			return Mix(state += 0x9E3779B97F4A7C15);
+		}
+		std::uint32_t Below(std::uint32_t n) noexcept {
+			return static_cast<std::uint32_t>(Next() % n);
+		}
+	};
+
+	// Points of a synthetic sample: a triangle wave plus noise, computed from the position alone
+	// so that any block can be produced on its own (see SfSample::SetWavSource).
+	struct SynthWave {
+		std::uint64_t key;
+		std::uint32_t period;
+		std::size_t point_size;
+
+		void operator()(std::uint32_t first, std::span<BYTE> out) const noexcept {
+			if (point_size == 2) {
+				Fill<2>(first, out);
+			} else {
+				Fill<3>(first, out);
+			}
+		}
+
+		template <std::size_t PointSize>
+		void Fill(std::uint32_t first, std::span<BYTE> out) const noexcept {
+			constexpr std::int32_t amplitude = 1 << 22;
+			const std::int32_t step = 4 * amplitude / static_cast<std::int32_t>(period);
+			const std::size_t count = out.size() / PointSize;
+			BYTE* pos = out.data();
+			std::uint32_t phase = first % period;
+			for (std::uint32_t i = first; i < first + count; i++, pos += PointSize) {
+				const auto ramp = static_cast<std::int32_t>(std::min(phase, period - phase)); // 0..period/2
+				const auto noise = static_cast<std::int32_t>(Mix(key ^ i) & 0x3FFF) - 0x2000;
+				const std::int32_t point = ramp * step - amplitude + noise;
+				// 16 bit points are the upper bits of the 24 bit ones
+				const auto bits = static_cast<std::uint32_t>(PointSize == 2 ? point >> 8 : point);
+				for (std::size_t b = 0; b < PointSize; b++) {
+					pos[b] = static_cast<BYTE>(bits >> (8 * b));
+				}
+				if (++phase == period) {
+					phase = 0;
+				}
+			}
+		}
+	};
+
+	std::string Numbered(const char* prefix, std::uint32_t n) {
+		return prefix + std::to_string(n);
+	}
+
+	auto NewSynthSample(SoundFont& sf2, const SfSynthSpec& spec, std::string_view name, std::uint64_t key, std::uint32_t root_key)
+		-> SF2MLResult<SmplHandle> {
+		auto [handle, err] = sf2.NewSample(name, spec.bit_depth);
+		if (err) {
+			return { handle, err };
+		}
+		const std::uint32_t points = std::max<std::uint32_t>(spec.sample_points, 64);
+		// every sample gets a period of its own
+		const SynthWave wave { key, 32 + static_cast<std::uint32_t>(Mix(key) % 480),
+							   spec.bit_depth == SampleBitDepth::Signed16 ? 2u : 3u };
+
+		SfSample& smpl = sf2.GetSample(handle);
+		smpl.SetLoop(8, points - 8)
+			.SetRootKey(static_cast<std::uint8_t>(root_key));
+		if (spec.stream_samples) {
+			smpl.SetWavSource(points, wave);
+		} else {
+			std::pmr::vector<BYTE> wav(std::size_t(points) * wave.point_size, sf2.GetMemoryResource());
+			wave(0, wav);
+			smpl.SetWav(std::move(wav));
+		}
+		return { handle, SF2ML_SUCCESS };
+	}
+}
+
+auto SF2ML::CountSynthRecords(const SfSynthSpec& spec) noexcept -> SfSynthRecords {
+	// see BuildSynthBank: 5 generators per instrument zone(key range, velocity range, attenuation, pan, sample),
+	// 1 per instrument global zone and 2 per preset zone(key range, instrument)
+	const std::uint64_t insts = spec.instruments;
+	const std::uint64_t zones = spec.InstrumentZones();
+	const std::uint64_t presets = spec.PresetCount();
+	SfSynthRecords records;
+	records.preset_bags = presets + 1;
+	records.preset_mods = 1;
+	records.preset_gens = presets * 2 + 1;
+	records.inst_bags = zones + insts + 1;
+	records.inst_mods = zones * spec.modulator_chain + 1;
+	records.inst_gens = zones * 5 + insts + 1;
+	return records;
+}
+
+bool SF2ML::SynthFitsFileIndexes(const SfSynthSpec& spec) noexcept {
+	constexpr std::uint64_t limit = 0xFFFF;
+	const SfSynthRecords records = CountSynthRecords(spec);
+	const std::uint64_t samples = std::uint64_t(spec.samples) * (spec.stereo ? 2 : 1);
+	return records.preset_bags <= limit && records.preset_gens <= limit
+		&& records.inst_bags <= limit && records.inst_mods <= limit && records.inst_gens <= limit
+		&& spec.instruments <= limit && samples <= limit;
+}
+
+auto SF2ML::MaximizeSynthIndexes(SfSynthSpec spec) noexcept -> SfSynthSpec {
+	constexpr std::uint64_t limit = 0xFFFF - 1; // without the terminal record
+	const std::uint64_t zones = std::max<std::uint32_t>(spec.zones_per_instrument, 1);
+	std::uint64_t insts = std::min(limit / (zones + 1), limit / (zones * 5 + 1));
+	if (spec.modulator_chain) {
+		insts = std::min(insts, limit / (zones * spec.modulator_chain));
+	}
+	spec.zones_per_instrument = static_cast<std::uint32_t>(zones);
+	spec.instruments = static_cast<std::uint32_t>(insts);
+	spec.presets = static_cast<std::uint32_t>(limit / 2);
+	return spec;
+}
+
+auto SF2ML::BuildSynthBank(SoundFont& sf2, const SfSynthSpec& spec) -> SF2MLError {
+	SplitMix64 rng { spec.seed };
+	sf2.Info()
+		.SetBankName("SF2ML Synthetic Bank")
+		.SetSoundEngine("EMU8000");
+
+	std::vector<SmplHandle> samples;
+	const std::uint32_t sample_count = std::max<std::uint32_t>(spec.samples, 1);
+	for (std::uint32_t i = 0; i < sample_count; i++) {
+		const std::uint32_t root_key = 36 + i % 48;
+		if (!spec.stereo) {
+			auto [handle, err] = NewSynthSample(sf2, spec, Numbered("Smpl ", i), rng.Next(), root_key);
+			if (err) {
+				return err;
+			}
+			samples.push_back(handle);
+			continue;
+		}
+		auto [left, err_l] = NewSynthSample(sf2, spec, Numbered("Smpl L", i), rng.Next(), root_key);
+		if (err_l) {
+			return err_l;
+		}
+		auto [right, err_r] = NewSynthSample(sf2, spec, Numbered("Smpl R", i), rng.Next(), root_key);
+		if (err_r) {
+			return err_r;
+		}
+		if (auto err = sf2.LinkSamples(left, right)) {
+			return err;
+		}
+		samples.push_back(left);
+		samples.push_back(right);
+	}
+
+	std::vector<InstHandle> insts;
+	insts.reserve(spec.instruments);
+	for (std::uint32_t inst_no = 0; inst_no < spec.instruments; inst_no++) {
+		SfInstrument& inst = sf2.NewInstrument(Numbered("Inst ", inst_no));
+		insts.push_back(inst.GetHandle());
+		inst.GetGlobalZone().SetReverbEffectsSend(static_cast<std::int16_t>(rng.Below(1001)));
+
+		for (std::uint32_t zone_no = 0; zone_no < spec.zones_per_instrument; zone_no++) {
+			const auto lo = static_cast<std::uint8_t>(rng.Below(128));
+			const auto hi = static_cast<std::uint8_t>(lo + rng.Below(128 - lo));
+			const std::uint32_t sample_no = rng.Below(static_cast<std::uint32_t>(samples.size()));
+			// both halves of a stereo pair are panned to their side
+			const auto pan = static_cast<std::int16_t>(spec.stereo ? (sample_no % 2 ? 500 : -500)
+																 : static_cast<std::int32_t>(rng.Below(1001)) - 500);
+			SfInstrumentZone& zone = inst.NewZone()
+				.SetKeyRange(Ranges<std::uint8_t>{ lo, hi })
+				.SetVelRange(Ranges<std::uint8_t>{ 0, 127 })
+				.SetInitialAttenuation(static_cast<std::int16_t>(rng.Below(481)))
+				.SetPan(pan)
+				.SetSample(samples[sample_no]);
+
+			// a chain of linked modulators: each one feeds the source of the previous one,
+			// and the first one drives the filter cutoff
+			std::optional<ModHandle> feeds;
+			for (std::uint32_t m = 0; m < spec.modulator_chain; m++) {
+				const bool linked = m + 1 < spec.modulator_chain;
+				SfModulator& mod = zone.NewModulator()
+					.SetSource(linked ? GeneralController::Link : GeneralController::NoteOnVelocity,
+							   0, 1, SfModSourceType::Concave)
+					.SetAmtSource(MidiController(1 + m % 31), 0, 0, SfModSourceType::Linear)
+					.SetModAmount(static_cast<std::int16_t>(rng.Below(961)));
+				if (feeds) {
+					mod.SetDestination(*feeds);
+				} else {
+					mod.SetDestination(SfGenInitialFilterFc);
+				}
+				feeds = mod.GetHandle();
+			}
+		}
+	}
+
+	const std::uint32_t preset_count = insts.empty() ? 0 : spec.PresetCount();
+	for (std::uint32_t preset_no = 0; preset_no < preset_count; preset_no++) {
+		sf2.NewPreset(static_cast<std::uint16_t>(preset_no % 128), static_cast<std::uint16_t>(preset_no / 128),
+					  Numbered("Preset ", preset_no))
+			.NewZone()
+				.SetKeyRange(Ranges<std::uint8_t>{ 0, 127 })
+				.SetInstrument(insts[preset_no % insts.size()]);
+	}
+	return SF2ML_SUCCESS;
+}
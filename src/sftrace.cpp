@@ -0,0 +1,202 @@
+#include "sftracing.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace SF2ML;
+
+std::atomic<bool> trace::enabled { false };
+
+namespace {
+	// An event and its position in the ring(+1; 0 while being written): a seqlock, so that the flush
+	// can copy events while their thread overwrites the ring, and tell which copies are torn.
+	struct Slot {
+		std::atomic<std::uint64_t> seq { 0 };
+		trace::Event event {};
+	};
+
+	// Events of one thread. Only its thread writes them, without locking.
+	struct Ring {
+		Ring(std::uint32_t tid, std::size_t capacity)
+			: tid{tid}, mask{capacity - 1}, slots{std::make_unique<Slot[]>(capacity)} {}
+
+		const std::uint32_t tid;
+		const std::size_t mask;
+		const std::unique_ptr<Slot[]> slots;
+		std::atomic<std::uint64_t> written { 0 };
+		std::uint64_t flushed = 0;  // guarded by Registry::mutex
+		bool in_use = true;         // guarded by Registry::mutex
+	};
+
+	// Every ring ever created. Rings are kept until the end of the program(with their events, until flushed),
+	// and the rings of finished threads are handed to new threads: the serializer starts new threads on every Save.
+	struct Registry {
+		std::mutex mutex;
+		std::vector<std::unique_ptr<Ring>> rings;
+		std::atomic<std::size_t> capacity { 0 };
+
+		Ring* Acquire(Ring* released, std::size_t capacity) {
+			std::lock_guard lock(mutex);
+			if (released) {
+				released->in_use = false;
+			}
+			for (const auto& ring : rings) {
+				if (!ring->in_use && ring->mask + 1 == capacity) {
+					ring->in_use = true;
+					return ring.get();
+				}
+			}
+			rings.push_back(std::make_unique<Ring>(static_cast<std::uint32_t>(rings.size() + 1), capacity));
+			return rings.back().get();
+		}
+		void Release(Ring* ring) {
+			std::lock_guard lock(mutex);
+			ring->in_use = false;
+		}
+	};
+
+	Registry& GetRegistry() {
+		static Registry registry;
+		return registry;
+	}
+
+	// the ring of this thread, released when the thread ends
+	struct ThreadRing {
+		Ring* ring = nullptr;
+
+		~ThreadRing() {
+			if (ring) {
+				GetRegistry().Release(ring);
+			}
+		}
+	};
+
+	thread_local ThreadRing thread_ring;
+
+	// the events are read while their thread may overwrite them: every field is accessed atomically too
+	template <typename T>
+	void Store(T& field, T value) noexcept {
+		std::atomic_ref<T>(field).store(value, std::memory_order_relaxed);
+	}
+	template <typename T>
+	T Load(T& field) noexcept {
+		return std::atomic_ref<T>(field).load(std::memory_order_relaxed);
+	}
+
+	// ns as microseconds with 3 decimals, without going through the stream's float formatting
+	void WriteMicros(std::ostream& os, std::uint64_t ns) {
+		const std::uint64_t frac = ns % 1000;
+		os << ns / 1000 << '.' << char('0' + frac / 100) << char('0' + frac / 10 % 10) << char('0' + frac % 10);
+	}
+
+	long ProcessId() {
+#ifdef _WIN32
+		return _getpid();
+#else
+		return static_cast<long>(getpid());
+#endif
+	}
+}
+
+auto trace::Now() noexcept -> std::uint64_t {
+	return static_cast<std::uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void trace::Record(const char* name, std::uint64_t begin_ns, const char* arg_name, std::int64_t arg) noexcept {
+	const std::uint64_t end_ns = Now();
+	Registry& registry = GetRegistry();
+	const std::size_t capacity = registry.capacity.load(std::memory_order_relaxed);
+	Ring* ring = thread_ring.ring;
+	if (!ring || ring->mask + 1 != capacity) [[unlikely]] {
+		if (capacity == 0) {
+			return;
+		}
+		try {
+			ring = thread_ring.ring = registry.Acquire(ring, capacity);
+		} catch (...) {
+			thread_ring.ring = nullptr;
+			return; // no memory for the ring: the event is lost
+		}
+	}
+
+	const std::uint64_t n = ring->written.load(std::memory_order_relaxed);
+	Slot& slot = ring->slots[n & ring->mask];
+	slot.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Event& event = slot.event;
+	Store(event.name, name);
+	Store(event.arg_name, arg_name);
+	Store(event.begin_ns, begin_ns);
+	Store(event.dur_ns, end_ns - begin_ns);
+	Store(event.arg, arg);
+	slot.seq.store(n + 1, std::memory_order_release);
+	ring->written.store(n + 1, std::memory_order_release);
+}
+
+void SF2ML::EnableTrace(std::size_t events_per_thread) {
+	GetRegistry().capacity.store(std::bit_ceil(std::max<std::size_t>(events_per_thread, 2)), std::memory_order_relaxed);
+	trace::enabled.store(true, std::memory_order_relaxed);
+}
+
+void SF2ML::DisableTrace() noexcept {
+	trace::enabled.store(false, std::memory_order_relaxed);
+}
+
+auto SF2ML::IsTraceEnabled() noexcept -> bool {
+	return trace::enabled.load(std::memory_order_relaxed);
+}
+
+auto SF2ML::FlushTrace(std::ostream& os) -> SF2MLError {
+	Registry& registry = GetRegistry();
+	std::lock_guard lock(registry.mutex);
+	const long pid = ProcessId();
+
+	os << "{\"traceEvents\":[";
+	bool first = true;
+	std::vector<trace::Event> events;
+	for (const auto& ring : registry.rings) {
+		const std::uint64_t capacity = ring->mask + 1;
+		const std::uint64_t written = ring->written.load(std::memory_order_acquire);
+		const std::uint64_t begin = std::max(ring->flushed, written > capacity ? written - capacity : 0);
+		events.clear();
+		for (std::uint64_t n = begin; n < written; n++) {
+			Slot& slot = ring->slots[n & ring->mask];
+			if (slot.seq.load(std::memory_order_acquire) != n + 1) {
+				continue; // already overwritten
+			}
+			trace::Event& event = slot.event;
+			const trace::Event copy { Load(event.name), Load(event.arg_name), Load(event.begin_ns), Load(event.dur_ns), Load(event.arg) };
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.seq.load(std::memory_order_relaxed) == n + 1) {
+				events.push_back(copy);
+			}
+		}
+		ring->flushed = written;
+
+		for (auto it = events.begin(); it != events.end(); ++it) {
+			os << (first ? "\n" : ",\n") << "{\"name\":\"" << it->name << "\",\"cat\":\"sf2ml\",\"ph\":\"X\",\"ts\":";
+			WriteMicros(os, it->begin_ns);
+			os << ",\"dur\":";
+			WriteMicros(os, it->dur_ns);
+			os << ",\"pid\":" << pid << ",\"tid\":" << ring->tid;
+			if (it->arg_name) {
+				os << ",\"args\":{\"" << it->arg_name << "\":" << it->arg << '}';
+			}
+			os << '}';
+			first = false;
+		}
+	}
+	os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+	return os ? SF2ML_SUCCESS : SF2ML_FAILED;
+}
@@ -0,0 +1,56 @@
+#ifndef SF2ML_SFTRACING_HPP_
+#define SF2ML_SFTRACING_HPP_
+
+#include <sftrace.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+// Trace events of the library (see sftrace.hpp). Operations open a Scope, which records one complete event
+// into the ring of the calling thread when it closes.
+namespace SF2ML::trace {
+	struct Event {
+		const char* name;
+		const char* arg_name;  // nullptr: no argument
+		std::uint64_t begin_ns;
+		std::uint64_t dur_ns;
+		std::int64_t arg;
+	};
+
+	extern std::atomic<bool> enabled;
+
+	auto Now() noexcept -> std::uint64_t;
+
+	// records the event [begin_ns, now) into the ring of this thread
+	void Record(const char* name, std::uint64_t begin_ns, const char* arg_name, std::int64_t arg) noexcept;
+
+	/// Records the time between its construction and its destruction, when tracing is enabled at construction.
+	/// name(and arg_name) must be string literals.
+	class Scope {
+	public:
+		explicit Scope(const char* name) noexcept : Scope(name, nullptr, 0) {}
+		Scope(const char* name, const char* arg_name, std::int64_t arg) noexcept {
+			if (enabled.load(std::memory_order_relaxed)) [[unlikely]] {
+				this->name = name;
+				this->arg_name = arg_name;
+				this->arg = arg;
+				begin_ns = Now();
+			}
+		}
+		~Scope() {
+			if (name) [[unlikely]] {
+				Record(name, begin_ns, arg_name, arg);
+			}
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* name = nullptr;
+		const char* arg_name = nullptr;
+		std::int64_t arg = 0;
+		std::uint64_t begin_ns = 0;
+	};
+}
+
+#endif
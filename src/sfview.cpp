@@ -0,0 +1,223 @@
+#include <sfview.hpp>
+#include "sffilemap.hpp"
+#include "sfmap.hpp"
+#include "sftracing.hpp"
+
+#include <cstring>
+#include <utility>
+
+using namespace SF2ML;
+
+namespace {
+	// the records of the chunk at ck(its head), which must hold at least the terminal record
+	template <typename RecordT>
+	SF2MLError MapRecords(std::span<const RecordT>& dst, const BYTE* ck) {
+		if (!ck) {
+			return SF2ML_FAILED;
+		}
+		ChunkHead head;
+		std::memcpy(&head, ck, sizeof(head));
+		if (head.ck_size % sizeof(RecordT) != 0) {
+			return SF2ML_INVALID_CK_SIZE;
+		}
+		if (head.ck_size == 0) {
+			return SF2ML_MISSING_TERMINAL_RECORD;
+		}
+		dst = { reinterpret_cast<const RecordT*>(ck + sizeof(ChunkHead)), head.ck_size / sizeof(RecordT) };
+		return SF2ML_SUCCESS;
+	}
+
+	std::span<const BYTE> ChunkData(const BYTE* ck) {
+		if (!ck) {
+			return {};
+		}
+		ChunkHead head;
+		std::memcpy(&head, ck, sizeof(head));
+		return { ck + sizeof(ChunkHead), head.ck_size };
+	}
+
+	// records [first, last) of the chunk, where first and last come from the file
+	template <typename RecordT>
+	std::span<const RecordT> Slice(std::span<const RecordT> records, std::size_t first, std::size_t last) noexcept {
+		if (first > last || last > records.size()) {
+			return {};
+		}
+		return records.subspan(first, last - first);
+	}
+}
+
+SoundFontView::~SoundFontView() {
+	Close();
+}
+
+SoundFontView::SoundFontView(SoundFontView&& other) noexcept {
+	*this = std::move(other);
+}
+
+SoundFontView& SoundFontView::operator=(SoundFontView&& other) noexcept {
+	if (this != &other) {
+		Close();
+		mapping = std::exchange(other.mapping, {});
+		phdr = std::exchange(other.phdr, {});
+		pbag = std::exchange(other.pbag, {});
+		pmod = std::exchange(other.pmod, {});
+		pgen = std::exchange(other.pgen, {});
+		inst = std::exchange(other.inst, {});
+		ibag = std::exchange(other.ibag, {});
+		imod = std::exchange(other.imod, {});
+		igen = std::exchange(other.igen, {});
+		shdr = std::exchange(other.shdr, {});
+		smpl = std::exchange(other.smpl, {});
+		sm24 = std::exchange(other.sm24, {});
+	}
+	return *this;
+}
+
+auto SoundFontView::Open(const std::filesystem::path& path) -> SF2MLError {
+	trace::Scope trace("OpenView");
+	Close();
+	FileMapping file;
+	if (auto err = MapFile(path, file)) {
+		return err;
+	}
+	mapping = { file.address, file.size, file.handle };
+
+	SF2MLError err = MapChunks({ static_cast<const BYTE*>(mapping.address), mapping.size });
+	if (err) {
+		Close();
+	}
+	return err;
+}
+
+auto SoundFontView::Open(std::span<const BYTE> file) -> SF2MLError {
+	trace::Scope trace("OpenView");
+	Close();
+	SF2MLError err = MapChunks(file);
+	if (err) {
+		Close();
+	}
+	return err;
+}
+
+void SoundFontView::Close() noexcept {
+	Unmap();
+	phdr = {};
+	pbag = {};
+	pmod = {};
+	pgen = {};
+	inst = {};
+	ibag = {};
+	imod = {};
+	igen = {};
+	shdr = {};
+	smpl = {};
+	sm24 = {};
+}
+
+void SoundFontView::Unmap() noexcept {
+	FileMapping file { mapping.address, mapping.size, mapping.handle };
+	UnmapFile(file);
+	mapping = {};
+}
+
+auto SoundFontView::MapChunks(std::span<const BYTE> file) -> SF2MLError {
+	if (file.size() < sizeof(ChunkHead)) {
+		return SF2ML_FAILED;
+	}
+	ChunkHead riff_head;
+	std::memcpy(&riff_head, file.data(), sizeof(riff_head));
+	if (!CheckFOURCC(riff_head.ck_id, "RIFF") || riff_head.ck_size > file.size() - sizeof(ChunkHead)) {
+		return SF2ML_FAILED;
+	}
+
+	SfbkMap sfbk;
+	if (auto err = GetSfbkMap(sfbk, file.data() + sizeof(ChunkHead), riff_head.ck_size)) {
+		return err;
+	}
+	const auto& pdta = sfbk.pdta;
+	for (auto err : { MapRecords(phdr, pdta.phdr), MapRecords(pbag, pdta.pbag), MapRecords(pmod, pdta.pmod),
+					  MapRecords(pgen, pdta.pgen), MapRecords(inst, pdta.inst), MapRecords(ibag, pdta.ibag),
+					  MapRecords(imod, pdta.imod), MapRecords(igen, pdta.igen), MapRecords(shdr, pdta.shdr) }) {
+		if (err) {
+			return err;
+		}
+	}
+	smpl = ChunkData(sfbk.sdta.smpl);
+	if (!smpl.empty()) {
+		sm24 = ChunkData(sfbk.sdta.sm24);
+	}
+	return SF2ML_SUCCESS;
+}
+
+auto SoundFontView::PresetBags(std::size_t preset) const noexcept -> std::span<const spec::SfPresetBag> {
+	if (preset + 1 >= phdr.size()) {
+		return {};
+	}
+	// the bags of the zones, and the next one for their ends
+	const auto bags = Slice(pbag, phdr[preset].w_preset_bag_ndx, std::size_t(phdr[preset + 1].w_preset_bag_ndx) + 1);
+	return bags.empty() ? bags : bags.first(bags.size() - 1);
+}
+
+auto SoundFontView::PresetGenerators(std::size_t bag) const noexcept -> std::span<const spec::SfGenList> {
+	if (bag + 1 >= pbag.size()) {
+		return {};
+	}
+	return Slice(pgen, pbag[bag].w_gen_ndx, pbag[bag + 1].w_gen_ndx);
+}
+
+auto SoundFontView::PresetModulators(std::size_t bag) const noexcept -> std::span<const spec::SfModList> {
+	if (bag + 1 >= pbag.size()) {
+		return {};
+	}
+	return Slice(pmod, pbag[bag].w_mod_ndx, pbag[bag + 1].w_mod_ndx);
+}
+
+auto SoundFontView::InstrumentBags(std::size_t inst_no) const noexcept -> std::span<const spec::SfInstBag> {
+	if (inst_no + 1 >= inst.size()) {
+		return {};
+	}
+	const auto bags = Slice(ibag, inst[inst_no].w_inst_bag_ndx, std::size_t(inst[inst_no + 1].w_inst_bag_ndx) + 1);
+	return bags.empty() ? bags : bags.first(bags.size() - 1);
+}
+
+auto SoundFontView::InstrumentGenerators(std::size_t bag) const noexcept -> std::span<const spec::SfInstGenList> {
+	if (bag + 1 >= ibag.size()) {
+		return {};
+	}
+	return Slice(igen, ibag[bag].w_inst_gen_ndx, ibag[bag + 1].w_inst_gen_ndx);
+}
+
+auto SoundFontView::InstrumentModulators(std::size_t bag) const noexcept -> std::span<const spec::SfInstModList> {
+	if (bag + 1 >= ibag.size()) {
+		return {};
+	}
+	return Slice(imod, ibag[bag].w_inst_mod_ndx, ibag[bag + 1].w_inst_mod_ndx);
+}
+
+auto SoundFontView::SampleData(std::size_t sample) const noexcept -> std::span<const BYTE> {
+	if (sample >= SampleCount() || IsRomSample(shdr[sample].sf_sample_type)) {
+		return {};
+	}
+	const std::size_t start = shdr[sample].dw_start;
+	const std::size_t end = shdr[sample].dw_end;
+	if (start > end || end > smpl.size() / 2) {
+		return {};
+	}
+	return smpl.subspan(start * 2, (end - start) * 2);
+}
+
+auto SoundFontView::SampleData24(std::size_t sample) const noexcept -> std::span<const BYTE> {
+	if (sample >= SampleCount() || IsRomSample(shdr[sample].sf_sample_type)) {
+		return {};
+	}
+	return Slice(sm24, shdr[sample].dw_start, shdr[sample].dw_end);
+}
+
+auto SoundFontView::FindPreset(std::uint16_t bank, std::uint16_t program) const noexcept -> std::optional<std::size_t> {
+	for (std::size_t i = 0; i < PresetCount(); i++) {
+		if (phdr[i].w_bank == bank && phdr[i].w_preset == program) {
+			return i;
+		}
+	}
+	return std::nullopt;
+}
@@ -0,0 +1,31 @@
+# sf2ml_embed(<target> <bank.sf2> NAME <identifier> [NAMESPACE <identifier>] [TOOL <sf2ml-embed>])
+#
+# Compiles the bank into <target>: sf2ml-embed writes <name>.hpp and <name>.cpp
+# into ${CMAKE_CURRENT_BINARY_DIR}/sf2ml_embed (regenerated when the bank changes),
+# the source is added to the target and the directory to its include path.
+# TOOL defaults to the sf2ml-embed target of this project.
+function(sf2ml_embed target bank)
+	cmake_parse_arguments(PARSE_ARGV 2 ARG "" "NAME;NAMESPACE;TOOL" "")
+	if (NOT ARG_NAME)
+		message(FATAL_ERROR "sf2ml_embed: NAME is required")
+	endif()
+	if (NOT ARG_TOOL)
+		set(ARG_TOOL sf2ml-embed)
+	endif()
+	set(namespace_args)
+	if (ARG_NAMESPACE)
+		set(namespace_args --namespace ${ARG_NAMESPACE})
+	endif()
+
+	get_filename_component(bank "${bank}" ABSOLUTE)
+	set(out_dir "${CMAKE_CURRENT_BINARY_DIR}/sf2ml_embed")
+	add_custom_command(
+		OUTPUT "${out_dir}/${ARG_NAME}.hpp" "${out_dir}/${ARG_NAME}.cpp"
+		COMMAND ${ARG_TOOL} "${bank}" --name ${ARG_NAME} ${namespace_args} -o "${out_dir}"
+		DEPENDS "${bank}" ${ARG_TOOL}
+		COMMENT "Embedding ${bank} as ${ARG_NAME}"
+		VERBATIM
+	)
+	target_sources(${target} PRIVATE "${out_dir}/${ARG_NAME}.hpp" "${out_dir}/${ARG_NAME}.cpp")
+	target_include_directories(${target} PRIVATE "${out_dir}")
+endfunction()
@@ -0,0 +1,181 @@
+// sf2ml-embed: compiles a bank into C++ source, for programs that ship their bank inside the executable.
+// The bank is frozen (see sffrozen.hpp) and its cache image written as a 64-byte aligned constexpr array;
+// FrozenSoundFont::FromImage reads it in place at run time: no file, no parsing, no copy of the samples.
+//
+// usage: sf2ml-embed bank.sf2 --name piano [--namespace banks] -o out_dir
+//        writes out_dir/piano.hpp and out_dir/piano.cpp (see SF2MLEmbed.cmake for the CMake function)
+
+#include <SF2ML/sffrozen.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using namespace SF2ML;
+
+namespace {
+	struct Config {
+		std::string input;
+		std::string name;
+		std::string name_space;
+		std::string output;
+	};
+
+	bool IsIdentifier(std::string_view name) {
+		if (name.empty() || (name[0] >= '0' && name[0] <= '9')) {
+			return false;
+		}
+		for (char c : name) {
+			if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ParseArgs(int argc, char** argv, Config& config) {
+		for (int i = 1; i < argc; i++) {
+			const std::string_view arg = argv[i];
+			if (!arg.starts_with('-')) {
+				if (!config.input.empty()) {
+					return false;
+				}
+				config.input = arg;
+				continue;
+			}
+
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+			if (!value) {
+				return false;
+			}
+			if (arg == "--name") {
+				config.name = value;
+			} else if (arg == "--namespace") {
+				config.name_space = value;
+			} else if (arg == "-o" || arg == "--output") {
+				config.output = value;
+			} else {
+				return false;
+			}
+			i++;
+		}
+		return !config.input.empty() && IsIdentifier(config.name) && !config.output.empty() &&
+			   (config.name_space.empty() || IsIdentifier(config.name_space));
+	}
+
+	void WriteHeader(std::ostream& os, const Config& config, std::size_t image_size) {
+		std::string guard = "SF2ML_EMBED_" + config.name + "_HPP_";
+		for (char& c : guard) {
+			if (c >= 'a' && c <= 'z') {
+				c = static_cast<char>(c - 'a' + 'A');
+			}
+		}
+		os << "// generated by sf2ml-embed from " << std::filesystem::path(config.input).filename().string()
+		   << "; do not edit\n"
+		   << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+		   << "#include <SF2ML/sffrozen.hpp>\n\n"
+		   << "#include <cstddef>\n#include <memory_resource>\n#include <span>\n\n";
+		if (!config.name_space.empty()) {
+			os << "namespace " << config.name_space << " {\n";
+		}
+		os << "\t/// size of the cache image of the bank, in bytes\n"
+		   << "\tinline constexpr std::size_t " << config.name << "_image_size = " << image_size << ";\n\n"
+		   << "\t/// the cache image of the bank(64-byte aligned, static storage)\n"
+		   << "\tauto " << config.name << "_image() noexcept -> std::span<const SF2ML::BYTE>;\n\n"
+		   << "\t/// @brief the bank, read in place from its image(see SF2ML::FrozenSoundFont::FromImage)\n"
+		   << "\tauto " << config.name << "(std::pmr::memory_resource* resource = std::pmr::get_default_resource())\n"
+		   << "\t\t-> SF2ML::SF2MLResult<SF2ML::FrozenSoundFont>;\n";
+		if (!config.name_space.empty()) {
+			os << "}\n";
+		}
+		os << "\n#endif\n";
+	}
+
+	void WriteSource(std::ostream& os, const Config& config, std::string_view image) {
+		static constexpr char digits[] = "0123456789abcdef";
+		os << "// generated by sf2ml-embed from " << std::filesystem::path(config.input).filename().string()
+		   << "; do not edit\n"
+		   << "#include \"" << config.name << ".hpp\"\n\n";
+		if (!config.name_space.empty()) {
+			os << "namespace " << config.name_space << " {\n";
+		}
+		os << "\tnamespace {\n"
+		   << "\t\talignas(64) constexpr SF2ML::BYTE embedded_image[" << config.name << "_image_size] = {";
+		std::string line;
+		for (std::size_t i = 0; i < image.size(); i++) {
+			if (i % 32 == 0) {
+				os << line << "\n\t\t\t";
+				line.clear();
+			}
+			const auto byte = static_cast<unsigned char>(image[i]);
+			line += "0x";
+			line += digits[byte >> 4];
+			line += digits[byte & 0xF];
+			line += ',';
+		}
+		os << line << "\n\t\t};\n\t}\n\n"
+		   << "\tauto " << config.name << "_image() noexcept -> std::span<const SF2ML::BYTE> {\n"
+		   << "\t\treturn embedded_image;\n\t}\n\n"
+		   << "\tauto " << config.name << "(std::pmr::memory_resource* resource) -> SF2ML::SF2MLResult<SF2ML::FrozenSoundFont> {\n"
+		   << "\t\treturn SF2ML::FrozenSoundFont::FromImage(embedded_image, resource);\n\t}\n";
+		if (!config.name_space.empty()) {
+			os << "}\n";
+		}
+	}
+
+	bool WriteFile(const std::filesystem::path& path, const std::string& contents) {
+		std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+		return ofs.write(contents.data(), std::streamsize(contents.size())) && ofs.flush();
+	}
+}
+
+int main(int argc, char** argv) {
+	Config config;
+	if (!ParseArgs(argc, argv, config)) {
+		std::cerr << "usage: " << argv[0] << " bank.sf2 --name identifier [--namespace identifier] -o out_dir" << std::endl;
+		return 1;
+	}
+
+	SoundFont sf2;
+	std::ifstream ifs(config.input, std::ios::binary);
+	if (!ifs) {
+		std::cerr << "error: cannot open " << config.input << std::endl;
+		return 1;
+	}
+	if (auto err = sf2.Load(ifs)) {
+		std::cerr << "error: failed to load " << config.input << ": " << ToStringView(err) << std::endl;
+		return 1;
+	}
+	// an image is never checked against its bank(FromImage takes no key): a zero key keeps the output
+	// independent of the time the bank was written, so that builds are reproducible
+	std::ostringstream image_stream;
+	if (auto err = sf2.Freeze().SaveCache(image_stream, SfCacheKey{})) {
+		std::cerr << "error: failed to freeze the bank: " << ToStringView(err) << std::endl;
+		return 1;
+	}
+	const std::string image = std::move(image_stream).str();
+
+	const std::filesystem::path dir = config.output;
+	std::error_code ec;
+	std::filesystem::create_directories(dir, ec);
+	std::ostringstream header;
+	std::ostringstream source;
+	WriteHeader(header, config, image.size());
+	WriteSource(source, config, image);
+	for (const auto& [path, contents] : { std::pair{ dir / (config.name + ".hpp"), header.str() },
+										  std::pair{ dir / (config.name + ".cpp"), source.str() } }) {
+		if (!WriteFile(path, contents)) {
+			std::cerr << "error: cannot write " << path.string() << std::endl;
+			return 1;
+		}
+	}
+	std::cerr << config.input << ": " << sf2.Presets().size() << " presets, " << sf2.Samples().size()
+			  << " samples, " << image.size() << " bytes embedded as " << (dir / config.name).string()
+			  << ".cpp" << std::endl;
+	return 0;
+}
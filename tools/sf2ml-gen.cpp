@@ -0,0 +1,137 @@
+// sf2ml-gen: writes deterministic synthetic banks (see sfsynth.hpp) for load testing.
+// The sample points are produced while saving, so banks of several GB take little memory.
+//
+// usage: sf2ml-gen [--seed 1] [--instruments 1] [--zones-per-inst 100] [--mod-chain 0] [--presets 0]
+//                  [--samples 256] [--points 20480] [--bits 16|24] [--stereo] [--in-memory] [--max-indexes]
+//                  -o bank.sf2
+
+#include <SF2ML/sfsynth.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace SF2ML;
+
+namespace {
+	struct Config {
+		SfSynthSpec spec;
+		bool max_indexes = false;
+		std::string output;
+	};
+
+	std::uint32_t ParseU32(const char* arg) {
+		return static_cast<std::uint32_t>(std::strtoul(arg, nullptr, 10));
+	}
+
+	bool ParseArgs(int argc, char** argv, Config& config) {
+		for (int i = 1; i < argc; i++) {
+			const std::string_view arg = argv[i];
+			if (arg == "--stereo") {
+				config.spec.stereo = true;
+				continue;
+			} else if (arg == "--in-memory") {
+				config.spec.stream_samples = false;
+				continue;
+			} else if (arg == "--max-indexes") {
+				config.max_indexes = true;
+				continue;
+			}
+
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+			if (!value) {
+				return false;
+			}
+			if (arg == "--seed") {
+				config.spec.seed = std::strtoull(value, nullptr, 10);
+			} else if (arg == "--instruments") {
+				config.spec.instruments = ParseU32(value);
+			} else if (arg == "--zones-per-inst") {
+				config.spec.zones_per_instrument = ParseU32(value);
+			} else if (arg == "--mod-chain") {
+				config.spec.modulator_chain = ParseU32(value);
+			} else if (arg == "--presets") {
+				config.spec.presets = ParseU32(value);
+			} else if (arg == "--samples") {
+				config.spec.samples = ParseU32(value);
+			} else if (arg == "--points") {
+				config.spec.sample_points = ParseU32(value);
+			} else if (arg == "--bits") {
+				config.spec.bit_depth = ParseU32(value) == 24 ? SampleBitDepth::Signed24 : SampleBitDepth::Signed16;
+			} else if (arg == "-o" || arg == "--output") {
+				config.output = value;
+			} else {
+				return false;
+			}
+			i++;
+		}
+		return !config.output.empty();
+	}
+
+	// size of the sample data in the file (smpl and sm24 chunks, with the 46 zero points after each sample)
+	std::uint64_t SampleDataSize(const SfSynthSpec& spec) {
+		const std::uint64_t samples = std::uint64_t(spec.samples) * (spec.stereo ? 2 : 1);
+		const std::uint64_t points = samples * (spec.sample_points + 23);
+		return points * (spec.bit_depth == SampleBitDepth::Signed16 ? 2 : 3);
+	}
+}
+
+int main(int argc, char** argv) {
+	Config config;
+	if (!ParseArgs(argc, argv, config)) {
+		std::cerr << "usage: " << argv[0]
+				  << " [--seed 1] [--instruments 1] [--zones-per-inst 100] [--mod-chain 0] [--presets 0]"
+					 " [--samples 256] [--points 20480] [--bits 16|24] [--stereo] [--in-memory] [--max-indexes]"
+					 " -o bank.sf2" << std::endl;
+		return 1;
+	}
+	SfSynthSpec spec = config.max_indexes ? MaximizeSynthIndexes(config.spec) : config.spec;
+
+	// RIFF sizes are 32 bit; leave room for the pdta chunk
+	if (SampleDataSize(spec) > 0xFFFFFFFFull - (64u << 20)) {
+		std::cerr << "error: the sample data does not fit in a RIFF file (4 GiB)" << std::endl;
+		return 1;
+	}
+	if (!SynthFitsFileIndexes(spec)) {
+		std::cerr << "error: the bank exceeds the 16-bit indexes of the format"
+					 " (--max-indexes gives the largest one that fits)" << std::endl;
+		return 1;
+	}
+
+	const auto t0 = std::chrono::steady_clock::now();
+	SoundFont sf2;
+	if (auto err = BuildSynthBank(sf2, spec)) {
+		std::cerr << "error: failed to build the bank: " << ToStringView(err) << std::endl;
+		return 1;
+	}
+	const auto t1 = std::chrono::steady_clock::now();
+	SfSaveStats save_stats;
+	{
+		std::ofstream ofs(config.output, std::ios::binary);
+		if (!ofs) {
+			std::cerr << "error: cannot open " << config.output << std::endl;
+			return 1;
+		}
+		if (auto err = sf2.Save(ofs, save_stats)) {
+			std::cerr << "error: failed to save the bank: " << ToStringView(err) << std::endl;
+			return 1;
+		}
+	}
+
+	const SfSynthRecords records = CountSynthRecords(spec);
+	const auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+	const auto ns_ms = [](std::uint64_t ns) { return double(ns) / 1e6; };
+	std::cerr << config.output << ": " << sf2.GetSavedSize() << " bytes, "
+			  << sf2.Presets().size() << " presets, " << sf2.Instruments().size() << " instruments, "
+			  << spec.InstrumentZones() << " instrument zones, " << sf2.Samples().size() << " samples\n"
+			  << "  records: pbag " << records.preset_bags << ", pgen " << records.preset_gens
+			  << ", ibag " << records.inst_bags << ", imod " << records.inst_mods << ", igen " << records.inst_gens << '\n'
+			  << "  built in " << ms(t1 - t0) << " ms, saved in " << ns_ms(save_stats.total_ns) << " ms"
+			  << " (validate " << ns_ms(save_stats.validate_ns) << ", serialize " << ns_ms(save_stats.serialize_ns)
+			  << ", sdta " << ns_ms(save_stats.sdta_ns) << ", write " << ns_ms(save_stats.write_ns) << "), "
+			  << save_stats.allocations << " allocations" << std::endl;
+	return 0;
+}